@@ -0,0 +1,312 @@
+// Host microbenchmarks for the hot paths of the firmware modules.
+//
+//   bench [name-filter]
+//
+// Host timings only rank alternatives and catch regressions; the ESP32-S3
+// is an in-order 240 MHz core, so absolute numbers do not transfer.
+
+#include "api_json.h"
+#include "mjpeg_framing.h"
+#include "motion_kernel.h"
+#include "nh3_model.h"
+#include "pgm.h"
+#include "sht30.h"
+#include "signal_filter.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MIN_RUN_NS 200000000LL // Repeat each benchmark for at least 0.2 s
+
+typedef struct {
+  const char *name;
+  // Runs the operation iterations times; the result defeats dead-code removal
+  uint32_t (*run)(uint32_t iterations);
+} bench_t;
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint32_t bench_sht30_crc8(uint32_t iterations) {
+  uint8_t word[2] = {0xBE, 0xEF};
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    word[1] = (uint8_t)i;
+    acc += sht30_crc8(word, 2);
+  }
+  return acc;
+}
+
+static uint32_t bench_sht30_parse(uint32_t iterations) {
+  uint8_t frame[6] = {0x66, 0x66, 0, 0x80, 0x00, 0};
+  frame[2] = sht30_crc8(&frame[0], 2);
+  frame[5] = sht30_crc8(&frame[3], 2);
+  float t, rh;
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    acc += sht30_parse(frame, &t, &rh) == ESP_OK;
+  }
+  return acc + (uint32_t)t;
+}
+
+static const sensor_snapshot_t s_snapshot = {
+    .version = 123456,
+    .ammonia_raw = 1234,
+    .ammonia_voltage_mv = 995,
+    .ammonia_variance = 3.5f,
+    .ammonia_ppm = 12.34f,
+    .ammonia_seq = 4321,
+    .ammonia_time_us = 123456789,
+    .temperature = 21.5f,
+    .humidity = 55.2f,
+    .sht30_seq = 1234,
+    .sht30_time_us = 123400000,
+};
+
+static uint32_t bench_api_json_sensors(uint32_t iterations) {
+  char buf[API_JSON_SENSORS_MAX];
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    acc += api_json_sensors(buf, sizeof(buf), &s_snapshot, 123500 + i, true,
+                            true);
+  }
+  return acc;
+}
+
+static uint32_t bench_api_json_ammonia(uint32_t iterations) {
+  char buf[API_JSON_SENSORS_MAX];
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    acc += api_json_ammonia(buf, sizeof(buf), &s_snapshot);
+  }
+  return acc;
+}
+
+static uint32_t bench_mjpeg_part_header(uint32_t iterations) {
+  char buf[MJPEG_PART_HDR_MAX];
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    acc += mjpeg_part_header(buf, 20000 + (i & 0xFFFF));
+  }
+  return acc;
+}
+
+// The snprintf() construction mjpeg_part_header() replaced, for comparison
+static uint32_t bench_mjpeg_part_header_snprintf(uint32_t iterations) {
+  char buf[MJPEG_PART_HDR_MAX];
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    acc += snprintf(buf, sizeof(buf),
+                    "\r\n--%s\r\nContent-Type: image/jpeg\r\n"
+                    "Content-Length: %u\r\n\r\n",
+                    MJPEG_PART_BOUNDARY, 20000 + (i & 0xFFFF));
+  }
+  return acc;
+}
+
+static nh3_model_t s_nh3;
+
+static uint32_t bench_nh3_model_ppm(uint32_t iterations) {
+  float acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    acc += nh3_model_ppm(&s_nh3, 0.25f + (i & 0xFFF) * (7.5f / 4096));
+  }
+  return (uint32_t)acc;
+}
+
+// The powf() evaluation the table replaces, for comparison
+static uint32_t bench_nh3_model_ppm_powf(uint32_t iterations) {
+  float acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    acc += nh3_model_ppm_reference(&s_nh3.params,
+                                   0.25f + (i & 0xFFF) * (7.5f / 4096));
+  }
+  return (uint32_t)acc;
+}
+
+// Luma frames from host/data/motion, as the detector sees them
+#define MOTION_FRAMES 6
+#define MOTION_MAX_PIXELS (160 * 120)
+
+static uint32_t s_luma[MOTION_FRAMES][MOTION_MAX_PIXELS / 4]; // Aligned
+static int s_luma_w;
+static int s_luma_h;
+
+static bool load_motion_frames(void) {
+  for (int f = 0; f < MOTION_FRAMES; f++) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/motion/frame_%02d.pgm", HOST_DATA_DIR,
+             f);
+    if (!pgm_load(path, (uint8_t *)s_luma[f], sizeof(s_luma[f]), &s_luma_w,
+                  &s_luma_h)) {
+      fprintf(stderr, "Cannot load %s\n", path);
+      return false;
+    }
+  }
+  return true;
+}
+
+// One op = one frame pair, consecutive frames in turn
+static uint32_t bench_motion_diff(uint32_t iterations,
+                                  uint32_t (*diff)(const uint8_t *,
+                                                   const uint8_t *, int, int,
+                                                   uint8_t, uint16_t *)) {
+  uint16_t cells[MOTION_MAX_CELLS];
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    int f = 1 + i % (MOTION_FRAMES - 1);
+    acc += diff((const uint8_t *)s_luma[f], (const uint8_t *)s_luma[f - 1],
+                s_luma_w, s_luma_h, 25, cells);
+  }
+  return acc;
+}
+
+static uint32_t bench_motion_diff_ref(uint32_t iterations) {
+  return bench_motion_diff(iterations, motion_diff_cells_ref);
+}
+
+static uint32_t bench_motion_diff_swar(uint32_t iterations) {
+  return bench_motion_diff(iterations, motion_diff_cells_swar);
+}
+
+static uint32_t bench_motion_blobs(uint32_t iterations) {
+  static motion_blob_work_t work;
+  uint16_t cells[MOTION_MAX_CELLS];
+  motion_diff_cells_swar((const uint8_t *)s_luma[3],
+                         (const uint8_t *)s_luma[2], s_luma_w, s_luma_h, 25,
+                         cells);
+  uint32_t acc = 0;
+  int largest;
+  for (uint32_t i = 0; i < iterations; i++) {
+    acc += motion_count_blobs(cells, s_luma_w / MOTION_CELL_W,
+                              s_luma_h / MOTION_CELL_H, 8, &work, &largest);
+  }
+  return acc + largest;
+}
+
+// One MQ-137 read: 500 ms at 1 kHz, median over windows of 15 (the
+// mq137_adc defaults); noise around a level with occasional spikes
+#define ADC_BLOCK 500
+#define ADC_MEDIAN_WINDOW 15
+
+static uint16_t s_adc_block[ADC_BLOCK];
+
+static void fill_adc_block(void) {
+  uint32_t x = 1;
+  for (int i = 0; i < ADC_BLOCK; i++) {
+    x = x * 1103515245u + 12345u;
+    s_adc_block[i] = 1500 + (x >> 16) % 16 + ((x >> 20) % 20 == 0 ? 2000 : 0);
+  }
+}
+
+static int cmp_u16(const void *a, const void *b) {
+  return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+// One op = one block; the copy stands in for the fresh DMA frame
+static uint32_t bench_median(uint32_t iterations, bool use_qsort) {
+  uint16_t block[ADC_BLOCK];
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    memcpy(block, s_adc_block, sizeof(block));
+    for (int off = 0; off < ADC_BLOCK; off += ADC_MEDIAN_WINDOW) {
+      int len = ADC_BLOCK - off < ADC_MEDIAN_WINDOW ? ADC_BLOCK - off
+                                                    : ADC_MEDIAN_WINDOW;
+      if (use_qsort) {
+        qsort(&block[off], len, sizeof(uint16_t), cmp_u16);
+        acc += block[off + len / 2];
+      } else {
+        acc += filter_median(&block[off], len);
+      }
+    }
+  }
+  return acc;
+}
+
+static uint32_t bench_filter_median(uint32_t iterations) {
+  return bench_median(iterations, false);
+}
+
+// Sorting each window, for comparison
+static uint32_t bench_filter_median_qsort(uint32_t iterations) {
+  return bench_median(iterations, true);
+}
+
+static uint32_t bench_filter_iir(uint32_t iterations) {
+  filter_iir_t iir;
+  filter_iir_init(&iir, 6);
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    acc += filter_iir_update(&iir, s_adc_block, ADC_BLOCK);
+  }
+  return acc;
+}
+
+static uint32_t bench_filter_stats(uint32_t iterations) {
+  filter_stats_t stats;
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    filter_stats_reset(&stats);
+    filter_stats_add(&stats, s_adc_block, ADC_BLOCK);
+    acc += (uint32_t)filter_stats_mean(&stats) +
+           (uint32_t)filter_stats_variance(&stats);
+  }
+  return acc;
+}
+
+static const bench_t s_benches[] = {
+    {"sht30_crc8", bench_sht30_crc8},
+    {"sht30_parse", bench_sht30_parse},
+    {"api_json_sensors", bench_api_json_sensors},
+    {"api_json_ammonia", bench_api_json_ammonia},
+    {"mjpeg_part_header", bench_mjpeg_part_header},
+    {"mjpeg_part_header_snprintf", bench_mjpeg_part_header_snprintf},
+    {"nh3_model_ppm", bench_nh3_model_ppm},
+    {"nh3_model_ppm_powf", bench_nh3_model_ppm_powf},
+    {"motion_diff_cells_ref", bench_motion_diff_ref},
+    {"motion_diff_cells_swar", bench_motion_diff_swar},
+    {"motion_count_blobs", bench_motion_blobs},
+    {"filter_median_block", bench_filter_median},
+    {"filter_median_block_qsort", bench_filter_median_qsort},
+    {"filter_iir_block", bench_filter_iir},
+    {"filter_stats_block", bench_filter_stats},
+};
+
+int main(int argc, char **argv) {
+  const char *filter = argc > 1 ? argv[1] : NULL;
+  nh3_model_params_t nh3_params = NH3_MODEL_DEFAULT_PARAMS();
+  nh3_model_init(&s_nh3, &nh3_params);
+  fill_adc_block();
+  if (!load_motion_frames()) {
+    return 1;
+  }
+  volatile uint32_t sink = 0;
+
+  printf("%-32s %12s %14s\n", "benchmark", "ns/op", "iterations");
+  for (size_t i = 0; i < sizeof(s_benches) / sizeof(s_benches[0]); i++) {
+    const bench_t *b = &s_benches[i];
+    if (filter != NULL && strstr(b->name, filter) == NULL) {
+      continue;
+    }
+    // Double the count until one run is long enough to time reliably
+    uint32_t n = 1;
+    int64_t elapsed;
+    while (true) {
+      int64_t start = now_ns();
+      sink += b->run(n);
+      elapsed = now_ns() - start;
+      if (elapsed >= MIN_RUN_NS || n >= (1u << 30)) {
+        break;
+      }
+      n *= 2;
+    }
+    printf("%-32s %12.1f %14u\n", b->name, (double)elapsed / n, n);
+  }
+  (void)sink;
+  return 0;
+}
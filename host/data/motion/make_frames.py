@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+"""Synthetic stand-ins for recorded motion-detector input.
+
+The firmware decodes camera frames at 1/8 scale, so a VGA stream gives
+80x60 luma images. These frames imitate that: a lit coop wall with a
+perch, sensor noise of a few levels, and a dark hen-sized shape that
+stands still in frames 0-1 and walks across frames 2-5. Replace them
+with real dumps (binary PGM, same names) when some are captured; the
+test and benchmark only assume the still/moving split above.
+
+    python3 make_frames.py   # rewrites frame_00.pgm ... frame_05.pgm
+"""
+
+import os
+import random
+
+W, H = 80, 60
+FRAMES = 6
+NOISE = 6  # +- luma levels
+
+
+def background(x, y):
+    v = 70 + x + y // 2  # Light falling in from one side
+    if 38 <= y < 41:
+        v = 40  # Perch
+    return v
+
+
+def hen(x, y, cx, cy):
+    dx, dy = (x - cx) / 9.0, (y - cy) / 6.0
+    return dx * dx + dy * dy <= 1.0
+
+
+def main():
+    rng = random.Random(20260115)
+    here = os.path.dirname(os.path.abspath(__file__))
+    for f in range(FRAMES):
+        cx = 20 if f < 2 else 20 + (f - 1) * 8
+        pixels = bytearray()
+        for y in range(H):
+            for x in range(W):
+                v = 35 if hen(x, y, cx, 30) else background(x, y)
+                v += rng.randint(-NOISE, NOISE)
+                pixels.append(max(0, min(255, v)))
+        path = os.path.join(here, "frame_%02d.pgm" % f)
+        with open(path, "wb") as out:
+            out.write(b"P5\n%d %d\n255\n" % (W, H))
+            out.write(pixels)
+
+
+if __name__ == "__main__":
+    main()
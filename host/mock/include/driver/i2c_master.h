@@ -0,0 +1,69 @@
+#ifndef I2C_MASTER_H
+#define I2C_MASTER_H
+
+// Host build: transfers go to the simulated devices attached with
+// mock_i2c_attach() (mock_hal.h)
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct mock_i2c_bus *i2c_master_bus_handle_t;
+typedef struct mock_i2c_dev *i2c_master_dev_handle_t;
+typedef int i2c_port_num_t;
+
+typedef enum {
+  I2C_CLK_SRC_DEFAULT = 0,
+} i2c_clock_source_t;
+
+typedef enum {
+  I2C_ADDR_BIT_LEN_7 = 0,
+  I2C_ADDR_BIT_LEN_10,
+} i2c_addr_bit_len_t;
+
+typedef struct {
+  i2c_port_num_t i2c_port;
+  int sda_io_num;
+  int scl_io_num;
+  i2c_clock_source_t clk_source;
+  uint8_t glitch_ignore_cnt;
+  int intr_priority;
+  size_t trans_queue_depth;
+  struct {
+    uint32_t enable_internal_pullup : 1;
+  } flags;
+} i2c_master_bus_config_t;
+
+typedef struct {
+  i2c_addr_bit_len_t dev_addr_length;
+  uint16_t device_address;
+  uint32_t scl_speed_hz;
+  uint32_t scl_wait_us;
+  struct {
+    uint32_t disable_ack_check : 1;
+  } flags;
+} i2c_device_config_t;
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *config,
+                             i2c_master_bus_handle_t *out);
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus);
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus,
+                                    const i2c_device_config_t *config,
+                                    i2c_master_dev_handle_t *out);
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev);
+
+esp_err_t i2c_master_get_bus_handle(i2c_port_num_t port,
+                                    i2c_master_bus_handle_t *out);
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus, uint16_t address,
+                           int xfer_timeout_ms);
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev,
+                              const uint8_t *data, size_t len,
+                              int xfer_timeout_ms);
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t *data,
+                             size_t len, int xfer_timeout_ms);
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev,
+                                      const uint8_t *wdata, size_t wlen,
+                                      uint8_t *rdata, size_t rlen,
+                                      int xfer_timeout_ms);
+
+#endif // I2C_MASTER_H
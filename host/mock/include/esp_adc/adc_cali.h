@@ -0,0 +1,15 @@
+#ifndef ADC_CALI_H
+#define ADC_CALI_H
+
+#include "esp_adc/adc_continuous.h"
+
+typedef struct mock_adc_cali *adc_cali_handle_t;
+
+// Linear over 12 bits to MOCK_ADC_CALI_FULL_SCALE_MV, which differs from
+// the 3300 mV the firmware assumes without calibration
+#define MOCK_ADC_CALI_FULL_SCALE_MV 3100
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw,
+                                  int *voltage_mv);
+
+#endif // ADC_CALI_H
@@ -0,0 +1,18 @@
+#ifndef ADC_CALI_SCHEME_H
+#define ADC_CALI_SCHEME_H
+
+#include "esp_adc/adc_cali.h"
+
+typedef struct {
+  adc_unit_t unit_id;
+  adc_channel_t chan;
+  adc_atten_t atten;
+  adc_bitwidth_t bitwidth;
+} adc_cali_curve_fitting_config_t;
+
+// Fails with ESP_ERR_NOT_SUPPORTED after mock_adc_set_cali(false)
+esp_err_t
+adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t *cfg,
+                                     adc_cali_handle_t *out);
+
+#endif // ADC_CALI_SCHEME_H
@@ -0,0 +1,42 @@
+#ifndef ESP_CAMERA_H
+#define ESP_CAMERA_H
+
+// Host build: esp_camera_fb_get() serves the frames loaded with
+// mock_camera_add_frame() (mock_hal.h) in a loop
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+typedef enum {
+  PIXFORMAT_RGB565,
+  PIXFORMAT_YUV422,
+  PIXFORMAT_GRAYSCALE,
+  PIXFORMAT_JPEG,
+} pixformat_t;
+
+typedef struct {
+  pixformat_t pixel_format;
+  int jpeg_quality;
+  size_t fb_count;
+} camera_config_t;
+
+typedef struct {
+  uint8_t *buf;
+  size_t len;
+  size_t width;
+  size_t height;
+  pixformat_t format;
+  struct timeval timestamp;
+} camera_fb_t;
+
+esp_err_t esp_camera_init(const camera_config_t *config);
+esp_err_t esp_camera_deinit(void);
+
+// NULL while not initialized, with no frames loaded, or when fb_count
+// buffers are already out
+camera_fb_t *esp_camera_fb_get(void);
+void esp_camera_fb_return(camera_fb_t *fb);
+
+#endif // ESP_CAMERA_H
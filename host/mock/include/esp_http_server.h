@@ -0,0 +1,51 @@
+#ifndef ESP_HTTP_SERVER_H
+#define ESP_HTTP_SERVER_H
+
+// Host build: the types the module headers mention, plus the calls the
+// push channel and the module handlers make. Requests are bare sockets
+// (mock_httpd.c); responses other than socket sends are dropped, and no
+// URI handler is registered.
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <sys/types.h>
+
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_INVALID -2
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+
+typedef enum {
+  HTTPD_500_INTERNAL_SERVER_ERROR = 0,
+  HTTPD_400_BAD_REQUEST,
+  HTTPD_404_NOT_FOUND,
+} httpd_err_code_t;
+
+typedef void *httpd_handle_t;
+typedef struct httpd_req httpd_req_t;
+
+struct httpd_req {
+  httpd_handle_t handle;
+  int mock_sockfd; // Connection the request arrived on
+};
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out);
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r);
+int httpd_req_to_sockfd(httpd_req_t *r);
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd);
+int httpd_socket_send(httpd_handle_t hd, int sockfd, const char *buf,
+                      size_t buf_len, int flags);
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status);
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf,
+                                ssize_t buf_len);
+esp_err_t httpd_resp_send_err(httpd_req_t *r, httpd_err_code_t error,
+                              const char *msg);
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field,
+                             const char *value);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf,
+                                      size_t buf_len);
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val,
+                                size_t val_size);
+
+#endif // ESP_HTTP_SERVER_H
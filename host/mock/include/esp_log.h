@@ -0,0 +1,28 @@
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+// Host build: log lines go to stderr, filtered by $HOST_LOG_LEVEL (0-5,
+// default 0 = silent); mock_hal.h can count them
+
+#include "esp_err.h"
+
+typedef enum {
+  ESP_LOG_NONE = 0,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+void mock_log(esp_log_level_t level, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOGE(tag, fmt, ...) mock_log(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) mock_log(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) mock_log(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) mock_log(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...)                                               \
+  mock_log(ESP_LOG_VERBOSE, tag, fmt, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
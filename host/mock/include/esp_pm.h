@@ -0,0 +1,31 @@
+#ifndef ESP_PM_H
+#define ESP_PM_H
+
+// Host build: configuration and locks are only counted; see
+// mock_pm_lock_held() (mock_hal.h)
+
+#include "esp_err.h"
+#include <stdbool.h>
+
+typedef enum {
+  ESP_PM_CPU_FREQ_MAX,
+  ESP_PM_APB_FREQ_MAX,
+  ESP_PM_NO_LIGHT_SLEEP,
+} esp_pm_lock_type_t;
+
+typedef struct {
+  int max_freq_mhz;
+  int min_freq_mhz;
+  bool light_sleep_enable;
+} esp_pm_config_t;
+
+typedef struct mock_pm_lock *esp_pm_lock_handle_t;
+
+esp_err_t esp_pm_configure(const void *config);
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t type, int arg,
+                             const char *name, esp_pm_lock_handle_t *out);
+esp_err_t esp_pm_lock_delete(esp_pm_lock_handle_t handle);
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle);
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle);
+
+#endif // ESP_PM_H
@@ -0,0 +1,11 @@
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+// Host build: monotonic microseconds since start, or the fake clock set
+// through mock_hal.h
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
+
+#endif // ESP_TIMER_H
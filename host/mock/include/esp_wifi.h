@@ -0,0 +1,16 @@
+#ifndef ESP_WIFI_H
+#define ESP_WIFI_H
+
+// Host build: only the power save setting, which is accepted and ignored
+
+#include "esp_err.h"
+
+typedef enum {
+  WIFI_PS_NONE,
+  WIFI_PS_MIN_MODEM,
+  WIFI_PS_MAX_MODEM,
+} wifi_ps_type_t;
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type);
+
+#endif // ESP_WIFI_H
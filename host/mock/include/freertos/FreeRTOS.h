@@ -0,0 +1,43 @@
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+// Host build: FreeRTOS on pthreads (host/mock/mock_freertos.c). One tick
+// is one millisecond.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define configTICK_RATE_HZ 1000
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 2 // As in sdkconfig.defaults
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define pdMS_TO_TICKS(ms)                                                     \
+  ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+// Critical sections: one process-wide recursive lock stands in for the
+// spinlock with interrupts masked
+typedef struct {
+  int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void mock_enter_critical(void);
+void mock_exit_critical(void);
+
+#define portENTER_CRITICAL(mux) ((void)(mux), mock_enter_critical())
+#define portEXIT_CRITICAL(mux) ((void)(mux), mock_exit_critical())
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+
+#endif // INC_FREERTOS_H
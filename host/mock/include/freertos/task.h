@@ -0,0 +1,43 @@
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct mock_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+// Tasks run as detached threads; priority, stack size and core are ignored
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                   uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core);
+
+#define xTaskCreate(fn, name, stack, arg, priority, handle)                   \
+  xTaskCreatePinnedToCore(fn, name, stack, arg, priority, handle,             \
+                          tskNO_AFFINITY)
+
+// Only NULL (the calling task) is supported
+void vTaskDelete(TaskHandle_t task);
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+TickType_t xTaskGetTickCount(void);
+
+// Sleeps, or advances the clock by the delay in fake clock mode
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment);
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+// Notifications; waits always use the real clock
+BaseType_t xTaskNotifyGiveIndexed(TaskHandle_t task, UBaseType_t index);
+uint32_t ulTaskNotifyTakeIndexed(UBaseType_t index, BaseType_t clear,
+                                 TickType_t ticks);
+
+#define xTaskNotifyGive(task) xTaskNotifyGiveIndexed(task, 0)
+#define ulTaskNotifyTake(clear, ticks) ulTaskNotifyTakeIndexed(0, clear, ticks)
+
+#endif // INC_TASK_H
@@ -0,0 +1,20 @@
+#ifndef IMG_CONVERTERS_H
+#define IMG_CONVERTERS_H
+
+// Host build: no JPEG decoder; every decode fails
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  JPG_SCALE_NONE,
+  JPG_SCALE_2X,
+  JPG_SCALE_4X,
+  JPG_SCALE_8X,
+} jpg_scale_t;
+
+bool jpg2rgb565(const uint8_t *src, size_t src_len, uint8_t *out,
+                jpg_scale_t scale);
+
+#endif // IMG_CONVERTERS_H
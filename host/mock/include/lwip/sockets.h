@@ -0,0 +1,17 @@
+#ifndef LWIP_SOCKETS_H
+#define LWIP_SOCKETS_H
+
+// Host build: the lwIP socket calls are the POSIX ones; writev can be cut
+// short with mock_socket_set_write_limit() (mock_hal.h)
+
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+ssize_t mock_writev(int fd, const struct iovec *iov, int iovcnt);
+
+#define lwip_writev mock_writev
+#define lwip_select select
+
+#endif // LWIP_SOCKETS_H
@@ -0,0 +1,11 @@
+#ifndef SOC_CAPS_H
+#define SOC_CAPS_H
+
+// Host build: the ESP32-S3 values used by the firmware
+
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+#define SOC_ADC_DIGI_RESULT_BYTES 4
+#define SOC_ADC_SAMPLE_FREQ_THRES_LOW 611
+#define SOC_ADC_SAMPLE_FREQ_THRES_HIGH 83333
+
+#endif // SOC_CAPS_H
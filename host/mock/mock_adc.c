@@ -0,0 +1,158 @@
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_adc/adc_continuous.h"
+#include "mock_hal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QUEUE_MAX 65536
+
+struct mock_adc_continuous {
+  uint32_t frame_bytes;
+  bool configured;
+  bool running;
+};
+
+struct mock_adc_cali {
+  int unused;
+};
+
+static adc_digi_output_data_t s_queue[QUEUE_MAX];
+static size_t s_head = 0;
+static size_t s_count = 0;
+static bool s_cali_supported = true;
+static adc_continuous_handle_t s_last = NULL;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void mock_adc_feed(adc_unit_t unit, adc_channel_t channel,
+                   const uint16_t *raw, size_t count) {
+  pthread_mutex_lock(&s_lock);
+  for (size_t i = 0; i < count && s_count < QUEUE_MAX; i++) {
+    adc_digi_output_data_t *d = &s_queue[(s_head + s_count++) % QUEUE_MAX];
+    d->val = 0;
+    d->type2.data = raw[i] & 0xFFF;
+    d->type2.channel = channel;
+    d->type2.unit = unit;
+  }
+  pthread_mutex_unlock(&s_lock);
+}
+
+void mock_adc_reset(void) {
+  pthread_mutex_lock(&s_lock);
+  s_head = 0;
+  s_count = 0;
+  s_cali_supported = true;
+  pthread_mutex_unlock(&s_lock);
+}
+
+void mock_adc_set_cali(bool supported) { s_cali_supported = supported; }
+
+bool mock_adc_running(void) { return s_last != NULL && s_last->running; }
+
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t *config,
+                                    adc_continuous_handle_t *out) {
+  if (config->conv_frame_size == 0 ||
+      config->conv_frame_size % sizeof(adc_digi_output_data_t) != 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  *out = calloc(1, sizeof(**out));
+  if (*out == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  (*out)->frame_bytes = config->conv_frame_size;
+  s_last = *out;
+  return ESP_OK;
+}
+
+esp_err_t adc_continuous_config(adc_continuous_handle_t handle,
+                                const adc_continuous_config_t *config) {
+  if (config->format != ADC_DIGI_OUTPUT_FORMAT_TYPE2) {
+    return ESP_ERR_NOT_SUPPORTED; // TYPE2 is the only ESP32-S3 format
+  }
+  if (handle->running || config->pattern_num == 0) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  handle->configured = true;
+  return ESP_OK;
+}
+
+esp_err_t adc_continuous_start(adc_continuous_handle_t handle) {
+  if (!handle->configured || handle->running) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  handle->running = true;
+  return ESP_OK;
+}
+
+esp_err_t adc_continuous_stop(adc_continuous_handle_t handle) {
+  if (!handle->running) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  handle->running = false;
+  return ESP_OK;
+}
+
+esp_err_t adc_continuous_read(adc_continuous_handle_t handle, uint8_t *buf,
+                              uint32_t length_max, uint32_t *out_length,
+                              uint32_t timeout_ms) {
+  (void)timeout_ms;
+  if (!handle->running) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  uint32_t max = length_max < handle->frame_bytes ? length_max
+                                                  : handle->frame_bytes;
+  size_t n = 0;
+  pthread_mutex_lock(&s_lock);
+  while (s_count > 0 && (n + 1) * sizeof(adc_digi_output_data_t) <= max) {
+    memcpy(&buf[n * sizeof(adc_digi_output_data_t)], &s_queue[s_head],
+           sizeof(adc_digi_output_data_t));
+    s_head = (s_head + 1) % QUEUE_MAX;
+    s_count--;
+    n++;
+  }
+  pthread_mutex_unlock(&s_lock);
+  *out_length = n * sizeof(adc_digi_output_data_t);
+  return n > 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+// Drops every queued conversion, as the driver empties its pool
+esp_err_t adc_continuous_flush_pool(adc_continuous_handle_t handle) {
+  if (handle->running) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  pthread_mutex_lock(&s_lock);
+  s_head = 0;
+  s_count = 0;
+  pthread_mutex_unlock(&s_lock);
+  return ESP_OK;
+}
+
+esp_err_t adc_continuous_deinit(adc_continuous_handle_t handle) {
+  if (handle->running) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (s_last == handle) {
+    s_last = NULL;
+  }
+  free(handle);
+  return ESP_OK;
+}
+
+esp_err_t
+adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t *cfg,
+                                     adc_cali_handle_t *out) {
+  (void)cfg;
+  if (!s_cali_supported) {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  static struct mock_adc_cali cali;
+  *out = &cali;
+  return ESP_OK;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw,
+                                  int *voltage_mv) {
+  (void)handle;
+  *voltage_mv = raw * MOCK_ADC_CALI_FULL_SCALE_MV / 4095;
+  return ESP_OK;
+}
@@ -0,0 +1,103 @@
+#include "esp_camera.h"
+#include "img_converters.h"
+#include "mock_hal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define MAX_FRAMES 16
+
+typedef struct {
+  uint8_t *buf;
+  size_t len;
+} stored_frame_t;
+
+static stored_frame_t s_frames[MAX_FRAMES];
+static int s_frame_count = 0;
+static int s_next = 0;
+static bool s_initialized = false;
+static size_t s_fb_count = 1;
+static int s_outstanding = 0;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void mock_camera_add_frame(const uint8_t *buf, size_t len) {
+  pthread_mutex_lock(&s_lock);
+  if (s_frame_count == MAX_FRAMES) {
+    abort();
+  }
+  stored_frame_t *f = &s_frames[s_frame_count++];
+  f->buf = malloc(len);
+  memcpy(f->buf, buf, len);
+  f->len = len;
+  pthread_mutex_unlock(&s_lock);
+}
+
+void mock_camera_reset(void) {
+  pthread_mutex_lock(&s_lock);
+  for (int i = 0; i < s_frame_count; i++) {
+    free(s_frames[i].buf);
+  }
+  s_frame_count = 0;
+  s_next = 0;
+  s_outstanding = 0;
+  pthread_mutex_unlock(&s_lock);
+}
+
+int mock_camera_outstanding(void) {
+  pthread_mutex_lock(&s_lock);
+  int n = s_outstanding;
+  pthread_mutex_unlock(&s_lock);
+  return n;
+}
+
+esp_err_t esp_camera_init(const camera_config_t *config) {
+  pthread_mutex_lock(&s_lock);
+  s_initialized = true;
+  s_fb_count = config->fb_count > 0 ? config->fb_count : 1;
+  pthread_mutex_unlock(&s_lock);
+  return ESP_OK;
+}
+
+esp_err_t esp_camera_deinit(void) {
+  pthread_mutex_lock(&s_lock);
+  bool was = s_initialized;
+  s_initialized = false;
+  pthread_mutex_unlock(&s_lock);
+  return was ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+camera_fb_t *esp_camera_fb_get(void) {
+  pthread_mutex_lock(&s_lock);
+  if (!s_initialized || s_frame_count == 0 ||
+      s_outstanding >= (int)s_fb_count) {
+    pthread_mutex_unlock(&s_lock);
+    return NULL;
+  }
+  const stored_frame_t *f = &s_frames[s_next];
+  s_next = (s_next + 1) % s_frame_count;
+  s_outstanding++;
+  pthread_mutex_unlock(&s_lock);
+
+  // The driver hands out its own buffer; a copy catches use after return
+  camera_fb_t *fb = calloc(1, sizeof(*fb));
+  fb->buf = malloc(f->len);
+  memcpy(fb->buf, f->buf, f->len);
+  fb->len = f->len;
+  fb->format = PIXFORMAT_JPEG;
+  gettimeofday(&fb->timestamp, NULL);
+  return fb;
+}
+
+void esp_camera_fb_return(camera_fb_t *fb) {
+  pthread_mutex_lock(&s_lock);
+  s_outstanding--;
+  pthread_mutex_unlock(&s_lock);
+  free(fb->buf);
+  free(fb);
+}
+
+bool jpg2rgb565(const uint8_t *src, size_t src_len, uint8_t *out,
+                jpg_scale_t scale) {
+  return false;
+}
@@ -0,0 +1,77 @@
+#include "esp_err.h"
+#include "esp_log.h"
+#include "mock_hal.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static atomic_uint s_log_counts[ESP_LOG_VERBOSE + 1];
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch (code) {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_NO_MEM:
+    return "ESP_ERR_NO_MEM";
+  case ESP_ERR_INVALID_ARG:
+    return "ESP_ERR_INVALID_ARG";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_INVALID_SIZE:
+    return "ESP_ERR_INVALID_SIZE";
+  case ESP_ERR_NOT_FOUND:
+    return "ESP_ERR_NOT_FOUND";
+  case ESP_ERR_NOT_SUPPORTED:
+    return "ESP_ERR_NOT_SUPPORTED";
+  case ESP_ERR_TIMEOUT:
+    return "ESP_ERR_TIMEOUT";
+  case ESP_ERR_INVALID_RESPONSE:
+    return "ESP_ERR_INVALID_RESPONSE";
+  case ESP_ERR_INVALID_CRC:
+    return "ESP_ERR_INVALID_CRC";
+  case ESP_ERR_INVALID_VERSION:
+    return "ESP_ERR_INVALID_VERSION";
+  case ESP_ERR_NOT_FINISHED:
+    return "ESP_ERR_NOT_FINISHED";
+  case ESP_ERR_NOT_ALLOWED:
+    return "ESP_ERR_NOT_ALLOWED";
+  default:
+    return "UNKNOWN ERROR";
+  }
+}
+
+static int log_level(void) {
+  static int level = -1;
+  if (level < 0) {
+    const char *env = getenv("HOST_LOG_LEVEL");
+    level = env != NULL ? atoi(env) : ESP_LOG_NONE;
+  }
+  return level;
+}
+
+void mock_log(esp_log_level_t level, const char *tag, const char *fmt, ...) {
+  atomic_fetch_add(&s_log_counts[level], 1);
+  if ((int)level > log_level()) {
+    return;
+  }
+  static const char letters[] = "-EWIDV";
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "%c (%s) ", letters[level], tag);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+uint32_t mock_log_count(esp_log_level_t level) {
+  return atomic_load(&s_log_counts[level]);
+}
+
+void mock_log_reset(void) {
+  for (int i = 0; i <= ESP_LOG_VERBOSE; i++) {
+    atomic_store(&s_log_counts[i], 0);
+  }
+}
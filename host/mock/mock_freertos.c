@@ -0,0 +1,296 @@
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mock_hal.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+struct mock_task {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint32_t notify[configTASK_NOTIFICATION_ARRAY_ENTRIES];
+  TaskFunction_t fn;
+  void *arg;
+};
+
+typedef enum {
+  SEM_MUTEX,
+  SEM_RECURSIVE,
+  SEM_COUNTING,
+} sem_type_t;
+
+struct mock_semaphore {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  sem_type_t type;
+  UBaseType_t count;
+  UBaseType_t max;
+  TaskHandle_t owner; // Mutexes only
+  UBaseType_t depth;  // Recursive mutex nesting
+};
+
+static pthread_mutex_t s_critical;
+static _Thread_local struct mock_task *t_self = NULL;
+
+__attribute__((constructor)) static void critical_init(void) {
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&s_critical, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+void mock_enter_critical(void) { pthread_mutex_lock(&s_critical); }
+
+void mock_exit_critical(void) { pthread_mutex_unlock(&s_critical); }
+
+static void cond_init(pthread_cond_t *cond) {
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+static struct mock_task *task_new(TaskFunction_t fn, void *arg) {
+  struct mock_task *task = calloc(1, sizeof(*task));
+  if (task == NULL) {
+    return NULL;
+  }
+  pthread_mutex_init(&task->lock, NULL);
+  cond_init(&task->cond);
+  task->fn = fn;
+  task->arg = arg;
+  return task;
+}
+
+// Absolute deadline for a tick timeout; false for portMAX_DELAY
+static bool deadline(TickType_t ticks, struct timespec *out) {
+  if (ticks == portMAX_DELAY) {
+    return false;
+  }
+  clock_gettime(CLOCK_MONOTONIC, out);
+  int64_t ns = out->tv_nsec + (int64_t)ticks * portTICK_PERIOD_MS * 1000000;
+  out->tv_sec += ns / 1000000000;
+  out->tv_nsec = ns % 1000000000;
+  return true;
+}
+
+// Waits on cond until *ready; false on timeout. Called with lock held.
+static bool wait_until(pthread_cond_t *cond, pthread_mutex_t *lock,
+                       bool (*ready)(void *), void *ctx, TickType_t ticks) {
+  struct timespec until;
+  bool timed = deadline(ticks, &until);
+  while (!ready(ctx)) {
+    if (ticks == 0) {
+      return false;
+    }
+    if (!timed) {
+      pthread_cond_wait(cond, lock);
+    } else if (pthread_cond_timedwait(cond, lock, &until) == ETIMEDOUT) {
+      return ready(ctx);
+    }
+  }
+  return true;
+}
+
+static void *task_entry(void *arg) {
+  t_self = arg;
+  t_self->fn(t_self->arg);
+  return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                   uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core) {
+  (void)name;
+  (void)stack;
+  (void)priority;
+  (void)core;
+  struct mock_task *task = task_new(fn, arg);
+  if (task == NULL) {
+    return pdFAIL;
+  }
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, task_entry, task) != 0) {
+    free(task);
+    return pdFAIL;
+  }
+  pthread_detach(thread);
+  if (handle != NULL) {
+    *handle = task;
+  }
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task == NULL || task == t_self) {
+    pthread_exit(NULL);
+  }
+  abort(); // Deleting another task is not supported on the host
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  if (t_self == NULL) {
+    t_self = task_new(NULL, NULL); // A thread the mock did not create
+  }
+  return t_self;
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return (TickType_t)(esp_timer_get_time() / (portTICK_PERIOD_MS * 1000));
+}
+
+void vTaskDelay(TickType_t ticks) {
+  int64_t us = (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+  if (mock_clock_is_fake()) {
+    mock_clock_advance(us);
+  } else {
+    usleep((useconds_t)us);
+  }
+}
+
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment) {
+  TickType_t wake = *previous + increment;
+  TickType_t now = xTaskGetTickCount();
+  if ((int32_t)(wake - now) > 0) {
+    vTaskDelay(wake - now);
+  }
+  *previous = wake;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  (void)task;
+  return 0;
+}
+
+BaseType_t xTaskNotifyGiveIndexed(TaskHandle_t task, UBaseType_t index) {
+  if (index >= configTASK_NOTIFICATION_ARRAY_ENTRIES) {
+    abort(); // Like configASSERT()
+  }
+  pthread_mutex_lock(&task->lock);
+  task->notify[index]++;
+  pthread_cond_broadcast(&task->cond);
+  pthread_mutex_unlock(&task->lock);
+  return pdPASS;
+}
+
+typedef struct {
+  struct mock_task *task;
+  UBaseType_t index;
+} notify_wait_t;
+
+static bool notified(void *ctx) {
+  notify_wait_t *w = ctx;
+  return w->task->notify[w->index] > 0;
+}
+
+uint32_t ulTaskNotifyTakeIndexed(UBaseType_t index, BaseType_t clear,
+                                 TickType_t ticks) {
+  if (index >= configTASK_NOTIFICATION_ARRAY_ENTRIES) {
+    abort();
+  }
+  struct mock_task *self = xTaskGetCurrentTaskHandle();
+  notify_wait_t w = {self, index};
+
+  pthread_mutex_lock(&self->lock);
+  wait_until(&self->cond, &self->lock, notified, &w, ticks);
+  uint32_t value = self->notify[index];
+  if (value > 0) {
+    self->notify[index] = clear ? 0 : value - 1;
+  }
+  pthread_mutex_unlock(&self->lock);
+  return value;
+}
+
+static SemaphoreHandle_t sem_new(sem_type_t type, UBaseType_t max,
+                                 UBaseType_t initial) {
+  struct mock_semaphore *sem = calloc(1, sizeof(*sem));
+  if (sem == NULL) {
+    return NULL;
+  }
+  pthread_mutex_init(&sem->lock, NULL);
+  cond_init(&sem->cond);
+  sem->type = type;
+  sem->max = max;
+  sem->count = initial;
+  return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  return sem_new(SEM_MUTEX, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+  return sem_new(SEM_RECURSIVE, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max,
+                                           UBaseType_t initial) {
+  return sem_new(SEM_COUNTING, max, initial);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+  pthread_mutex_destroy(&sem->lock);
+  pthread_cond_destroy(&sem->cond);
+  free(sem);
+}
+
+static bool available(void *ctx) {
+  return ((struct mock_semaphore *)ctx)->count > 0;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  pthread_mutex_lock(&sem->lock);
+  if (sem->type == SEM_RECURSIVE && sem->owner == self) {
+    sem->depth++;
+    pthread_mutex_unlock(&sem->lock);
+    return pdTRUE;
+  }
+  if (sem->type == SEM_MUTEX && sem->owner == self) {
+    abort(); // Would deadlock on the target
+  }
+  bool taken = wait_until(&sem->cond, &sem->lock, available, sem, ticks);
+  if (taken) {
+    sem->count--;
+    if (sem->type != SEM_COUNTING) {
+      sem->owner = self;
+      sem->depth = 1;
+    }
+  }
+  pthread_mutex_unlock(&sem->lock);
+  return taken ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  BaseType_t ret = pdTRUE;
+  pthread_mutex_lock(&sem->lock);
+  if (sem->type != SEM_COUNTING &&
+      sem->owner != xTaskGetCurrentTaskHandle()) {
+    ret = pdFALSE; // Not the holder
+  } else if (sem->type == SEM_RECURSIVE && --sem->depth > 0) {
+    // Still held
+  } else if (sem->count >= sem->max) {
+    ret = pdFALSE;
+  } else {
+    sem->count++;
+    sem->owner = NULL;
+    pthread_cond_signal(&sem->cond);
+  }
+  pthread_mutex_unlock(&sem->lock);
+  return ret;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks) {
+  return xSemaphoreTake(sem, ticks);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) {
+  return xSemaphoreGive(sem);
+}
@@ -0,0 +1,115 @@
+#ifndef MOCK_HAL_H
+#define MOCK_HAL_H
+
+#include "driver/i2c_master.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Control side of the host build's ESP-IDF stand-ins
+ *
+ * host/mock/include replaces the IDF headers the firmware modules include,
+ * so the main/ sources compile unchanged for the host. Tests drive the
+ * fakes behind those headers from here: the clock, the simulated I2C
+ * devices, the ADC sample feed, the camera frames, NVS and the PM locks.
+ */
+
+/**
+ * @brief Switch esp_timer_get_time() to a fake clock
+ *
+ * The fake clock only moves through mock_clock_set()/mock_clock_advance()
+ * and vTaskDelay(), which advances it instead of sleeping. Notification and
+ * semaphore timeouts keep using the real clock.
+ */
+void mock_clock_set_fake(bool fake);
+void mock_clock_set(int64_t us);
+void mock_clock_advance(int64_t us);
+bool mock_clock_is_fake(void);
+
+/**
+ * @brief Number of ESP_LOGx lines at exactly this level since the last reset
+ */
+uint32_t mock_log_count(esp_log_level_t level);
+void mock_log_reset(void);
+
+/**
+ * @brief A simulated I2C target
+ *
+ * write() receives the bytes of a write transfer, read() fills a read
+ * transfer; transmit_receive() calls both in turn. Returning
+ * MOCK_I2C_NACK makes the transfer fail as a NACK does on the bus. A NULL
+ * callback NACKs.
+ */
+typedef struct {
+  esp_err_t (*write)(void *ctx, const uint8_t *data, size_t len);
+  esp_err_t (*read)(void *ctx, uint8_t *data, size_t len);
+  void *ctx;
+} mock_i2c_device_t;
+
+// What i2c_master reports when the target does not acknowledge
+#define MOCK_I2C_NACK ESP_ERR_INVALID_STATE
+
+/**
+ * @brief Put a device on the (single, shared) simulated bus
+ *
+ * Transfers to an address with no device attached NACK.
+ */
+void mock_i2c_attach(uint16_t addr, const mock_i2c_device_t *dev);
+void mock_i2c_detach_all(void);
+
+/**
+ * @brief Queue raw conversions for adc_continuous_read()
+ *
+ * Reads return the queued samples in order, at most one frame per call,
+ * and ESP_ERR_TIMEOUT once the queue is empty.
+ */
+void mock_adc_feed(adc_unit_t unit, adc_channel_t channel,
+                   const uint16_t *raw, size_t count);
+void mock_adc_reset(void);
+
+/**
+ * @brief Whether the last ADC handle created is started
+ */
+bool mock_adc_running(void);
+
+/**
+ * @brief Make adc_cali_create_scheme_curve_fitting() succeed or fail
+ */
+void mock_adc_set_cali(bool supported);
+
+/**
+ * @brief Cap the bytes each lwip_writev() or httpd_socket_send() call
+ * writes (0 = no cap)
+ *
+ * Forces the partial writes a congested lwIP socket produces.
+ */
+void mock_socket_set_write_limit(size_t max_bytes);
+size_t mock_socket_write_limit(void);
+
+/**
+ * @brief Add a frame (copied) to the camera's loop
+ */
+void mock_camera_add_frame(const uint8_t *buf, size_t len);
+void mock_camera_reset(void);
+
+/**
+ * @brief Frame buffers handed out by esp_camera_fb_get() and not returned
+ */
+int mock_camera_outstanding(void);
+
+/**
+ * @brief Forget every NVS namespace and value
+ */
+void mock_nvs_reset(void);
+
+/**
+ * @brief Locks of a type currently acquired, summed over all handles
+ */
+int mock_pm_lock_held(esp_pm_lock_type_t type);
+
+#endif // MOCK_HAL_H
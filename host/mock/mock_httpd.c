@@ -0,0 +1,83 @@
+#include "esp_http_server.h"
+#include "mock_hal.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+// Host build: a request is the socket it arrived on. Socket sends go
+// straight to it and fail the way httpd_default_send() does; responses
+// are dropped and requests have no query string.
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out) {
+  httpd_req_t *copy = malloc(sizeof(*copy));
+  if (copy == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  *copy = *r;
+  *out = copy;
+  return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r) {
+  free(r);
+  return ESP_OK;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r) { return r->mock_sockfd; }
+
+// The peer sees the connection end; the descriptor stays the test's
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd) {
+  return shutdown(sockfd, SHUT_RDWR) == 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+int httpd_socket_send(httpd_handle_t hd, int sockfd, const char *buf,
+                      size_t buf_len, int flags) {
+  size_t limit = mock_socket_write_limit();
+  if (limit != 0 && buf_len > limit) {
+    buf_len = limit;
+  }
+  ssize_t ret = send(sockfd, buf, buf_len, flags | MSG_NOSIGNAL);
+  if (ret < 0) {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR
+               ? HTTPD_SOCK_ERR_TIMEOUT
+               : HTTPD_SOCK_ERR_FAIL;
+  }
+  return (int)ret;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status) {
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len) {
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf,
+                                ssize_t buf_len) {
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *r, httpd_err_code_t error,
+                              const char *msg) {
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type) {
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field,
+                             const char *value) {
+  return ESP_OK;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf,
+                                      size_t buf_len) {
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val,
+                                size_t val_size) {
+  return ESP_ERR_NOT_FOUND;
+}
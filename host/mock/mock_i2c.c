@@ -0,0 +1,161 @@
+#include "driver/i2c_master.h"
+#include "mock_hal.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+#define MAX_DEVICES 8
+#define MAX_PORTS 2
+
+struct mock_i2c_bus {
+  int port;
+  int devices; // Attached device handles
+};
+
+struct mock_i2c_dev {
+  struct mock_i2c_bus *bus;
+  uint16_t addr;
+};
+
+typedef struct {
+  uint16_t addr;
+  mock_i2c_device_t dev;
+} attached_t;
+
+// One bus is plenty: tests attach each simulated part at its own address
+static attached_t s_attached[MAX_DEVICES];
+static int s_attached_count = 0;
+static i2c_master_bus_handle_t s_ports[MAX_PORTS];
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void mock_i2c_attach(uint16_t addr, const mock_i2c_device_t *dev) {
+  pthread_mutex_lock(&s_lock);
+  for (int i = 0; i < s_attached_count; i++) {
+    if (s_attached[i].addr == addr) {
+      s_attached[i].dev = *dev;
+      pthread_mutex_unlock(&s_lock);
+      return;
+    }
+  }
+  if (s_attached_count == MAX_DEVICES) {
+    abort();
+  }
+  s_attached[s_attached_count++] = (attached_t){addr, *dev};
+  pthread_mutex_unlock(&s_lock);
+}
+
+void mock_i2c_detach_all(void) {
+  pthread_mutex_lock(&s_lock);
+  s_attached_count = 0;
+  pthread_mutex_unlock(&s_lock);
+}
+
+static const mock_i2c_device_t *find_locked(uint16_t addr) {
+  for (int i = 0; i < s_attached_count; i++) {
+    if (s_attached[i].addr == addr) {
+      return &s_attached[i].dev;
+    }
+  }
+  return NULL;
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *config,
+                             i2c_master_bus_handle_t *out) {
+  int port = config->i2c_port;
+  for (int i = 0; port < 0 && i < MAX_PORTS; i++) { // -1 = auto select
+    if (s_ports[i] == NULL) {
+      port = i;
+    }
+  }
+  if (port < 0 || port >= MAX_PORTS || s_ports[port] != NULL) {
+    return ESP_ERR_INVALID_STATE; // Like the driver: one bus per port
+  }
+  *out = calloc(1, sizeof(**out));
+  if (*out == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  (*out)->port = port;
+  s_ports[port] = *out;
+  return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus) {
+  if (bus->devices > 0) {
+    return ESP_ERR_INVALID_STATE; // Like the driver
+  }
+  s_ports[bus->port] = NULL;
+  free(bus);
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_get_bus_handle(i2c_port_num_t port,
+                                    i2c_master_bus_handle_t *out) {
+  if (port < 0 || port >= MAX_PORTS || s_ports[port] == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  *out = s_ports[port];
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus, uint16_t address,
+                           int xfer_timeout_ms) {
+  (void)bus;
+  (void)xfer_timeout_ms;
+  pthread_mutex_lock(&s_lock);
+  bool found = find_locked(address) != NULL;
+  pthread_mutex_unlock(&s_lock);
+  return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus,
+                                    const i2c_device_config_t *config,
+                                    i2c_master_dev_handle_t *out) {
+  *out = calloc(1, sizeof(**out));
+  if (*out == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  (*out)->bus = bus;
+  (*out)->addr = config->device_address;
+  bus->devices++;
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev) {
+  dev->bus->devices--;
+  free(dev);
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev,
+                              const uint8_t *data, size_t len,
+                              int xfer_timeout_ms) {
+  return i2c_master_transmit_receive(dev, data, len, NULL, 0,
+                                     xfer_timeout_ms);
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t *data,
+                             size_t len, int xfer_timeout_ms) {
+  return i2c_master_transmit_receive(dev, NULL, 0, data, len,
+                                     xfer_timeout_ms);
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev,
+                                      const uint8_t *wdata, size_t wlen,
+                                      uint8_t *rdata, size_t rlen,
+                                      int xfer_timeout_ms) {
+  (void)xfer_timeout_ms;
+  pthread_mutex_lock(&s_lock);
+  const mock_i2c_device_t *target = find_locked(dev->addr);
+  mock_i2c_device_t copy = target != NULL ? *target : (mock_i2c_device_t){0};
+  pthread_mutex_unlock(&s_lock);
+
+  esp_err_t ret = ESP_OK;
+  if (wlen > 0) {
+    ret = copy.write != NULL ? copy.write(copy.ctx, wdata, wlen)
+                             : MOCK_I2C_NACK;
+  }
+  if (ret == ESP_OK && rlen > 0) {
+    ret = copy.read != NULL ? copy.read(copy.ctx, rdata, rlen)
+                            : MOCK_I2C_NACK;
+  }
+  return ret;
+}
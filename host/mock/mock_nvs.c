@@ -0,0 +1,131 @@
+#include "mock_hal.h"
+#include "nvs.h"
+#include <pthread.h>
+#include <string.h>
+
+#define MAX_NAMESPACES 8
+#define MAX_ENTRIES 32
+#define NAME_LEN 16 // NVS_KEY_NAME_MAX_SIZE
+
+// Values keep their type, as on the target a u8 can't be read as a u32
+typedef enum { TYPE_U8 = 1, TYPE_U32 } value_type_t;
+
+typedef struct {
+  nvs_handle_t ns;
+  char key[NAME_LEN];
+  value_type_t type;
+  uint32_t value;
+} entry_t;
+
+// Handle = namespace index + 1
+static char s_namespaces[MAX_NAMESPACES][NAME_LEN];
+static int s_namespace_count = 0;
+static entry_t s_entries[MAX_ENTRIES];
+static int s_entry_count = 0;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void mock_nvs_reset(void) {
+  pthread_mutex_lock(&s_lock);
+  s_namespace_count = 0;
+  s_entry_count = 0;
+  pthread_mutex_unlock(&s_lock);
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode,
+                   nvs_handle_t *out) {
+  if (strlen(name) >= NAME_LEN) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  esp_err_t err = ESP_OK;
+  pthread_mutex_lock(&s_lock);
+  int i = 0;
+  while (i < s_namespace_count && strcmp(s_namespaces[i], name) != 0) {
+    i++;
+  }
+  if (i == s_namespace_count) {
+    // Like the target, only a writer creates the namespace
+    if (mode == NVS_READONLY) {
+      err = ESP_ERR_NVS_NOT_FOUND;
+    } else if (i == MAX_NAMESPACES) {
+      err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    } else {
+      strcpy(s_namespaces[s_namespace_count++], name);
+    }
+  }
+  pthread_mutex_unlock(&s_lock);
+  if (err == ESP_OK) {
+    *out = i + 1;
+  }
+  return err;
+}
+
+void nvs_close(nvs_handle_t handle) { (void)handle; }
+
+esp_err_t nvs_commit(nvs_handle_t handle) { return ESP_OK; }
+
+// Caller holds s_lock
+static entry_t *find_locked(nvs_handle_t handle, const char *key) {
+  for (int i = 0; i < s_entry_count; i++) {
+    if (s_entries[i].ns == handle && strcmp(s_entries[i].key, key) == 0) {
+      return &s_entries[i];
+    }
+  }
+  return NULL;
+}
+
+static esp_err_t get(nvs_handle_t handle, const char *key,
+                     value_type_t type, uint32_t *out) {
+  pthread_mutex_lock(&s_lock);
+  entry_t *e = find_locked(handle, key);
+  esp_err_t err = e != NULL && e->type == type ? ESP_OK
+                                               : ESP_ERR_NVS_NOT_FOUND;
+  if (err == ESP_OK) {
+    *out = e->value;
+  }
+  pthread_mutex_unlock(&s_lock);
+  return err;
+}
+
+static esp_err_t set(nvs_handle_t handle, const char *key,
+                     value_type_t type, uint32_t value) {
+  if (strlen(key) >= NAME_LEN) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  esp_err_t err = ESP_OK;
+  pthread_mutex_lock(&s_lock);
+  entry_t *e = find_locked(handle, key);
+  if (e == NULL && s_entry_count < MAX_ENTRIES) {
+    e = &s_entries[s_entry_count++];
+    e->ns = handle;
+    strcpy(e->key, key);
+  }
+  if (e != NULL) {
+    e->type = type;
+    e->value = value;
+  } else {
+    err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+  }
+  pthread_mutex_unlock(&s_lock);
+  return err;
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out) {
+  uint32_t value;
+  esp_err_t err = get(handle, key, TYPE_U8, &value);
+  if (err == ESP_OK) {
+    *out = (uint8_t)value;
+  }
+  return err;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+  return set(handle, key, TYPE_U8, value);
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out) {
+  return get(handle, key, TYPE_U32, out);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+  return set(handle, key, TYPE_U32, value);
+}
@@ -0,0 +1,69 @@
+#include "esp_pm.h"
+#include "esp_wifi.h"
+#include "mock_hal.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+struct mock_pm_lock {
+  esp_pm_lock_type_t type;
+  int count;
+};
+
+static int s_held[ESP_PM_NO_LIGHT_SLEEP + 1];
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+esp_err_t esp_pm_configure(const void *config) {
+  (void)config;
+  return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t type, int arg,
+                             const char *name, esp_pm_lock_handle_t *out) {
+  *out = calloc(1, sizeof(**out));
+  if (*out == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  (*out)->type = type;
+  return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_delete(esp_pm_lock_handle_t handle) {
+  if (handle->count > 0) {
+    return ESP_ERR_INVALID_STATE; // Like the target
+  }
+  free(handle);
+  return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle) {
+  pthread_mutex_lock(&s_lock);
+  handle->count++;
+  s_held[handle->type]++;
+  pthread_mutex_unlock(&s_lock);
+  return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle) {
+  esp_err_t err = ESP_OK;
+  pthread_mutex_lock(&s_lock);
+  if (handle->count == 0) {
+    err = ESP_ERR_INVALID_STATE; // Released more often than acquired
+  } else {
+    handle->count--;
+    s_held[handle->type]--;
+  }
+  pthread_mutex_unlock(&s_lock);
+  return err;
+}
+
+int mock_pm_lock_held(esp_pm_lock_type_t type) {
+  pthread_mutex_lock(&s_lock);
+  int held = s_held[type];
+  pthread_mutex_unlock(&s_lock);
+  return held;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+  (void)type;
+  return ESP_OK;
+}
@@ -0,0 +1,30 @@
+#include "lwip/sockets.h"
+#include "mock_hal.h"
+#include <stdatomic.h>
+
+static atomic_size_t s_write_limit = 0;
+
+void mock_socket_set_write_limit(size_t max_bytes) {
+  atomic_store(&s_write_limit, max_bytes);
+}
+
+size_t mock_socket_write_limit(void) { return atomic_load(&s_write_limit); }
+
+ssize_t mock_writev(int fd, const struct iovec *iov, int iovcnt) {
+  size_t limit = atomic_load(&s_write_limit);
+  if (limit == 0) {
+    return writev(fd, iov, iovcnt);
+  }
+  // Trim the vector to the first limit bytes
+  struct iovec cut[16];
+  int n = 0;
+  for (int i = 0; i < iovcnt && n < 16 && limit > 0; i++) {
+    cut[n] = iov[i];
+    if (cut[n].iov_len > limit) {
+      cut[n].iov_len = limit;
+    }
+    limit -= cut[n].iov_len;
+    n++;
+  }
+  return writev(fd, cut, n);
+}
@@ -0,0 +1,21 @@
+#include "task_topology.h"
+
+// Host build: tasks are plain threads; periods are not tracked
+
+esp_err_t task_topology_create(task_id_t id, TaskFunction_t fn, void *arg,
+                               TaskHandle_t *handle) {
+  (void)id;
+  return xTaskCreatePinnedToCore(fn, "task", 0, arg, 0, handle,
+                                 tskNO_AFFINITY) == pdPASS
+             ? ESP_OK
+             : ESP_ERR_NO_MEM;
+}
+
+void task_topology_set_period(task_id_t id, uint32_t period_ms) {
+  (void)id;
+  (void)period_ms;
+}
+
+void task_topology_tick(task_id_t id) { (void)id; }
+
+void task_topology_reset_period(task_id_t id) { (void)id; }
@@ -0,0 +1,39 @@
+#include "esp_timer.h"
+#include "mock_hal.h"
+#include <stdatomic.h>
+#include <time.h>
+
+static atomic_bool s_fake = false;
+static _Atomic int64_t s_fake_us = 0;
+
+static int64_t s_start_us;
+
+static int64_t clock_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Relative to process start, like the boot-relative esp_timer clock
+__attribute__((constructor)) static void clock_init(void) {
+  s_start_us = clock_us();
+}
+
+static int64_t monotonic_us(void) { return clock_us() - s_start_us; }
+
+int64_t esp_timer_get_time(void) {
+  return atomic_load(&s_fake) ? atomic_load(&s_fake_us) : monotonic_us();
+}
+
+void mock_clock_set_fake(bool fake) {
+  if (fake) {
+    atomic_store(&s_fake_us, monotonic_us());
+  }
+  atomic_store(&s_fake, fake);
+}
+
+void mock_clock_set(int64_t us) { atomic_store(&s_fake_us, us); }
+
+void mock_clock_advance(int64_t us) { atomic_fetch_add(&s_fake_us, us); }
+
+bool mock_clock_is_fake(void) { return atomic_load(&s_fake); }
@@ -0,0 +1,111 @@
+#include "clip_io_file.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK 4096
+
+static esp_err_t file_read(void *ctx, uint32_t offset, void *buf,
+                           size_t len) {
+  clip_io_file_t *f = ctx;
+  if (offset + len > f->io.size || fseek(f->file, offset, SEEK_SET) != 0 ||
+      fread(buf, 1, len, f->file) != len) {
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+static esp_err_t file_write(void *ctx, uint32_t offset, const void *buf,
+                            size_t len) {
+  clip_io_file_t *f = ctx;
+  if (offset + len > f->io.size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  if (f->writes_left == 0) {
+    return ESP_FAIL; // Power is gone
+  }
+  if (f->writes_left > 0) {
+    f->writes_left--;
+  }
+
+  const uint8_t *src = buf;
+  uint8_t old[CHUNK];
+  for (size_t done = 0; done < len;) {
+    size_t n = len - done < CHUNK ? len - done : CHUNK;
+    if (file_read(f, offset + done, old, n) != ESP_OK) {
+      return ESP_FAIL;
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (src[done + i] & ~old[i]) {
+        f->program_errors++;
+      }
+      old[i] &= src[done + i];
+    }
+    if (fseek(f->file, offset + done, SEEK_SET) != 0 ||
+        fwrite(old, 1, n, f->file) != n) {
+      return ESP_FAIL;
+    }
+    done += n;
+  }
+  f->writes++;
+  return ESP_OK;
+}
+
+static esp_err_t file_erase(void *ctx, uint32_t offset, size_t len) {
+  clip_io_file_t *f = ctx;
+  if (offset + len > f->io.size || fseek(f->file, offset, SEEK_SET) != 0) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  uint8_t ones[CHUNK];
+  memset(ones, 0xFF, sizeof(ones));
+  for (size_t done = 0; done < len;) {
+    size_t n = len - done < CHUNK ? len - done : CHUNK;
+    if (fwrite(ones, 1, n, f->file) != n) {
+      return ESP_FAIL;
+    }
+    done += n;
+  }
+  f->erases++;
+  return ESP_OK;
+}
+
+esp_err_t clip_io_file_open(clip_io_file_t *f, const char *path,
+                            uint32_t size) {
+  memset(f, 0, sizeof(*f));
+  f->writes_left = -1;
+  if (path == NULL) {
+    f->file = tmpfile();
+  } else {
+    f->file = fopen(path, "r+b");
+    if (f->file == NULL) {
+      f->file = fopen(path, "w+b");
+    }
+  }
+  if (f->file == NULL) {
+    return ESP_FAIL;
+  }
+  f->io = (clip_io_t){
+      .read = file_read,
+      .write = file_write,
+      .erase = file_erase,
+      .ctx = f,
+      .size = size,
+  };
+
+  // Extend a new or short image with erased space
+  fseek(f->file, 0, SEEK_END);
+  long end = ftell(f->file);
+  if (end < (long)size &&
+      file_erase(f, end, size - end) != ESP_OK) {
+    fclose(f->file);
+    return ESP_FAIL;
+  }
+  f->erases = 0;
+  return ESP_OK;
+}
+
+void clip_io_file_close(clip_io_file_t *f) {
+  if (f->file != NULL) {
+    fclose(f->file);
+    f->file = NULL;
+  }
+}
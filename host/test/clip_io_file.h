@@ -0,0 +1,39 @@
+#ifndef CLIP_IO_FILE_H
+#define CLIP_IO_FILE_H
+
+#include "clip_store.h"
+#include <stdio.h>
+
+/**
+ * @brief clip_io_t on an image file with NOR flash semantics
+ *
+ * Erase fills with 0xFF; a write can only clear bits (the result is the AND
+ * of old and new data, as on flash). Writes that would need to set a bit are
+ * still applied that way but counted in program_errors, so a test can
+ * assert the store never relies on them. writes_left simulates a power cut:
+ * once it reaches 0, every further write fails without touching the image.
+ */
+typedef struct {
+  FILE *file;
+  clip_io_t io;
+  int writes_left;         // -1 = unlimited
+  uint32_t writes;         // Successful write() calls
+  uint32_t erases;         // Successful erase() calls
+  uint32_t program_errors; // Writes that tried to turn a 0 bit into a 1
+} clip_io_file_t;
+
+/**
+ * @brief Open or create an image
+ *
+ * @param f Backend state, must outlive every store mounted on f->io
+ * @param path Image file, created erased if shorter than size; NULL for an
+ *        anonymous temporary image
+ * @param size Area size in bytes
+ * @return ESP_OK on success, ESP_FAIL if the file cannot be opened
+ */
+esp_err_t clip_io_file_open(clip_io_file_t *f, const char *path,
+                            uint32_t size);
+
+void clip_io_file_close(clip_io_file_t *f);
+
+#endif // CLIP_IO_FILE_H
@@ -0,0 +1,43 @@
+#include "pgm.h"
+#include <ctype.h>
+#include <stdio.h>
+
+// Next header number, skipping whitespace and # comments
+static bool header_int(FILE *f, int *out) {
+  int c = fgetc(f);
+  while (c == '#' || isspace(c)) {
+    if (c == '#') {
+      while (c != '\n' && c != EOF) {
+        c = fgetc(f);
+      }
+    }
+    c = fgetc(f);
+  }
+  if (!isdigit(c)) {
+    return false;
+  }
+  int v = 0;
+  while (isdigit(c)) {
+    v = v * 10 + (c - '0');
+    c = fgetc(f);
+  }
+  *out = v;
+  return isspace(c); // Exactly one whitespace byte before the pixels
+}
+
+bool pgm_load(const char *path, uint8_t *pixels, size_t max, int *width,
+              int *height) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    return false;
+  }
+  int maxval;
+  bool ok = fgetc(f) == 'P' && fgetc(f) == '5' && header_int(f, width) &&
+            header_int(f, height) && header_int(f, &maxval) &&
+            maxval == 255 && *width > 0 && *height > 0 &&
+            (size_t)*width * *height <= max &&
+            fread(pixels, 1, (size_t)*width * *height, f) ==
+                (size_t)*width * *height;
+  fclose(f);
+  return ok;
+}
@@ -0,0 +1,22 @@
+#ifndef PGM_H
+#define PGM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Load a binary (P5) 8-bit PGM image
+ *
+ * @param path File name
+ * @param pixels Output, width * height bytes, row-major
+ * @param max Size of pixels
+ * @param width Output, image width
+ * @param height Output, image height
+ * @return false if the file is missing, not an 8-bit P5 PGM or larger than
+ *         max
+ */
+bool pgm_load(const char *path, uint8_t *pixels, size_t max, int *width,
+              int *height);
+
+#endif // PGM_H
@@ -0,0 +1,56 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <math.h>
+#include <stdio.h>
+
+/**
+ * @brief Minimal checks for the host tests
+ *
+ * A failed CHECK prints its location and the test keeps going; main()
+ * returns TEST_RESULT() so ctest sees the failure.
+ */
+
+static int test_failures = 0;
+
+#define CHECK(cond)                                                           \
+  do {                                                                        \
+    if (!(cond)) {                                                            \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,        \
+              #cond);                                                         \
+      test_failures++;                                                        \
+    }                                                                         \
+  } while (0)
+
+#define CHECK_INT(actual, expected)                                           \
+  do {                                                                        \
+    long long a_ = (long long)(actual);                                       \
+    long long e_ = (long long)(expected);                                     \
+    if (a_ != e_) {                                                           \
+      fprintf(stderr, "%s:%d: %s = %lld, expected %lld\n", __FILE__,          \
+              __LINE__, #actual, a_, e_);                                     \
+      test_failures++;                                                        \
+    }                                                                         \
+  } while (0)
+
+#define CHECK_NEAR(actual, expected, tol)                                     \
+  do {                                                                        \
+    double a_ = (double)(actual);                                             \
+    double e_ = (double)(expected);                                           \
+    if (!(fabs(a_ - e_) <= (tol))) {                                          \
+      fprintf(stderr, "%s:%d: %s = %.6g, expected %.6g +- %g\n", __FILE__,    \
+              __LINE__, #actual, a_, e_, (double)(tol));                      \
+      test_failures++;                                                        \
+    }                                                                         \
+  } while (0)
+
+#define RUN_TEST(fn)                                                          \
+  do {                                                                        \
+    int before_ = test_failures;                                              \
+    fn();                                                                     \
+    printf("%s %s\n", test_failures == before_ ? "ok  " : "FAIL", #fn);       \
+  } while (0)
+
+#define TEST_RESULT() (test_failures == 0 ? 0 : 1)
+
+#endif // TEST_H
@@ -0,0 +1,78 @@
+#include "alarm_rule.h"
+#include "test.h"
+#include <math.h>
+#include <string.h>
+
+static alarm_rule_t valid_rule(void) {
+  alarm_rule_t rule = {"nh3_high", 1, ALARM_SRC_AMMONIA_PPM, ALARM_SUSTAINED,
+                       1, 25.0f, 20.0f, 300};
+  return rule;
+}
+
+static void test_valid(void) {
+  alarm_rule_t rule = valid_rule();
+  CHECK(alarm_rule_check(&rule) == NULL);
+
+  // Below-rules clear above set
+  rule.above = 0;
+  rule.set = 5.0f;
+  rule.clear = 7.0f;
+  CHECK(alarm_rule_check(&rule) == NULL);
+
+  // Longest name
+  memset(rule.name, 'a', ALARM_NAME_LEN - 1);
+  rule.name[ALARM_NAME_LEN - 1] = '\0';
+  CHECK(alarm_rule_check(&rule) == NULL);
+}
+
+static void test_name(void) {
+  alarm_rule_t rule = valid_rule();
+  rule.name[0] = '\0';
+  CHECK(alarm_rule_check(&rule) != NULL);
+
+  strcpy(rule.name, "a\"b");
+  CHECK(alarm_rule_check(&rule) != NULL);
+
+  // Not terminated inside the field, as in a corrupt blob
+  memset(rule.name, 'a', ALARM_NAME_LEN);
+  CHECK(alarm_rule_check(&rule) != NULL);
+}
+
+// Out-of-range enums would index past the name tables
+static void test_enums(void) {
+  alarm_rule_t rule = valid_rule();
+  rule.source = ALARM_SRC_COUNT;
+  CHECK(alarm_rule_check(&rule) != NULL);
+  rule.source = 0xFF;
+  CHECK(alarm_rule_check(&rule) != NULL);
+  rule.source = ALARM_SRC_COUNT - 1;
+  CHECK(alarm_rule_check(&rule) == NULL);
+
+  rule.type = ALARM_TYPE_COUNT;
+  CHECK(alarm_rule_check(&rule) != NULL);
+  rule.type = 0xFF;
+  CHECK(alarm_rule_check(&rule) != NULL);
+  rule.type = ALARM_TYPE_COUNT - 1;
+  CHECK(alarm_rule_check(&rule) == NULL);
+}
+
+static void test_levels(void) {
+  alarm_rule_t rule = valid_rule();
+  rule.clear = 30.0f; // Above set for an above-rule
+  CHECK(alarm_rule_check(&rule) != NULL);
+
+  rule = valid_rule();
+  rule.set = NAN;
+  CHECK(alarm_rule_check(&rule) != NULL);
+  rule = valid_rule();
+  rule.clear = INFINITY;
+  CHECK(alarm_rule_check(&rule) != NULL);
+}
+
+int main(void) {
+  RUN_TEST(test_valid);
+  RUN_TEST(test_name);
+  RUN_TEST(test_enums);
+  RUN_TEST(test_levels);
+  return TEST_RESULT();
+}
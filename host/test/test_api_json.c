@@ -0,0 +1,115 @@
+#include "api_json.h"
+#include "test.h"
+#include <math.h>
+#include <string.h>
+
+static sensor_snapshot_t sample_snapshot(void) {
+  return (sensor_snapshot_t){
+      .version = 42,
+      .ammonia_raw = 1234,
+      .ammonia_voltage_mv = 995,
+      .ammonia_variance = 3.5f,
+      .ammonia_ppm = 12.345f,
+      .ammonia_seq = 7,
+      .ammonia_time_us = 5000123,
+      .temperature = 21.46f,
+      .humidity = 55.04f,
+      .sht30_seq = 3,
+      .sht30_time_us = 4999999,
+  };
+}
+
+static void test_ammonia(void) {
+  char buf[API_JSON_SENSORS_MAX];
+  sensor_snapshot_t snap = sample_snapshot();
+  int len = api_json_ammonia(buf, sizeof(buf), &snap);
+  CHECK_INT(len, strlen(buf));
+  CHECK(strcmp(buf, "{\"raw\":1234,\"voltage_mv\":995,\"variance\":3.5,"
+                    "\"ppm\":12.35}") == 0);
+
+  // Not calibrated yet
+  snap.ammonia_ppm = NAN;
+  api_json_ammonia(buf, sizeof(buf), &snap);
+  CHECK(strstr(buf, "\"ppm\":null}") != NULL);
+}
+
+static void test_sht30(void) {
+  char buf[API_JSON_SENSORS_MAX];
+  sensor_snapshot_t snap = sample_snapshot();
+  int len = api_json_sht30(buf, sizeof(buf), &snap);
+  CHECK_INT(len, strlen(buf));
+  CHECK(strcmp(buf, "{\"temperature\":21.5,\"humidity\":55.0}") == 0);
+}
+
+static void test_sensors(void) {
+  char buf[API_JSON_SENSORS_MAX];
+  sensor_snapshot_t snap = sample_snapshot();
+  int len = api_json_sensors(buf, sizeof(buf), &snap, 6000, true, false);
+  CHECK_INT(len, strlen(buf));
+  CHECK(strncmp(buf, "{\"version\":42,\"now_ms\":6000,\"ammonia\":{", 39) ==
+        0);
+  CHECK(strstr(buf, "\"seq\":7,\"t_ms\":5000}") != NULL);
+  CHECK(strstr(buf, "\"seq\":3,\"t_ms\":4999}") != NULL);
+  CHECK(strstr(buf, "\"camera\":{\"enabled\":true,\"initialized\":false}}") !=
+        NULL);
+}
+
+static void test_sensors_fits_max(void) {
+  // Widest values every field can take still fit API_JSON_SENSORS_MAX
+  sensor_snapshot_t snap = {
+      .version = UINT32_MAX,
+      .ammonia_raw = -2147483647 - 1,
+      .ammonia_voltage_mv = -2147483647 - 1,
+      .ammonia_variance = -1e6f,
+      .ammonia_ppm = -99999.99f,
+      .ammonia_seq = UINT32_MAX,
+      .ammonia_time_us = INT64_MIN,
+      .temperature = -45.0f,
+      .humidity = 100.0f,
+      .sht30_seq = UINT32_MAX,
+      .sht30_time_us = INT64_MIN,
+  };
+  char buf[API_JSON_SENSORS_MAX];
+  int len = api_json_sensors(buf, sizeof(buf), &snap, INT64_MIN, false, false);
+  CHECK(len > 0 && len < API_JSON_SENSORS_MAX);
+}
+
+static void test_truncation(void) {
+  // snprintf semantics: the full length is returned, the output is cut
+  char buf[16];
+  sensor_snapshot_t snap = sample_snapshot();
+  int len = api_json_sht30(buf, sizeof(buf), &snap);
+  CHECK(len >= (int)sizeof(buf));
+  CHECK_INT(strlen(buf), sizeof(buf) - 1);
+}
+
+static void test_name_valid(void) {
+  CHECK(api_json_name_valid("nh3_high"));
+  CHECK(api_json_name_valid("Coop-2_heat"));
+  CHECK(api_json_name_valid("0"));
+  CHECK(!api_json_name_valid(""));
+  CHECK(!api_json_name_valid("a\"b"));
+  CHECK(!api_json_name_valid("a\\b"));
+  CHECK(!api_json_name_valid("two words"));
+  CHECK(!api_json_name_valid("line\nbreak"));
+  CHECK(!api_json_name_valid("x}"));
+  CHECK(!api_json_name_valid("caf\xc3\xa9"));
+
+  // Exactly the documented set, over every byte value
+  int accepted = 0;
+  for (int c = 1; c < 256; c++) {
+    char name[2] = {(char)c, '\0'};
+    accepted += api_json_name_valid(name);
+  }
+  CHECK_INT(accepted, 26 + 26 + 10 + 2);
+}
+
+int main(void) {
+  RUN_TEST(test_ammonia);
+  RUN_TEST(test_sht30);
+  RUN_TEST(test_sensors);
+  RUN_TEST(test_sensors_fits_max);
+  RUN_TEST(test_truncation);
+  RUN_TEST(test_name_valid);
+  return TEST_RESULT();
+}
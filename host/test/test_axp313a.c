@@ -0,0 +1,277 @@
+#include "axp313a.h"
+#include "i2c_bus.h"
+#include "mock_hal.h"
+#include "test.h"
+#include <string.h>
+
+#define AXP313A_ADDR 0x36
+#define OV3660_SCCB_ADDR 0x3C
+#define REG_OUTPUT_CTRL 0x10
+#define REG_DCDC2 0x14
+#define REG_DCDC3 0x15
+#define REG_ALDO1 0x16
+#define REG_DLDO1 0x17
+
+#define BIT_DCDC1 (1 << 0)
+#define BIT_DCDC2 (1 << 1)
+#define BIT_DCDC3 (1 << 2)
+#define BIT_ALDO1 (1 << 3)
+#define BIT_DLDO1 (1 << 4)
+
+// Simulated AXP313A: a register file with an auto-incrementing pointer
+typedef struct {
+  uint8_t regs[256];
+  uint8_t ptr;
+  int writes;        // Write transfers carrying data
+  int reads;         // Read transfers
+  uint8_t last_write[16];
+  size_t last_write_len;
+  uint8_t first_write_reg[8]; // Start register of each write in a flush
+} sim_t;
+
+static sim_t s_sim;
+
+static esp_err_t sim_write(void *ctx, const uint8_t *data, size_t len) {
+  sim_t *sim = ctx;
+  sim->ptr = data[0];
+  if (len > 1) {
+    if (sim->writes < 8) {
+      sim->first_write_reg[sim->writes] = data[0];
+    }
+    sim->writes++;
+    memcpy(sim->last_write, data, len < 16 ? len : 16);
+    sim->last_write_len = len;
+  }
+  for (size_t i = 1; i < len; i++) {
+    sim->regs[sim->ptr++] = data[i];
+  }
+  return ESP_OK;
+}
+
+static esp_err_t sim_read(void *ctx, uint8_t *data, size_t len) {
+  sim_t *sim = ctx;
+  sim->reads++;
+  for (size_t i = 0; i < len; i++) {
+    data[i] = sim->regs[sim->ptr++];
+  }
+  return ESP_OK;
+}
+
+static void reset_counts(void) {
+  s_sim.writes = 0;
+  s_sim.reads = 0;
+}
+
+static void test_init_loads_shadow(void) {
+  // Power-on state: DCDC1 (ESP32-S3) and DCDC3 on
+  s_sim.regs[REG_OUTPUT_CTRL] = BIT_DCDC1 | BIT_DCDC3;
+  s_sim.regs[REG_DCDC3] = 88 + 13; // 2.9 V
+  CHECK_INT(axp313a_init(), ESP_OK);
+  CHECK_INT(s_sim.reads, 1); // One burst read of the window
+  CHECK_INT(s_sim.writes, 0);
+  CHECK_INT(axp313a_verify(), ESP_OK);
+}
+
+static void test_camera_power_sequence(void) {
+  reset_counts();
+  CHECK_INT(axp313a_camera_power_on(), ESP_OK);
+  CHECK_INT(s_sim.regs[REG_ALDO1], 23); // 2.8 V
+  CHECK_INT(s_sim.regs[REG_OUTPUT_CTRL], BIT_DCDC1 | BIT_DCDC3 | BIT_ALDO1);
+  // Voltage first, enable last, no readback
+  CHECK_INT(s_sim.writes, 2);
+  CHECK_INT(s_sim.first_write_reg[0], REG_ALDO1);
+  CHECK_INT(s_sim.first_write_reg[1], REG_OUTPUT_CTRL);
+  CHECK_INT(s_sim.reads, 0);
+
+  // Off clears ALDO1 only; DCDC1 keeps the ESP32-S3 powered
+  reset_counts();
+  CHECK_INT(axp313a_camera_power_off(), ESP_OK);
+  CHECK_INT(s_sim.regs[REG_OUTPUT_CTRL], BIT_DCDC1 | BIT_DCDC3);
+  CHECK_INT(s_sim.writes, 1);
+  CHECK_INT(s_sim.last_write_len, 2);
+
+  // Already off: nothing to write
+  reset_counts();
+  CHECK_INT(axp313a_camera_power_off(), ESP_OK);
+  CHECK_INT(s_sim.writes, 0);
+  CHECK_INT(axp313a_verify(), ESP_OK);
+}
+
+static void test_enable_bits(void) {
+  static const struct {
+    axp313a_rail_t rail;
+    uint8_t bit;
+  } rails[] = {
+      {AXP313A_RAIL_DCDC2, BIT_DCDC2},
+      {AXP313A_RAIL_DCDC3, BIT_DCDC3},
+      {AXP313A_RAIL_ALDO1, BIT_ALDO1},
+      {AXP313A_RAIL_DLDO1, BIT_DLDO1},
+  };
+  for (size_t i = 0; i < sizeof(rails) / sizeof(rails[0]); i++) {
+    uint8_t before = s_sim.regs[REG_OUTPUT_CTRL];
+    CHECK_INT(axp313a_rail_enable(rails[i].rail, true), ESP_OK);
+    CHECK_INT(axp313a_flush(), ESP_OK);
+    CHECK_INT(s_sim.regs[REG_OUTPUT_CTRL], before | rails[i].bit);
+    CHECK_INT(axp313a_rail_enable(rails[i].rail, false), ESP_OK);
+    CHECK_INT(axp313a_flush(), ESP_OK);
+    CHECK_INT(s_sim.regs[REG_OUTPUT_CTRL], before & ~rails[i].bit);
+    CHECK(s_sim.regs[REG_OUTPUT_CTRL] & BIT_DCDC1);
+  }
+  CHECK_INT(axp313a_rail_enable(AXP313A_RAIL_COUNT, true),
+            ESP_ERR_INVALID_ARG);
+  // Restore the power-on state
+  axp313a_rail_enable(AXP313A_RAIL_DCDC3, true);
+  CHECK_INT(axp313a_flush(), ESP_OK);
+}
+
+// Register code written for mv, or -1 if rejected
+static int code_for(axp313a_rail_t rail, uint8_t reg, uint16_t mv) {
+  if (axp313a_rail_set_voltage(rail, mv) != ESP_OK) {
+    return -1;
+  }
+  axp313a_flush();
+  return s_sim.regs[reg];
+}
+
+static void test_voltage_codes(void) {
+  // DCDC2: 10 mV steps to 1.2 V, 20 mV steps to 1.54 V
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 499), -1);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 500), 0);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 509), 0);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 1000), 50);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 1200), 70);
+  // Between the segments: down to 1.20 V, not up to 1.22 V
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 1201), 70);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 1210), 70);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 1219), 70);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 1220), 71);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 1239), 71);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 1240), 72);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 1540), 87);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC2, REG_DCDC2, 1541), -1);
+
+  // DCDC3 continues in 100 mV steps from 1.6 V; the gap rounds down
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC3, REG_DCDC3, 1541), 87);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC3, REG_DCDC3, 1599), 87);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC3, REG_DCDC3, 1600), 88);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC3, REG_DCDC3, 1699), 88);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC3, REG_DCDC3, 3300), 105);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC3, REG_DCDC3, 3400), 106);
+  CHECK_INT(code_for(AXP313A_RAIL_DCDC3, REG_DCDC3, 3401), -1);
+
+  // LDOs: 100 mV steps from 0.5 V
+  CHECK_INT(code_for(AXP313A_RAIL_ALDO1, REG_ALDO1, 500), 0);
+  CHECK_INT(code_for(AXP313A_RAIL_ALDO1, REG_ALDO1, 2850), 23);
+  CHECK_INT(code_for(AXP313A_RAIL_DLDO1, REG_DLDO1, 3500), 30);
+  CHECK_INT(code_for(AXP313A_RAIL_DLDO1, REG_DLDO1, 3501), -1);
+
+  // Monotonic and never above the request over the whole DCDC3 range
+  int prev = -1;
+  for (uint16_t mv = 500; mv <= 3400; mv++) {
+    int code = code_for(AXP313A_RAIL_DCDC3, REG_DCDC3, mv);
+    int code_mv = code <= 70   ? 500 + code * 10
+                  : code <= 87 ? 1220 + (code - 71) * 20
+                               : 1600 + (code - 88) * 100;
+    CHECK(code >= prev && code_mv <= mv);
+    prev = code;
+  }
+}
+
+static void test_burst_runs(void) {
+  // Adjacent dirty registers go out as one auto-increment write
+  axp313a_rail_set_voltage(AXP313A_RAIL_DCDC2, 900);
+  axp313a_rail_set_voltage(AXP313A_RAIL_DCDC3, 1800);
+  axp313a_rail_set_voltage(AXP313A_RAIL_ALDO1, 1800);
+  reset_counts();
+  CHECK_INT(axp313a_flush(), ESP_OK);
+  CHECK_INT(s_sim.writes, 1);
+  CHECK_INT(s_sim.last_write_len, 4);
+  CHECK_INT(s_sim.last_write[0], REG_DCDC2);
+  CHECK_INT(s_sim.regs[REG_DCDC2], 40);
+  CHECK_INT(s_sim.regs[REG_DCDC3], 90);
+  CHECK_INT(s_sim.regs[REG_ALDO1], 13);
+
+  // Same values again: nothing dirty, no bus traffic
+  axp313a_rail_set_voltage(AXP313A_RAIL_DCDC2, 900);
+  reset_counts();
+  CHECK_INT(axp313a_flush(), ESP_OK);
+  CHECK_INT(s_sim.writes, 0);
+}
+
+static void test_verify(void) {
+  CHECK_INT(axp313a_verify(), ESP_OK);
+
+  // Changed behind the driver's back
+  s_sim.regs[REG_DLDO1] ^= 0x01;
+  CHECK_INT(axp313a_verify(), ESP_ERR_INVALID_RESPONSE);
+  // The shadow now follows the chip
+  CHECK_INT(axp313a_verify(), ESP_OK);
+
+  // Staged, unflushed values survive a verify
+  axp313a_rail_set_voltage(AXP313A_RAIL_DLDO1, 3300);
+  CHECK_INT(axp313a_verify(), ESP_OK);
+  CHECK_INT(axp313a_flush(), ESP_OK);
+  CHECK_INT(s_sim.regs[REG_DLDO1], 28);
+}
+
+static void test_dcdc1_guard(void) {
+  // A corrupted load leaves DCDC1 clear in the shadow
+  s_sim.regs[REG_OUTPUT_CTRL] = 0;
+  CHECK_INT(axp313a_init(), ESP_OK);
+  s_sim.regs[REG_OUTPUT_CTRL] = BIT_DCDC1 | BIT_DCDC3;
+
+  // Voltages alone do not touch OUTPUT_CTRL
+  axp313a_rail_set_voltage(AXP313A_RAIL_DLDO1, 1800);
+  CHECK_INT(axp313a_flush(), ESP_OK);
+
+  // Writing it would switch the ESP32-S3 off: nothing goes out
+  axp313a_rail_enable(AXP313A_RAIL_DCDC2, true);
+  reset_counts();
+  CHECK_INT(axp313a_flush(), ESP_ERR_INVALID_STATE);
+  CHECK_INT(s_sim.writes, 0);
+  CHECK_INT(s_sim.regs[REG_OUTPUT_CTRL], BIT_DCDC1 | BIT_DCDC3);
+
+  // The retry keeps DCDC1 on
+  CHECK_INT(axp313a_flush(), ESP_OK);
+  CHECK_INT(s_sim.regs[REG_OUTPUT_CTRL], BIT_DCDC1 | BIT_DCDC2);
+}
+
+static esp_err_t sccb_ack(void *ctx, const uint8_t *data, size_t len) {
+  return ESP_OK;
+}
+
+// The camera SCCB found on the shared bus, as after esp_camera_init()
+static void test_camera_attached(void) {
+  // Not answering on this bus: the camera driver has its own, or no sensor
+  CHECK_INT(i2c_bus_check_attached(OV3660_SCCB_ADDR), ESP_ERR_NOT_FOUND);
+
+  mock_i2c_attach(OV3660_SCCB_ADDR, &(mock_i2c_device_t){.write = sccb_ack});
+  CHECK_INT(i2c_bus_check_attached(OV3660_SCCB_ADDR), ESP_OK);
+
+  // A second bus (the SHT30's) doesn't take the port
+  i2c_master_bus_handle_t other;
+  CHECK_INT(i2c_new_master_bus(&(i2c_master_bus_config_t){.i2c_port = -1},
+                               &other),
+            ESP_OK);
+  CHECK_INT(i2c_bus_check_attached(OV3660_SCCB_ADDR), ESP_OK);
+}
+
+int main(void) {
+  mock_clock_set_fake(true); // Skip the power-on settle delay
+  mock_i2c_attach(AXP313A_ADDR, &(mock_i2c_device_t){
+                                    .write = sim_write,
+                                    .read = sim_read,
+                                    .ctx = &s_sim,
+                                });
+  CHECK_INT(axp313a_flush(), ESP_ERR_INVALID_STATE); // Before init
+  CHECK_INT(i2c_bus_check_attached(AXP313A_ADDR), ESP_ERR_INVALID_STATE);
+  RUN_TEST(test_init_loads_shadow);
+  RUN_TEST(test_camera_power_sequence);
+  RUN_TEST(test_enable_bits);
+  RUN_TEST(test_voltage_codes);
+  RUN_TEST(test_burst_runs);
+  RUN_TEST(test_verify);
+  RUN_TEST(test_dcdc1_guard);
+  RUN_TEST(test_camera_attached);
+  return TEST_RESULT();
+}
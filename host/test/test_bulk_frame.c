@@ -0,0 +1,166 @@
+#include "bulk_frame.h"
+#include "test.h"
+#include <math.h>
+#include <string.h>
+
+static uint32_t get_u16(const uint8_t *p) { return p[0] | p[1] << 8; }
+
+static uint32_t get_u32(const uint8_t *p) {
+  return get_u16(p) | get_u16(&p[2]) << 16;
+}
+
+static int get_i16(const uint8_t *p) { return (int16_t)get_u16(p); }
+
+static void test_header(void) {
+  uint8_t buf[BULK_FRAME_HEADER_SIZE + 1];
+  memset(buf, 0xAA, sizeof(buf));
+  bulk_frame_header_t header = {
+      .seq = 1234,
+      .since = 1200,
+      .now_ms = 0x123456789LL,
+      .heap_free = 150000,
+      .flags = BULK_FLAG_GAP | BULK_FLAG_MORE,
+      .count = 34,
+  };
+  CHECK_INT(bulk_frame_header(buf, &header), BULK_FRAME_HEADER_SIZE);
+  CHECK(memcmp(buf, "SCB1", 4) == 0);
+  CHECK_INT(get_u16(&buf[4]), BULK_FRAME_VERSION);
+  CHECK_INT(get_u16(&buf[6]), BULK_FRAME_RECORD_SIZE);
+  CHECK_INT(get_u32(&buf[8]), 1234);
+  CHECK_INT(get_u32(&buf[12]), 1200);
+  CHECK_INT(get_u32(&buf[16]), 0x23456789);
+  CHECK_INT(get_u32(&buf[20]), 1);
+  CHECK_INT(get_u32(&buf[24]), 150000);
+  CHECK_INT(get_u16(&buf[28]), BULK_FLAG_GAP | BULK_FLAG_MORE);
+  CHECK_INT(get_u16(&buf[30]), 34);
+  CHECK_INT(buf[BULK_FRAME_HEADER_SIZE], 0xAA);
+}
+
+static void test_records(void) {
+  uint8_t buf[BULK_FRAME_RECORD_SIZE + 1];
+  memset(buf, 0xAA, sizeof(buf));
+  sensor_sample_t sample = {
+      .version = 77,
+      .kind = SENSOR_SAMPLE_AMMONIA,
+      .time_us = 9500000,
+      .ammonia = {.raw = 2048, .voltage_mv = 1650, .variance = 12.4f,
+                  .ppm = 3.5f},
+  };
+  CHECK_INT(bulk_frame_record(buf, &sample, 10000), BULK_FRAME_RECORD_SIZE);
+  CHECK_INT(get_u32(&buf[0]), 77);
+  CHECK_INT(get_u32(&buf[4]), 500);
+  CHECK_INT(buf[8], SENSOR_SAMPLE_AMMONIA);
+  CHECK_INT(get_i16(&buf[10]), 1650);
+  CHECK_INT(get_i16(&buf[12]), 2048);
+  CHECK_INT(get_u16(&buf[14]), 12);
+  CHECK_INT(get_u16(&buf[16]), 350);
+  CHECK_INT(get_u16(&buf[18]), 0);
+  CHECK_INT(buf[BULK_FRAME_RECORD_SIZE], 0xAA);
+
+  sample = (sensor_sample_t){
+      .version = 78,
+      .kind = SENSOR_SAMPLE_SHT30,
+      .time_us = 10000000,
+      .sht30 = {.temperature = -4.256f, .humidity = 61.5f},
+  };
+  bulk_frame_record(buf, &sample, 10000);
+  CHECK_INT(get_u32(&buf[0]), 78);
+  CHECK_INT(get_u32(&buf[4]), 0);
+  CHECK_INT(buf[8], SENSOR_SAMPLE_SHT30);
+  CHECK_INT(get_i16(&buf[10]), -426);
+  CHECK_INT(get_i16(&buf[12]), 6150);
+  CHECK_INT(get_u16(&buf[14]), 0);
+  CHECK_INT(get_u16(&buf[16]), 0);
+}
+
+// Values outside the 16-bit fields saturate, NaN reads as the minimum
+static void test_clamping(void) {
+  uint8_t buf[BULK_FRAME_RECORD_SIZE];
+  sensor_sample_t sample = {
+      .kind = SENSOR_SAMPLE_AMMONIA,
+      .time_us = 0,
+      .ammonia = {.raw = 100000, .voltage_mv = -100000, .variance = 1e9f},
+  };
+  bulk_frame_record(buf, &sample, 0);
+  CHECK_INT(get_i16(&buf[10]), INT16_MIN);
+  CHECK_INT(get_i16(&buf[12]), INT16_MAX);
+  CHECK_INT(get_u16(&buf[14]), UINT16_MAX);
+
+  sample.ammonia.variance = NAN;
+  bulk_frame_record(buf, &sample, 0);
+  CHECK_INT(get_u16(&buf[14]), 0);
+
+  sample = (sensor_sample_t){
+      .kind = SENSOR_SAMPLE_SHT30,
+      .time_us = 0,
+      .sht30 = {.temperature = NAN, .humidity = 400.0f},
+  };
+  bulk_frame_record(buf, &sample, 0);
+  CHECK_INT(get_i16(&buf[10]), INT16_MIN);
+  CHECK_INT(get_i16(&buf[12]), INT16_MAX);
+}
+
+// ppm in hundredths; uncalibrated has its own value, never a saturated one
+static void test_ppm(void) {
+  uint8_t buf[BULK_FRAME_RECORD_SIZE];
+  sensor_sample_t sample = {.kind = SENSOR_SAMPLE_AMMONIA, .time_us = 0};
+  static const struct {
+    float ppm;
+    unsigned v3;
+  } cases[] = {
+      {NAN, BULK_PPM_UNCALIBRATED},
+      {0.0f, 0},
+      {-2.0f, 0},
+      {0.004f, 0},
+      {0.006f, 1},
+      {25.0f, 2500},
+      {655.34f, 65534},
+      {655.35f, 65534},
+      {1e6f, 65534},
+      {INFINITY, 65534},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    sample.ammonia.ppm = cases[i].ppm;
+    bulk_frame_record(buf, &sample, 0);
+    CHECK_INT(get_u16(&buf[16]), cases[i].v3);
+  }
+}
+
+static void test_resume(void) {
+  bool gap = true;
+
+  // Nothing logged yet
+  CHECK_INT(bulk_frame_resume(0, 0, 0, &gap), 0);
+  CHECK(!gap);
+
+  // The log still reaches back to since + 1
+  CHECK_INT(bulk_frame_resume(0, 100, 1, &gap), 0);
+  CHECK(!gap);
+  CHECK_INT(bulk_frame_resume(600, 1000, 489, &gap), 600);
+  CHECK(!gap);
+  CHECK_INT(bulk_frame_resume(488, 1000, 489, &gap), 488);
+  CHECK(!gap);
+  CHECK_INT(bulk_frame_resume(1000, 1000, 489, &gap), 1000);
+  CHECK(!gap);
+
+  // Samples after since were overwritten: read on from the oldest
+  CHECK_INT(bulk_frame_resume(487, 1000, 489, &gap), 487);
+  CHECK(gap);
+
+  // since from before a reboot: start over
+  CHECK_INT(bulk_frame_resume(1001, 1000, 489, &gap), 0);
+  CHECK(gap);
+  CHECK_INT(bulk_frame_resume(5000, 3, 1, &gap), 0);
+  CHECK(gap);
+  CHECK_INT(bulk_frame_resume(1, 0, 0, &gap), 0);
+  CHECK(gap);
+}
+
+int main(void) {
+  RUN_TEST(test_header);
+  RUN_TEST(test_records);
+  RUN_TEST(test_clamping);
+  RUN_TEST(test_ppm);
+  RUN_TEST(test_resume);
+  return TEST_RESULT();
+}
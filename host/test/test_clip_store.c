@@ -0,0 +1,315 @@
+#include "clip_io_file.h"
+#include "clip_store.h"
+#include "test.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SEGS 4
+#define AREA_SIZE (SEGS * CLIP_SEGMENT_SIZE)
+// Odd length to exercise record alignment; 5 frames fit in a segment
+#define FRAME_LEN 50001
+#define FRAMES_PER_SEG 5
+
+static clip_store_t s_st;
+static clip_store_t s_st2;
+static uint8_t s_frame[FRAME_LEN];
+static uint8_t s_readback[FRAME_LEN];
+
+// Frame contents depend on clip and time, so read-back catches mix-ups
+static void fill_frame(uint32_t clip, uint32_t t_ms) {
+  uint32_t x = clip * 2654435761u ^ t_ms;
+  for (size_t i = 0; i < FRAME_LEN; i++) {
+    x = x * 1103515245u + 12345u;
+    s_frame[i] = (uint8_t)(x >> 16);
+  }
+}
+
+static esp_err_t append(clip_store_t *st, uint32_t clip, uint32_t t_ms) {
+  fill_frame(clip, t_ms);
+  return clip_store_append(st, t_ms, s_frame, FRAME_LEN);
+}
+
+// Record a clip with frames every 500 ms; returns its id
+static uint32_t record(clip_store_t *st, uint32_t start_ms, int frames) {
+  uint32_t id = 0;
+  CHECK_INT(clip_store_begin(st, start_ms, &id), ESP_OK);
+  for (int i = 0; i < frames; i++) {
+    CHECK_INT(append(st, id, i * 500), ESP_OK);
+  }
+  clip_store_end(st);
+  return id;
+}
+
+// Play a clip from from_ms and check every frame's time and contents;
+// returns the number of frames
+static int play(clip_store_t *st, uint32_t id, uint32_t from_ms,
+                uint32_t first_t_ms) {
+  clip_cursor_t cur;
+  if (clip_store_open(st, id, from_ms, &cur) != ESP_OK) {
+    return -1;
+  }
+  int n = 0;
+  clip_frame_t frame;
+  while (clip_store_next_frame(st, &cur, &frame) == ESP_OK) {
+    CHECK_INT(frame.t_ms, first_t_ms + n * 500);
+    CHECK_INT(frame.len, FRAME_LEN);
+    CHECK_INT(clip_store_read(st, frame.offset, s_readback, frame.len),
+              ESP_OK);
+    fill_frame(id, frame.t_ms);
+    CHECK(memcmp(s_readback, s_frame, FRAME_LEN) == 0);
+    n++;
+  }
+  return n;
+}
+
+static int seg_of(const clip_store_t *st, uint32_t seq) {
+  for (int i = 0; i < st->seg_count; i++) {
+    if (st->segs[i].seq == seq) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Index of a fresh mount compared with the one built while recording
+static void check_same_index(const clip_store_t *a, const clip_store_t *b) {
+  clip_info_t la[CLIP_MAX_CLIPS];
+  clip_info_t lb[CLIP_MAX_CLIPS];
+  int na = clip_store_list(a, la, CLIP_MAX_CLIPS);
+  int nb = clip_store_list(b, lb, CLIP_MAX_CLIPS);
+  CHECK_INT(nb, na);
+  for (int i = 0; i < na && i < nb; i++) {
+    CHECK_INT(lb[i].id, la[i].id);
+    CHECK_INT(lb[i].start_ms, la[i].start_ms);
+    CHECK_INT(lb[i].duration_ms, la[i].duration_ms);
+    CHECK_INT(lb[i].frames, la[i].frames);
+    CHECK_INT(lb[i].bytes, la[i].bytes);
+    CHECK_INT(lb[i].seg_seq, la[i].seg_seq);
+    CHECK_INT(lb[i].offset, la[i].offset);
+  }
+  for (int i = 0; i < a->seg_count; i++) {
+    CHECK_INT(b->segs[i].seq, a->segs[i].seq);
+    CHECK_INT(b->segs[i].erase_count, a->segs[i].erase_count);
+    CHECK_INT(b->segs[i].first_clip, a->segs[i].first_clip);
+    CHECK_INT(b->segs[i].first_t_ms, a->segs[i].first_t_ms);
+  }
+  CHECK_INT(b->cur_seg, a->cur_seg);
+  CHECK_INT(b->next_clip_id, a->next_clip_id);
+}
+
+static void test_mount_blank(void) {
+  clip_io_file_t f;
+  CHECK_INT(clip_io_file_open(&f, NULL, AREA_SIZE), ESP_OK);
+  CHECK_INT(clip_store_mount(&s_st, &f.io), ESP_OK);
+  CHECK_INT(s_st.seg_count, SEGS);
+  CHECK_INT(s_st.clip_count, 0);
+  CHECK_INT(s_st.cur_seg, -1);
+  CHECK_INT(s_st.boot, 1);
+  clip_info_t info;
+  CHECK_INT(clip_store_find(&s_st, 1, &info), ESP_ERR_NOT_FOUND);
+  clip_io_file_close(&f);
+
+  CHECK_INT(clip_io_file_open(&f, NULL, CLIP_SEGMENT_SIZE), ESP_OK);
+  CHECK_INT(clip_store_mount(&s_st, &f.io), ESP_ERR_INVALID_SIZE);
+  clip_io_file_close(&f);
+}
+
+static void test_mount_rescan(void) {
+  char path[] = "/tmp/clip_store_XXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  close(fd);
+
+  clip_io_file_t f;
+  CHECK_INT(clip_io_file_open(&f, path, AREA_SIZE), ESP_OK);
+  CHECK_INT(clip_store_mount(&s_st, &f.io), ESP_OK);
+  uint32_t a = record(&s_st, 1000, 3);
+  uint32_t b = record(&s_st, 9000, 7); // Crosses into the second segment
+  CHECK_INT(a, 1);
+  CHECK_INT(b, 2);
+  clip_io_file_close(&f);
+
+  // Reboot: the index comes back from the image alone
+  CHECK_INT(clip_io_file_open(&f, path, AREA_SIZE), ESP_OK);
+  CHECK_INT(clip_store_mount(&s_st2, &f.io), ESP_OK);
+  s_st.io = &f.io;
+  check_same_index(&s_st, &s_st2);
+  CHECK_INT(s_st2.boot, 2);
+  clip_info_t info;
+  CHECK_INT(clip_store_find(&s_st2, b, &info), ESP_OK);
+  CHECK_INT(info.frames, 7);
+  CHECK_INT(info.duration_ms, 3000);
+  CHECK_INT(info.bytes, 7 * FRAME_LEN);
+  CHECK_INT(info.boot, 1);
+  CHECK_INT(play(&s_st2, a, 0, 0), 3);
+  CHECK_INT(play(&s_st2, b, 0, 0), 7);
+
+  // Appending resumes where the last session stopped, with new ids
+  uint32_t used = s_st2.segs[s_st2.cur_seg].used;
+  uint32_t c = record(&s_st2, 500, 1);
+  CHECK_INT(c, 3);
+  CHECK_INT(clip_store_find(&s_st2, c, &info), ESP_OK);
+  CHECK_INT(info.boot, 2);
+  CHECK_INT(info.offset, used);
+  CHECK_INT(f.program_errors, 0);
+  clip_io_file_close(&f);
+  unlink(path);
+}
+
+static void test_torn_record(void) {
+  // Power lost after the header, or after the data: the commit word is
+  // still erased either way
+  for (int written = 1; written <= 2; written++) {
+    clip_io_file_t f;
+    CHECK_INT(clip_io_file_open(&f, NULL, AREA_SIZE), ESP_OK);
+    CHECK_INT(clip_store_mount(&s_st, &f.io), ESP_OK);
+    uint32_t id = 0;
+    CHECK_INT(clip_store_begin(&s_st, 0, &id), ESP_OK);
+    CHECK_INT(append(&s_st, id, 0), ESP_OK);
+    CHECK_INT(append(&s_st, id, 500), ESP_OK);
+    int seg = s_st.cur_seg;
+    f.writes_left = written;
+    CHECK(append(&s_st, id, 1000) != ESP_OK);
+    f.writes_left = -1;
+
+    CHECK_INT(clip_store_mount(&s_st2, &f.io), ESP_OK);
+    clip_info_t info;
+    CHECK_INT(clip_store_find(&s_st2, id, &info), ESP_OK);
+    CHECK_INT(info.frames, 2);
+    CHECK_INT(info.duration_ms, 500);
+    // The segment is closed at the torn record
+    CHECK_INT(s_st2.segs[seg].used, CLIP_SEGMENT_SIZE);
+    CHECK_INT(play(&s_st2, id, 0, 0), 2);
+
+    // The next clip starts in a fresh segment
+    uint32_t next = record(&s_st2, 0, 1);
+    CHECK(s_st2.cur_seg != seg);
+    CHECK_INT(play(&s_st2, next, 0, 0), 1);
+    CHECK_INT(play(&s_st2, id, 0, 0), 2);
+    CHECK_INT(f.program_errors, 0);
+    clip_io_file_close(&f);
+  }
+}
+
+static void test_ring_rotation(void) {
+  clip_io_file_t f;
+  CHECK_INT(clip_io_file_open(&f, NULL, AREA_SIZE), ESP_OK);
+  CHECK_INT(clip_store_mount(&s_st, &f.io), ESP_OK);
+
+  // Three laps of short clips: a clip is listed exactly as long as the
+  // segment holding its start record has not been reused
+  uint32_t first_live = 1;
+  for (int i = 0; i < 3 * SEGS * FRAMES_PER_SEG / 3; i++) {
+    record(&s_st, i * 10000, 3);
+    clip_info_t list[CLIP_MAX_CLIPS];
+    int n = clip_store_list(&s_st, list, CLIP_MAX_CLIPS);
+    for (int k = 0; k < n; k++) {
+      CHECK(seg_of(&s_st, list[k].seg_seq) >= 0);
+    }
+    for (uint32_t id = first_live; id < list[n - 1].id; id++) {
+      clip_info_t info;
+      CHECK_INT(clip_store_find(&s_st, id, &info), ESP_ERR_NOT_FOUND);
+    }
+    first_live = list[n - 1].id; // Oldest remaining
+    // Oldest one that survived the rotation plays from its segment
+    CHECK_INT(play(&s_st, list[n - 1].id, 0, 0),
+              (int)list[n - 1].frames);
+  }
+  CHECK(first_live > 1);
+  // Each segment erased once per lap, evenly
+  for (int i = 0; i < SEGS; i++) {
+    CHECK(s_st.segs[i].erase_count >= 2 && s_st.segs[i].erase_count <= 3);
+  }
+
+  // A mount after wrapping sees the same ring
+  CHECK_INT(clip_store_mount(&s_st2, &f.io), ESP_OK);
+  check_same_index(&s_st, &s_st2);
+
+  // A clip longer than the ring loses its own start segment
+  uint32_t id = 0;
+  CHECK_INT(clip_store_begin(&s_st, 0, &id), ESP_OK);
+  esp_err_t err = ESP_OK;
+  int frames = 0;
+  while (err == ESP_OK && frames < 2 * SEGS * FRAMES_PER_SEG) {
+    err = append(&s_st, id, frames * 500);
+    frames++;
+  }
+  CHECK_INT(err, ESP_ERR_INVALID_STATE);
+  CHECK(frames > (SEGS - 1) * FRAMES_PER_SEG);
+  clip_info_t info;
+  CHECK_INT(clip_store_find(&s_st, id, &info), ESP_ERR_NOT_FOUND);
+  CHECK_INT(s_st.recording_id, 0);
+  CHECK_INT(append(&s_st, id, 0), ESP_ERR_INVALID_STATE);
+  CHECK_INT(f.program_errors, 0);
+  clip_io_file_close(&f);
+}
+
+static void test_seek(void) {
+  clip_io_file_t f;
+  CHECK_INT(clip_io_file_open(&f, NULL, AREA_SIZE), ESP_OK);
+  CHECK_INT(clip_store_mount(&s_st, &f.io), ESP_OK);
+  // Frames 0-4 in the first segment, 5-9 in the second, 10-11 in the third
+  uint32_t id = record(&s_st, 0, 12);
+  clip_info_t info;
+  CHECK_INT(clip_store_find(&s_st, id, &info), ESP_OK);
+  uint32_t start_seq = info.seg_seq;
+
+  clip_cursor_t cur;
+  CHECK_INT(clip_store_open(&s_st, id, 0, &cur), ESP_OK);
+  CHECK_INT(cur.seg_seq, start_seq);
+  CHECK_INT(play(&s_st, id, 0, 0), 12);
+
+  // Exactly the first frame of a later segment: starts there
+  CHECK_INT(clip_store_open(&s_st, id, 2500, &cur), ESP_OK);
+  CHECK_INT(cur.seg_seq, start_seq + 1);
+  CHECK_INT(cur.offset, 32); // Right after the segment header
+  CHECK_INT(play(&s_st, id, 2500, 2500), 7);
+
+  // Inside a segment: starts at that segment, skips the earlier frames
+  CHECK_INT(clip_store_open(&s_st, id, 3100, &cur), ESP_OK);
+  CHECK_INT(cur.seg_seq, start_seq + 1);
+  CHECK_INT(play(&s_st, id, 3100, 3500), 5);
+  CHECK_INT(clip_store_open(&s_st, id, 5200, &cur), ESP_OK);
+  CHECK_INT(cur.seg_seq, start_seq + 2);
+  CHECK_INT(play(&s_st, id, 5200, 5500), 1);
+
+  // Before the next segment's first frame: walks on from the start segment
+  CHECK_INT(clip_store_open(&s_st, id, 2200, &cur), ESP_OK);
+  CHECK_INT(cur.seg_seq, start_seq);
+  CHECK_INT(play(&s_st, id, 2200, 2500), 7);
+
+  // Past the end
+  CHECK_INT(play(&s_st, id, 6000, 0), 0);
+  CHECK_INT(clip_store_open(&s_st, id + 1, 0, &cur), ESP_ERR_NOT_FOUND);
+
+  // A following clip stops playback of this one
+  uint32_t next = record(&s_st, 0, 2);
+  CHECK_INT(play(&s_st, id, 5000, 5000), 2);
+  CHECK_INT(play(&s_st, next, 0, 0), 2);
+
+  // The seek index is rebuilt on mount
+  CHECK_INT(clip_store_mount(&s_st2, &f.io), ESP_OK);
+  CHECK_INT(clip_store_open(&s_st2, id, 3100, &cur), ESP_OK);
+  CHECK_INT(cur.seg_seq, start_seq + 1);
+  CHECK_INT(play(&s_st2, id, 3100, 3500), 5);
+
+  // A cursor dies with its segment
+  CHECK_INT(clip_store_open(&s_st, id, 0, &cur), ESP_OK);
+  while (clip_store_find(&s_st, id, &info) == ESP_OK) {
+    record(&s_st, 0, FRAMES_PER_SEG);
+  }
+  CHECK(!clip_store_cursor_valid(&s_st, &cur));
+  clip_frame_t frame;
+  CHECK_INT(clip_store_next_frame(&s_st, &cur, &frame), ESP_ERR_NOT_FOUND);
+  clip_io_file_close(&f);
+}
+
+int main(void) {
+  RUN_TEST(test_mount_blank);
+  RUN_TEST(test_mount_rescan);
+  RUN_TEST(test_torn_record);
+  RUN_TEST(test_ring_rotation);
+  RUN_TEST(test_seek);
+  return TEST_RESULT();
+}
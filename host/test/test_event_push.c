@@ -0,0 +1,163 @@
+#include "event_push.h"
+#include "mock_hal.h"
+#include "sensor_snapshot.h"
+#include "test.h"
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// A send that waits for a client that never reads hangs the test; the alarm
+// turns that into a failure
+#define HANG_TIMEOUT_S 10
+#define WAIT_MS 2000
+
+typedef struct {
+  int server;     // Descriptor the device side writes to
+  int peer;       // Browser side
+  char buf[4096]; // Read from peer, not yet matched
+  size_t len;
+} client_t;
+
+static void connect_client(client_t *c) {
+  int sv[2];
+  CHECK_INT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  httpd_req_t req = {.mock_sockfd = sv[0]};
+  CHECK_INT(event_push_handler(&req), ESP_OK);
+  c->server = sv[0];
+  c->peer = sv[1];
+  c->len = 0;
+}
+
+// Reads from the peer until needle arrives and consumes everything up to
+// it; false on timeout or EOF
+static bool wait_for(client_t *c, const char *needle) {
+  size_t keep = strlen(needle) - 1;
+  while (true) {
+    c->buf[c->len] = '\0';
+    char *match = strstr(c->buf, needle);
+    if (match != NULL) {
+      size_t used = match - c->buf + strlen(needle);
+      memmove(c->buf, c->buf + used, c->len - used);
+      c->len -= used;
+      return true;
+    }
+    // Keep a tail that may hold the start of needle
+    if (c->len > keep) {
+      memmove(c->buf, c->buf + c->len - keep, keep);
+      c->len = keep;
+    }
+    if (poll(&(struct pollfd){.fd = c->peer, .events = POLLIN}, 1,
+             WAIT_MS) <= 0) {
+      return false;
+    }
+    ssize_t n = read(c->peer, c->buf + c->len, sizeof(c->buf) - 1 - c->len);
+    if (n <= 0) {
+      return false;
+    }
+    c->len += n;
+  }
+}
+
+// Fills the connection until the device side would block, as a tab in the
+// background that stopped reading does
+static void stall(const client_t *c) {
+  static const char junk[4096];
+  while (send(c->server, junk, sizeof(junk), MSG_DONTWAIT) > 0) {
+  }
+}
+
+static bool wait_client_count(int count) {
+  for (int ms = 0; ms < WAIT_MS; ms += 10) {
+    if (event_push_client_count() == count) {
+      return true;
+    }
+    usleep(10000);
+  }
+  return event_push_client_count() == count;
+}
+
+static client_t s_first, s_second, s_third;
+
+static void test_connect(void) {
+  connect_client(&s_first);
+  CHECK_INT(event_push_client_count(), 1);
+  CHECK(wait_for(&s_first, "text/event-stream"));
+  CHECK(wait_for(&s_first, "\"camera\":{"));
+
+  event_push_send("alarm", "{\"rule\":\"a\"}");
+  CHECK(wait_for(&s_first, "event: alarm\ndata: {\"rule\":\"a\"}\n\n"));
+}
+
+// event_push_send() returns at once and only loses the stalled client
+static void test_send_stalled(void) {
+  static client_t stalled;
+  connect_client(&stalled);
+  connect_client(&s_second);
+  CHECK(wait_for(&stalled, "\"camera\":{"));
+  CHECK(wait_for(&s_second, "\"camera\":{"));
+  CHECK(wait_client_count(3));
+
+  stall(&stalled);
+  alarm(HANG_TIMEOUT_S);
+  event_push_send("alarm", "{\"rule\":\"b\"}");
+  alarm(0);
+
+  CHECK_INT(event_push_client_count(), 2);
+  CHECK(wait_for(&s_first, "{\"rule\":\"b\"}"));
+  CHECK(wait_for(&s_second, "{\"rule\":\"b\"}"));
+
+  // Dropped: the browser sees the connection end
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(stalled.peer, buf, sizeof(buf))) > 0) {
+  }
+  CHECK_INT(n, 0);
+  close(stalled.server);
+  close(stalled.peer);
+}
+
+// The push task drops a stalled client and goes on serving the others
+static void test_push_stalled(void) {
+  connect_client(&s_third);
+  CHECK(wait_for(&s_third, "\"camera\":{"));
+  CHECK(wait_client_count(3));
+
+  stall(&s_third);
+  alarm(HANG_TIMEOUT_S);
+  sensor_snapshot_publish_sht30(22.5f, 55.0f);
+  event_push_notify();
+  CHECK(wait_client_count(2));
+  CHECK(wait_for(&s_first, "\"temperature\":22.5"));
+  CHECK(wait_for(&s_second, "\"temperature\":22.5"));
+
+  // The push task is not stuck
+  sensor_snapshot_publish_sht30(23.5f, 55.0f);
+  event_push_notify();
+  CHECK(wait_for(&s_first, "\"temperature\":23.5"));
+  alarm(0);
+}
+
+// Part of an event can't be finished later, so the client goes
+static void test_partial_write(void) {
+  mock_socket_set_write_limit(8);
+  event_push_send("alarm", "{\"rule\":\"c\"}");
+  mock_socket_set_write_limit(0);
+  CHECK_INT(event_push_client_count(), 0);
+
+  // Its slot is free again
+  static client_t c;
+  connect_client(&c);
+  CHECK(wait_for(&c, "\"camera\":{"));
+  CHECK_INT(event_push_client_count(), 1);
+}
+
+int main(void) {
+  CHECK_INT(event_push_init(), ESP_OK);
+
+  RUN_TEST(test_connect);
+  RUN_TEST(test_send_stalled);
+  RUN_TEST(test_push_stalled);
+  RUN_TEST(test_partial_write);
+  return TEST_RESULT();
+}
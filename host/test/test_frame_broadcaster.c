@@ -0,0 +1,214 @@
+#include "esp_camera.h"
+#include "frame_broadcaster.h"
+#include "freertos/task.h"
+#include "mock_hal.h"
+#include "test.h"
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FB_COUNT FRAME_BROADCASTER_SLOTS
+#define VIEWERS 4
+#define VIEWER_FRAMES 50
+
+// Same shape as the camera source in main.c
+static void *camera_get(void *ctx, const uint8_t **buf, size_t *len) {
+  camera_fb_t *fb = esp_camera_fb_get();
+  if (fb != NULL) {
+    *buf = fb->buf;
+    *len = fb->len;
+  }
+  return fb;
+}
+
+static void camera_put(void *ctx, void *handle) {
+  esp_camera_fb_return((camera_fb_t *)handle);
+}
+
+static const frame_source_t s_source = {
+    .get = camera_get,
+    .put = camera_put,
+};
+
+static void load_frames(void) {
+  uint8_t frame[400];
+  for (int i = 0; i < 3; i++) {
+    size_t len = 200 + i * 50;
+    memset(frame, 0x55, len);
+    frame[0] = 0xFF;
+    frame[1] = 0xD8;
+    frame[2] = (uint8_t)i;
+    frame[len - 2] = 0xFF;
+    frame[len - 1] = 0xD9;
+    mock_camera_add_frame(frame, len);
+  }
+  // Not a JPEG: must never reach a viewer
+  memset(frame, 0, sizeof(frame));
+  mock_camera_add_frame(frame, sizeof(frame));
+}
+
+static bool valid(const shared_frame_t *f) {
+  return f->len >= 200 && f->buf[0] == 0xFF && f->buf[1] == 0xD8 &&
+         f->buf[f->len - 1] == 0xD9 && f->len == 200 + f->buf[2] * 50u;
+}
+
+static void test_single_viewer(void) {
+  CHECK_INT(frame_broadcaster_subscribe(), ESP_OK);
+  CHECK_INT(frame_broadcaster_subscriber_count(), 1);
+
+  uint32_t last = 0;
+  for (int i = 0; i < 30; i++) {
+    const shared_frame_t *f =
+        frame_broadcaster_acquire(last, pdMS_TO_TICKS(1000));
+    CHECK(f != NULL);
+    if (f == NULL) {
+      break;
+    }
+    CHECK(f->seq > last);
+    CHECK(valid(f));
+    last = f->seq;
+    frame_broadcaster_release(f);
+  }
+  frame_broadcaster_unsubscribe();
+  CHECK_INT(frame_broadcaster_subscriber_count(), 0);
+}
+
+// Viewers keep notification index 0 for their own use: the broadcaster
+// neither consumes nor adds to it
+static void test_notify_index(void) {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  xTaskNotifyGive(self);
+  CHECK_INT(frame_broadcaster_subscribe(), ESP_OK);
+
+  uint32_t last = 0;
+  for (int i = 0; i < 5; i++) {
+    const shared_frame_t *f =
+        frame_broadcaster_acquire(last, pdMS_TO_TICKS(1000));
+    CHECK(f != NULL);
+    if (f == NULL) {
+      break;
+    }
+    last = f->seq;
+    frame_broadcaster_release(f);
+  }
+  // Let a few more frames be published while not waiting
+  usleep(50000);
+  frame_broadcaster_unsubscribe();
+
+  CHECK_INT(ulTaskNotifyTake(pdTRUE, 0), 1);
+  CHECK(ulTaskNotifyTakeIndexed(FRAME_BROADCASTER_NOTIFY_INDEX, pdTRUE, 0) >
+        0);
+}
+
+typedef struct {
+  atomic_int frames;
+  atomic_int errors;
+  atomic_bool done;
+} viewer_t;
+
+static void viewer_task(void *arg) {
+  viewer_t *v = arg;
+  frame_broadcaster_subscribe();
+  uint32_t last = 0;
+  for (int i = 0; i < VIEWER_FRAMES; i++) {
+    const shared_frame_t *f =
+        frame_broadcaster_acquire(last, pdMS_TO_TICKS(1000));
+    if (f == NULL) {
+      atomic_fetch_add(&v->errors, 1);
+      break;
+    }
+    if (f->seq <= last || !valid(f)) {
+      atomic_fetch_add(&v->errors, 1);
+    }
+    last = f->seq;
+    atomic_fetch_add(&v->frames, 1);
+    frame_broadcaster_release(f);
+  }
+  frame_broadcaster_unsubscribe();
+  atomic_store(&v->done, true);
+  vTaskDelete(NULL);
+}
+
+static void test_concurrent_viewers(void) {
+  static viewer_t viewers[VIEWERS];
+  for (int i = 0; i < VIEWERS; i++) {
+    CHECK_INT(xTaskCreate(viewer_task, "viewer", 4096, &viewers[i], 5, NULL),
+              pdPASS);
+  }
+  for (int i = 0; i < VIEWERS; i++) {
+    for (int ms = 0; ms < 10000 && !atomic_load(&viewers[i].done); ms++) {
+      usleep(1000);
+    }
+    CHECK(atomic_load(&viewers[i].done));
+    CHECK_INT(atomic_load(&viewers[i].frames), VIEWER_FRAMES);
+    CHECK_INT(atomic_load(&viewers[i].errors), 0);
+  }
+  CHECK(mock_camera_outstanding() <= FB_COUNT);
+}
+
+// A viewer holding frames stalls capture instead of exhausting the driver
+static void test_slow_viewer_back_pressure(void) {
+  CHECK_INT(frame_broadcaster_subscribe(), ESP_OK);
+  const shared_frame_t *a = frame_broadcaster_acquire(0, pdMS_TO_TICKS(1000));
+  CHECK(a != NULL);
+  const shared_frame_t *b =
+      a != NULL ? frame_broadcaster_acquire(a->seq, pdMS_TO_TICKS(1000))
+                : NULL;
+  CHECK(b != NULL);
+  if (a == NULL || b == NULL) {
+    frame_broadcaster_unsubscribe();
+    return;
+  }
+
+  // The third slot fills with the latest frame; after it nothing is free
+  const shared_frame_t *c = frame_broadcaster_acquire(b->seq, 1000);
+  CHECK(c != NULL);
+  uint32_t last = c != NULL ? c->seq : b->seq;
+  frame_broadcaster_release(c);
+  CHECK(frame_broadcaster_acquire(last, pdMS_TO_TICKS(200)) == NULL);
+  CHECK_INT(mock_camera_outstanding(), FB_COUNT);
+
+  // Releasing one held frame lets capture continue
+  frame_broadcaster_release(a);
+  const shared_frame_t *d = frame_broadcaster_acquire(last, 1000);
+  CHECK(d != NULL && d->seq > last);
+  frame_broadcaster_release(d);
+  frame_broadcaster_release(b);
+  frame_broadcaster_unsubscribe();
+}
+
+static void test_stop_drains(void) {
+  CHECK_INT(frame_broadcaster_subscribe(), ESP_OK);
+  const shared_frame_t *f = frame_broadcaster_acquire(0, 1000);
+  CHECK(f != NULL);
+  frame_broadcaster_release(f);
+  frame_broadcaster_unsubscribe();
+
+  CHECK_INT(frame_broadcaster_stop(pdMS_TO_TICKS(1000)), ESP_OK);
+  CHECK_INT(mock_camera_outstanding(), 0);
+  // Stopped: acquire returns at once instead of waiting out the timeout
+  CHECK(frame_broadcaster_acquire(0, portMAX_DELAY) == NULL);
+
+  CHECK_INT(frame_broadcaster_start(), ESP_OK);
+  CHECK_INT(frame_broadcaster_subscribe(), ESP_OK);
+  f = frame_broadcaster_acquire(0, 1000);
+  CHECK(f != NULL && valid(f));
+  frame_broadcaster_release(f);
+  frame_broadcaster_unsubscribe();
+}
+
+int main(void) {
+  camera_config_t config = {.pixel_format = PIXFORMAT_JPEG,
+                            .fb_count = FB_COUNT};
+  CHECK_INT(esp_camera_init(&config), ESP_OK);
+  load_frames();
+  CHECK_INT(frame_broadcaster_init(&s_source), ESP_OK);
+  CHECK_INT(frame_broadcaster_start(), ESP_OK);
+
+  RUN_TEST(test_single_viewer);
+  RUN_TEST(test_notify_index);
+  RUN_TEST(test_concurrent_viewers);
+  RUN_TEST(test_slow_viewer_back_pressure);
+  RUN_TEST(test_stop_drains);
+  return TEST_RESULT();
+}
@@ -0,0 +1,147 @@
+#include "mjpeg_framing.h"
+#include "mock_hal.h"
+#include "test.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Small socket buffers so large frames go out in many partial writes
+#define SNDBUF_BYTES 4096
+
+typedef struct {
+  int fd;
+  uint8_t *buf;
+  size_t cap;
+  size_t len;
+} reader_t;
+
+static void *reader_thread(void *arg) {
+  reader_t *r = arg;
+  while (r->len < r->cap) {
+    // Short reads keep the writer's buffer full most of the time
+    size_t want = r->cap - r->len < 1000 ? r->cap - r->len : 1000;
+    ssize_t n = read(r->fd, &r->buf[r->len], want);
+    if (n <= 0) {
+      break;
+    }
+    r->len += (size_t)n;
+  }
+  return NULL;
+}
+
+static void socket_pair(int fds[2]) {
+  CHECK_INT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  int size = SNDBUF_BYTES;
+  setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+  setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+}
+
+static void test_part_header(void) {
+  char buf[MJPEG_PART_HDR_MAX];
+  char expected[MJPEG_PART_HDR_MAX];
+  const size_t lengths[] = {0,      1,       9,          10,     99999,
+                            100000, 4000000, 4294967295u};
+
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    size_t len = mjpeg_part_header(buf, lengths[i]);
+    int exp_len = snprintf(expected, sizeof(expected),
+                           "\r\n--%s\r\nContent-Type: image/jpeg\r\n"
+                           "Content-Length: %zu\r\n\r\n",
+                           MJPEG_PART_BOUNDARY, lengths[i]);
+    CHECK_INT(len, exp_len);
+    CHECK(len <= MJPEG_PART_HDR_MAX);
+    CHECK(memcmp(buf, expected, len) == 0);
+  }
+}
+
+static void test_response_header(void) {
+  int fds[2];
+  socket_pair(fds);
+  CHECK_INT(mjpeg_send_response_header(fds[0], 15), ESP_OK);
+  close(fds[0]);
+
+  char buf[512] = {0};
+  size_t len = 0;
+  ssize_t n;
+  while ((n = read(fds[1], &buf[len], sizeof(buf) - 1 - len)) > 0) {
+    len += (size_t)n;
+  }
+  close(fds[1]);
+  CHECK(strncmp(buf, "HTTP/1.1 200 OK\r\n", 17) == 0);
+  CHECK(strstr(buf, "multipart/x-mixed-replace;boundary=" MJPEG_PART_BOUNDARY
+                    "\r\n") != NULL);
+  CHECK(strstr(buf, "X-Framerate: 15\r\n") != NULL);
+  CHECK(len >= 4 && memcmp(&buf[len - 4], "\r\n\r\n", 4) == 0);
+}
+
+// Header and data go out in one writev; partial writes must resume
+// mid-vector, including inside the header
+static void test_frame_partial_writes(void) {
+  const size_t jpeg_len = 300 * 1024;
+  uint8_t *jpeg = malloc(jpeg_len);
+  for (size_t i = 0; i < jpeg_len; i++) {
+    jpeg[i] = (uint8_t)(i * 31 + (i >> 8));
+  }
+  char header[MJPEG_PART_HDR_MAX];
+  size_t hlen = mjpeg_part_header(header, jpeg_len);
+
+  int fds[2];
+  socket_pair(fds);
+  reader_t r = {.fd = fds[1], .cap = 2 * (hlen + jpeg_len) + 16};
+  r.buf = malloc(r.cap);
+  pthread_t thread;
+  pthread_create(&thread, NULL, reader_thread, &r);
+
+  mock_socket_set_write_limit(37); // Not a divisor of any length involved
+  CHECK_INT(mjpeg_send_frame(fds[0], jpeg, jpeg_len), ESP_OK);
+  mock_socket_set_write_limit(1000);
+  // Split path used by clip playback
+  CHECK_INT(mjpeg_send_part_header(fds[0], jpeg_len), ESP_OK);
+  CHECK_INT(mjpeg_send_data(fds[0], jpeg, 1000), ESP_OK);
+  CHECK_INT(mjpeg_send_data(fds[0], jpeg + 1000, jpeg_len - 1000), ESP_OK);
+  mock_socket_set_write_limit(0);
+  close(fds[0]);
+  pthread_join(thread, NULL);
+  close(fds[1]);
+
+  CHECK_INT(r.len, 2 * (hlen + jpeg_len));
+  for (int part = 0; part < 2 && r.len == 2 * (hlen + jpeg_len); part++) {
+    const uint8_t *p = &r.buf[part * (hlen + jpeg_len)];
+    CHECK(memcmp(p, header, hlen) == 0);
+    CHECK(memcmp(p + hlen, jpeg, jpeg_len) == 0);
+  }
+  free(r.buf);
+  free(jpeg);
+}
+
+static void test_writable_and_errors(void) {
+  int fds[2];
+  socket_pair(fds);
+  CHECK(mjpeg_socket_writable(fds[0]));
+
+  // Fill the send path until it would block
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  uint8_t chunk[1024] = {0};
+  while (write(fds[0], chunk, sizeof(chunk)) > 0) {
+  }
+  CHECK(!mjpeg_socket_writable(fds[0]));
+
+  // A closed peer fails the send instead of blocking
+  close(fds[1]);
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) & ~O_NONBLOCK);
+  CHECK_INT(mjpeg_send_data(fds[0], chunk, sizeof(chunk)), ESP_FAIL);
+  close(fds[0]);
+}
+
+int main(void) {
+  signal(SIGPIPE, SIG_IGN); // lwIP reports EPIPE without a signal
+  RUN_TEST(test_part_header);
+  RUN_TEST(test_response_header);
+  RUN_TEST(test_frame_partial_writes);
+  RUN_TEST(test_writable_and_errors);
+  return TEST_RESULT();
+}
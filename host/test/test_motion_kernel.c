@@ -0,0 +1,206 @@
+#include "motion_kernel.h"
+#include "pgm.h"
+#include "test.h"
+#include <string.h>
+
+// As in motion_detect.c
+#define PIXEL_THRESHOLD 25
+#define CELL_MIN 8
+#define SCORE_ON 15 // Per mille
+
+#define MAX_W 160
+#define MAX_H 120
+#define RECORDED_FRAMES 6
+
+// Word arrays: the SWAR kernel needs 4-byte aligned images
+static uint32_t s_cur[MAX_W * MAX_H / 4];
+static uint32_t s_ref[MAX_W * MAX_H / 4];
+static uint16_t s_cells_ref[MOTION_MAX_CELLS];
+static uint16_t s_cells_swar[MOTION_MAX_CELLS];
+static motion_blob_work_t s_work;
+
+static uint32_t s_rng = 0x12345678;
+
+static uint32_t rnd(void) {
+  s_rng ^= s_rng << 13;
+  s_rng ^= s_rng >> 17;
+  s_rng ^= s_rng << 5;
+  return s_rng;
+}
+
+static uint8_t clamp_u8(int v) { return v < 0 ? 0 : v > 255 ? 255 : v; }
+
+// Both kernels on the same pair; false on the first mismatch
+static bool kernels_agree(const uint8_t *cur, const uint8_t *ref, int w,
+                          int h, uint8_t threshold) {
+  int cells = (w / MOTION_CELL_W) * (h / MOTION_CELL_H);
+  memset(s_cells_swar, 0xAA, sizeof(s_cells_swar));
+  uint32_t total_ref =
+      motion_diff_cells_ref(cur, ref, w, h, threshold, s_cells_ref);
+  uint32_t total_swar =
+      motion_diff_cells_swar(cur, ref, w, h, threshold, s_cells_swar);
+  if (total_ref != total_swar ||
+      memcmp(s_cells_ref, s_cells_swar, cells * sizeof(uint16_t)) != 0) {
+    fprintf(stderr, "     mismatch at %dx%d threshold %u: %u vs %u\n", w, h,
+            threshold, total_ref, total_swar);
+    return false;
+  }
+  return true;
+}
+
+static void test_swar_matches_ref_random(void) {
+  static const uint8_t edge_thresholds[] = {0, 1, 2, PIXEL_THRESHOLD, 127,
+                                            128, 253, 254, 255};
+  uint8_t *cur = (uint8_t *)s_cur;
+  uint8_t *ref = (uint8_t *)s_ref;
+  int mismatches = 0;
+  for (int iter = 0; iter < 3000; iter++) {
+    int w = (1 + rnd() % (MAX_W / MOTION_CELL_W)) * MOTION_CELL_W;
+    int h = (1 + rnd() % (MAX_H / MOTION_CELL_H)) * MOTION_CELL_H;
+    uint8_t t = iter % 4 == 0
+                    ? edge_thresholds[rnd() % sizeof(edge_thresholds)]
+                    : (uint8_t)rnd();
+
+    for (int i = 0; i < w * h; i++) {
+      ref[i] = (uint8_t)rnd();
+      switch (iter % 3) {
+      case 0: // Unrelated images
+        cur[i] = (uint8_t)rnd();
+        break;
+      case 1: // Differences right around the threshold
+        cur[i] = clamp_u8(ref[i] + (int)(rnd() % 5) - 2 +
+                          (rnd() & 1 ? t : -t));
+        break;
+      default: // Saturated pixels
+        ref[i] = rnd() & 1 ? 255 : 0;
+        cur[i] = rnd() & 1 ? 255 : (uint8_t)rnd();
+        break;
+      }
+    }
+    if (!kernels_agree(cur, ref, w, h, t) && ++mismatches >= 5) {
+      break;
+    }
+  }
+  CHECK_INT(mismatches, 0);
+}
+
+static void test_swar_exhaustive_pairs(void) {
+  // Every (cur, ref) byte pair, in four 128x128 images of 64 cur values each
+  uint8_t *cur = (uint8_t *)s_cur;
+  uint8_t *ref = (uint8_t *)s_ref;
+  static const uint8_t thresholds[] = {0, PIXEL_THRESHOLD, 128, 255};
+  for (size_t k = 0; k < sizeof(thresholds); k++) {
+    for (int chunk = 0; chunk < 4; chunk++) {
+      for (int i = 0; i < 128 * 128; i++) {
+        cur[i] = (uint8_t)(chunk * 64 + (i >> 8));
+        ref[i] = (uint8_t)i;
+      }
+      CHECK(kernels_agree(cur, ref, 128, 128, thresholds[k]));
+    }
+  }
+}
+
+static void test_diff_cells_counts(void) {
+  uint8_t *cur = (uint8_t *)s_cur;
+  uint8_t *ref = (uint8_t *)s_ref;
+  const int w = 16, h = 8; // 2x2 cells
+  memset(cur, 100, w * h);
+  memset(ref, 100, w * h);
+  cur[0] = 126;         // Cell 0, changed by 26
+  cur[1] = 125;         // Cell 0, exactly the threshold: not counted
+  cur[9] = 74;          // Cell 1, changed by -26
+  cur[5 * w + 15] = 0;  // Cell 3
+  uint32_t total = motion_diff_cells_swar(cur, ref, w, h, PIXEL_THRESHOLD,
+                                          s_cells_swar);
+  CHECK_INT(total, 3);
+  CHECK_INT(s_cells_swar[0], 1);
+  CHECK_INT(s_cells_swar[1], 1);
+  CHECK_INT(s_cells_swar[2], 0);
+  CHECK_INT(s_cells_swar[3], 1);
+}
+
+static void test_rgb565_to_luma(void) {
+  // Big-endian RGB565: black, white, red, green, blue
+  const uint8_t rgb[] = {0x00, 0x00, 0xFF, 0xFF, 0xF8, 0x00,
+                         0x07, 0xE0, 0x00, 0x1F};
+  uint8_t luma[5];
+  motion_rgb565_to_luma(rgb, luma, 5);
+  CHECK_INT(luma[0], 0);
+  CHECK_INT(luma[1], 250);
+  CHECK_INT(luma[2], 74);
+  CHECK_INT(luma[3], 147);
+  CHECK_INT(luma[4], 28);
+}
+
+static void test_count_blobs(void) {
+  // 6x4 grid: an L of three cells, a diagonal neighbour (not connected),
+  // a single cell and one just below min_count
+  const uint16_t cells[] = {
+      9, 9, 0, 0, 0, 8, //
+      9, 0, 0, 0, 0, 0, //
+      0, 9, 0, 7, 0, 0, //
+      0, 0, 0, 0, 0, 0, //
+  };
+  int largest;
+  CHECK_INT(motion_count_blobs(cells, 6, 4, CELL_MIN, &s_work, &largest),
+            3);
+  CHECK_INT(largest, 3);
+  CHECK_INT(motion_count_blobs(cells, 6, 4, 10, &s_work, &largest), 0);
+  CHECK_INT(largest, 0);
+  CHECK_INT(motion_count_blobs(cells, 6, 4, 1, &s_work, &largest), 4);
+}
+
+static void test_recorded_frames(void) {
+  static uint32_t frames[RECORDED_FRAMES][MAX_W * MAX_H / 4];
+  int w = 0, h = 0;
+  for (int f = 0; f < RECORDED_FRAMES; f++) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/motion/frame_%02d.pgm", HOST_DATA_DIR,
+             f);
+    int fw, fh;
+    CHECK(pgm_load(path, (uint8_t *)frames[f], sizeof(frames[f]), &fw, &fh));
+    CHECK(f == 0 || (fw == w && fh == h));
+    w = fw;
+    h = fh;
+  }
+  if (test_failures > 0) {
+    return;
+  }
+
+  int cols = w / MOTION_CELL_W;
+  int rows = h / MOTION_CELL_H;
+  for (int f = 1; f < RECORDED_FRAMES; f++) {
+    const uint8_t *cur = (const uint8_t *)frames[f];
+    const uint8_t *ref = (const uint8_t *)frames[f - 1];
+    for (int t = 0; t < 256; t += 5) {
+      CHECK(kernels_agree(cur, ref, w, h, t));
+    }
+
+    // Detector decision with the firmware's parameters: frames 0-1 are
+    // still (noise only), the hen moves from frame 2 on
+    uint32_t changed = motion_diff_cells(cur, ref, w, h, PIXEL_THRESHOLD,
+                                         s_cells_swar);
+    int largest;
+    int blobs = motion_count_blobs(s_cells_swar, cols, rows, CELL_MIN,
+                                   &s_work, &largest);
+    uint32_t score = changed * 1000 / (w * h);
+    if (f == 1) {
+      CHECK_INT(changed, 0);
+      CHECK_INT(blobs, 0);
+    } else {
+      CHECK(score >= SCORE_ON);
+      CHECK(blobs >= 1 && blobs <= 2); // Leading and trailing edge
+      CHECK(largest >= 2);
+    }
+  }
+}
+
+int main(void) {
+  RUN_TEST(test_swar_matches_ref_random);
+  RUN_TEST(test_swar_exhaustive_pairs);
+  RUN_TEST(test_diff_cells_counts);
+  RUN_TEST(test_rgb565_to_luma);
+  RUN_TEST(test_count_blobs);
+  RUN_TEST(test_recorded_frames);
+  return TEST_RESULT();
+}
@@ -0,0 +1,165 @@
+#include "esp_adc/adc_cali.h"
+#include "esp_timer.h"
+#include "mock_hal.h"
+#include "mq137_adc.h"
+#include "test.h"
+
+// Firmware ADC pins (mq137_adc.c)
+#define UNIT ADC_UNIT_1
+#define CHANNEL ADC_CHANNEL_2
+
+// 1 kHz, 100 ms blocks without pauses: 100 samples per read
+static void init(mq137_filter_t filter) {
+  mq137_adc_config_t config = MQ137_ADC_DEFAULT_CONFIG();
+  config.sample_rate_hz = 1000;
+  config.publish_interval_ms = 100;
+  config.burst_ms = 100;
+  config.filter = filter;
+  config.iir_shift = 8;
+  CHECK_INT(mq137_adc_init(&config), ESP_OK);
+}
+
+static void feed_constant(uint16_t value, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    mock_adc_feed(UNIT, CHANNEL, &value, 1);
+  }
+}
+
+static void test_invalid_config(void) {
+  mq137_adc_config_t config = MQ137_ADC_DEFAULT_CONFIG();
+  config.sample_rate_hz = 100; // Below the DMA minimum
+  CHECK_INT(mq137_adc_init(&config), ESP_ERR_INVALID_ARG);
+  config = (mq137_adc_config_t)MQ137_ADC_DEFAULT_CONFIG();
+  config.median_window = 0;
+  CHECK_INT(mq137_adc_init(&config), ESP_ERR_INVALID_ARG);
+  config = (mq137_adc_config_t)MQ137_ADC_DEFAULT_CONFIG();
+  config.burst_ms = config.publish_interval_ms + 1;
+  CHECK_INT(mq137_adc_init(&config), ESP_ERR_INVALID_ARG);
+}
+
+// Without pauses the ADC starts at init and never stops
+static void test_continuous(void) {
+  mock_adc_reset();
+  init(MQ137_FILTER_MEAN);
+  CHECK(mock_adc_running());
+  feed_constant(1000, 150);
+  mq137_reading_t r;
+  CHECK_INT(mq137_adc_read(&r, 0), ESP_OK);
+  CHECK(mock_adc_running());
+  // The rest of the queue is the next block
+  CHECK_INT(mq137_adc_read(&r, 0), ESP_OK);
+  CHECK_INT(r.samples, 50);
+}
+
+// Default bursts: the ADC only runs inside a read, once per interval
+static void test_bursts(void) {
+  mock_adc_reset();
+  mock_clock_set_fake(true);
+  mock_clock_set(0);
+  mq137_adc_config_t config = MQ137_ADC_DEFAULT_CONFIG();
+  CHECK_INT(mq137_adc_init(&config), ESP_OK);
+  CHECK(!mock_adc_running()); // Light sleep is not held off
+
+  uint32_t samples = config.sample_rate_hz * config.burst_ms / 1000;
+  mq137_reading_t r;
+  for (int i = 0; i < 3; i++) {
+    feed_constant(1000 + i, samples + 10);
+    CHECK_INT(mq137_adc_read(&r, 0), ESP_OK);
+    CHECK_INT(r.samples, samples);
+    CHECK_INT(r.raw, 1000 + i);
+    CHECK(!mock_adc_running());
+    // First burst at once, then one per publish interval
+    CHECK_INT(esp_timer_get_time(),
+              (int64_t)i * config.publish_interval_ms * 1000);
+  }
+
+  // Conversions left from a burst are dropped, not read in the next one
+  mq137_reading_t stale;
+  CHECK_INT(mq137_adc_read(&stale, 0), ESP_ERR_TIMEOUT);
+  CHECK(!mock_adc_running());
+  mock_clock_set_fake(false);
+}
+
+static void test_mean_and_conversion(void) {
+  mock_adc_reset();
+  init(MQ137_FILTER_MEAN);
+  // Alternating 1000/1002, interleaved with another channel to skip
+  for (int i = 0; i < 50; i++) {
+    uint16_t pair[2] = {1000, 1002};
+    uint16_t other = 4000;
+    mock_adc_feed(UNIT, CHANNEL, pair, 2);
+    mock_adc_feed(UNIT, ADC_CHANNEL_5, &other, 1);
+  }
+
+  mq137_reading_t r;
+  CHECK_INT(mq137_adc_read(&r, 0), ESP_OK);
+  // First frame: 100 conversions, 67 of them on the sensor channel
+  CHECK_INT(r.samples, 67);
+  CHECK_INT(r.raw, 1001);
+  CHECK_INT(r.voltage_mv, 1001 * MOCK_ADC_CALI_FULL_SCALE_MV / 4095);
+  CHECK_NEAR(r.variance, 1.0, 0.01);
+}
+
+static void test_no_samples(void) {
+  mock_adc_reset();
+  init(MQ137_FILTER_MEAN);
+  mq137_reading_t r;
+  CHECK_INT(mq137_adc_read(&r, 0), ESP_ERR_TIMEOUT);
+
+  // Only the other channel converted
+  uint16_t other[10] = {0};
+  mock_adc_feed(UNIT, ADC_CHANNEL_5, other, 10);
+  CHECK_INT(mq137_adc_read(&r, 0), ESP_ERR_NOT_FOUND);
+}
+
+static void test_uncalibrated_fallback(void) {
+  mock_adc_reset();
+  mock_adc_set_cali(false);
+  init(MQ137_FILTER_MEAN);
+  feed_constant(4095, 100);
+  mq137_reading_t r;
+  CHECK_INT(mq137_adc_read(&r, 0), ESP_OK);
+  CHECK_INT(r.voltage_mv, 3300);
+}
+
+static void test_median_rejects_spikes(void) {
+  mock_adc_reset();
+  init(MQ137_FILTER_MEDIAN); // Windows of 15
+  for (int i = 0; i < 100; i++) {
+    uint16_t v = i % 15 == 3 ? 4095 : i % 15 == 9 ? 0 : 1500;
+    mock_adc_feed(UNIT, CHANNEL, &v, 1);
+  }
+  mq137_reading_t r;
+  CHECK_INT(mq137_adc_read(&r, 0), ESP_OK);
+  CHECK_INT(r.raw, 1500);
+  CHECK(r.variance > 10000); // Statistics still see the spikes
+}
+
+static void test_iir_across_blocks(void) {
+  mock_adc_reset();
+  init(MQ137_FILTER_IIR); // Shift 8, per sample: time constant 256 samples
+  mq137_reading_t r;
+  feed_constant(1000, 100);
+  CHECK_INT(mq137_adc_read(&r, 0), ESP_OK);
+  CHECK_INT(r.raw, 1000); // Primed with the first sample
+
+  // The state carries over from block to block
+  feed_constant(2000, 100);
+  CHECK_INT(mq137_adc_read(&r, 0), ESP_OK);
+  CHECK_NEAR(r.raw, 2000 - 1000 * pow(255.0 / 256, 100), 2);
+  feed_constant(2000, 100);
+  CHECK_INT(mq137_adc_read(&r, 0), ESP_OK);
+  CHECK_NEAR(r.raw, 2000 - 1000 * pow(255.0 / 256, 200), 2);
+}
+
+int main(void) {
+  RUN_TEST(test_invalid_config);
+  RUN_TEST(test_continuous);
+  RUN_TEST(test_bursts);
+  RUN_TEST(test_mean_and_conversion);
+  RUN_TEST(test_no_samples);
+  RUN_TEST(test_uncalibrated_fallback);
+  RUN_TEST(test_median_rejects_spikes);
+  RUN_TEST(test_iir_across_blocks);
+  return TEST_RESULT();
+}
@@ -0,0 +1,141 @@
+#include "nh3_model.h"
+#include "test.h"
+
+#define MAX_REL_ERROR 0.001 // 0.1 %, as documented in nh3_model.h
+
+// Largest relative error of the table against powf() over the table range,
+// sampled on a geometric grid much finer than the 64 segments per octave
+static double max_rel_error(const nh3_model_t *model, double *worst_ratio) {
+  const double lo = ldexp(1.0, NH3_RATIO_MIN_EXP);
+  const double hi = ldexp(1.0, NH3_RATIO_MAX_EXP);
+  const int points = 200000;
+  double max_err = 0;
+  for (int i = 0; i < points; i++) {
+    float ratio = (float)(lo * pow(hi / lo, (double)i / points));
+    double ref = nh3_model_ppm_reference(&model->params, ratio);
+    double err = fabs(nh3_model_ppm(model, ratio) - ref) / ref;
+    if (err > max_err) {
+      max_err = err;
+      *worst_ratio = ratio;
+    }
+  }
+  return max_err;
+}
+
+static void test_lut_error_default(void) {
+  nh3_model_t model;
+  nh3_model_params_t params = NH3_MODEL_DEFAULT_PARAMS();
+  CHECK(nh3_model_init(&model, &params));
+  double worst = 0;
+  double err = max_rel_error(&model, &worst);
+  printf("     max error %.4f %% at Rs/R0 = %.5f\n", err * 100, worst);
+  CHECK(err < MAX_REL_ERROR);
+}
+
+static void test_lut_error_other_curve(void) {
+  // Flatter curves and a slightly steeper one than the MQ-137 default; the
+  // interpolation error grows with b * (b - 1)
+  static const float exponents[] = {-0.5f, -1.0f, -2.0f, -4.0f};
+  for (size_t i = 0; i < sizeof(exponents) / sizeof(exponents[0]); i++) {
+    nh3_model_t model;
+    nh3_model_params_t params = NH3_MODEL_DEFAULT_PARAMS();
+    params.curve_b = exponents[i];
+    CHECK(nh3_model_init(&model, &params));
+    double worst = 0;
+    CHECK(max_rel_error(&model, &worst) < MAX_REL_ERROR);
+  }
+}
+
+static void test_lut_octave_edges(void) {
+  nh3_model_t model;
+  nh3_model_params_t params = NH3_MODEL_DEFAULT_PARAMS();
+  nh3_model_init(&model, &params);
+  // Exact powers of two hit a table point: only fixed-point rounding
+  for (int e = NH3_RATIO_MIN_EXP; e < NH3_RATIO_MAX_EXP; e++) {
+    float ratio = ldexpf(1.0f, e);
+    float ref = nh3_model_ppm_reference(&params, ratio);
+    CHECK_NEAR(nh3_model_ppm(&model, ratio), ref, ref * 1e-5);
+  }
+  CHECK_NEAR(nh3_model_ppm(&model, 1.0f), params.curve_a, 1e-4);
+}
+
+static void test_lut_clamp(void) {
+  nh3_model_t model;
+  nh3_model_params_t params = NH3_MODEL_DEFAULT_PARAMS();
+  nh3_model_init(&model, &params);
+  float at_min = nh3_model_ppm(&model, 0.25f);
+  float at_max = nh3_model_ppm(&model, 7.9999f);
+  CHECK_NEAR(nh3_model_ppm(&model, 0.01f), at_min, at_min * 1e-6);
+  CHECK_NEAR(nh3_model_ppm(&model, 0.0f), at_min, at_min * 1e-6);
+  CHECK_NEAR(nh3_model_ppm(&model, -1.0f), at_min, at_min * 1e-6);
+  CHECK_NEAR(nh3_model_ppm(&model, 100.0f), at_max, at_max * 1e-3);
+  CHECK_NEAR(nh3_model_ppm(&model, INFINITY), at_max, at_max * 1e-3);
+  CHECK(isnan(nh3_model_ppm(&model, NAN)));
+
+  // More resistance, less ammonia, across the whole table
+  float prev = INFINITY;
+  for (float ratio = 0.25f; ratio < 8.0f; ratio *= 1.001f) {
+    float ppm = nh3_model_ppm(&model, ratio);
+    CHECK(ppm <= prev);
+    prev = ppm;
+  }
+}
+
+static void test_init_rejects(void) {
+  nh3_model_t model;
+  nh3_model_params_t params = NH3_MODEL_DEFAULT_PARAMS();
+  params.curve_b = 0.5f;
+  CHECK(!nh3_model_init(&model, &params));
+  params = (nh3_model_params_t)NH3_MODEL_DEFAULT_PARAMS();
+  params.curve_a = 0;
+  CHECK(!nh3_model_init(&model, &params));
+  params = (nh3_model_params_t)NH3_MODEL_DEFAULT_PARAMS();
+  params.curve_a = NAN;
+  CHECK(!nh3_model_init(&model, &params));
+  // a * 0.25^b overflows the 64-bit octave table
+  params = (nh3_model_params_t)NH3_MODEL_DEFAULT_PARAMS();
+  params.curve_b = -30.0f;
+  CHECK(!nh3_model_init(&model, &params));
+}
+
+static void test_rs(void) {
+  nh3_model_t model;
+  nh3_model_params_t params = NH3_MODEL_DEFAULT_PARAMS();
+  nh3_model_init(&model, &params);
+  // Half the supply across RL: Rs = RL
+  CHECK_NEAR(nh3_model_rs(&model, 2500.0f), 10000.0f, 0.01);
+  CHECK_NEAR(nh3_model_rs(&model, 1000.0f), 40000.0f, 0.1);
+  CHECK(nh3_model_rs(&model, 0.0f) < 0);
+  CHECK(nh3_model_rs(&model, -5.0f) < 0);
+  CHECK(nh3_model_rs(&model, 5000.0f) < 0);
+  CHECK(nh3_model_rs(&model, NAN) < 0);
+
+  // Behind a 2:1 divider the pin sees half the output
+  params.adc_scale = 2.0f;
+  nh3_model_init(&model, &params);
+  CHECK_NEAR(nh3_model_rs(&model, 1250.0f), 10000.0f, 0.01);
+}
+
+static void test_compensation(void) {
+  nh3_model_t model;
+  nh3_model_params_t params = NH3_MODEL_DEFAULT_PARAMS();
+  nh3_model_init(&model, &params);
+  CHECK_NEAR(nh3_model_compensation(&model, 20.0f, 65.0f), 1.0, 1e-6);
+  // Warmer and wetter: Rs drops
+  CHECK_NEAR(nh3_model_compensation(&model, 30.0f, 65.0f), 0.955, 1e-5);
+  CHECK_NEAR(nh3_model_compensation(&model, 20.0f, 85.0f), 0.966, 1e-5);
+  // Nonsense readings are clamped
+  CHECK_NEAR(nh3_model_compensation(&model, 200.0f, 100.0f), 0.5, 1e-6);
+  CHECK_NEAR(nh3_model_compensation(&model, -200.0f, 0.0f), 1.5, 1e-6);
+}
+
+int main(void) {
+  RUN_TEST(test_lut_error_default);
+  RUN_TEST(test_lut_error_other_curve);
+  RUN_TEST(test_lut_octave_edges);
+  RUN_TEST(test_lut_clamp);
+  RUN_TEST(test_init_rejects);
+  RUN_TEST(test_rs);
+  RUN_TEST(test_compensation);
+  return TEST_RESULT();
+}
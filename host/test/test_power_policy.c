@@ -0,0 +1,115 @@
+#include "frame_broadcaster.h"
+#include "mock_hal.h"
+#include "motion_detect.h"
+#include "nvs.h"
+#include "power_policy.h"
+#include "test.h"
+#include <stdatomic.h>
+#include <unistd.h>
+
+// The policy checks once a second; with an idle time of 1 s the hook is
+// due within 2 s
+#define IDLE_S 1
+#define WAIT_MS 4000
+
+static atomic_int s_idle_calls;
+
+// As in main.c, without viewers
+static bool camera_busy(void) { return motion_detect_armed(); }
+
+static void camera_idle(void) { atomic_fetch_add(&s_idle_calls, 1); }
+
+// Never started, so the detector only ever sees an empty broadcaster
+static void *no_frame(void *ctx, const uint8_t **buf, size_t *len) {
+  return NULL;
+}
+
+static void no_put(void *ctx, void *handle) {}
+
+static const frame_source_t s_source = {.get = no_frame, .put = no_put};
+
+static bool wait_idle_call(void) {
+  for (int ms = 0; ms < WAIT_MS; ms += 10) {
+    if (atomic_load(&s_idle_calls) > 0) {
+      return true;
+    }
+    usleep(10000);
+  }
+  return false;
+}
+
+static bool wait_subscribers(int count) {
+  for (int ms = 0; ms < WAIT_MS; ms += 10) {
+    if (frame_broadcaster_subscriber_count() == count) {
+      return true;
+    }
+    usleep(10000);
+  }
+  return false;
+}
+
+static int stored_armed(void) {
+  nvs_handle_t nvs;
+  uint8_t armed = 0xFF;
+  if (nvs_open("motion", NVS_READONLY, &nvs) == ESP_OK) {
+    nvs_get_u8(nvs, "armed", &armed);
+    nvs_close(nvs);
+  }
+  return armed;
+}
+
+// Fresh from boot the detector is disarmed: the camera powers down
+static void test_disarmed_goes_idle(void) {
+  CHECK(!motion_detect_armed());
+  power_policy_set_camera(POWER_CAMERA_ON);
+  CHECK_INT(mock_pm_lock_held(ESP_PM_NO_LIGHT_SLEEP), 1);
+
+  CHECK(wait_idle_call());
+  CHECK_INT(frame_broadcaster_subscriber_count(), 0);
+}
+
+// Armed, the detector takes frames and the camera stays on
+static void test_armed_keeps_camera(void) {
+  CHECK_INT(motion_detect_set_armed(true), ESP_OK);
+  CHECK_INT(stored_armed(), 1);
+  CHECK(wait_subscribers(1));
+
+  motion_status_t st;
+  motion_detect_get_status(&st);
+  CHECK(st.armed);
+
+  atomic_store(&s_idle_calls, 0);
+  usleep((IDLE_S + 2) * 1000000);
+  CHECK_INT(atomic_load(&s_idle_calls), 0);
+}
+
+// Disarming lets go of the broadcaster and the camera idles again
+static void test_disarm_releases_camera(void) {
+  CHECK_INT(motion_detect_set_armed(false), ESP_OK);
+  CHECK_INT(stored_armed(), 0);
+  CHECK(wait_subscribers(0));
+  CHECK(wait_idle_call());
+
+  motion_status_t st;
+  motion_detect_get_status(&st);
+  CHECK(!st.armed);
+}
+
+int main(void) {
+  CHECK_INT(frame_broadcaster_init(&s_source), ESP_OK);
+  CHECK_INT(motion_detect_init(), ESP_OK);
+  CHECK_INT(stored_armed(), 0xFF); // Nothing stored yet
+
+  power_policy_config_t config = POWER_POLICY_DEFAULT_CONFIG();
+  config.camera_idle_s = IDLE_S;
+  power_policy_hooks_t hooks = {
+      .camera_busy = camera_busy,
+      .camera_idle = camera_idle,
+  };
+  CHECK_INT(power_policy_init(&config, &hooks), ESP_OK);
+
+  RUN_TEST(test_disarmed_goes_idle);
+  RUN_TEST(test_armed_keeps_camera);
+  RUN_TEST(test_disarm_releases_camera);
+  return TEST_RESULT();
+}
@@ -0,0 +1,131 @@
+#include "quality_ctrl.h"
+#include "test.h"
+
+#define LEVELS 4
+#define S 1000000LL
+
+// 10 fps target with 20 kB frames: 1600 kbit/s demand
+static quality_sample_t sample(float fps, uint32_t kbps) {
+  return (quality_sample_t){
+      .target_fps = 10,
+      .achieved_fps = fps,
+      .throughput_kbps = kbps,
+      .frame_bytes = 20000,
+  };
+}
+
+static void test_headroom(void) {
+  quality_sample_t s = sample(10, 3200);
+  CHECK_INT(quality_ctrl_headroom_pct(&s), 200);
+  s.frame_bytes = 0;
+  CHECK_INT(quality_ctrl_headroom_pct(&s), UINT32_MAX);
+}
+
+static void test_step_down_with_hold(void) {
+  quality_ctrl_t c;
+  quality_ctrl_init(&c, LEVELS, 0, 0);
+  quality_sample_t congested = sample(5, 1000);
+
+  // Not before the down-hold since the last change (init counts)
+  CHECK_INT(quality_ctrl_update(&c, &congested, 1 * S), 0);
+  CHECK_INT(quality_ctrl_update(&c, &congested, 2 * S), 1);
+  CHECK_INT(quality_ctrl_update(&c, &congested, 3 * S), 1);
+  CHECK_INT(quality_ctrl_update(&c, &congested, 4 * S), 2);
+  CHECK_INT(quality_ctrl_update(&c, &congested, 6 * S), 3);
+  // Bottom of the ladder
+  CHECK_INT(quality_ctrl_update(&c, &congested, 8 * S), 3);
+  CHECK_INT(c.changes, 3);
+}
+
+static void test_camera_bound_is_not_congestion(void) {
+  quality_ctrl_t c;
+  quality_ctrl_init(&c, LEVELS, 1, 0);
+  // Missing fps but the link has plenty of room: the camera is slow
+  quality_sample_t s = sample(5, 2500);
+  for (int t = 0; t < 60; t += 2) {
+    CHECK_INT(quality_ctrl_update(&c, &s, t * S), 1);
+  }
+}
+
+static void test_step_up_after_hold(void) {
+  quality_ctrl_t c;
+  quality_ctrl_init(&c, LEVELS, 2, 0);
+  quality_sample_t fast = sample(10, 4000);
+  quality_sample_t tight = sample(10, 2000);
+
+  CHECK_INT(quality_ctrl_update(&c, &fast, 2 * S), 2);
+  // Headroom run broken: the hold starts over
+  CHECK_INT(quality_ctrl_update(&c, &tight, 8 * S), 2);
+  CHECK_INT(quality_ctrl_update(&c, &fast, 10 * S), 2);
+  CHECK_INT(quality_ctrl_update(&c, &fast, 19 * S), 2);
+  CHECK_INT(quality_ctrl_update(&c, &fast, 20 * S), 1);
+  CHECK_INT(quality_ctrl_update(&c, &fast, 25 * S), 1);
+  CHECK_INT(quality_ctrl_update(&c, &fast, 30 * S), 1);
+  CHECK_INT(quality_ctrl_update(&c, &fast, 31 * S), 1);
+  CHECK_INT(quality_ctrl_update(&c, &fast, 40 * S), 0);
+  // Top of the ladder
+  CHECK_INT(quality_ctrl_update(&c, &fast, 100 * S), 0);
+}
+
+// A probe that fails within the probe window doubles the up-hold
+static void test_failed_probe_backoff(void) {
+  quality_ctrl_t c;
+  quality_ctrl_init(&c, LEVELS, 1, 0);
+  quality_sample_t fast = sample(10, 4000);
+  quality_sample_t congested = sample(5, 1000);
+
+  int64_t t = 0;
+  int64_t expected_hold = QUALITY_CTRL_UP_HOLD_US;
+  for (int round = 0; round < 6; round++) {
+    CHECK_INT(c.up_hold_us, expected_hold);
+    // Step up once the (current) hold has passed with headroom
+    int64_t start = t + S;
+    quality_ctrl_update(&c, &fast, start);
+    t = start + c.up_hold_us;
+    CHECK_INT(quality_ctrl_update(&c, &fast, t), 0);
+    // ...and fall back 2 s later
+    t += QUALITY_CTRL_DOWN_HOLD_US;
+    CHECK_INT(quality_ctrl_update(&c, &congested, t), 1);
+    expected_hold *= 2;
+    if (expected_hold > QUALITY_CTRL_UP_HOLD_MAX_US) {
+      expected_hold = QUALITY_CTRL_UP_HOLD_MAX_US;
+    }
+  }
+  CHECK_INT(c.up_hold_us, QUALITY_CTRL_UP_HOLD_MAX_US);
+}
+
+static void test_history_ring(void) {
+  quality_ctrl_t c;
+  quality_ctrl_init(&c, 2, 0, 0);
+  quality_sample_t fast = sample(10, 4000);
+  quality_sample_t congested = sample(5, 1000);
+
+  int64_t t = 0;
+  for (int i = 0; i < QUALITY_CTRL_HISTORY + 3; i++) {
+    t += 200 * S; // Past every hold, so each update changes the level
+    quality_ctrl_update(&c, i % 2 == 0 ? &congested : &fast, t);
+    if (i % 2 == 1) {
+      t += 200 * S;
+      quality_ctrl_update(&c, &fast, t);
+    }
+  }
+  quality_change_t out[QUALITY_CTRL_HISTORY + 4];
+  int n = quality_ctrl_history(&c, out, QUALITY_CTRL_HISTORY + 4);
+  CHECK_INT(n, QUALITY_CTRL_HISTORY);
+  CHECK(c.changes > QUALITY_CTRL_HISTORY);
+  for (int i = 1; i < n; i++) {
+    CHECK(out[i - 1].t_us > out[i].t_us); // Newest first
+    CHECK_INT(out[i - 1].from, out[i].to);
+  }
+  CHECK_INT(quality_ctrl_history(&c, out, 2), 2);
+}
+
+int main(void) {
+  RUN_TEST(test_headroom);
+  RUN_TEST(test_step_down_with_hold);
+  RUN_TEST(test_camera_bound_is_not_congestion);
+  RUN_TEST(test_step_up_after_hold);
+  RUN_TEST(test_failed_probe_backoff);
+  RUN_TEST(test_history_ring);
+  return TEST_RESULT();
+}
@@ -0,0 +1,154 @@
+#include "mock_hal.h"
+#include "sensor_history.h"
+#include "test.h"
+
+#define SAMPLE_US 500000 // 2 Hz, as the sensor tasks record
+#define MAX_READ 2048
+
+static history_point_t s_points[MAX_READ];
+
+// Records value i at i * SAMPLE_US for i in [first, first + n)
+static void record_run(history_sensor_t sensor, int first, int n) {
+  for (int i = first; i < first + n; i++) {
+    mock_clock_set((int64_t)i * SAMPLE_US);
+    sensor_history_record(sensor, (float)i);
+  }
+}
+
+// Reads everything with batches of the given size
+static size_t read_all(history_sensor_t sensor, history_tier_t tier,
+                       uint32_t step_ds, int64_t from_ms, size_t batch) {
+  history_cursor_t cursor = {0};
+  size_t total = 0;
+  while (total < MAX_READ) {
+    size_t want = MAX_READ - total < batch ? MAX_READ - total : batch;
+    size_t n = sensor_history_read(sensor, tier, step_ds, from_ms, &cursor,
+                                   &s_points[total], want);
+    if (n == 0) {
+      break;
+    }
+    total += n;
+  }
+  return total;
+}
+
+// Samples first..last as one bucket
+static void check_point(const history_point_t *p, uint32_t t_ds, int first,
+                        int last) {
+  CHECK_INT(p->t_ds, t_ds);
+  CHECK_NEAR(p->min, first, 0);
+  CHECK_NEAR(p->max, last, 0);
+  CHECK_NEAR(p->mean, (first + last) / 2.0, 1e-3);
+}
+
+static void test_tier_for_step(void) {
+  CHECK_INT(sensor_history_tier_for_step(0), HISTORY_TIER_RAW);
+  CHECK_INT(sensor_history_tier_for_step(599), HISTORY_TIER_RAW);
+  CHECK_INT(sensor_history_tier_for_step(600), HISTORY_TIER_MINUTE);
+  CHECK_INT(sensor_history_tier_for_step(35999), HISTORY_TIER_MINUTE);
+  CHECK_INT(sensor_history_tier_for_step(36000), HISTORY_TIER_HOUR);
+}
+
+// 3.5 minutes of ammonia: three closed minutes and one in progress
+static void test_provisional_rollup(void) {
+  history_sensor_t s = HISTORY_AMMONIA_MV;
+  CHECK_INT(read_all(s, HISTORY_TIER_MINUTE, 0, 0, 16), 0);
+
+  record_run(s, 0, 420);
+
+  // Raw points are final; none is provisional
+  CHECK_INT(read_all(s, HISTORY_TIER_RAW, 0, 0, 16), 420);
+  CHECK_INT(s_points[419].t_ds, 419 * 5);
+
+  CHECK_INT(read_all(s, HISTORY_TIER_MINUTE, 0, 0, 16), 4);
+  check_point(&s_points[0], 0, 0, 119);
+  check_point(&s_points[1], 600, 120, 239);
+  check_point(&s_points[2], 1200, 240, 359);
+  check_point(&s_points[3], 1800, 360, 419); // Provisional
+
+  // Still filling up: the provisional row follows
+  record_run(s, 420, 30);
+  CHECK_INT(read_all(s, HISTORY_TIER_MINUTE, 0, 0, 16), 4);
+  check_point(&s_points[3], 1800, 360, 449);
+
+  // The hour only has its bucket in progress
+  CHECK_INT(read_all(s, HISTORY_TIER_HOUR, 0, 0, 16), 1);
+  check_point(&s_points[0], 0, 0, 449);
+
+  // from skips the closed minutes, not the one in progress
+  CHECK_INT(read_all(s, HISTORY_TIER_MINUTE, 0, 180000, 16), 1);
+  check_point(&s_points[0], 1800, 360, 449);
+  // ... which is skipped too once it starts before from
+  CHECK_INT(read_all(s, HISTORY_TIER_MINUTE, 0, 180100, 16), 0);
+
+  // Batches of one: the provisional row comes after the closed ones
+  CHECK_INT(read_all(s, HISTORY_TIER_MINUTE, 0, 0, 1), 4);
+  check_point(&s_points[3], 1800, 360, 449);
+}
+
+// 12.5 minutes merged into 5-minute steps from the minute tier
+static void test_step_from_minutes(void) {
+  history_sensor_t s = HISTORY_TEMPERATURE;
+  record_run(s, 0, 1500);
+
+  for (size_t batch = 1; batch <= 16; batch += 15) {
+    CHECK_INT(read_all(s, HISTORY_TIER_MINUTE, 3000, 0, batch), 3);
+    check_point(&s_points[0], 0, 0, 599);
+    check_point(&s_points[1], 3000, 600, 1199);
+    // Minutes 10 and 11 plus the rollup of minute 12 in progress. The mean
+    // is the mean of the three minute means, not of the samples.
+    CHECK_INT(s_points[2].t_ds, 6000);
+    CHECK_NEAR(s_points[2].min, 1200, 0);
+    CHECK_NEAR(s_points[2].max, 1499, 0);
+    CHECK_NEAR(s_points[2].mean, (1259.5 + 1379.5 + 1469.5) / 3, 1e-3);
+  }
+
+  // A step of one minute gives the minute points, provisional one included
+  CHECK_INT(read_all(s, HISTORY_TIER_MINUTE, 600, 0, 4), 13);
+  check_point(&s_points[12], 7200, 1440, 1499);
+
+  // from lands inside the second step: it starts at the first point kept
+  CHECK_INT(read_all(s, HISTORY_TIER_MINUTE, 3000, 360000, 16), 2);
+  check_point(&s_points[0], 3000, 720, 1199);
+}
+
+// 10 s steps straight from the raw samples
+static void test_step_from_raw(void) {
+  history_sensor_t s = HISTORY_HUMIDITY;
+  record_run(s, 0, 105);
+
+  for (size_t batch = 1; batch <= 7; batch += 6) {
+    CHECK_INT(read_all(s, HISTORY_TIER_RAW, 100, 0, batch), 6);
+    for (int i = 0; i < 5; i++) {
+      check_point(&s_points[i], i * 100, i * 20, i * 20 + 19);
+    }
+    check_point(&s_points[5], 500, 100, 104); // Provisional
+  }
+
+  // Samples arriving between reads never split a returned bucket
+  history_cursor_t cursor = {0};
+  CHECK_INT(sensor_history_read(s, HISTORY_TIER_RAW, 100, 0, &cursor,
+                                s_points, 2),
+            2);
+  record_run(s, 105, 20);
+  CHECK_INT(sensor_history_read(s, HISTORY_TIER_RAW, 100, 0, &cursor,
+                                s_points, 16),
+            5);
+  check_point(&s_points[2], 400, 80, 99);
+  check_point(&s_points[3], 500, 100, 119);
+  check_point(&s_points[4], 600, 120, 124);
+  CHECK_INT(sensor_history_read(s, HISTORY_TIER_RAW, 100, 0, &cursor,
+                                s_points, 16),
+            0);
+}
+
+int main(void) {
+  mock_clock_set_fake(true);
+  CHECK_INT(sensor_history_init(), ESP_OK);
+
+  RUN_TEST(test_tier_for_step);
+  RUN_TEST(test_provisional_rollup);
+  RUN_TEST(test_step_from_minutes);
+  RUN_TEST(test_step_from_raw);
+  return TEST_RESULT();
+}
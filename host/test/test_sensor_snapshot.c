@@ -0,0 +1,161 @@
+#include "freertos/task.h"
+#include "sensor_snapshot.h"
+#include "test.h"
+#include <stdatomic.h>
+#include <unistd.h>
+
+#define WRITER_SAMPLES 20000
+
+static void test_empty(void) {
+  sensor_sample_t sample;
+  CHECK(!sensor_snapshot_log_latest(SENSOR_SAMPLE_AMMONIA, &sample));
+  CHECK(!sensor_snapshot_log_latest(SENSOR_SAMPLE_SHT30, &sample));
+  CHECK(!sensor_snapshot_log_latest((sensor_sample_kind_t)7, &sample));
+
+  sensor_sample_t out[4];
+  uint32_t oldest = 99;
+  CHECK_INT(sensor_snapshot_log_read(0, out, 4, &oldest), 0);
+  CHECK_INT(oldest, 0);
+}
+
+static void test_latest_per_kind(void) {
+  sensor_snapshot_publish_ammonia(100, 500, 1.0f, 2.0f);
+  sensor_snapshot_publish_sht30(20.0f, 50.0f);
+  sensor_snapshot_publish_ammonia(101, 501, 1.5f, 2.5f);
+
+  sensor_sample_t sample;
+  CHECK(sensor_snapshot_log_latest(SENSOR_SAMPLE_AMMONIA, &sample));
+  CHECK_INT(sample.version, 3);
+  CHECK_INT(sample.kind, SENSOR_SAMPLE_AMMONIA);
+  CHECK_INT(sample.ammonia.raw, 101);
+  CHECK_INT(sample.ammonia.voltage_mv, 501);
+  CHECK_NEAR(sample.ammonia.ppm, 2.5, 0);
+
+  CHECK(sensor_snapshot_log_latest(SENSOR_SAMPLE_SHT30, &sample));
+  CHECK_INT(sample.version, 2);
+  CHECK_INT(sample.kind, SENSOR_SAMPLE_SHT30);
+  CHECK_NEAR(sample.sht30.temperature, 20.0, 0);
+  CHECK_NEAR(sample.sht30.humidity, 50.0, 0);
+
+  sensor_snapshot_t snap;
+  sensor_snapshot_read(&snap);
+  CHECK_INT(snap.version, 3);
+  CHECK_INT(snap.ammonia_seq, 2);
+  CHECK_INT(snap.sht30_seq, 1);
+  CHECK_INT(snap.ammonia_raw, 101);
+}
+
+// A sensor that stopped publishing keeps its newest sample after the other
+// one has overwritten the whole log
+static void test_latest_outlives_log(void) {
+  sensor_snapshot_publish_sht30(21.5f, 60.0f);
+  sensor_snapshot_t snap;
+  sensor_snapshot_read(&snap);
+  uint32_t sht30_version = snap.version;
+
+  for (int i = 0; i < SENSOR_SNAPSHOT_LOG_SIZE + 100; i++) {
+    sensor_snapshot_publish_ammonia(i, i, 0, 0);
+  }
+  sensor_snapshot_read(&snap);
+
+  sensor_sample_t sample;
+  CHECK(sensor_snapshot_log_latest(SENSOR_SAMPLE_SHT30, &sample));
+  CHECK_INT(sample.version, sht30_version);
+  CHECK_NEAR(sample.sht30.temperature, 21.5, 0);
+  CHECK(sensor_snapshot_log_latest(SENSOR_SAMPLE_AMMONIA, &sample));
+  CHECK_INT(sample.version, snap.version);
+  CHECK_INT(sample.ammonia.raw, SENSOR_SNAPSHOT_LOG_SIZE + 99);
+
+  // Long gone from the log itself
+  sensor_sample_t out[1];
+  uint32_t oldest;
+  CHECK_INT(sensor_snapshot_log_read(0, out, 1, &oldest), 1);
+  CHECK_INT(oldest, snap.version - SENSOR_SNAPSHOT_LOG_SIZE + 1);
+  CHECK(oldest > sht30_version);
+  CHECK_INT(out[0].version, oldest);
+}
+
+static void test_log_read_resume(void) {
+  sensor_snapshot_t snap;
+  sensor_snapshot_read(&snap);
+
+  sensor_sample_t out[8];
+  uint32_t oldest;
+  CHECK_INT(sensor_snapshot_log_read(snap.version - 3, out, 8, &oldest), 3);
+  for (int i = 0; i < 3; i++) {
+    CHECK_INT(out[i].version, snap.version - 2 + i);
+    CHECK_INT(out[i].kind, SENSOR_SAMPLE_AMMONIA);
+  }
+  CHECK_INT(sensor_snapshot_log_read(snap.version, out, 8, &oldest), 0);
+}
+
+typedef struct {
+  atomic_bool done;
+} writer_t;
+
+// Publishes matching fields so a torn read shows up as a mismatch
+static void writer_task(void *arg) {
+  writer_t *w = arg;
+  for (int i = 1; i <= WRITER_SAMPLES; i++) {
+    sensor_snapshot_publish_sht30((float)i, (float)i);
+    sensor_snapshot_publish_ammonia(i, i, (float)i, (float)i);
+  }
+  atomic_store(&w->done, true);
+  vTaskDelete(NULL);
+}
+
+static void test_concurrent_readers(void) {
+  sensor_snapshot_publish_sht30(0, 0);
+  sensor_snapshot_publish_ammonia(0, 0, 0, 0);
+
+  static writer_t writers[2];
+  for (int i = 0; i < 2; i++) {
+    CHECK_INT(xTaskCreate(writer_task, "writer", 4096, &writers[i], 5, NULL),
+              pdPASS);
+  }
+
+  int torn = 0;
+  uint32_t last_version = 0;
+  uint32_t last_sht30 = 0;
+  while (!atomic_load(&writers[0].done) || !atomic_load(&writers[1].done)) {
+    sensor_snapshot_t snap;
+    sensor_snapshot_read(&snap);
+    if (snap.temperature != snap.humidity ||
+        snap.ammonia_raw != snap.ammonia_voltage_mv) {
+      torn++;
+    }
+    if (snap.version < last_version) {
+      torn++;
+    }
+    last_version = snap.version;
+
+    sensor_sample_t sample;
+    if (sensor_snapshot_log_latest(SENSOR_SAMPLE_SHT30, &sample)) {
+      if (sample.kind != SENSOR_SAMPLE_SHT30 ||
+          sample.sht30.temperature != sample.sht30.humidity ||
+          sample.version < last_sht30) {
+        torn++;
+      }
+      last_sht30 = sample.version;
+    }
+  }
+  CHECK_INT(torn, 0);
+
+  sensor_snapshot_t snap;
+  sensor_snapshot_read(&snap);
+  sensor_sample_t sample;
+  CHECK(sensor_snapshot_log_latest(SENSOR_SAMPLE_SHT30, &sample));
+  CHECK_INT(snap.sht30_time_us, sample.time_us);
+  CHECK_NEAR(snap.temperature, sample.sht30.temperature, 0);
+  CHECK(sensor_snapshot_log_latest(SENSOR_SAMPLE_AMMONIA, &sample));
+  CHECK_INT(snap.ammonia_raw, sample.ammonia.raw);
+}
+
+int main(void) {
+  RUN_TEST(test_empty);
+  RUN_TEST(test_latest_per_kind);
+  RUN_TEST(test_latest_outlives_log);
+  RUN_TEST(test_log_read_resume);
+  RUN_TEST(test_concurrent_readers);
+  return TEST_RESULT();
+}
@@ -0,0 +1,344 @@
+#include "esp_timer.h"
+#include "mock_hal.h"
+#include "sht30.h"
+#include "test.h"
+#include <string.h>
+
+// Measurement frame for raw words with correct CRCs
+static void make_frame(uint8_t out[6], uint16_t raw_t, uint16_t raw_rh) {
+  out[0] = raw_t >> 8;
+  out[1] = raw_t & 0xFF;
+  out[2] = sht30_crc8(&out[0], 2);
+  out[3] = raw_rh >> 8;
+  out[4] = raw_rh & 0xFF;
+  out[5] = sht30_crc8(&out[3], 2);
+}
+
+#define SHT30_ADDR 0x44
+
+#define CMD_SINGLE_SHOT 0x2400
+#define CMD_FETCH 0xE000
+#define CMD_BREAK 0x3093
+#define CMD_PERIODIC_1_MPS 0x2130
+#define CMD_PERIODIC_10_MPS 0x2737
+
+// Simulated SHT30 on the mock I2C bus
+typedef struct {
+  uint16_t cmds[64];
+  int64_t cmd_us[64];
+  int cmd_count;
+
+  bool periodic;
+  int64_t period_us;
+  int64_t next_result_us; // A periodic result exists from this time
+  int64_t break_us;       // Last break; the sensor is busy for 1 ms after
+  bool single_pending;
+  bool fetch_pending;
+
+  uint16_t raw_t;
+  uint16_t raw_rh;
+  int corrupt_word; // 0 = none, 1 = temperature CRC, 2 = humidity CRC
+  bool absent;      // NACK everything
+} sim_t;
+
+static sim_t s_sim;
+
+static int64_t periodic_cmd_period_us(uint16_t cmd) {
+  switch (cmd) {
+  case 0x2032:
+    return 2000000;
+  case CMD_PERIODIC_1_MPS:
+    return 1000000;
+  case 0x2236:
+    return 500000;
+  case 0x2334:
+    return 250000;
+  case CMD_PERIODIC_10_MPS:
+    return 100000;
+  default:
+    return 0;
+  }
+}
+
+static esp_err_t sim_write(void *ctx, const uint8_t *data, size_t len) {
+  sim_t *sim = ctx;
+  int64_t now = esp_timer_get_time();
+  if (sim->absent || len != 2) {
+    return MOCK_I2C_NACK;
+  }
+  uint16_t cmd = (data[0] << 8) | data[1];
+  if (sim->cmd_count < 64) {
+    sim->cmd_us[sim->cmd_count] = now;
+    sim->cmds[sim->cmd_count++] = cmd;
+  }
+  if (now - sim->break_us < 1000) {
+    return MOCK_I2C_NACK; // Still processing the break
+  }
+
+  int64_t period = periodic_cmd_period_us(cmd);
+  if (cmd == CMD_BREAK) {
+    sim->periodic = false;
+    sim->break_us = now;
+  } else if (cmd == CMD_FETCH && sim->periodic) {
+    sim->fetch_pending = true;
+  } else if (sim->periodic) {
+    // Measurement commands are not accepted in periodic mode
+    return MOCK_I2C_NACK;
+  } else if (cmd == CMD_SINGLE_SHOT) {
+    sim->single_pending = true;
+  } else if (period > 0) {
+    sim->periodic = true;
+    sim->period_us = period;
+    sim->next_result_us = now + period;
+  } else {
+    return MOCK_I2C_NACK;
+  }
+  return ESP_OK;
+}
+
+static esp_err_t sim_read(void *ctx, uint8_t *data, size_t len) {
+  sim_t *sim = ctx;
+  int64_t now = esp_timer_get_time();
+  bool ready = false;
+  if (sim->single_pending) {
+    ready = true;
+    sim->single_pending = false;
+  } else if (sim->fetch_pending) {
+    sim->fetch_pending = false;
+    if (now >= sim->next_result_us) {
+      ready = true;
+      // Results not fetched in time are overwritten by newer ones
+      while (sim->next_result_us <= now) {
+        sim->next_result_us += sim->period_us;
+      }
+    }
+  }
+  if (sim->absent || !ready || len != 6) {
+    return MOCK_I2C_NACK; // No data: the read header is not acknowledged
+  }
+  make_frame(data, sim->raw_t, sim->raw_rh);
+  if (sim->corrupt_word == 1) {
+    data[2] ^= 0x01;
+  } else if (sim->corrupt_word == 2) {
+    data[5] ^= 0x01;
+  }
+  return ESP_OK;
+}
+
+static void test_crc8(void) {
+  // Datasheet example (CRC-8, poly 0x31, init 0xFF)
+  CHECK_INT(sht30_crc8((const uint8_t[]){0xBE, 0xEF}, 2), 0x92);
+  CHECK_INT(sht30_crc8((const uint8_t[]){0x00, 0x00}, 2), 0x81);
+  CHECK_INT(sht30_crc8(NULL, 0), 0xFF);
+
+  // Any single bit flip changes the CRC
+  const uint8_t word[2] = {0x66, 0x66};
+  uint8_t crc = sht30_crc8(word, 2);
+  for (int bit = 0; bit < 16; bit++) {
+    uint8_t flipped[2] = {word[0], word[1]};
+    flipped[bit / 8] ^= 1 << (bit % 8);
+    CHECK(sht30_crc8(flipped, 2) != crc);
+  }
+}
+
+static void test_parse_conversions(void) {
+  uint8_t frame[6];
+  float t, rh;
+
+  make_frame(frame, 0, 0);
+  CHECK_INT(sht30_parse(frame, &t, &rh), ESP_OK);
+  CHECK_NEAR(t, -45.0, 1e-4);
+  CHECK_NEAR(rh, 0.0, 1e-4);
+
+  make_frame(frame, 0xFFFF, 0xFFFF);
+  CHECK_INT(sht30_parse(frame, &t, &rh), ESP_OK);
+  CHECK_NEAR(t, 130.0, 1e-4);
+  CHECK_NEAR(rh, 100.0, 1e-4);
+
+  // T = -45 + 175 * raw / 65535, RH = 100 * raw / 65535
+  make_frame(frame, 0x6666, 0x8000);
+  CHECK_INT(sht30_parse(frame, &t, &rh), ESP_OK);
+  CHECK_NEAR(t, -45.0 + 175.0 * 0x6666 / 65535.0, 1e-3);
+  CHECK_NEAR(rh, 100.0 * 0x8000 / 65535.0, 1e-3);
+
+  // Exhaustive over the temperature word: monotonic and within range
+  float prev = -1000;
+  for (uint32_t raw = 0; raw <= 0xFFFF; raw += 17) {
+    make_frame(frame, raw, raw);
+    CHECK_INT(sht30_parse(frame, &t, &rh), ESP_OK);
+    CHECK(t > prev);
+    CHECK(t >= -45.0f && t <= 130.0f && rh >= 0.0f && rh <= 100.0f);
+    prev = t;
+  }
+}
+
+static void test_parse_crc_mismatch(void) {
+  uint8_t frame[6];
+  float t = 1.0f, rh = 2.0f;
+
+  make_frame(frame, 0x6666, 0x8000);
+  frame[2] ^= 0x01;
+  CHECK_INT(sht30_parse(frame, &t, &rh), ESP_ERR_INVALID_CRC);
+
+  make_frame(frame, 0x6666, 0x8000);
+  frame[5] ^= 0x80;
+  CHECK_INT(sht30_parse(frame, &t, &rh), ESP_ERR_INVALID_CRC);
+
+  make_frame(frame, 0x6666, 0x8000);
+  frame[0] ^= 0x10; // Data corrupted, CRC intact
+  CHECK_INT(sht30_parse(frame, &t, &rh), ESP_ERR_INVALID_CRC);
+
+  // Outputs untouched on error
+  CHECK(t == 1.0f && rh == 2.0f);
+}
+
+static uint16_t last_cmd(void) {
+  return s_sim.cmd_count > 0 ? s_sim.cmds[s_sim.cmd_count - 1] : 0;
+}
+
+static void test_init_single_shot(void) {
+  s_sim.raw_t = 0x6666;
+  s_sim.raw_rh = 0x8000;
+  CHECK_INT(sht30_init(), ESP_OK);
+  CHECK_INT(s_sim.cmd_count, 1);
+  CHECK_INT(last_cmd(), CMD_SINGLE_SHOT);
+
+  float t, rh;
+  CHECK_INT(sht30_read(&t, &rh), ESP_OK);
+  CHECK_NEAR(rh, 100.0 * 0x8000 / 65535.0, 1e-3);
+  // Periodic-only calls before periodic mode
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_ERR_INVALID_STATE);
+}
+
+static void test_fetch_paced_by_period(void) {
+  float t, rh;
+  CHECK_INT(sht30_start_periodic(SHT30_RATE_1_MPS), ESP_OK);
+  CHECK_INT(last_cmd(), CMD_PERIODIC_1_MPS);
+  CHECK_INT(sht30_read(&t, &rh), ESP_ERR_INVALID_STATE);
+
+  // Before the first result is due the bus is not touched
+  int cmds = s_sim.cmd_count;
+  mock_clock_advance(500000);
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_ERR_NOT_FINISHED);
+  CHECK_INT(s_sim.cmd_count, cmds);
+
+  mock_clock_advance(500000);
+  s_sim.raw_t = 0x7000;
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_OK);
+  CHECK_INT(last_cmd(), CMD_FETCH);
+  CHECK_NEAR(t, -45.0 + 175.0 * 0x7000 / 65535.0, 1e-3);
+
+  // Next one a full period later
+  mock_clock_advance(999000);
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_ERR_NOT_FINISHED);
+  mock_clock_advance(1000);
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_OK);
+}
+
+// A result that is late NACKs the read; that is "not yet", not an error
+static void test_not_ready_nack(void) {
+  float t = 0, rh = 0;
+  // The sensor's clock runs slow: the result shows up 30 ms late
+  s_sim.next_result_us = esp_timer_get_time() + 1030000;
+  mock_clock_advance(1000000);
+  mock_log_reset();
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_ERR_NOT_FINISHED);
+  CHECK_INT(last_cmd(), CMD_FETCH);
+  CHECK_INT(mock_log_count(ESP_LOG_WARN), 0);
+
+  // Retried on the next call, and succeeds once the result exists
+  mock_clock_advance(20000);
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_ERR_NOT_FINISHED);
+  mock_clock_advance(10000);
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_OK);
+
+  // A sensor that stops answering becomes an error after 3 periods
+  s_sim.absent = true;
+  mock_clock_advance(1000000);
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_ERR_NOT_FINISHED);
+  mock_clock_advance(1000000);
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_ERR_NOT_FINISHED);
+  mock_clock_advance(1000000);
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_ERR_NOT_FINISHED);
+  mock_clock_advance(1000000);
+  CHECK_INT(sht30_fetch(&t, &rh), MOCK_I2C_NACK);
+  CHECK_INT(mock_log_count(ESP_LOG_WARN), 1);
+  // ...and the wait starts over rather than hammering the bus
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_ERR_NOT_FINISHED);
+
+  // Back: resynchronize on the sensor's schedule
+  s_sim.absent = false;
+  s_sim.next_result_us = esp_timer_get_time();
+  mock_clock_advance(1000000);
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_OK);
+}
+
+static void test_fetch_crc_mismatch(void) {
+  for (int word = 1; word <= 2; word++) {
+    float t = 123.0f, rh = 456.0f;
+    s_sim.corrupt_word = word;
+    s_sim.next_result_us = esp_timer_get_time();
+    mock_clock_advance(1000000);
+    mock_log_reset();
+    CHECK_INT(sht30_fetch(&t, &rh), ESP_ERR_INVALID_CRC);
+    CHECK_INT(mock_log_count(ESP_LOG_WARN), 1); // Logged by the caller
+    CHECK(t == 123.0f && rh == 456.0f);
+  }
+  s_sim.corrupt_word = 0;
+  s_sim.next_result_us = esp_timer_get_time();
+  mock_clock_advance(1000000);
+  float t, rh;
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_OK);
+}
+
+// Changing the rate in periodic mode needs a break and 1 ms of quiet
+static void test_break_before_mode_change(void) {
+  int first = s_sim.cmd_count;
+  CHECK_INT(sht30_start_periodic(SHT30_RATE_10_MPS), ESP_OK);
+  CHECK_INT(s_sim.cmd_count, first + 2);
+  CHECK_INT(s_sim.cmds[first], CMD_BREAK);
+  CHECK_INT(s_sim.cmds[first + 1], CMD_PERIODIC_10_MPS);
+  CHECK(s_sim.cmd_us[first + 1] - s_sim.cmd_us[first] >= 1000);
+  CHECK(s_sim.periodic);
+  CHECK_INT(s_sim.period_us, 100000);
+  CHECK_INT(sht30_rate_period_ms(SHT30_RATE_10_MPS), 100);
+
+  mock_clock_advance(100000);
+  float t, rh;
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_OK);
+
+  // Stopping sends the break; single shots work again afterwards
+  CHECK_INT(sht30_stop_periodic(), ESP_OK);
+  CHECK_INT(last_cmd(), CMD_BREAK);
+  CHECK(!s_sim.periodic);
+  CHECK_INT(sht30_fetch(&t, &rh), ESP_ERR_INVALID_STATE);
+  mock_clock_advance(1000);
+  CHECK_INT(sht30_read(&t, &rh), ESP_OK);
+}
+
+static void test_invalid_rate(void) {
+  CHECK_INT(sht30_start_periodic((sht30_rate_t)99), ESP_ERR_INVALID_ARG);
+  CHECK_INT(sht30_deinit(), ESP_OK);
+  CHECK_INT(sht30_start_periodic(SHT30_RATE_1_MPS), ESP_ERR_INVALID_ARG);
+}
+
+int main(void) {
+  RUN_TEST(test_crc8);
+  RUN_TEST(test_parse_conversions);
+  RUN_TEST(test_parse_crc_mismatch);
+
+  mock_clock_set_fake(true);
+  mock_i2c_attach(SHT30_ADDR, &(mock_i2c_device_t){
+                                  .write = sim_write,
+                                  .read = sim_read,
+                                  .ctx = &s_sim,
+                              });
+  s_sim.break_us = -1000000;
+  RUN_TEST(test_init_single_shot);
+  RUN_TEST(test_fetch_paced_by_period);
+  RUN_TEST(test_not_ready_nack);
+  RUN_TEST(test_fetch_crc_mismatch);
+  RUN_TEST(test_break_before_mode_change);
+  RUN_TEST(test_invalid_rate);
+  return TEST_RESULT();
+}
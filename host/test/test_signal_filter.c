@@ -0,0 +1,239 @@
+#include "signal_filter.h"
+#include "test.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BLOCK 1025
+
+static uint32_t s_rng = 0x9E3779B9;
+
+static uint32_t rnd(void) {
+  s_rng ^= s_rng << 13;
+  s_rng ^= s_rng >> 17;
+  s_rng ^= s_rng << 5;
+  return s_rng;
+}
+
+static int cmp_u16(const void *a, const void *b) {
+  return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+// Fill a block with one of several shapes that stress quickselect
+static void fill(uint16_t *s, size_t n, int shape) {
+  for (size_t i = 0; i < n; i++) {
+    switch (shape) {
+    case 0: // Uniform 12-bit
+      s[i] = rnd() & 0xFFF;
+      break;
+    case 1: // Heavy duplicates
+      s[i] = 2000 + rnd() % 4;
+      break;
+    case 2: // Ascending
+      s[i] = (uint16_t)i;
+      break;
+    case 3: // Descending
+      s[i] = (uint16_t)(n - i);
+      break;
+    case 4: // Constant
+      s[i] = 1234;
+      break;
+    case 5: // Organ pipe
+      s[i] = (uint16_t)(i < n / 2 ? i : n - i);
+      break;
+    default: // Noise around a level with spikes, as from the MQ-137
+      s[i] = 1500 + rnd() % 16 - 8 + (rnd() % 20 == 0 ? 2000 : 0);
+      break;
+    }
+  }
+}
+
+static void test_median_vs_qsort(void) {
+  uint16_t block[MAX_BLOCK];
+  uint16_t sorted[MAX_BLOCK];
+  int cases = 0;
+  for (int shape = 0; shape <= 6; shape++) {
+    for (int iter = 0; iter < 400; iter++) {
+      // All small sizes, then random ones up to MAX_BLOCK
+      size_t n = iter < 40 ? (size_t)iter + 1 : 1 + rnd() % MAX_BLOCK;
+      fill(block, n, shape);
+      memcpy(sorted, block, n * sizeof(uint16_t));
+      qsort(sorted, n, sizeof(uint16_t), cmp_u16);
+
+      uint16_t median = filter_median(block, n);
+      if (median != sorted[n / 2]) {
+        fprintf(stderr, "     shape %d n %zu: %u, expected %u\n", shape, n,
+                median, sorted[n / 2]);
+        test_failures++;
+      }
+      // Only reordered: same multiset, median in its sorted position
+      CHECK_INT(block[n / 2], median);
+      qsort(block, n, sizeof(uint16_t), cmp_u16);
+      CHECK(memcmp(block, sorted, n * sizeof(uint16_t)) == 0);
+      cases++;
+    }
+  }
+  CHECK_INT(cases, 2800);
+}
+
+static void test_median_small(void) {
+  uint16_t one[] = {7};
+  CHECK_INT(filter_median(one, 1), 7);
+  uint16_t two[] = {9, 3};
+  CHECK_INT(filter_median(two, 2), 9); // Upper median
+  uint16_t spike[] = {100, 101, 4095, 99, 100};
+  CHECK_INT(filter_median(spike, 5), 100);
+  uint16_t zeros[] = {0, 0, 0, 4095};
+  CHECK_INT(filter_median(zeros, 4), 0);
+}
+
+// Output after a step from `from` to `to`, n samples in: the exact
+// exponential to within the Q16 truncation
+static double iir_step_expected(int from, int to, int shift, int n) {
+  return to + (from - to) * pow(1.0 - ldexp(1.0, -shift), n);
+}
+
+static void test_iir_step_response(void) {
+  uint16_t block[64];
+  for (int shift = 1; shift <= 8; shift++) {
+    for (int dir = 0; dir < 2; dir++) {
+      int from = dir ? 3000 : 1000;
+      int to = dir ? 1000 : 3000;
+      filter_iir_t iir;
+      filter_iir_init(&iir, shift);
+      uint16_t x = from;
+      CHECK_INT(filter_iir_update(&iir, &x, 1), from); // Primed directly
+
+      int n = 0;
+      int prev = from;
+      for (int b = 0; b < 64; b++) {
+        for (int i = 0; i < 64; i++) {
+          block[i] = to;
+        }
+        int y = filter_iir_update(&iir, block, 64);
+        n += 64;
+        CHECK_NEAR(y, iir_step_expected(from, to, shift, n), 1.0);
+        CHECK(dir ? y <= prev : y >= prev); // No overshoot or ringing
+        prev = y;
+      }
+      // Settles on the input exactly, despite truncation
+      CHECK_INT(prev, to);
+    }
+  }
+}
+
+static void test_iir_blocks(void) {
+  // Block boundaries do not matter: one long block or single samples
+  uint16_t samples[500];
+  fill(samples, 500, 6);
+  filter_iir_t a, b;
+  filter_iir_init(&a, 6);
+  filter_iir_init(&b, 6);
+  uint16_t ya = filter_iir_update(&a, samples, 500);
+  uint16_t yb = 0;
+  for (int i = 0; i < 500; i++) {
+    yb = filter_iir_update(&b, &samples[i], 1);
+  }
+  CHECK_INT(ya, yb);
+  CHECK_INT(a.state_q16, b.state_q16);
+
+  // An empty block changes nothing
+  CHECK_INT(filter_iir_update(&a, samples, 0), ya);
+  filter_iir_t c;
+  filter_iir_init(&c, 6);
+  CHECK_INT(filter_iir_update(&c, samples, 0), 0);
+  CHECK(!c.primed);
+
+  // Full 12-bit range without overflow
+  uint16_t max = 4095;
+  filter_iir_init(&c, 0);
+  CHECK_INT(filter_iir_update(&c, &max, 1), 4095);
+  uint16_t zero = 0;
+  CHECK_INT(filter_iir_update(&c, &zero, 1), 0); // shift 0 = no filtering
+}
+
+static void test_stats_vs_double(void) {
+  uint16_t block[MAX_BLOCK];
+  for (int iter = 0; iter < 200; iter++) {
+    filter_stats_t stats;
+    filter_stats_reset(&stats);
+    double sum = 0, sum_sq = 0;
+    size_t total = 0;
+    // Several blocks into one accumulator
+    int blocks = 1 + rnd() % 5;
+    for (int b = 0; b < blocks; b++) {
+      size_t n = 1 + rnd() % MAX_BLOCK;
+      fill(block, n, iter % 7);
+      filter_stats_add(&stats, block, n);
+      for (size_t i = 0; i < n; i++) {
+        sum += block[i];
+        sum_sq += (double)block[i] * block[i];
+      }
+      total += n;
+    }
+    double mean = sum / total;
+    double var = sum_sq / total - mean * mean;
+    CHECK_INT(stats.count, total);
+    CHECK_NEAR(filter_stats_mean(&stats), mean, mean * 1e-6 + 1e-6);
+    CHECK_NEAR(filter_stats_variance(&stats), var, var * 1e-5 + 1e-3);
+  }
+}
+
+static void test_stats_oversampling(void) {
+  // Averaging dithered samples resolves steps below one ADC count: 1000
+  // and 1001 in a 1:3 ratio average to 1000.75
+  uint16_t block[400];
+  for (int i = 0; i < 400; i++) {
+    block[i] = i % 4 == 0 ? 1000 : 1001;
+  }
+  filter_stats_t stats;
+  filter_stats_reset(&stats);
+  filter_stats_add(&stats, block, 400);
+  CHECK_NEAR(filter_stats_mean(&stats), 1000.75, 1e-4);
+  CHECK_NEAR(filter_stats_variance(&stats), 0.1875, 1e-5);
+
+  // Zero-mean noise averages out as 1/sqrt(n): +-8 counts uniform noise
+  // (sigma 4.6) gives a mean within 0.5 of the level over 1000 samples
+  uint16_t noisy[1000];
+  for (int i = 0; i < 1000; i++) {
+    noisy[i] = 2048 + (int)(rnd() % 17) - 8;
+  }
+  filter_stats_reset(&stats);
+  filter_stats_add(&stats, noisy, 1000);
+  CHECK_NEAR(filter_stats_mean(&stats), 2048, 0.5);
+}
+
+static void test_stats_edges(void) {
+  filter_stats_t stats;
+  filter_stats_reset(&stats);
+  CHECK_NEAR(filter_stats_mean(&stats), 0, 0);
+  CHECK_NEAR(filter_stats_variance(&stats), 0, 0);
+
+  // Constant full-scale input: variance exactly 0, no overflow over a
+  // long accumulation (500k samples, far more than one read)
+  static uint16_t full[1000];
+  for (int i = 0; i < 1000; i++) {
+    full[i] = 4095;
+  }
+  for (int b = 0; b < 500; b++) {
+    filter_stats_add(&stats, full, 1000);
+  }
+  CHECK_NEAR(filter_stats_mean(&stats), 4095, 0);
+  CHECK_NEAR(filter_stats_variance(&stats), 0, 0);
+
+  // Largest possible variance: half 0, half 4095
+  filter_stats_reset(&stats);
+  uint16_t ends[2] = {0, 4095};
+  filter_stats_add(&stats, ends, 2);
+  CHECK_NEAR(filter_stats_variance(&stats), 4095.0 * 4095.0 / 4, 1);
+}
+
+int main(void) {
+  RUN_TEST(test_median_vs_qsort);
+  RUN_TEST(test_median_small);
+  RUN_TEST(test_iir_step_response);
+  RUN_TEST(test_iir_blocks);
+  RUN_TEST(test_stats_vs_double);
+  RUN_TEST(test_stats_oversampling);
+  RUN_TEST(test_stats_edges);
+  return TEST_RESULT();
+}
@@ -0,0 +1,101 @@
+#include "stream_pacer.h"
+#include "test.h"
+
+static void test_init_clamps(void) {
+  stream_pacer_t p;
+  stream_pacer_init(&p, 0, 0);
+  CHECK_INT(p.target_fps, STREAM_PACER_MIN_FPS);
+  stream_pacer_init(&p, 1000, 0);
+  CHECK_INT(p.target_fps, STREAM_PACER_MAX_FPS);
+  stream_pacer_init(&p, 10, 500);
+  CHECK_INT(p.interval_us, 100000);
+  CHECK_INT(stream_pacer_wait_us(&p, 500), 0); // First frame due at once
+}
+
+// Send time is subtracted from the next wait instead of added to it
+static void test_deadline_pacing(void) {
+  stream_pacer_t p;
+  int64_t now = 1000000;
+  stream_pacer_init(&p, 10, now);
+
+  for (int i = 0; i < 50; i++) {
+    now += stream_pacer_wait_us(&p, now);
+    int64_t start = now;
+    now += 30000; // Each write takes 30 ms
+    stream_pacer_on_sent(&p, 10000, start - 5000, start, now);
+    CHECK_INT(stream_pacer_wait_us(&p, now), 70000);
+  }
+  // 50 frames at 100 ms spacing; no drift from the write time
+  CHECK_INT(now, 1000000 + 49 * 100000 + 30000);
+  CHECK_INT(p.frames_sent, 50);
+}
+
+static void test_late_client_no_burst(void) {
+  stream_pacer_t p;
+  stream_pacer_init(&p, 10, 0);
+
+  // One slow write of 350 ms: more than one interval behind
+  stream_pacer_on_sent(&p, 1000, 0, 0, 350000);
+  CHECK_INT(stream_pacer_wait_us(&p, 350000), 100000);
+
+  // 150 ms late (less than two intervals): catch up by one frame only
+  stream_pacer_init(&p, 10, 0);
+  stream_pacer_on_sent(&p, 1000, 0, 0, 150000);
+  CHECK_INT(stream_pacer_wait_us(&p, 150000), 0);
+  stream_pacer_on_sent(&p, 1000, 150000, 150000, 160000);
+  CHECK_INT(stream_pacer_wait_us(&p, 160000), 40000);
+}
+
+static void test_dropped(void) {
+  stream_pacer_t p;
+  stream_pacer_init(&p, 20, 0);
+  stream_pacer_on_dropped(&p, 0);
+  CHECK_INT(p.frames_dropped, 1);
+  CHECK_INT(stream_pacer_wait_us(&p, 0), 50000);
+  CHECK_INT(p.frames_sent, 0);
+}
+
+static void test_window_statistics(void) {
+  stream_pacer_t p;
+  int64_t now = 0;
+  stream_pacer_init(&p, 10, now);
+
+  // 2.1 s of 20 kB frames, each written in 10 ms
+  for (int i = 0; i < 22; i++) {
+    int64_t start = i * 100000;
+    stream_pacer_on_sent(&p, 20000, start - 40000, start, start + 10000);
+    now = start + 10000;
+  }
+  CHECK_INT(p.windows, 1);
+  // Window closed by frame 21 at 2.01 s
+  CHECK_NEAR(p.achieved_fps, 21 / 2.01, 0.01);
+  CHECK_INT(p.frame_bytes, 20000);
+  // 20 kB per 10 ms = 16000 kbit/s
+  CHECK_INT(p.throughput_kbps, 16000);
+  CHECK_INT(p.window_frames, 1);
+
+  // Smoothed latency converges on 50 ms, send time on 10 ms
+  CHECK(p.latency_us > 45000 && p.latency_us <= 50000);
+  CHECK(p.send_us > 9000 && p.send_us <= 10000);
+}
+
+static void test_never_blocked(void) {
+  stream_pacer_t p;
+  stream_pacer_init(&p, 30, 0);
+  for (int i = 0; i <= 61; i++) {
+    int64_t t = i * 33334;
+    stream_pacer_on_sent(&p, 5000, t, t, t); // Zero-time writes
+  }
+  CHECK_INT(p.windows, 1);
+  CHECK_INT(p.throughput_kbps, UINT32_MAX);
+}
+
+int main(void) {
+  RUN_TEST(test_init_clamps);
+  RUN_TEST(test_deadline_pacing);
+  RUN_TEST(test_late_client_no_burst);
+  RUN_TEST(test_dropped);
+  RUN_TEST(test_window_statistics);
+  RUN_TEST(test_never_blocked);
+  return TEST_RESULT();
+}
@@ -0,0 +1,442 @@
+#include "alarm_engine.h"
+#include "alarm_rule.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "event_push.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "task_topology.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "Alarm";
+
+#define NVS_NAMESPACE "alarms"
+#define NVS_KEY "rules"
+#define RULES_FORMAT 1 // Bump when alarm_rule_t changes
+
+// Transitions waiting for the notifier; more are dropped and counted
+#define EVENT_QUEUE_LEN 16
+
+typedef struct {
+  bool active;
+  bool primed;        // Rate rules: last_value/last_us are valid
+  int64_t pending_us; // Past set since (sustained rules), 0 = not
+  int64_t last_us;
+  float last_value;
+  float rate;   // Smoothed rate per minute
+  float value;  // Last evaluated level or rate
+  uint32_t raised;
+} rule_state_t;
+
+typedef struct {
+  uint8_t format;
+  uint8_t reserved[3];
+  alarm_rule_t rules[ALARM_MAX_RULES];
+} rules_blob_t;
+
+typedef struct {
+  uint8_t rule;
+  bool active;
+  float value;
+  int64_t time_us;
+} alarm_event_t;
+
+static const char *const s_source_names[ALARM_SRC_COUNT] = {
+    [ALARM_SRC_AMMONIA_MV] = "ammonia_mv",
+    [ALARM_SRC_TEMPERATURE] = "temperature",
+    [ALARM_SRC_HUMIDITY] = "humidity",
+    [ALARM_SRC_AMMONIA_PPM] = "ammonia_ppm",
+};
+
+static const char *const s_type_names[ALARM_TYPE_COUNT] = {
+    [ALARM_THRESHOLD] = "threshold",
+    [ALARM_SUSTAINED] = "sustained",
+    [ALARM_RATE] = "rate",
+};
+
+// Used until rules are saved for the first time
+static const alarm_rule_t s_default_rules[] = {
+    {"heat", 1, ALARM_SRC_TEMPERATURE, ALARM_SUSTAINED, 1, 32.0f, 30.0f, 300},
+    {"cold", 1, ALARM_SRC_TEMPERATURE, ALARM_SUSTAINED, 0, 5.0f, 7.0f, 600},
+    {"humid", 1, ALARM_SRC_HUMIDITY, ALARM_SUSTAINED, 1, 85.0f, 80.0f, 600},
+    {"nh3_rise", 1, ALARM_SRC_AMMONIA_MV, ALARM_RATE, 1, 200.0f, 50.0f, 60},
+    // Common exposure limit for poultry houses
+    {"nh3_high", 1, ALARM_SRC_AMMONIA_PPM, ALARM_SUSTAINED, 1, 25.0f, 20.0f,
+     300},
+};
+
+// Rules and their state, guarded by s_lock; an empty name is a free slot
+static alarm_rule_t s_rules[ALARM_MAX_RULES];
+static rule_state_t s_state[ALARM_MAX_RULES];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static QueueHandle_t s_events = NULL;
+static uint32_t s_events_dropped = 0;
+
+// Update one rule with a sample; returns true on a raise or clear
+static bool rule_evaluate(const alarm_rule_t *rule, rule_state_t *st,
+                          float sample, int64_t now) {
+  float value = sample;
+  if (rule->type == ALARM_RATE) {
+    if (!st->primed) {
+      st->primed = true;
+      st->last_value = sample;
+      st->last_us = now;
+      return false;
+    }
+    float dt_s = (now - st->last_us) / 1e6f;
+    if (dt_s <= 0) {
+      return false;
+    }
+    // Exponential average over about time_s: O(1), no sample window
+    float window_s = rule->time_s > 0 ? rule->time_s : 60;
+    float rate = (sample - st->last_value) / dt_s * 60.0f;
+    st->rate += dt_s / (window_s + dt_s) * (rate - st->rate);
+    st->last_value = sample;
+    st->last_us = now;
+    value = st->rate;
+  }
+  st->value = value;
+
+  bool past_set = rule->above ? value >= rule->set : value <= rule->set;
+  bool past_clear = rule->above ? value <= rule->clear : value >= rule->clear;
+
+  if (!st->active) {
+    if (!past_set) {
+      st->pending_us = 0;
+      return false;
+    }
+    if (st->pending_us == 0) {
+      st->pending_us = now;
+    }
+    if (rule->type == ALARM_SUSTAINED &&
+        now - st->pending_us < (int64_t)rule->time_s * 1000000) {
+      return false;
+    }
+    st->active = true;
+    st->pending_us = 0;
+    st->raised++;
+    return true;
+  }
+  if (past_clear) {
+    st->active = false;
+    return true;
+  }
+  return false;
+}
+
+void alarm_engine_feed(alarm_source_t source, float value) {
+  if (s_events == NULL) {
+    return;
+  }
+  int64_t now = esp_timer_get_time();
+  alarm_event_t events[ALARM_MAX_RULES];
+  int count = 0;
+
+  portENTER_CRITICAL(&s_lock);
+  for (int i = 0; i < ALARM_MAX_RULES; i++) {
+    const alarm_rule_t *rule = &s_rules[i];
+    if (rule->name[0] == '\0' || !rule->enabled || rule->source != source) {
+      continue;
+    }
+    if (rule_evaluate(rule, &s_state[i], value, now)) {
+      events[count++] = (alarm_event_t){
+          .rule = (uint8_t)i,
+          .active = s_state[i].active,
+          .value = s_state[i].value,
+          .time_us = now,
+      };
+    }
+  }
+  portEXIT_CRITICAL(&s_lock);
+
+  for (int i = 0; i < count; i++) {
+    if (xQueueSend(s_events, &events[i], 0) != pdTRUE) {
+      __atomic_fetch_add(&s_events_dropped, 1, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+static void notify_task(void *arg) {
+  alarm_event_t ev;
+  char json[192];
+
+  while (true) {
+    if (xQueueReceive(s_events, &ev, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    portENTER_CRITICAL(&s_lock);
+    alarm_rule_t rule = s_rules[ev.rule];
+    portEXIT_CRITICAL(&s_lock);
+
+    int len = snprintf(json, sizeof(json),
+                       "{\"id\":%d,\"name\":\"%s\",\"source\":\"%s\","
+                       "\"type\":\"%s\",\"state\":\"%s\",\"value\":%.2f,"
+                       "\"t_ms\":%lld}",
+                       ev.rule, rule.name, s_source_names[rule.source],
+                       s_type_names[rule.type],
+                       ev.active ? "raised" : "cleared", ev.value,
+                       (long long)(ev.time_us / 1000));
+    if (ev.active) {
+      ESP_LOGW(TAG, "Alarm %s raised (%.2f)", rule.name, ev.value);
+    } else {
+      ESP_LOGI(TAG, "Alarm %s cleared (%.2f)", rule.name, ev.value);
+    }
+    event_push_send("alarm", json);
+    // QoS 1: held in the client outbox while the broker is unreachable
+    telemetry_publish_event("alarm", json, len);
+  }
+}
+
+// ------------------------------------------
+// Persistence
+// ------------------------------------------
+static esp_err_t rules_load(void) {
+  nvs_handle_t nvs;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+  if (err != ESP_OK) {
+    return err;
+  }
+  rules_blob_t *blob = malloc(sizeof(rules_blob_t));
+  if (blob == NULL) {
+    nvs_close(nvs);
+    return ESP_ERR_NO_MEM;
+  }
+  size_t size = sizeof(rules_blob_t);
+  err = nvs_get_blob(nvs, NVS_KEY, blob, &size);
+  nvs_close(nvs);
+  if (err == ESP_OK &&
+      (size != sizeof(rules_blob_t) || blob->format != RULES_FORMAT)) {
+    err = ESP_ERR_INVALID_VERSION;
+  }
+  if (err == ESP_OK) {
+    memcpy(s_rules, blob->rules, sizeof(s_rules));
+    // A corrupt blob, or one saved by older firmware (unrestricted names,
+    // another enum layout), must not reach the name tables
+    for (int i = 0; i < ALARM_MAX_RULES; i++) {
+      alarm_rule_t *rule = &s_rules[i];
+      if (rule->name[0] == '\0') {
+        continue;
+      }
+      const char *reason = alarm_rule_check(rule);
+      if (reason != NULL) {
+        ESP_LOGW(TAG, "Dropping rule %d: %s", i, reason);
+        memset(rule, 0, sizeof(*rule));
+      }
+    }
+  }
+  free(blob);
+  return err;
+}
+
+static esp_err_t rules_save(void) {
+  rules_blob_t *blob = calloc(1, sizeof(rules_blob_t));
+  if (blob == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  blob->format = RULES_FORMAT;
+  portENTER_CRITICAL(&s_lock);
+  memcpy(blob->rules, s_rules, sizeof(s_rules));
+  portEXIT_CRITICAL(&s_lock);
+
+  nvs_handle_t nvs;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (err == ESP_OK) {
+    err = nvs_set_blob(nvs, NVS_KEY, blob, sizeof(rules_blob_t));
+    if (err == ESP_OK) {
+      err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+  }
+  free(blob);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to save rules: %s", esp_err_to_name(err));
+  }
+  return err;
+}
+
+esp_err_t alarm_engine_init(void) {
+  if (s_events != NULL) {
+    return ESP_OK;
+  }
+
+  esp_err_t err = rules_load();
+  if (err != ESP_OK) {
+    ESP_LOGI(TAG, "No saved rules (%s), using defaults", esp_err_to_name(err));
+    memset(s_rules, 0, sizeof(s_rules));
+    memcpy(s_rules, s_default_rules, sizeof(s_default_rules));
+  }
+
+  s_events = xQueueCreate(EVENT_QUEUE_LEN, sizeof(alarm_event_t));
+  if (s_events == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  err = task_topology_create(TASK_ALARM, notify_task, NULL, NULL);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  int count = 0;
+  for (int i = 0; i < ALARM_MAX_RULES; i++) {
+    count += s_rules[i].name[0] != '\0';
+  }
+  ESP_LOGI(TAG, "%d alarm rules loaded", count);
+  return ESP_OK;
+}
+
+// ------------------------------------------
+// HTTP API
+// ------------------------------------------
+static int name_index(const char *const *names, int count, const char *name) {
+  for (int i = 0; i < count; i++) {
+    if (strcmp(names[i], name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+esp_err_t alarm_engine_get_handler(httpd_req_t *req) {
+  alarm_rule_t rules[ALARM_MAX_RULES];
+  rule_state_t state[ALARM_MAX_RULES];
+  portENTER_CRITICAL(&s_lock);
+  memcpy(rules, s_rules, sizeof(rules));
+  memcpy(state, s_state, sizeof(state));
+  portEXIT_CRITICAL(&s_lock);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+  char buf[256];
+  int len = snprintf(buf, sizeof(buf), "{\"dropped\":%lu,\"rules\":[",
+                     (unsigned long)__atomic_load_n(&s_events_dropped,
+                                                    __ATOMIC_RELAXED));
+  esp_err_t res = httpd_resp_send_chunk(req, buf, len);
+  bool first = true;
+  for (int i = 0; i < ALARM_MAX_RULES && res == ESP_OK; i++) {
+    const alarm_rule_t *r = &rules[i];
+    if (r->name[0] == '\0') {
+      continue;
+    }
+    len = snprintf(buf, sizeof(buf),
+                   "%s{\"id\":%d,\"name\":\"%s\",\"enabled\":%s,"
+                   "\"source\":\"%s\",\"type\":\"%s\",\"dir\":\"%s\","
+                   "\"set\":%.2f,\"clear\":%.2f,\"time_s\":%lu,"
+                   "\"active\":%s,\"value\":%.2f,\"raised\":%lu}",
+                   first ? "" : ",", i, r->name, r->enabled ? "true" : "false",
+                   s_source_names[r->source], s_type_names[r->type],
+                   r->above ? "above" : "below", r->set, r->clear,
+                   (unsigned long)r->time_s,
+                   state[i].active ? "true" : "false", state[i].value,
+                   (unsigned long)state[i].raised);
+    res = httpd_resp_send_chunk(req, buf, len);
+    first = false;
+  }
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, "]}", 2);
+  }
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+static esp_err_t bad_request(httpd_req_t *req, const char *msg) {
+  return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, msg);
+}
+
+esp_err_t alarm_engine_set_handler(httpd_req_t *req) {
+  char query[192];
+  char value[24];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+      httpd_query_key_value(query, "id", value, sizeof(value)) != ESP_OK) {
+    return bad_request(req, "Missing id");
+  }
+  int id = atoi(value);
+  if (id < 0 || id >= ALARM_MAX_RULES) {
+    return bad_request(req, "Invalid id");
+  }
+
+  alarm_rule_t rule;
+  portENTER_CRITICAL(&s_lock);
+  rule = s_rules[id];
+  portEXIT_CRITICAL(&s_lock);
+
+  if (httpd_query_key_value(query, "delete", value, sizeof(value)) ==
+          ESP_OK &&
+      atoi(value) != 0) {
+    memset(&rule, 0, sizeof(rule));
+  } else {
+    if (rule.name[0] == '\0') {
+      rule.enabled = 1; // New rule
+    }
+    if (httpd_query_key_value(query, "name", value, sizeof(value)) ==
+        ESP_OK) {
+      if (strlen(value) >= sizeof(rule.name)) {
+        return bad_request(req, "Name too long");
+      }
+      strcpy(rule.name, value);
+    }
+    if (httpd_query_key_value(query, "source", value, sizeof(value)) ==
+        ESP_OK) {
+      int source = name_index(s_source_names, ALARM_SRC_COUNT, value);
+      if (source < 0) {
+        return bad_request(req, "Unknown source");
+      }
+      rule.source = source;
+    }
+    if (httpd_query_key_value(query, "type", value, sizeof(value)) ==
+        ESP_OK) {
+      int type = name_index(s_type_names, ALARM_TYPE_COUNT, value);
+      if (type < 0) {
+        return bad_request(req, "Unknown type");
+      }
+      rule.type = type;
+    }
+    if (httpd_query_key_value(query, "dir", value, sizeof(value)) ==
+        ESP_OK) {
+      rule.above = strcmp(value, "below") != 0;
+    }
+    if (httpd_query_key_value(query, "set", value, sizeof(value)) ==
+        ESP_OK) {
+      rule.set = strtof(value, NULL);
+    }
+    if (httpd_query_key_value(query, "clear", value, sizeof(value)) ==
+        ESP_OK) {
+      rule.clear = strtof(value, NULL);
+    }
+    if (httpd_query_key_value(query, "time_s", value, sizeof(value)) ==
+        ESP_OK) {
+      rule.time_s = strtoul(value, NULL, 10);
+    }
+    if (httpd_query_key_value(query, "enabled", value, sizeof(value)) ==
+        ESP_OK) {
+      rule.enabled = atoi(value) != 0;
+    }
+
+    const char *reason = alarm_rule_check(&rule);
+    if (reason != NULL) {
+      return bad_request(req, reason);
+    }
+  }
+
+  // A changed rule starts over; a raised alarm is not reported as cleared
+  portENTER_CRITICAL(&s_lock);
+  s_rules[id] = rule;
+  memset(&s_state[id], 0, sizeof(s_state[id]));
+  portEXIT_CRITICAL(&s_lock);
+  ESP_LOGI(TAG, "Rule %d %s", id, rule.name[0] ? "updated" : "deleted");
+
+  if (rules_save() != ESP_OK) {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                               "Rule applied but not saved");
+  }
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+}
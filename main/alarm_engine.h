@@ -0,0 +1,92 @@
+#ifndef ALARM_ENGINE_H
+#define ALARM_ENGINE_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief On-device alarm rules, evaluated as samples arrive
+ *
+ * The sensor tasks feed every sample to alarm_engine_feed(), which updates
+ * the rules watching that source in O(1) per rule (at most ALARM_MAX_RULES)
+ * without allocating. A rule raises when its value crosses `set` and
+ * clears only once it is back past `clear`, so a reading hovering at the
+ * limit does not toggle the alarm:
+ *
+ * - threshold: the sample value itself
+ * - sustained: like threshold, but the value must stay past `set` for
+ *   time_s before the alarm raises
+ * - rate: rate of change per minute, smoothed over about time_s
+ *
+ * Raise/clear transitions are edge-triggered: each one is queued once and
+ * sent by a notifier task as an "alarm" SSE event (event_push.h) and an
+ * MQTT message on <prefix>/<device>/alarm (telemetry.h), so the sensor
+ * tasks never wait on the network.
+ *
+ * Rules are changed at runtime through /api/alarms and persisted in NVS.
+ */
+
+#define ALARM_MAX_RULES 8
+#define ALARM_NAME_LEN 16
+
+typedef enum {
+  ALARM_SRC_AMMONIA_MV = 0,
+  ALARM_SRC_TEMPERATURE,
+  ALARM_SRC_HUMIDITY,
+  ALARM_SRC_AMMONIA_PPM, // Only fed once the MQ-137 is calibrated
+  ALARM_SRC_COUNT
+} alarm_source_t;
+
+typedef enum {
+  ALARM_THRESHOLD = 0,
+  ALARM_SUSTAINED,
+  ALARM_RATE,
+  ALARM_TYPE_COUNT
+} alarm_type_t;
+
+typedef struct {
+  char name[ALARM_NAME_LEN];
+  uint8_t enabled;
+  uint8_t source; // alarm_source_t
+  uint8_t type;   // alarm_type_t
+  uint8_t above;  // 1: raise above set, 0: raise below set
+  float set;      // Raise level (rate: per minute)
+  float clear;    // Clear level, on the safe side of set
+  uint32_t time_s; // Sustained: hold time; rate: smoothing window
+} alarm_rule_t;
+
+/**
+ * @brief Load the rules from NVS (or the defaults) and start the notifier
+ *
+ * Requires nvs_flash_init().
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t alarm_engine_init(void);
+
+/**
+ * @brief Evaluate the rules watching a source against a new sample
+ *
+ * Non-blocking; call from the sensor task that produced the sample.
+ */
+void alarm_engine_feed(alarm_source_t source, float value);
+
+/**
+ * @brief URI handler for GET /api/alarms (rules and their state)
+ */
+esp_err_t alarm_engine_get_handler(httpd_req_t *req);
+
+/**
+ * @brief URI handler for POST /api/alarms
+ *
+ * Query parameters: id (slot 0..ALARM_MAX_RULES-1) and either delete=1, or
+ * name, source (ammonia_mv, ammonia_ppm, temperature, humidity), type
+ * (threshold, sustained, rate), dir (above, below), set, clear, time_s and
+ * enabled. Names are 1-15 characters of A-Z, a-z, 0-9, '_' and '-'.
+ * Missing fields keep their current value.
+ */
+esp_err_t alarm_engine_set_handler(httpd_req_t *req);
+
+#endif // ALARM_ENGINE_H
@@ -0,0 +1,31 @@
+#include "alarm_rule.h"
+#include "api_json.h"
+#include <math.h>
+#include <string.h>
+
+const char *alarm_rule_check(const alarm_rule_t *rule) {
+  if (memchr(rule->name, '\0', sizeof(rule->name)) == NULL) {
+    return "Name too long";
+  }
+  if (rule->name[0] == '\0') {
+    return "Missing name";
+  }
+  // Names go into the notify JSON unescaped
+  if (!api_json_name_valid(rule->name)) {
+    return "Name may only contain A-Z a-z 0-9 _ -";
+  }
+  // Both index name tables
+  if (rule->source >= ALARM_SRC_COUNT) {
+    return "Unknown source";
+  }
+  if (rule->type >= ALARM_TYPE_COUNT) {
+    return "Unknown type";
+  }
+  if (!isfinite(rule->set) || !isfinite(rule->clear)) {
+    return "set and clear must be numbers";
+  }
+  if (rule->above ? rule->clear > rule->set : rule->clear < rule->set) {
+    return "clear must be on the safe side of set";
+  }
+  return NULL;
+}
@@ -0,0 +1,25 @@
+#ifndef ALARM_RULE_H
+#define ALARM_RULE_H
+
+#include "alarm_engine.h"
+
+/**
+ * @brief Validation of alarm rules (alarm_engine.h)
+ *
+ * Shared by the /api/alarms handler and the NVS loader, so a rule that
+ * reaches the engine always has a printable name and in-range enums. No
+ * httpd, NVS or FreeRTOS dependency.
+ */
+
+/**
+ * @brief Check a rule before it is stored or evaluated
+ *
+ * The name must be a terminated, non-empty api_json_name_valid() name,
+ * source and type must be known and clear must be on the safe side of set.
+ *
+ * @param rule Rule to check (not a free slot)
+ * @return NULL if the rule is valid, otherwise the reason
+ */
+const char *alarm_rule_check(const alarm_rule_t *rule);
+
+#endif // ALARM_RULE_H
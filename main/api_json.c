@@ -0,0 +1,65 @@
+#include "api_json.h"
+#include <math.h>
+#include <stdio.h>
+
+// ppm is NaN until the sensor is calibrated
+static const char *format_ppm(char *buf, size_t size, float ppm) {
+  if (isnan(ppm)) {
+    return "null";
+  }
+  snprintf(buf, size, "%.2f", ppm);
+  return buf;
+}
+
+int api_json_ammonia(char *buf, size_t size, const sensor_snapshot_t *snap) {
+  char ppm[16];
+  return snprintf(buf, size,
+                  "{\"raw\":%d,\"voltage_mv\":%d,\"variance\":%.1f,"
+                  "\"ppm\":%s}",
+                  snap->ammonia_raw, snap->ammonia_voltage_mv,
+                  snap->ammonia_variance,
+                  format_ppm(ppm, sizeof(ppm), snap->ammonia_ppm));
+}
+
+int api_json_sht30(char *buf, size_t size, const sensor_snapshot_t *snap) {
+  return snprintf(buf, size, "{\"temperature\":%.1f,\"humidity\":%.1f}",
+                  snap->temperature, snap->humidity);
+}
+
+int api_json_sensors(char *buf, size_t size, const sensor_snapshot_t *snap,
+                     int64_t now_ms, bool camera_enabled,
+                     bool camera_initialized) {
+  char ppm[16];
+  return snprintf(buf, size,
+                  "{\"version\":%lu,\"now_ms\":%lld,"
+                  "\"ammonia\":{\"raw\":%d,\"voltage_mv\":%d,"
+                  "\"variance\":%.1f,\"ppm\":%s,\"seq\":%lu,\"t_ms\":%lld},"
+                  "\"sht30\":{\"temperature\":%.1f,\"humidity\":%.1f,"
+                  "\"seq\":%lu,\"t_ms\":%lld},"
+                  "\"camera\":{\"enabled\":%s,\"initialized\":%s}}",
+                  (unsigned long)snap->version, (long long)now_ms,
+                  snap->ammonia_raw, snap->ammonia_voltage_mv,
+                  snap->ammonia_variance,
+                  format_ppm(ppm, sizeof(ppm), snap->ammonia_ppm),
+                  (unsigned long)snap->ammonia_seq,
+                  (long long)(snap->ammonia_time_us / 1000),
+                  snap->temperature, snap->humidity,
+                  (unsigned long)snap->sht30_seq,
+                  (long long)(snap->sht30_time_us / 1000),
+                  camera_enabled ? "true" : "false",
+                  camera_initialized ? "true" : "false");
+}
+
+bool api_json_name_valid(const char *name) {
+  if (name[0] == '\0') {
+    return false;
+  }
+  for (const char *c = name; *c != '\0'; c++) {
+    bool ok = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+              (*c >= '0' && *c <= '9') || *c == '_' || *c == '-';
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
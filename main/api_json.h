@@ -0,0 +1,51 @@
+#ifndef API_JSON_H
+#define API_JSON_H
+
+#include "sensor_snapshot.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief JSON bodies of the sensor API handlers
+ *
+ * Pure formatting with no httpd, FreeRTOS or driver dependency, so the
+ * handlers' output can be produced and timed off-target. Each function has
+ * snprintf() semantics: it returns the length the body needs, which is
+ * >= size if buf was too small.
+ */
+
+// Buffer large enough for any of the bodies below
+#define API_JSON_SENSORS_MAX 384
+
+/**
+ * @brief Body of GET /api/ammonia
+ */
+int api_json_ammonia(char *buf, size_t size, const sensor_snapshot_t *snap);
+
+/**
+ * @brief Body of GET /api/sht30
+ */
+int api_json_sht30(char *buf, size_t size, const sensor_snapshot_t *snap);
+
+/**
+ * @brief Body of GET /api/sensors
+ *
+ * @param now_ms Time since boot the response is generated at
+ * @param camera_enabled Camera capturing
+ * @param camera_initialized Camera driver loaded
+ */
+int api_json_sensors(char *buf, size_t size, const sensor_snapshot_t *snap,
+                     int64_t now_ms, bool camera_enabled,
+                     bool camera_initialized);
+
+/**
+ * @brief Check a user-chosen name (e.g. an alarm rule) for embedding as is
+ *
+ * Accepts non-empty names made of A-Z, a-z, 0-9, '_' and '-' only, which
+ * can be placed between quotes in a JSON body, an SSE data line or an MQTT
+ * payload without escaping.
+ */
+bool api_json_name_valid(const char *name);
+
+#endif // API_JSON_H
@@ -1,152 +1,296 @@
 #include "axp313a.h"
-#include "driver/i2c_master.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "i2c_bus.h"
+#include <string.h>
 
 static const char *TAG = "AXP313A";
 
-// AXP313A I2C address
+// AXP313A I2C address (on the shared IO1/IO2 bus, see i2c_bus.h)
 #define AXP313A_ADDR 0x36
-
-// I2C configuration for Romeo ESP32-S3
-// Must match the pins used by the camera to avoid conflict,
-// but we will init/deinit on demand to share the bus.
-#define I2C_MASTER_SDA_IO 1
-#define I2C_MASTER_SCL_IO 2
-#define I2C_MASTER_FREQ_HZ 100000
+#define AXP313A_FREQ_HZ 100000
 
 // AXP313A Register addresses
 #define AXP313A_OUTPUT_CTRL 0x10   // Output control register
+#define AXP313A_DCDC2_VOLTAGE 0x14 // DCDC2 voltage setting
+#define AXP313A_DCDC3_VOLTAGE 0x15 // DCDC3 voltage setting
 #define AXP313A_ALDO1_VOLTAGE 0x16 // ALDO1 voltage setting
+#define AXP313A_DLDO1_VOLTAGE 0x17 // DLDO1 voltage setting
 
 // Output control bits
-#define AXP313A_ALDO1_EN (1 << 0)
-
-// Helper to perform transient I2C operation
-// We init bus, perfom op, then deinit bus to avoid conflict with Camera driver
-static esp_err_t axp313a_perform_op(uint8_t reg, uint8_t *val, bool write) {
-  esp_err_t ret;
-
-  // 1. Create I2C Master Bus
-  i2c_master_bus_config_t i2c_bus_config = {
-      .clk_source = I2C_CLK_SRC_DEFAULT,
-      .i2c_port = -1, // Auto select
-      .scl_io_num = I2C_MASTER_SCL_IO,
-      .sda_io_num = I2C_MASTER_SDA_IO,
-      .glitch_ignore_cnt = 7,
-      .flags.enable_internal_pullup = true,
-  };
-
-  i2c_master_bus_handle_t bus_handle;
-  ret = i2c_new_master_bus(&i2c_bus_config, &bus_handle);
-  if (ret != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to create I2C bus: %s", esp_err_to_name(ret));
-    return ret;
-  }
-
-  // 2. Add AXP313A Device
-  i2c_device_config_t dev_config = {
-      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-      .device_address = AXP313A_ADDR,
-      .scl_speed_hz = I2C_MASTER_FREQ_HZ,
-  };
-
-  i2c_master_dev_handle_t dev_handle;
-  ret = i2c_master_bus_add_device(bus_handle, &dev_config, &dev_handle);
-  if (ret != ESP_OK) {
-    i2c_del_master_bus(bus_handle);
-    return ret;
-  }
-
-  // 3. Perform Operation
-  if (write) {
-    uint8_t write_buf[2] = {reg, *val};
-    ret = i2c_master_transmit(dev_handle, write_buf, sizeof(write_buf),
-                              pdMS_TO_TICKS(100));
-  } else {
-    // Read
-    ret = i2c_master_transmit_receive(dev_handle, &reg, 1, val, 1,
-                                      pdMS_TO_TICKS(100));
-  }
-
-  // 4. Teardown
-  i2c_master_bus_rm_device(dev_handle);
-  i2c_del_master_bus(bus_handle);
-
-  return ret;
+#define AXP313A_DCDC1_EN (1 << 0) // ESP32-S3 supply, never cleared
+#define AXP313A_DCDC2_EN (1 << 1)
+#define AXP313A_DCDC3_EN (1 << 2)
+#define AXP313A_ALDO1_EN (1 << 3)
+#define AXP313A_DLDO1_EN (1 << 4)
+
+// Shadowed register window: output control through DLDO1 voltage
+#define AXP313A_SHADOW_FIRST AXP313A_OUTPUT_CTRL
+#define AXP313A_SHADOW_LAST AXP313A_DLDO1_VOLTAGE
+#define AXP313A_SHADOW_SIZE (AXP313A_SHADOW_LAST - AXP313A_SHADOW_FIRST + 1)
+
+typedef struct {
+  uint8_t en_bit;
+  uint8_t voltage_reg;
+  uint16_t min_mv;
+  uint16_t max_mv;
+  bool dcdc; // DCDC step table, otherwise 100 mV LDO steps
+} axp313a_rail_info_t;
+
+static const axp313a_rail_info_t s_rails[] = {
+    [AXP313A_RAIL_DCDC2] = {AXP313A_DCDC2_EN, AXP313A_DCDC2_VOLTAGE, 500, 1540,
+                            true},
+    [AXP313A_RAIL_DCDC3] = {AXP313A_DCDC3_EN, AXP313A_DCDC3_VOLTAGE, 500, 3400,
+                            true},
+    [AXP313A_RAIL_ALDO1] = {AXP313A_ALDO1_EN, AXP313A_ALDO1_VOLTAGE, 500, 3500,
+                            false},
+    [AXP313A_RAIL_DLDO1] = {AXP313A_DLDO1_EN, AXP313A_DLDO1_VOLTAGE, 500, 3500,
+                            false},
+};
+
+// Persistent handle on the shared bus
+static i2c_master_dev_handle_t s_dev = NULL;
+
+// Shadow of the register window. Only this firmware writes these
+// registers, so updates are applied here and flushed without readback.
+// Guarded by the (recursive) bus lock.
+static uint8_t s_shadow[AXP313A_SHADOW_SIZE];
+static uint8_t s_dirty[AXP313A_SHADOW_SIZE];
+
+static uint8_t *shadow(uint8_t reg) {
+  return &s_shadow[reg - AXP313A_SHADOW_FIRST];
+}
+
+// Stage a bit update in the shadow; marks the register dirty if it changed
+static void shadow_update(uint8_t reg, uint8_t clear, uint8_t set) {
+  uint8_t *val = shadow(reg);
+  uint8_t next = (*val & ~clear) | set;
+  if (next != *val) {
+    *val = next;
+    s_dirty[reg - AXP313A_SHADOW_FIRST] = 1;
+  }
 }
 
-static esp_err_t axp313a_write_reg(uint8_t reg, uint8_t value) {
-  return axp313a_perform_op(reg, &value, true);
+// Burst-read the whole window into the shadow
+static esp_err_t shadow_load(void) {
+  uint8_t reg = AXP313A_SHADOW_FIRST;
+  esp_err_t err =
+      i2c_bus_write_read(s_dev, &reg, 1, s_shadow, AXP313A_SHADOW_SIZE);
+  if (err == ESP_OK) {
+    memset(s_dirty, 0, sizeof(s_dirty));
+  }
+  return err;
 }
 
-static esp_err_t axp313a_read_reg(uint8_t reg, uint8_t *value) {
-  return axp313a_perform_op(reg, value, false);
+// Voltage register code for a rail, or -1 if out of range
+static int voltage_code(const axp313a_rail_info_t *rail, uint16_t mv) {
+  if (mv < rail->min_mv || mv > rail->max_mv) {
+    return -1;
+  }
+  if (!rail->dcdc) {
+    return (mv - 500) / 100; // 0.5 V + n * 100 mV
+  }
+  // Round down to the step below, also across the gaps between segments
+  if (mv < 1220) {
+    int code = (mv - 500) / 10; // 0.50-1.20 V, 10 mV steps
+    return code > 70 ? 70 : code;
+  }
+  if (mv < 1600) {
+    int code = 71 + (mv - 1220) / 20; // 1.22-1.54 V, 20 mV steps
+    return code > 87 ? 87 : code;
+  }
+  return 88 + (mv - 1600) / 100; // 1.6-3.4 V, 100 mV steps (DCDC3)
 }
 
 esp_err_t axp313a_init(void) {
-  // Verify AXP313A is present by reading a register
-  uint8_t reg_val = 0;
-  esp_err_t err = axp313a_read_reg(AXP313A_OUTPUT_CTRL, &reg_val);
+  esp_err_t err = i2c_bus_init();
+  if (err != ESP_OK) {
+    return err;
+  }
+  if (s_dev == NULL) {
+    err = i2c_bus_add_device(AXP313A_ADDR, AXP313A_FREQ_HZ, &s_dev);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to add AXP313A device: %s", esp_err_to_name(err));
+      return err;
+    }
+  }
+
+  // Verify AXP313A is present and seed the shadow registers
+  err = i2c_bus_lock(portMAX_DELAY);
+  if (err != ESP_OK) {
+    return err;
+  }
+  err = shadow_load();
+  i2c_bus_unlock();
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "Failed to communicate with AXP313A: %s",
              esp_err_to_name(err));
     return err;
   }
 
-  ESP_LOGI(TAG, "AXP313A initialized (transient), output control reg: 0x%02X",
-           reg_val);
+  ESP_LOGI(TAG, "AXP313A initialized, output control reg: 0x%02X",
+           *shadow(AXP313A_OUTPUT_CTRL));
   return ESP_OK;
 }
 
-esp_err_t axp313a_camera_power_on(void) {
-  esp_err_t err;
+esp_err_t axp313a_rail_set_voltage(axp313a_rail_t rail, uint16_t mv) {
+  if (rail >= AXP313A_RAIL_COUNT) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  const axp313a_rail_info_t *info = &s_rails[rail];
+  int code = voltage_code(info, mv);
+  if (code < 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
 
-  // Set ALDO1 voltage to 2.8V (camera AVDD)
-  // Voltage = 0.5V + (reg_val * 0.1V), so 2.8V = 0x17 (23 * 0.1 + 0.5 = 2.8)
-  err = axp313a_write_reg(AXP313A_ALDO1_VOLTAGE, 0x17);
+  esp_err_t err = i2c_bus_lock(portMAX_DELAY);
   if (err != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to set ALDO1 voltage: %s", esp_err_to_name(err));
     return err;
   }
+  shadow_update(info->voltage_reg, 0xFF, (uint8_t)code);
+  i2c_bus_unlock();
+  return ESP_OK;
+}
 
-  // Enable ALDO1 output
-  // We need read-modify-write, but to be safe and simple with transient bus,
-  // we can just read then write in separate transactions.
-  uint8_t reg_val = 0;
-  err = axp313a_read_reg(AXP313A_OUTPUT_CTRL, &reg_val);
-  if (err != ESP_OK)
+esp_err_t axp313a_rail_enable(axp313a_rail_t rail, bool enable) {
+  if (rail >= AXP313A_RAIL_COUNT) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  uint8_t bit = s_rails[rail].en_bit;
+
+  esp_err_t err = i2c_bus_lock(portMAX_DELAY);
+  if (err != ESP_OK) {
     return err;
+  }
+  shadow_update(AXP313A_OUTPUT_CTRL, bit, enable ? bit : 0);
+  i2c_bus_unlock();
+  return ESP_OK;
+}
+
+esp_err_t axp313a_flush(void) {
+  if (s_dev == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  esp_err_t err = i2c_bus_lock(portMAX_DELAY);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  // Clearing DCDC1 cuts the ESP32-S3's own supply. Only a bad shadow (a
+  // corrupted load) can get here; write nothing and put the bit back so a
+  // retry keeps the SoC powered.
+  uint8_t *ctrl = shadow(AXP313A_OUTPUT_CTRL);
+  if (s_dirty[AXP313A_OUTPUT_CTRL - AXP313A_SHADOW_FIRST] &&
+      !(*ctrl & AXP313A_DCDC1_EN)) {
+    *ctrl |= AXP313A_DCDC1_EN;
+    i2c_bus_unlock();
+    ESP_LOGE(TAG, "Refusing to clear DCDC1 (ESP32-S3 supply)");
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  // One burst write (register address + data, auto-increment) per run of
+  // consecutive dirty registers. Voltages go out before the enable bits
+  // because the run containing OUTPUT_CTRL is written last.
+  uint8_t buf[1 + AXP313A_SHADOW_SIZE];
+  int i = AXP313A_SHADOW_SIZE - 1;
+  while (i >= 0 && err == ESP_OK) {
+    if (!s_dirty[i]) {
+      i--;
+      continue;
+    }
+    int end = i;
+    while (i > 0 && s_dirty[i - 1]) {
+      i--;
+    }
+    size_t len = end - i + 1;
+    buf[0] = AXP313A_SHADOW_FIRST + i;
+    memcpy(&buf[1], &s_shadow[i], len);
+    err = i2c_bus_write(s_dev, buf, 1 + len);
+    if (err == ESP_OK) {
+      memset(&s_dirty[i], 0, len);
+    }
+    i--;
+  }
+
+  i2c_bus_unlock();
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Register flush failed: %s", esp_err_to_name(err));
+  }
+  return err;
+}
 
-  reg_val |= AXP313A_ALDO1_EN;
-  err = axp313a_write_reg(AXP313A_OUTPUT_CTRL, reg_val);
+esp_err_t axp313a_verify(void) {
+  if (s_dev == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  esp_err_t err = i2c_bus_lock(portMAX_DELAY);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  uint8_t expected[AXP313A_SHADOW_SIZE];
+  uint8_t dirty[AXP313A_SHADOW_SIZE];
+  memcpy(expected, s_shadow, sizeof(expected));
+  memcpy(dirty, s_dirty, sizeof(dirty));
+  err = shadow_load();
+  if (err == ESP_OK) {
+    for (int i = 0; i < AXP313A_SHADOW_SIZE; i++) {
+      if (dirty[i]) {
+        // Staged but not flushed: keep the staged value pending
+        s_shadow[i] = expected[i];
+        s_dirty[i] = 1;
+      } else if (s_shadow[i] != expected[i]) {
+        ESP_LOGW(TAG, "Reg 0x%02X: expected 0x%02X, read 0x%02X",
+                 AXP313A_SHADOW_FIRST + i, expected[i], s_shadow[i]);
+        err = ESP_ERR_INVALID_RESPONSE;
+      }
+    }
+  }
+
+  i2c_bus_unlock();
+  return err;
+}
+
+esp_err_t axp313a_camera_power_on(void) {
+  if (s_dev == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  int64_t start = esp_timer_get_time();
+
+  // ALDO1 = 2.8V (camera AVDD), then enable it; both go out in one flush
+  axp313a_rail_set_voltage(AXP313A_RAIL_ALDO1, 2800);
+  axp313a_rail_enable(AXP313A_RAIL_ALDO1, true);
+  esp_err_t err = axp313a_flush();
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "Failed to enable ALDO1: %s", esp_err_to_name(err));
     return err;
   }
+  int64_t bus_us = esp_timer_get_time() - start;
 
   // Wait for power to stabilize
   vTaskDelay(pdMS_TO_TICKS(100));
 
-  ESP_LOGI(TAG, "Camera power enabled (ALDO1 = 2.8V)");
+  ESP_LOGI(TAG, "Camera power enabled (ALDO1 = 2.8V, %lld us bus time)",
+           (long long)bus_us);
   return ESP_OK;
 }
 
 esp_err_t axp313a_camera_power_off(void) {
-  uint8_t reg_val = 0;
-  esp_err_t err = axp313a_read_reg(AXP313A_OUTPUT_CTRL, &reg_val);
-  if (err != ESP_OK) {
-    return err;
+  if (s_dev == NULL) {
+    return ESP_ERR_INVALID_STATE;
   }
+  int64_t start = esp_timer_get_time();
 
   // Disable ALDO1 output
-  reg_val &= ~AXP313A_ALDO1_EN;
-  err = axp313a_write_reg(AXP313A_OUTPUT_CTRL, reg_val);
+  axp313a_rail_enable(AXP313A_RAIL_ALDO1, false);
+  esp_err_t err = axp313a_flush();
   if (err != ESP_OK) {
     return err;
   }
 
-  ESP_LOGI(TAG, "Camera power disabled");
+  ESP_LOGI(TAG, "Camera power disabled (%lld us bus time)",
+           (long long)(esp_timer_get_time() - start));
   return ESP_OK;
 }
@@ -2,17 +2,75 @@
 #define AXP313A_H
 
 #include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Switchable AXP313A output rails
+ *
+ * DCDC1 feeds the ESP32-S3 itself and is deliberately not exposed.
+ */
+typedef enum {
+  AXP313A_RAIL_DCDC2 = 0, // 0.5-1.54 V
+  AXP313A_RAIL_DCDC3,     // 0.5-3.4 V
+  AXP313A_RAIL_ALDO1,     // 0.5-3.5 V, camera AVDD
+  AXP313A_RAIL_DLDO1,     // 0.5-3.5 V
+  AXP313A_RAIL_COUNT,
+} axp313a_rail_t;
 
 /**
  * @brief Initialize AXP313A power management IC
  *
- * This configures the I2C bus and enables power outputs
- * required for the camera module on DFRobot Romeo/FireBeetle ESP32-S3.
+ * Creates the shared IO1/IO2 I2C bus (see i2c_bus.h) if needed and attaches
+ * the PMIC that powers the camera module on DFRobot Romeo/FireBeetle
+ * ESP32-S3.
  *
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t axp313a_init(void);
 
+/**
+ * @brief Stage a rail voltage in the shadow registers
+ *
+ * Register updates are applied to a local shadow copy and only reach the
+ * PMIC on axp313a_flush(), so a power sequence costs one burst write per
+ * run of adjacent registers and no readback.
+ *
+ * @param rail Output rail
+ * @param mv Target voltage in millivolts (rounded down to the rail's step)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if out of range
+ */
+esp_err_t axp313a_rail_set_voltage(axp313a_rail_t rail, uint16_t mv);
+
+/**
+ * @brief Stage a rail enable/disable in the shadow registers
+ *
+ * @param rail Output rail
+ * @param enable true to switch the rail on
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t axp313a_rail_enable(axp313a_rail_t rail, bool enable);
+
+/**
+ * @brief Write all staged registers to the PMIC
+ *
+ * Enable bits are written after the voltages.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE (nothing written) if the
+ *         staged output control would turn DCDC1 off, error code otherwise
+ */
+esp_err_t axp313a_flush(void);
+
+/**
+ * @brief Read the PMIC back and compare it with the shadow registers
+ *
+ * The only operation that reads the PMIC after init. Staged, unflushed
+ * updates are kept.
+ *
+ * @return ESP_OK if they match, ESP_ERR_INVALID_RESPONSE on mismatch
+ */
+esp_err_t axp313a_verify(void);
+
 /**
  * @brief Enable camera power via AXP313A ALDO1 output
  *
@@ -0,0 +1,103 @@
+#include "bulk_frame.h"
+#include <math.h>
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  for (int i = 0; i < 4; i++) {
+    p[i] = (uint8_t)(v >> (8 * i));
+  }
+}
+
+static void put_u64(uint8_t *p, uint64_t v) {
+  for (int i = 0; i < 8; i++) {
+    p[i] = (uint8_t)(v >> (8 * i));
+  }
+}
+
+// Round and clamp to the 16-bit field
+static int16_t to_i16(float v) {
+  if (!(v > INT16_MIN)) { // Also catches NaN
+    return INT16_MIN;
+  }
+  if (v >= INT16_MAX) {
+    return INT16_MAX;
+  }
+  return (int16_t)lroundf(v);
+}
+
+static uint16_t to_u16(float v) {
+  if (!(v > 0)) {
+    return 0;
+  }
+  if (v >= UINT16_MAX) {
+    return UINT16_MAX;
+  }
+  return (uint16_t)lroundf(v);
+}
+
+// 0.01 ppm, saturated one below the uncalibrated sentinel
+static uint16_t to_centi_ppm(float ppm) {
+  if (isnan(ppm)) {
+    return BULK_PPM_UNCALIBRATED;
+  }
+  uint16_t v = to_u16(ppm * 100.0f);
+  return v == BULK_PPM_UNCALIBRATED ? BULK_PPM_UNCALIBRATED - 1 : v;
+}
+
+size_t bulk_frame_header(uint8_t *buf, const bulk_frame_header_t *header) {
+  put_u32(&buf[0], BULK_FRAME_MAGIC);
+  put_u16(&buf[4], BULK_FRAME_VERSION);
+  put_u16(&buf[6], BULK_FRAME_RECORD_SIZE);
+  put_u32(&buf[8], header->seq);
+  put_u32(&buf[12], header->since);
+  put_u64(&buf[16], (uint64_t)header->now_ms);
+  put_u32(&buf[24], header->heap_free);
+  put_u16(&buf[28], header->flags);
+  put_u16(&buf[30], header->count);
+  return BULK_FRAME_HEADER_SIZE;
+}
+
+size_t bulk_frame_record(uint8_t *buf, const sensor_sample_t *sample,
+                         int64_t now_ms) {
+  int64_t age_ms = now_ms - sample->time_us / 1000;
+  int16_t v0, v1;
+  uint16_t v2, v3;
+
+  if (sample->kind == SENSOR_SAMPLE_AMMONIA) {
+    v0 = to_i16(sample->ammonia.voltage_mv);
+    v1 = to_i16(sample->ammonia.raw);
+    v2 = to_u16(sample->ammonia.variance);
+    v3 = to_centi_ppm(sample->ammonia.ppm);
+  } else {
+    v0 = to_i16(sample->sht30.temperature * 100.0f);
+    v1 = to_i16(sample->sht30.humidity * 100.0f);
+    v2 = 0;
+    v3 = 0;
+  }
+
+  put_u32(&buf[0], sample->version);
+  put_u32(&buf[4], age_ms < 0 ? 0 : age_ms > UINT32_MAX ? UINT32_MAX
+                                                          : (uint32_t)age_ms);
+  buf[8] = sample->kind;
+  buf[9] = 0;
+  put_u16(&buf[10], (uint16_t)v0);
+  put_u16(&buf[12], (uint16_t)v1);
+  put_u16(&buf[14], v2);
+  put_u16(&buf[16], v3);
+  put_u16(&buf[18], 0);
+  return BULK_FRAME_RECORD_SIZE;
+}
+
+uint32_t bulk_frame_resume(uint32_t since, uint32_t newest, uint32_t oldest,
+                           bool *gap) {
+  if (since > newest) {
+    *gap = true; // Rebooted since the client's last read
+    return 0;
+  }
+  *gap = oldest != 0 && oldest > since + 1;
+  return since;
+}
@@ -0,0 +1,100 @@
+#ifndef BULK_FRAME_H
+#define BULK_FRAME_H
+
+#include "sensor_snapshot.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Fixed-layout binary body of GET /api/v1/bulk
+ *
+ * All fields little-endian. A 32-byte header is followed by count records
+ * of 20 bytes each:
+ *
+ *   header                              record
+ *   0  u32 magic "SCB1"                 0  u32 seq (snapshot version)
+ *   4  u16 format version (2)           4  u32 age_ms (now_ms - sample time)
+ *   6  u16 record size (20)             8  u8  sensor (sensor_sample_kind_t)
+ *   8  u32 seq (newest sample)          9  u8  reserved (0)
+ *   12 u32 since (as requested)         10 i16 v0
+ *   16 i64 now_ms (since boot)          12 i16 v1
+ *   24 u32 free internal heap (bytes)   14 u16 v2
+ *   28 u16 flags (BULK_FLAG_*)          16 u16 v3
+ *   30 u16 count                        18 u16 reserved (0)
+ *
+ * Values per sensor:
+ *   ammonia: v0 = voltage (mV), v1 = raw counts, v2 = variance (counts^2,
+ *            saturated at 65535), v3 = NH3 (0.01 ppm, saturated at 65534;
+ *            BULK_PPM_UNCALIBRATED if the sensor is not calibrated)
+ *   sht30:   v0 = temperature (0.01 degC), v1 = humidity (0.01 %RH),
+ *            v2 = v3 = 0
+ *
+ * Version 1 records were 16 bytes without v3. Readers should step through
+ * records by the size in the header, so fields added at the end don't
+ * break them.
+ *
+ * Pure formatting like api_json.h, so frames can be built off-target.
+ */
+
+#define BULK_FRAME_MAGIC 0x31424353u // "SCB1"
+#define BULK_FRAME_VERSION 2
+#define BULK_FRAME_HEADER_SIZE 32
+#define BULK_FRAME_RECORD_SIZE 20
+
+#define BULK_PPM_UNCALIBRATED 0xFFFF // v3 of an uncalibrated ammonia record
+
+#define BULK_FLAG_CAMERA_ENABLED 0x0001
+#define BULK_FLAG_CAMERA_INITIALIZED 0x0002
+#define BULK_FLAG_GAP 0x0004  // Samples after since are gone, see
+                              // bulk_frame_resume()
+#define BULK_FLAG_MORE 0x0008 // More samples pending, ask again from the
+                              // last record's seq
+
+typedef struct {
+  uint32_t seq;
+  uint32_t since;
+  int64_t now_ms;
+  uint32_t heap_free;
+  uint16_t flags;
+  uint16_t count;
+} bulk_frame_header_t;
+
+/**
+ * @brief Write the header
+ *
+ * @param buf At least BULK_FRAME_HEADER_SIZE bytes
+ * @return BULK_FRAME_HEADER_SIZE
+ */
+size_t bulk_frame_header(uint8_t *buf, const bulk_frame_header_t *header);
+
+/**
+ * @brief Write one sample record
+ *
+ * @param buf At least BULK_FRAME_RECORD_SIZE bytes
+ * @param sample Logged sample
+ * @param now_ms Time the frame is generated at (ms since boot)
+ * @return BULK_FRAME_RECORD_SIZE
+ */
+size_t bulk_frame_record(uint8_t *buf, const sensor_sample_t *sample,
+                         int64_t now_ms);
+
+/**
+ * @brief Where a since= read continues
+ *
+ * Samples after since are gone if the log no longer reaches back to
+ * since + 1, or if since is ahead of the newest seq: seqs restart at 0 on
+ * boot, so a scraper still holding a seq from before a reboot would
+ * otherwise get empty frames forever. In both cases the read restarts at
+ * the oldest logged sample and the frame carries BULK_FLAG_GAP.
+ *
+ * @param since Seq requested by the client
+ * @param newest Newest snapshot version
+ * @param oldest Oldest logged version (0 = log empty)
+ * @param gap Output, whether samples after since are gone
+ * @return Seq to read samples after
+ */
+uint32_t bulk_frame_resume(uint32_t since, uint32_t newest, uint32_t oldest,
+                           bool *gap);
+
+#endif // BULK_FRAME_H
@@ -0,0 +1,96 @@
+#include "cbor_lite.h"
+#include <string.h>
+
+// Major types
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_BYTES 2
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_SIMPLE 7
+
+#define CBOR_FALSE 20
+#define CBOR_TRUE 21
+
+static void put(cbor_writer_t *w, const void *data, size_t len) {
+  if (w->overflow || w->cap - w->len < len) {
+    w->overflow = true;
+    return;
+  }
+  memcpy(&w->buf[w->len], data, len);
+  w->len += len;
+}
+
+// Initial byte plus the argument in the shortest form, big-endian
+static void put_head(cbor_writer_t *w, uint8_t major, uint64_t arg) {
+  uint8_t head[9];
+  size_t n;
+  if (arg < 24) {
+    head[0] = (uint8_t)(major << 5 | arg);
+    n = 1;
+  } else if (arg <= UINT8_MAX) {
+    head[0] = major << 5 | 24;
+    head[1] = (uint8_t)arg;
+    n = 2;
+  } else if (arg <= UINT16_MAX) {
+    head[0] = major << 5 | 25;
+    head[1] = (uint8_t)(arg >> 8);
+    head[2] = (uint8_t)arg;
+    n = 3;
+  } else if (arg <= UINT32_MAX) {
+    head[0] = major << 5 | 26;
+    for (int i = 0; i < 4; i++) {
+      head[1 + i] = (uint8_t)(arg >> (24 - 8 * i));
+    }
+    n = 5;
+  } else {
+    head[0] = major << 5 | 27;
+    for (int i = 0; i < 8; i++) {
+      head[1 + i] = (uint8_t)(arg >> (56 - 8 * i));
+    }
+    n = 9;
+  }
+  put(w, head, n);
+}
+
+void cbor_init(cbor_writer_t *w, uint8_t *buf, size_t cap) {
+  w->buf = buf;
+  w->cap = cap;
+  w->len = 0;
+  w->overflow = false;
+}
+
+void cbor_uint(cbor_writer_t *w, uint64_t value) {
+  put_head(w, CBOR_UINT, value);
+}
+
+void cbor_int(cbor_writer_t *w, int64_t value) {
+  if (value >= 0) {
+    put_head(w, CBOR_UINT, (uint64_t)value);
+  } else {
+    // -1 - n, computed without overflowing INT64_MIN
+    put_head(w, CBOR_NEGINT, ~(uint64_t)value);
+  }
+}
+
+void cbor_text(cbor_writer_t *w, const char *text) {
+  size_t len = strlen(text);
+  put_head(w, CBOR_TEXT, len);
+  put(w, text, len);
+}
+
+void cbor_bytes(cbor_writer_t *w, const void *data, size_t len) {
+  put_head(w, CBOR_BYTES, len);
+  put(w, data, len);
+}
+
+void cbor_array(cbor_writer_t *w, size_t count) {
+  put_head(w, CBOR_ARRAY, count);
+}
+
+void cbor_map(cbor_writer_t *w, size_t count) { put_head(w, CBOR_MAP, count); }
+
+void cbor_bool(cbor_writer_t *w, bool value) {
+  put_head(w, CBOR_SIMPLE, value ? CBOR_TRUE : CBOR_FALSE);
+}
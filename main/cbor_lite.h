@@ -0,0 +1,65 @@
+#ifndef CBOR_LITE_H
+#define CBOR_LITE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Minimal CBOR (RFC 8949) encoder into a caller-provided buffer
+ *
+ * Covers the subset the telemetry payloads need: integers, text strings,
+ * and definite-length arrays and maps. Every item uses the shortest
+ * encoding, so small integers take a single byte. Writing past the end of
+ * the buffer sets the overflow flag and drops the rest; check it once
+ * after encoding. Plain C, no ESP-IDF dependency.
+ */
+
+typedef struct {
+  uint8_t *buf;
+  size_t cap;
+  size_t len;
+  bool overflow;
+} cbor_writer_t;
+
+/**
+ * @brief Start encoding into buf
+ */
+void cbor_init(cbor_writer_t *w, uint8_t *buf, size_t cap);
+
+/**
+ * @brief Unsigned integer
+ */
+void cbor_uint(cbor_writer_t *w, uint64_t value);
+
+/**
+ * @brief Signed integer
+ */
+void cbor_int(cbor_writer_t *w, int64_t value);
+
+/**
+ * @brief UTF-8 text string
+ */
+void cbor_text(cbor_writer_t *w, const char *text);
+
+/**
+ * @brief Byte string
+ */
+void cbor_bytes(cbor_writer_t *w, const void *data, size_t len);
+
+/**
+ * @brief Array header, followed by count items
+ */
+void cbor_array(cbor_writer_t *w, size_t count);
+
+/**
+ * @brief Map header, followed by count key/value pairs
+ */
+void cbor_map(cbor_writer_t *w, size_t count);
+
+/**
+ * @brief Boolean
+ */
+void cbor_bool(cbor_writer_t *w, bool value);
+
+#endif // CBOR_LITE_H
@@ -0,0 +1,350 @@
+#include "clip_recorder.h"
+#include "clip_store.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "frame_broadcaster.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "httpd_async.h"
+#include "mjpeg_framing.h"
+#include "motion_detect.h"
+#include "task_topology.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "Clips";
+
+#define CLIP_PARTITION_LABEL "clips"
+#define CLIP_PARTITION_SUBTYPE 0x40 // Custom data subtype, partitions.csv
+
+#define CLIP_IDLE_POLL_MS 250
+
+// Playback reads the flash in chunks this large and writes each straight
+// to the socket
+#define CLIP_READ_CHUNK (16 * 1024)
+
+static const esp_partition_t *s_part = NULL;
+static clip_io_t s_io;
+static clip_store_t s_store;       // Guarded by s_lock
+static SemaphoreHandle_t s_lock = NULL;
+
+static uint8_t *s_frame = NULL; // Copy of the frame being written, PSRAM
+static size_t s_frame_cap = 0;
+
+// ------------------------------------------
+// Partition backend
+// ------------------------------------------
+static esp_err_t part_read(void *ctx, uint32_t offset, void *buf, size_t len) {
+  return esp_partition_read(ctx, offset, buf, len);
+}
+
+static esp_err_t part_write(void *ctx, uint32_t offset, const void *buf,
+                            size_t len) {
+  return esp_partition_write(ctx, offset, buf, len);
+}
+
+static esp_err_t part_erase(void *ctx, uint32_t offset, size_t len) {
+  return esp_partition_erase_range(ctx, offset, len);
+}
+
+// ------------------------------------------
+// Recorder task
+// ------------------------------------------
+static bool copy_frame(const shared_frame_t *frame) {
+  if (frame->len > s_frame_cap) {
+    uint8_t *buf = heap_caps_realloc(s_frame, frame->len, MALLOC_CAP_SPIRAM);
+    if (buf == NULL) {
+      return false;
+    }
+    s_frame = buf;
+    s_frame_cap = frame->len;
+  }
+  memcpy(s_frame, frame->buf, frame->len);
+  return true;
+}
+
+static void clip_end(uint32_t id) {
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  clip_info_t info;
+  bool found = clip_store_find(&s_store, id, &info) == ESP_OK;
+  clip_store_end(&s_store);
+  xSemaphoreGive(s_lock);
+
+  if (found) {
+    ESP_LOGI(TAG, "Clip %lu ended: %lu frames, %lu KB in %lu ms",
+             (unsigned long)id, (unsigned long)info.frames,
+             (unsigned long)(info.bytes / 1024),
+             (unsigned long)info.duration_ms);
+  }
+}
+
+static void recorder_task(void *arg) {
+  uint32_t clip_id = 0; // Clip being recorded, 0 = idle
+  int64_t clip_start_us = 0;
+  uint32_t last_seq = 0;
+  TickType_t last_wake = xTaskGetTickCount();
+
+  while (true) {
+    if (!motion_detect_active()) {
+      if (clip_id != 0) {
+        clip_end(clip_id);
+        clip_id = 0;
+        frame_broadcaster_unsubscribe();
+      }
+      vTaskDelay(pdMS_TO_TICKS(CLIP_IDLE_POLL_MS));
+      last_wake = xTaskGetTickCount();
+      continue;
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (clip_id != 0 && now - clip_start_us > CLIP_MAX_DURATION_MS * 1000LL) {
+      clip_end(clip_id);
+      clip_id = 0;
+    } else if (clip_id == 0 && frame_broadcaster_subscribe() != ESP_OK) {
+      vTaskDelay(pdMS_TO_TICKS(CLIP_IDLE_POLL_MS));
+      continue;
+    }
+
+    if (clip_id == 0) {
+      xSemaphoreTake(s_lock, portMAX_DELAY);
+      esp_err_t err =
+          clip_store_begin(&s_store, (uint32_t)(now / 1000), &clip_id);
+      xSemaphoreGive(s_lock);
+      if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start clip: %s", esp_err_to_name(err));
+        frame_broadcaster_unsubscribe();
+        clip_id = 0;
+        vTaskDelay(pdMS_TO_TICKS(CLIP_IDLE_POLL_MS));
+        continue;
+      }
+      clip_start_us = now;
+      ESP_LOGI(TAG, "Recording clip %lu", (unsigned long)clip_id);
+    }
+
+    const shared_frame_t *frame =
+        frame_broadcaster_acquire(last_seq, pdMS_TO_TICKS(1000));
+    if (frame != NULL) {
+      last_seq = frame->seq;
+      // Copy out first: the flash write below is slow and must not hold a
+      // broadcaster slot
+      int64_t t_us = frame->timestamp_us - clip_start_us;
+      bool copied = copy_frame(frame);
+      size_t len = frame->len;
+      frame_broadcaster_release(frame);
+
+      if (copied) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        esp_err_t err = clip_store_append(
+            &s_store, t_us > 0 ? (uint32_t)(t_us / 1000) : 0, s_frame, len);
+        xSemaphoreGive(s_lock);
+        if (err != ESP_OK) {
+          ESP_LOGW(TAG, "Clip %lu: append failed: %s", (unsigned long)clip_id,
+                   esp_err_to_name(err));
+          clip_end(clip_id);
+          clip_id = 0;
+          frame_broadcaster_unsubscribe();
+        }
+      }
+    }
+
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(1000 / CLIP_RECORD_FPS));
+  }
+}
+
+esp_err_t clip_recorder_init(void) {
+  s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                    CLIP_PARTITION_SUBTYPE,
+                                    CLIP_PARTITION_LABEL);
+  if (s_part == NULL) {
+    ESP_LOGW(TAG, "No \"%s\" partition, recording disabled",
+             CLIP_PARTITION_LABEL);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  s_io = (clip_io_t){
+      .read = part_read,
+      .write = part_write,
+      .erase = part_erase,
+      .ctx = (void *)s_part,
+      .size = s_part->size,
+  };
+  int64_t start = esp_timer_get_time();
+  esp_err_t err = clip_store_mount(&s_store, &s_io);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to mount clip store: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  s_lock = xSemaphoreCreateMutex();
+  if (s_lock == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  err = task_topology_create(TASK_CLIP_REC, recorder_task, NULL, NULL);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  ESP_LOGI(TAG, "Clip store: %d segments, %d clips, boot %lu (mount %lld us)",
+           s_store.seg_count, s_store.clip_count, (unsigned long)s_store.boot,
+           (long long)(esp_timer_get_time() - start));
+  return ESP_OK;
+}
+
+// ------------------------------------------
+// HTTP handlers
+// ------------------------------------------
+esp_err_t clip_recorder_list_handler(httpd_req_t *req) {
+  if (s_lock == NULL) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_send(req, "Recording disabled", HTTPD_RESP_USE_STRLEN);
+  }
+
+  clip_info_t *clips = malloc(CLIP_MAX_CLIPS * sizeof(clip_info_t));
+  if (clips == NULL) {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                               "Out of memory");
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  int n = clip_store_list(&s_store, clips, CLIP_MAX_CLIPS);
+  uint32_t boot = s_store.boot;
+  uint32_t recording = s_store.recording_id;
+  xSemaphoreGive(s_lock);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+  char buf[1024];
+  size_t len = snprintf(buf, sizeof(buf),
+                        "{\"boot\":%lu,\"recording\":%lu,\"clips\":[",
+                        (unsigned long)boot, (unsigned long)recording);
+  esp_err_t res = ESP_OK;
+  for (int i = 0; i < n && res == ESP_OK; i++) {
+    const clip_info_t *c = &clips[i];
+    len += snprintf(&buf[len], sizeof(buf) - len,
+                    "%s{\"id\":%lu,\"boot\":%lu,\"start_ms\":%lu,"
+                    "\"duration_ms\":%lu,\"frames\":%lu,\"bytes\":%lu}",
+                    i > 0 ? "," : "", (unsigned long)c->id,
+                    (unsigned long)c->boot, (unsigned long)c->start_ms,
+                    (unsigned long)c->duration_ms, (unsigned long)c->frames,
+                    (unsigned long)c->bytes);
+    if (len > sizeof(buf) - 160) {
+      res = httpd_resp_send_chunk(req, buf, len);
+      len = 0;
+    }
+  }
+  free(clips);
+
+  if (res == ESP_OK) {
+    len += snprintf(&buf[len], sizeof(buf) - len, "]}");
+    res = httpd_resp_send_chunk(req, buf, len);
+  }
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+// Send one frame's JPEG data in large sequential reads. The store lock is
+// only held per chunk so the recorder keeps appending meanwhile; if the
+// segment is reclaimed under the cursor the frame is cut short.
+static esp_err_t send_frame_data(int sockfd, const clip_cursor_t *cur,
+                                 const clip_frame_t *frame, uint8_t *chunk) {
+  esp_err_t res = mjpeg_send_part_header(sockfd, frame->len);
+  for (uint32_t done = 0; done < frame->len && res == ESP_OK;) {
+    size_t n = frame->len - done;
+    if (n > CLIP_READ_CHUNK) {
+      n = CLIP_READ_CHUNK;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (clip_store_cursor_valid(&s_store, cur)) {
+      res = clip_store_read(&s_store, frame->offset + done, chunk, n);
+    } else {
+      res = ESP_ERR_NOT_FOUND;
+    }
+    xSemaphoreGive(s_lock);
+    if (res == ESP_OK) {
+      res = mjpeg_send_data(sockfd, chunk, n);
+      done += n;
+    }
+  }
+  return res;
+}
+
+// Runs on an async worker for the length of the clip
+static esp_err_t play_worker_handler(httpd_req_t *req) {
+  const char *id_str = strrchr(req->uri, '/');
+  uint32_t id = id_str != NULL ? strtoul(id_str + 1, NULL, 10) : 0;
+  uint32_t from_ms = 0;
+  char query[32];
+  char value[12];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+      httpd_query_key_value(query, "t", value, sizeof(value)) == ESP_OK) {
+    from_ms = strtoul(value, NULL, 10);
+  }
+
+  clip_cursor_t cur;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  esp_err_t res = clip_store_open(&s_store, id, from_ms, &cur);
+  xSemaphoreGive(s_lock);
+  if (res != ESP_OK) {
+    return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such clip");
+  }
+
+  uint8_t *chunk = malloc(CLIP_READ_CHUNK);
+  if (chunk == NULL) {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                               "Out of memory");
+  }
+
+  int sockfd = httpd_req_to_sockfd(req);
+  res = mjpeg_send_response_header(sockfd, CLIP_RECORD_FPS);
+
+  int64_t start_us = esp_timer_get_time();
+  uint32_t frames = 0;
+  uint32_t first_t_ms = 0;
+  while (res == ESP_OK) {
+    clip_frame_t frame;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = clip_store_next_frame(&s_store, &cur, &frame);
+    xSemaphoreGive(s_lock);
+    if (err != ESP_OK) {
+      break; // End of the clip
+    }
+
+    // Replay at the recorded pace
+    if (frames == 0) {
+      first_t_ms = frame.t_ms;
+    }
+    int64_t due_us = start_us + (int64_t)(frame.t_ms - first_t_ms) * 1000;
+    int64_t wait_us = due_us - esp_timer_get_time();
+    if (wait_us > 0) {
+      vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+    }
+
+    res = send_frame_data(sockfd, &cur, &frame, chunk);
+    frames++;
+  }
+  free(chunk);
+
+  ESP_LOGI(TAG, "Played clip %lu from %lu ms: %lu frames",
+           (unsigned long)id, (unsigned long)from_ms, (unsigned long)frames);
+  // Like the live stream, the response can only end by closing the socket
+  httpd_sess_trigger_close(req->handle, sockfd);
+  return ESP_OK;
+}
+
+esp_err_t clip_recorder_play_handler(httpd_req_t *req) {
+  if (s_lock == NULL) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_send(req, "Recording disabled", HTTPD_RESP_USE_STRLEN);
+  }
+  if (httpd_async_submit(req, play_worker_handler) != ESP_OK) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_send(req, "Too many streams", 16);
+  }
+  return ESP_OK;
+}
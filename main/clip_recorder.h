@@ -0,0 +1,42 @@
+#ifndef CLIP_RECORDER_H
+#define CLIP_RECORDER_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+/**
+ * @brief Motion-triggered JPEG clip recording to the "clips" partition
+ *
+ * While motion_detect_active() reports motion, frames from the broadcaster
+ * are appended to the clip store (see clip_store.h) at a low fixed rate.
+ * Stored clips are listed at /api/clips and played back as MJPEG at
+ * /api/clips/<id>[?t=<ms>], paced by their recorded timestamps.
+ */
+
+// Recording rate; every frame costs a flash program that stalls the cache
+#define CLIP_RECORD_FPS 2
+
+// Longer motion events are split into several clips
+#define CLIP_MAX_DURATION_MS (5 * 60 * 1000)
+
+/**
+ * @brief Mount the clip partition and start the recorder task
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the partition table has
+ *         no clip partition, error code otherwise
+ */
+esp_err_t clip_recorder_init(void);
+
+/**
+ * @brief URI handler for GET /api/clips (JSON list, newest first)
+ */
+esp_err_t clip_recorder_list_handler(httpd_req_t *req);
+
+/**
+ * @brief URI handler for GET /api/clips/<id>[?t=<ms>]
+ *
+ * Hands the request to an async worker (see httpd_async.h).
+ */
+esp_err_t clip_recorder_play_handler(httpd_req_t *req);
+
+#endif // CLIP_RECORDER_H
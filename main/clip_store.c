@@ -0,0 +1,466 @@
+#include "clip_store.h"
+#include <string.h>
+
+#define SEG_MAGIC 0x47455343u // "CSEG"
+#define REC_MAGIC 0x43455243u // "CREC"
+#define COMMITTED 0x00000000u
+#define UNCOMMITTED 0xFFFFFFFFu
+
+#define REC_START 1 // Clip start, aux = boot count, t_ms = uptime
+#define REC_FRAME 2 // JPEG frame, t_ms = time since clip start
+
+typedef struct {
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t erase_count;
+  uint32_t boot;
+  uint32_t reserved[4];
+} seg_header_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t commit; // Programmed to COMMITTED after the data
+  uint16_t type;
+  uint16_t flags;
+  uint32_t clip_id;
+  uint32_t t_ms;
+  uint32_t len;
+  uint32_t aux;
+  uint32_t reserved;
+} rec_header_t;
+
+_Static_assert(sizeof(seg_header_t) == 32, "segment header size");
+_Static_assert(sizeof(rec_header_t) == 32, "record header size");
+
+#define SEG_HDR_SIZE ((uint32_t)sizeof(seg_header_t))
+#define REC_HDR_SIZE ((uint32_t)sizeof(rec_header_t))
+#define ALIGN4(x) (((x) + 3u) & ~3u)
+
+static uint32_t seg_base(int seg) { return (uint32_t)seg * CLIP_SEGMENT_SIZE; }
+
+static clip_info_t *clip_at(clip_store_t *st, int i) {
+  return &st->clips[(st->clip_head + i) % CLIP_MAX_CLIPS];
+}
+
+static clip_info_t *clip_lookup(clip_store_t *st, uint32_t id) {
+  // Newest first: lookups are almost always for the clip being recorded
+  for (int i = st->clip_count - 1; i >= 0; i--) {
+    clip_info_t *c = clip_at(st, i);
+    if (c->id == id) {
+      return c;
+    }
+  }
+  return NULL;
+}
+
+static void clip_add(clip_store_t *st, const clip_info_t *info) {
+  if (st->clip_count == CLIP_MAX_CLIPS) {
+    // Index full: forget the oldest clip, its data is reclaimed later
+    st->clip_head = (st->clip_head + 1) % CLIP_MAX_CLIPS;
+    st->clip_count--;
+  }
+  *clip_at(st, st->clip_count) = *info;
+  st->clip_count++;
+}
+
+// Drop clips whose start record lives in a segment about to be erased
+static void clip_drop_until(clip_store_t *st, uint32_t seg_seq) {
+  while (st->clip_count > 0 && clip_at(st, 0)->seg_seq <= seg_seq) {
+    if (clip_at(st, 0)->id == st->recording_id) {
+      st->recording_id = 0;
+    }
+    st->clip_head = (st->clip_head + 1) % CLIP_MAX_CLIPS;
+    st->clip_count--;
+  }
+}
+
+// Read a record header; false if there is no committed record at offset
+static bool read_record(clip_store_t *st, int seg, uint32_t offset,
+                        rec_header_t *rec, bool *erased) {
+  *erased = false;
+  if (offset + REC_HDR_SIZE > CLIP_SEGMENT_SIZE) {
+    *erased = true; // Segment end behaves like erased space
+    return false;
+  }
+  if (st->io->read(st->io->ctx, seg_base(seg) + offset, rec, REC_HDR_SIZE) !=
+      ESP_OK) {
+    return false;
+  }
+  if (rec->magic == 0xFFFFFFFFu) {
+    const uint8_t *p = (const uint8_t *)rec;
+    *erased = true;
+    for (size_t i = 0; i < REC_HDR_SIZE; i++) {
+      if (p[i] != 0xFF) {
+        *erased = false;
+        break;
+      }
+    }
+    return false;
+  }
+  return rec->magic == REC_MAGIC && rec->commit == COMMITTED &&
+         offset + REC_HDR_SIZE + ALIGN4(rec->len) <= CLIP_SEGMENT_SIZE;
+}
+
+// Walk one segment's records into the index
+static void scan_segment(clip_store_t *st, int seg, uint32_t *max_id,
+                         uint32_t *max_boot) {
+  clip_segment_t *s = &st->segs[seg];
+  uint32_t offset = SEG_HDR_SIZE;
+  for (;;) {
+    rec_header_t rec;
+    bool erased;
+    if (!read_record(st, seg, offset, &rec, &erased)) {
+      // Erased space: the segment is open for appending up to here. Anything
+      // else is a torn record; nothing more may be written to the segment.
+      s->used = erased ? offset : CLIP_SEGMENT_SIZE;
+      return;
+    }
+    if (rec.clip_id > *max_id) {
+      *max_id = rec.clip_id;
+    }
+    if (rec.type == REC_START) {
+      clip_info_t info = {
+          .id = rec.clip_id,
+          .boot = rec.aux,
+          .start_ms = rec.t_ms,
+          .seg_seq = s->seq,
+          .offset = offset,
+      };
+      clip_add(st, &info);
+      if (rec.aux > *max_boot) {
+        *max_boot = rec.aux;
+      }
+    } else if (rec.type == REC_FRAME) {
+      if (s->first_clip == 0) {
+        s->first_clip = rec.clip_id;
+        s->first_t_ms = rec.t_ms;
+      }
+      clip_info_t *c = clip_lookup(st, rec.clip_id);
+      if (c != NULL) {
+        c->duration_ms = rec.t_ms;
+        c->frames++;
+        c->bytes += rec.len;
+      }
+    }
+    offset += REC_HDR_SIZE + ALIGN4(rec.len);
+  }
+}
+
+esp_err_t clip_store_mount(clip_store_t *st, const clip_io_t *io) {
+  memset(st, 0, sizeof(*st));
+  st->io = io;
+  st->seg_count = io->size / CLIP_SEGMENT_SIZE;
+  if (st->seg_count > CLIP_MAX_SEGMENTS) {
+    st->seg_count = CLIP_MAX_SEGMENTS;
+  }
+  if (st->seg_count < 2) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  uint32_t max_boot = 0;
+  int order[CLIP_MAX_SEGMENTS];
+  int valid = 0;
+  for (int i = 0; i < st->seg_count; i++) {
+    seg_header_t hdr;
+    esp_err_t err = io->read(io->ctx, seg_base(i), &hdr, sizeof(hdr));
+    if (err != ESP_OK) {
+      return err;
+    }
+    if (hdr.magic != SEG_MAGIC || hdr.seq == 0) {
+      continue; // Blank or foreign: treated as free
+    }
+    st->segs[i].seq = hdr.seq;
+    st->segs[i].erase_count = hdr.erase_count;
+    if (hdr.boot > max_boot) {
+      max_boot = hdr.boot;
+    }
+    // Insertion sort by sequence number
+    int j = valid++;
+    while (j > 0 && st->segs[order[j - 1]].seq > hdr.seq) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+
+  uint32_t max_id = 0;
+  for (int k = 0; k < valid; k++) {
+    scan_segment(st, order[k], &max_id, &max_boot);
+  }
+
+  st->cur_seg = valid > 0 ? order[valid - 1] : -1;
+  st->next_seq = valid > 0 ? st->segs[order[valid - 1]].seq + 1 : 1;
+  st->next_clip_id = max_id + 1;
+  st->boot = max_boot + 1;
+  return ESP_OK;
+}
+
+// Erase the next segment in ring order and make it the append target
+static esp_err_t rotate(clip_store_t *st) {
+  int next = (st->cur_seg + 1) % st->seg_count;
+  clip_segment_t *s = &st->segs[next];
+  if (s->seq != 0) {
+    clip_drop_until(st, s->seq);
+  }
+
+  const clip_io_t *io = st->io;
+  esp_err_t err = io->erase(io->ctx, seg_base(next), CLIP_SEGMENT_SIZE);
+  if (err != ESP_OK) {
+    return err;
+  }
+  seg_header_t hdr = {
+      .magic = SEG_MAGIC,
+      .seq = st->next_seq,
+      .erase_count = s->erase_count + 1,
+      .boot = st->boot,
+  };
+  memset(hdr.reserved, 0xFF, sizeof(hdr.reserved));
+  s->seq = 0; // Blank until the header is written
+  err = io->write(io->ctx, seg_base(next), &hdr, sizeof(hdr));
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  s->seq = st->next_seq++;
+  s->erase_count = hdr.erase_count;
+  s->used = SEG_HDR_SIZE;
+  s->first_clip = 0;
+  s->first_t_ms = 0;
+  st->cur_seg = next;
+  return ESP_OK;
+}
+
+static esp_err_t ensure_space(clip_store_t *st, uint32_t need) {
+  if (st->cur_seg >= 0 &&
+      st->segs[st->cur_seg].used + need <= CLIP_SEGMENT_SIZE) {
+    return ESP_OK;
+  }
+  if (st->cur_seg >= 0) {
+    st->segs[st->cur_seg].used = CLIP_SEGMENT_SIZE; // Closed
+  }
+  return rotate(st);
+}
+
+// Write a record: header with the commit word still erased, the payload,
+// then the commit word
+static esp_err_t write_record(clip_store_t *st, rec_header_t *rec,
+                              const uint8_t *data, uint32_t *offset) {
+  const clip_io_t *io = st->io;
+  clip_segment_t *s = &st->segs[st->cur_seg];
+  uint32_t addr = seg_base(st->cur_seg) + s->used;
+
+  rec->magic = REC_MAGIC;
+  rec->commit = UNCOMMITTED;
+  rec->flags = 0xFFFF;
+  rec->reserved = 0xFFFFFFFFu;
+  esp_err_t err = io->write(io->ctx, addr, rec, REC_HDR_SIZE);
+  if (err == ESP_OK && rec->len > 0) {
+    err = io->write(io->ctx, addr + REC_HDR_SIZE, data, rec->len);
+  }
+  if (err == ESP_OK) {
+    uint32_t commit = COMMITTED;
+    err = io->write(io->ctx, addr + offsetof(rec_header_t, commit), &commit,
+                    sizeof(commit));
+  }
+  if (err != ESP_OK) {
+    s->used = CLIP_SEGMENT_SIZE; // Don't append after a failed write
+    return err;
+  }
+  *offset = s->used;
+  s->used += REC_HDR_SIZE + ALIGN4(rec->len);
+  return ESP_OK;
+}
+
+esp_err_t clip_store_begin(clip_store_t *st, uint32_t start_ms,
+                           uint32_t *id) {
+  clip_store_end(st);
+  esp_err_t err = ensure_space(st, REC_HDR_SIZE);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  rec_header_t rec = {
+      .type = REC_START,
+      .clip_id = st->next_clip_id,
+      .t_ms = start_ms,
+      .len = 0,
+      .aux = st->boot,
+  };
+  uint32_t offset;
+  err = write_record(st, &rec, NULL, &offset);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  clip_info_t info = {
+      .id = st->next_clip_id++,
+      .boot = st->boot,
+      .start_ms = start_ms,
+      .seg_seq = st->segs[st->cur_seg].seq,
+      .offset = offset,
+  };
+  clip_add(st, &info);
+  st->recording_id = info.id;
+  *id = info.id;
+  return ESP_OK;
+}
+
+esp_err_t clip_store_append(clip_store_t *st, uint32_t t_ms,
+                            const uint8_t *jpeg, size_t len) {
+  uint32_t need = REC_HDR_SIZE + ALIGN4((uint32_t)len);
+  if (need > CLIP_SEGMENT_SIZE - SEG_HDR_SIZE) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  if (st->recording_id == 0) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  esp_err_t err = ensure_space(st, need);
+  if (err != ESP_OK) {
+    return err;
+  }
+  // Rotation may have reclaimed the clip's start segment
+  clip_info_t *c = clip_lookup(st, st->recording_id);
+  if (c == NULL) {
+    st->recording_id = 0;
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  rec_header_t rec = {
+      .type = REC_FRAME,
+      .clip_id = c->id,
+      .t_ms = t_ms,
+      .len = (uint32_t)len,
+      .aux = 0,
+  };
+  uint32_t offset;
+  err = write_record(st, &rec, jpeg, &offset);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  clip_segment_t *s = &st->segs[st->cur_seg];
+  if (s->first_clip == 0) {
+    s->first_clip = c->id;
+    s->first_t_ms = t_ms;
+  }
+  c->duration_ms = t_ms;
+  c->frames++;
+  c->bytes += len;
+  return ESP_OK;
+}
+
+void clip_store_end(clip_store_t *st) { st->recording_id = 0; }
+
+int clip_store_list(const clip_store_t *st, clip_info_t *out, int max) {
+  int n = 0;
+  for (int i = st->clip_count - 1; i >= 0 && n < max; i--) {
+    out[n++] = st->clips[(st->clip_head + i) % CLIP_MAX_CLIPS];
+  }
+  return n;
+}
+
+esp_err_t clip_store_find(const clip_store_t *st, uint32_t id,
+                          clip_info_t *out) {
+  const clip_info_t *c = clip_lookup((clip_store_t *)st, id);
+  if (c == NULL) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  *out = *c;
+  return ESP_OK;
+}
+
+static int seg_by_seq(const clip_store_t *st, uint32_t seq) {
+  for (int i = 0; i < st->seg_count; i++) {
+    if (st->segs[i].seq == seq) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+esp_err_t clip_store_open(const clip_store_t *st, uint32_t id,
+                          uint32_t from_ms, clip_cursor_t *cur) {
+  clip_info_t info;
+  if (clip_store_find(st, id, &info) != ESP_OK) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  int seg = seg_by_seq(st, info.seg_seq);
+  if (seg < 0) {
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  cur->clip_id = id;
+  cur->from_ms = from_ms;
+  cur->seg = seg;
+  cur->seg_seq = info.seg_seq;
+  cur->offset = info.offset;
+  cur->started = false;
+
+  // Skip whole segments: start in the latest one that the clip enters at or
+  // before from_ms
+  for (int i = 0; i < st->seg_count; i++) {
+    const clip_segment_t *s = &st->segs[i];
+    if (s->seq > cur->seg_seq && s->first_clip == id &&
+        s->first_t_ms <= from_ms) {
+      cur->seg = i;
+      cur->seg_seq = s->seq;
+      cur->offset = SEG_HDR_SIZE;
+      cur->started = true;
+    }
+  }
+  return ESP_OK;
+}
+
+bool clip_store_cursor_valid(const clip_store_t *st,
+                             const clip_cursor_t *cur) {
+  return cur->seg >= 0 && cur->seg < st->seg_count &&
+         st->segs[cur->seg].seq == cur->seg_seq;
+}
+
+esp_err_t clip_store_next_frame(clip_store_t *st, clip_cursor_t *cur,
+                                clip_frame_t *frame) {
+  for (;;) {
+    if (!clip_store_cursor_valid(st, cur)) {
+      return ESP_ERR_NOT_FOUND;
+    }
+    rec_header_t rec;
+    bool erased;
+    if (!read_record(st, cur->seg, cur->offset, &rec, &erased)) {
+      // End of this segment; the clip may continue in the next one unless
+      // this is where the recorder is appending
+      if (cur->seg == st->cur_seg) {
+        return ESP_ERR_NOT_FOUND;
+      }
+      int next = (cur->seg + 1) % st->seg_count;
+      if (st->segs[next].seq != cur->seg_seq + 1) {
+        return ESP_ERR_NOT_FOUND;
+      }
+      cur->seg = next;
+      cur->seg_seq++;
+      cur->offset = SEG_HDR_SIZE;
+      continue;
+    }
+
+    uint32_t data = seg_base(cur->seg) + cur->offset + REC_HDR_SIZE;
+    cur->offset += REC_HDR_SIZE + ALIGN4(rec.len);
+    if (rec.clip_id != cur->clip_id) {
+      if (cur->started) {
+        return ESP_ERR_NOT_FOUND; // The next clip begins
+      }
+      continue;
+    }
+    cur->started = true;
+    if (rec.type != REC_FRAME || rec.t_ms < cur->from_ms) {
+      continue;
+    }
+    frame->t_ms = rec.t_ms;
+    frame->len = rec.len;
+    frame->offset = data;
+    return ESP_OK;
+  }
+}
+
+esp_err_t clip_store_read(clip_store_t *st, uint32_t offset, void *buf,
+                          size_t len) {
+  return st->io->read(st->io->ctx, offset, buf, len);
+}
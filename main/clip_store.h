@@ -0,0 +1,195 @@
+#ifndef CLIP_STORE_H
+#define CLIP_STORE_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Append-only JPEG clip log on a raw storage area
+ *
+ * The area is divided into fixed-size segments that are written strictly
+ * in ring order: when the newest segment is full, the oldest one is erased
+ * and reused, which spreads erase cycles evenly (each segment header keeps
+ * its erase count). A segment holds a header followed by records: a clip
+ * start record, then one record per JPEG frame. A record's commit word is
+ * programmed last, so a frame torn by a power cut is detected on mount.
+ *
+ * Nothing but the index lives in RAM: per segment its sequence number,
+ * fill level and the clip/time of its first frame (the time -> offset
+ * index used for seeking), plus a table of the clips still on storage. The
+ * index is rebuilt on mount by walking the record headers.
+ *
+ * The storage is accessed through clip_io_t, so the same code runs on a
+ * flash partition on the target and on a file-backed image on a host. Not
+ * thread-safe; callers serialize access.
+ */
+
+#define CLIP_SEGMENT_SIZE (256 * 1024)
+#define CLIP_MAX_SEGMENTS 64
+#define CLIP_MAX_CLIPS 128
+
+/**
+ * @brief Storage backend
+ *
+ * Offsets are relative to the start of the area. erase() is only called
+ * with segment-aligned ranges; write() only programs erased bytes, except
+ * for clearing a record's commit word.
+ */
+typedef struct {
+  esp_err_t (*read)(void *ctx, uint32_t offset, void *buf, size_t len);
+  esp_err_t (*write)(void *ctx, uint32_t offset, const void *buf, size_t len);
+  esp_err_t (*erase)(void *ctx, uint32_t offset, size_t len);
+  void *ctx;
+  uint32_t size; // Area size in bytes
+} clip_io_t;
+
+typedef struct {
+  uint32_t seq;         // Write order, 0 = blank segment
+  uint32_t erase_count; // Times this segment was erased by the store
+  uint32_t used;        // Bytes in use; CLIP_SEGMENT_SIZE once closed
+  uint32_t first_clip;  // Clip of the first frame record, 0 = none
+  uint32_t first_t_ms;  // Time of that frame within its clip
+} clip_segment_t;
+
+typedef struct {
+  uint32_t id;          // Clip id, starts at 1
+  uint32_t boot;        // Boot count of the recording session
+  uint32_t start_ms;    // Uptime at clip start in that session
+  uint32_t duration_ms; // Time of the last frame
+  uint32_t frames;
+  uint32_t bytes; // JPEG payload bytes
+  uint32_t seg_seq; // Segment holding the start record
+  uint32_t offset;  // Offset of the start record within that segment
+} clip_info_t;
+
+typedef struct {
+  const clip_io_t *io;
+  int seg_count;
+  clip_segment_t segs[CLIP_MAX_SEGMENTS];
+  int cur_seg; // Segment being appended to, -1 = none
+  uint32_t next_seq;
+  uint32_t next_clip_id;
+  uint32_t boot;
+
+  clip_info_t clips[CLIP_MAX_CLIPS]; // Ring, oldest first
+  int clip_head;
+  int clip_count;
+  uint32_t recording_id; // Clip open for appending, 0 = none
+} clip_store_t;
+
+/**
+ * @brief Playback position
+ */
+typedef struct {
+  uint32_t clip_id;
+  uint32_t from_ms; // Frames before this time are skipped
+  int seg;
+  uint32_t seg_seq;
+  uint32_t offset; // Next record within the segment
+  bool started;    // A record of the clip has been seen
+} clip_cursor_t;
+
+/**
+ * @brief A frame found by clip_store_next_frame()
+ */
+typedef struct {
+  uint32_t t_ms;   // Time since clip start
+  uint32_t len;    // JPEG length
+  uint32_t offset; // Storage offset of the JPEG data
+} clip_frame_t;
+
+/**
+ * @brief Rebuild the index from storage
+ *
+ * Blank or foreign segments are ignored and reused first.
+ *
+ * @param st Store
+ * @param io Backend, must stay valid while the store is used
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if the area holds fewer
+ *         than two segments
+ */
+esp_err_t clip_store_mount(clip_store_t *st, const clip_io_t *io);
+
+/**
+ * @brief Start a new clip
+ *
+ * @param st Store
+ * @param start_ms Uptime at clip start
+ * @param id Output, id of the new clip
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t clip_store_begin(clip_store_t *st, uint32_t start_ms,
+                           uint32_t *id);
+
+/**
+ * @brief Append a JPEG frame to the open clip
+ *
+ * @param st Store
+ * @param t_ms Time since clip start
+ * @param jpeg JPEG data
+ * @param len JPEG length
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if no clip is open (or
+ *         it was rotated out), ESP_ERR_INVALID_SIZE if the frame does not
+ *         fit in a segment
+ */
+esp_err_t clip_store_append(clip_store_t *st, uint32_t t_ms,
+                            const uint8_t *jpeg, size_t len);
+
+/**
+ * @brief Close the open clip
+ */
+void clip_store_end(clip_store_t *st);
+
+/**
+ * @brief List the stored clips, newest first
+ *
+ * @return Number of clips written to out
+ */
+int clip_store_list(const clip_store_t *st, clip_info_t *out, int max);
+
+/**
+ * @brief Look up a clip by id
+ *
+ * @return ESP_OK if found, ESP_ERR_NOT_FOUND otherwise
+ */
+esp_err_t clip_store_find(const clip_store_t *st, uint32_t id,
+                          clip_info_t *out);
+
+/**
+ * @brief Position a cursor at the first frame at or after from_ms
+ *
+ * Seeks to the last segment whose first frame belongs to the clip and is
+ * not later than from_ms, instead of walking the clip from its start.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the clip does not exist
+ */
+esp_err_t clip_store_open(const clip_store_t *st, uint32_t id,
+                          uint32_t from_ms, clip_cursor_t *cur);
+
+/**
+ * @brief Advance to the next frame of the clip
+ *
+ * Only reads record headers; the JPEG data is read separately with
+ * clip_store_read().
+ *
+ * @return ESP_OK with a frame, ESP_ERR_NOT_FOUND at the end of the clip
+ *         or if its segment has been reused meanwhile
+ */
+esp_err_t clip_store_next_frame(clip_store_t *st, clip_cursor_t *cur,
+                                clip_frame_t *frame);
+
+/**
+ * @brief Check that the cursor's segment has not been reused
+ */
+bool clip_store_cursor_valid(const clip_store_t *st,
+                             const clip_cursor_t *cur);
+
+/**
+ * @brief Read raw bytes, e.g. a piece of a frame's JPEG data
+ */
+esp_err_t clip_store_read(clip_store_t *st, uint32_t offset, void *buf,
+                          size_t len);
+
+#endif // CLIP_STORE_H
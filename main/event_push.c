@@ -0,0 +1,312 @@
+#include "event_push.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "sensor_snapshot.h"
+#include "task_topology.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "EventPush";
+
+// Comment line sent when nothing changed for this long; lets dead
+// connections be detected and keeps proxies from timing out
+#define KEEPALIVE_MS 15000
+
+#define EVENT_BUF_SIZE 384
+
+static const char SSE_HEADER[] = "HTTP/1.1 200 OK\r\n"
+                                 "Content-Type: text/event-stream\r\n"
+                                 "Cache-Control: no-cache\r\n"
+                                 "Connection: keep-alive\r\n"
+                                 "Access-Control-Allow-Origin: *\r\n"
+                                 "\r\n"
+                                 "retry: 3000\n\n";
+
+static const char SSE_KEEPALIVE[] = ": keepalive\n\n";
+
+typedef struct {
+  httpd_req_t *req; // Detached request, NULL while the slot is free
+  int sockfd;
+  bool needs_full; // Send the complete state before any delta
+} push_client_t;
+
+typedef struct {
+  sensor_snapshot_t sensors;
+  bool camera_enabled;
+  bool camera_initialized;
+  bool motion_active;
+  uint32_t motion_events;
+} push_state_t;
+
+static push_client_t s_clients[EVENT_PUSH_MAX_CLIENTS];
+static int s_client_count = 0;
+static SemaphoreHandle_t s_lock = NULL;
+static TaskHandle_t s_task = NULL;
+
+static volatile bool s_camera_enabled = false;
+static volatile bool s_camera_initialized = false;
+static volatile bool s_motion_active = false;
+static volatile uint32_t s_motion_events = 0;
+
+// NaN (not calibrated) compares unequal to itself
+static bool ppm_changed(float cur, float prev) {
+  return isnan(cur) ? !isnan(prev) : isnan(prev) || cur != prev;
+}
+
+// Format the groups of cur that differ from prev (all of them if prev is
+// NULL) as one SSE event. Returns 0 if nothing changed.
+static int format_event(char *buf, size_t size, const push_state_t *cur,
+                        const push_state_t *prev) {
+  const sensor_snapshot_t *s = &cur->sensors;
+  int len = snprintf(buf, size, "event: sensors\ndata: {");
+  bool first = true;
+
+  if (s->ammonia_seq > 0 &&
+      (prev == NULL || s->ammonia_raw != prev->sensors.ammonia_raw ||
+       s->ammonia_voltage_mv != prev->sensors.ammonia_voltage_mv ||
+       ppm_changed(s->ammonia_ppm, prev->sensors.ammonia_ppm))) {
+    len += snprintf(buf + len, size - len,
+                    "\"ammonia\":{\"raw\":%d,\"voltage_mv\":%d,\"ppm\":",
+                    s->ammonia_raw, s->ammonia_voltage_mv);
+    len += isnan(s->ammonia_ppm)
+               ? snprintf(buf + len, size - len, "null}")
+               : snprintf(buf + len, size - len, "%.2f}", s->ammonia_ppm);
+    first = false;
+  }
+
+  if (s->sht30_seq > 0 &&
+      (prev == NULL || s->temperature != prev->sensors.temperature ||
+       s->humidity != prev->sensors.humidity)) {
+    len += snprintf(buf + len, size - len,
+                    "%s\"sht30\":{\"temperature\":%.1f,\"humidity\":%.1f}",
+                    first ? "" : ",", s->temperature, s->humidity);
+    first = false;
+  }
+
+  if (prev == NULL || cur->camera_enabled != prev->camera_enabled ||
+      cur->camera_initialized != prev->camera_initialized) {
+    len += snprintf(buf + len, size - len,
+                    "%s\"camera\":{\"enabled\":%s,\"initialized\":%s}",
+                    first ? "" : ",", cur->camera_enabled ? "true" : "false",
+                    cur->camera_initialized ? "true" : "false");
+    first = false;
+  }
+
+  if (prev == NULL || cur->motion_active != prev->motion_active ||
+      cur->motion_events != prev->motion_events) {
+    len += snprintf(buf + len, size - len,
+                    "%s\"motion\":{\"active\":%s,\"events\":%lu}",
+                    first ? "" : ",", cur->motion_active ? "true" : "false",
+                    (unsigned long)cur->motion_events);
+    first = false;
+  }
+
+  if (first) {
+    return 0;
+  }
+  len += snprintf(buf + len, size - len, "}\n\n");
+  return len;
+}
+
+static void client_drop(push_client_t *client) {
+  httpd_handle_t hd = client->req->handle;
+
+  httpd_req_async_handler_complete(client->req);
+  httpd_sess_trigger_close(hd, client->sockfd);
+  client->req = NULL;
+  s_client_count--;
+}
+
+// Never waits for the socket: a tab that stops reading would otherwise
+// stall the push task, and every event_push_send() caller behind s_lock.
+// A client whose send buffer is full is dropped, as is one that took part
+// of an event, since the rest can't be sent later without blocking. The
+// browser reconnects and gets the full state again.
+static void client_send(push_client_t *client, const char *msg, int len) {
+  int sent = httpd_socket_send(client->req->handle, client->sockfd, msg, len,
+                               MSG_DONTWAIT);
+  if (sent == len) {
+    return;
+  }
+  if (sent >= 0 || sent == HTTPD_SOCK_ERR_TIMEOUT) {
+    ESP_LOGW(TAG, "Event client %d not reading, dropped", client->sockfd);
+  } else {
+    ESP_LOGI(TAG, "Event client %d disconnected", client->sockfd);
+  }
+  client_drop(client);
+}
+
+static void push_task(void *arg) {
+  static char delta[EVENT_BUF_SIZE];
+  static char full[EVENT_BUF_SIZE];
+  push_state_t prev = {0};
+  bool have_prev = false;
+  TickType_t last_send = xTaskGetTickCount();
+
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(KEEPALIVE_MS));
+
+    push_state_t cur;
+    sensor_snapshot_read(&cur.sensors);
+    cur.camera_enabled = s_camera_enabled;
+    cur.camera_initialized = s_camera_initialized;
+    cur.motion_active = s_motion_active;
+    cur.motion_events = s_motion_events;
+
+    // Each message is formatted once and shared by every client
+    int delta_len =
+        format_event(delta, sizeof(delta), &cur, have_prev ? &prev : NULL);
+    int full_len = -1;
+    bool keepalive =
+        xTaskGetTickCount() - last_send >= pdMS_TO_TICKS(KEEPALIVE_MS);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < EVENT_PUSH_MAX_CLIENTS; i++) {
+      push_client_t *client = &s_clients[i];
+      if (client->req == NULL) {
+        continue;
+      }
+
+      const char *msg;
+      int len;
+      if (client->needs_full) {
+        if (full_len < 0) {
+          full_len = format_event(full, sizeof(full), &cur, NULL);
+        }
+        msg = full;
+        len = full_len;
+        client->needs_full = false;
+      } else if (delta_len > 0) {
+        msg = delta;
+        len = delta_len;
+      } else if (keepalive) {
+        msg = SSE_KEEPALIVE;
+        len = sizeof(SSE_KEEPALIVE) - 1;
+      } else {
+        continue;
+      }
+
+      client_send(client, msg, len);
+    }
+    xSemaphoreGive(s_lock);
+
+    if (delta_len > 0 || keepalive) {
+      last_send = xTaskGetTickCount();
+    }
+    prev = cur;
+    have_prev = true;
+  }
+}
+
+esp_err_t event_push_init(void) {
+  if (s_task != NULL) {
+    return ESP_OK;
+  }
+
+  s_lock = xSemaphoreCreateMutex();
+  if (s_lock == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  if (task_topology_create(TASK_EVENT_PUSH, push_task, NULL, &s_task) !=
+      ESP_OK) {
+    vSemaphoreDelete(s_lock);
+    s_lock = NULL;
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+esp_err_t event_push_handler(httpd_req_t *req) {
+  if (s_task == NULL) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_send(req, "Push unavailable", 16);
+  }
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  push_client_t *slot = NULL;
+  for (int i = 0; i < EVENT_PUSH_MAX_CLIENTS; i++) {
+    if (s_clients[i].req == NULL) {
+      slot = &s_clients[i];
+      break;
+    }
+  }
+  if (slot == NULL) {
+    xSemaphoreGive(s_lock);
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_send(req, "Too many event clients", 22);
+  }
+
+  // Keep the connection: the push task writes to it until the client leaves
+  httpd_req_t *copy = NULL;
+  esp_err_t err = httpd_req_async_handler_begin(req, &copy);
+  if (err != ESP_OK) {
+    xSemaphoreGive(s_lock);
+    return err;
+  }
+
+  int sockfd = httpd_req_to_sockfd(copy);
+  if (httpd_socket_send(copy->handle, sockfd, SSE_HEADER,
+                        sizeof(SSE_HEADER) - 1,
+                        MSG_DONTWAIT) != sizeof(SSE_HEADER) - 1) {
+    xSemaphoreGive(s_lock);
+    httpd_req_async_handler_complete(copy);
+    return ESP_FAIL;
+  }
+
+  slot->req = copy;
+  slot->sockfd = sockfd;
+  slot->needs_full = true;
+  s_client_count++;
+  xSemaphoreGive(s_lock);
+
+  ESP_LOGI(TAG, "Event client %d connected (%d total)", sockfd,
+           s_client_count);
+  xTaskNotifyGive(s_task);
+  return ESP_OK;
+}
+
+void event_push_notify(void) {
+  if (s_task != NULL) {
+    xTaskNotifyGive(s_task);
+  }
+}
+
+void event_push_set_camera_state(bool enabled, bool initialized) {
+  s_camera_enabled = enabled;
+  s_camera_initialized = initialized;
+  event_push_notify();
+}
+
+void event_push_set_motion(bool active, uint32_t events) {
+  s_motion_active = active;
+  s_motion_events = events;
+  event_push_notify();
+}
+
+void event_push_send(const char *event, const char *data) {
+  if (s_lock == NULL) {
+    return;
+  }
+  char msg[EVENT_BUF_SIZE];
+  int len = snprintf(msg, sizeof(msg), "event: %s\ndata: %s\n\n", event, data);
+  if (len >= (int)sizeof(msg)) {
+    ESP_LOGW(TAG, "Event %s too long, not sent", event);
+    return;
+  }
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  for (int i = 0; i < EVENT_PUSH_MAX_CLIENTS; i++) {
+    push_client_t *client = &s_clients[i];
+    if (client->req != NULL) {
+      client_send(client, msg, len);
+    }
+  }
+  xSemaphoreGive(s_lock);
+}
+
+int event_push_client_count(void) { return s_client_count; }
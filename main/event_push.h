@@ -0,0 +1,74 @@
+#ifndef EVENT_PUSH_H
+#define EVENT_PUSH_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Server-Sent Events push channel for the dashboard
+ *
+ * Browsers connect to /api/events and keep the connection open. A single
+ * push task formats each update once and fans it out to every connected
+ * tab. Only sensor groups that changed since the last push are sent; a newly
+ * connected client first receives the full state. Sends never wait for a
+ * client: one that stops reading is dropped, and its browser reconnects.
+ *
+ * Events are "sensors" with a JSON object containing any of the "ammonia",
+ * "sht30", "camera" and "motion" groups. Other modules can send their own
+ * events with event_push_send().
+ */
+
+// Maximum number of concurrently connected event clients
+#define EVENT_PUSH_MAX_CLIENTS 4
+
+/**
+ * @brief Create the push task
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t event_push_init(void);
+
+/**
+ * @brief URI handler for GET /api/events
+ */
+esp_err_t event_push_handler(httpd_req_t *req);
+
+/**
+ * @brief Wake the push task after new sensor data was published
+ *
+ * Cheap enough to call from the sensor tasks after every sample.
+ */
+void event_push_notify(void);
+
+/**
+ * @brief Update the camera state reported to clients
+ */
+void event_push_set_camera_state(bool enabled, bool initialized);
+
+/**
+ * @brief Update the motion state reported to clients
+ *
+ * @param active Motion event in progress
+ * @param events Motion events since boot
+ */
+void event_push_set_motion(bool active, uint32_t events);
+
+/**
+ * @brief Send a named event to every connected client
+ *
+ * Sent from the calling task; waits only for the push task, never for a
+ * client. Clients that are not reading are dropped.
+ *
+ * @param event Event name, e.g. "alarm"
+ * @param data Single-line payload (JSON)
+ */
+void event_push_send(const char *event, const char *data);
+
+/**
+ * @brief Number of connected event clients
+ */
+int event_push_client_count(void);
+
+#endif // EVENT_PUSH_H
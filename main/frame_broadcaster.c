@@ -0,0 +1,316 @@
+#include "frame_broadcaster.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "task_topology.h"
+
+static const char *TAG = "FrameBcast";
+
+_Static_assert(FRAME_BROADCASTER_NOTIFY_INDEX <
+                   configTASK_NOTIFICATION_ARRAY_ENTRIES,
+               "raise CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES");
+
+// Minimum plausible JPEG size; anything smaller is a truncated frame
+#define MIN_JPEG_LEN 100
+
+typedef struct {
+  shared_frame_t frame; // Must stay first: released frames are cast back
+  void *handle;         // Source handle, NULL while the slot is free
+  int refs;             // Viewer references + 1 while it is the latest
+} frame_slot_t;
+
+static const frame_source_t *s_source = NULL;
+static SemaphoreHandle_t s_lock = NULL;
+static TaskHandle_t s_capture_task = NULL;
+
+static frame_slot_t s_slots[FRAME_BROADCASTER_SLOTS];
+static frame_slot_t *s_latest = NULL;
+static uint32_t s_seq = 0;
+
+static TaskHandle_t s_subscribers[FRAME_BROADCASTER_MAX_SUBSCRIBERS];
+static int s_subscriber_count = 0;
+
+static bool s_running = false;
+static bool s_capture_idle = true;
+
+// Drop one reference; returns the source handle if the slot became free
+static void *slot_unref_locked(frame_slot_t *slot) {
+  if (--slot->refs > 0) {
+    return NULL;
+  }
+  void *handle = slot->handle;
+  slot->handle = NULL;
+  return handle;
+}
+
+static frame_slot_t *find_free_slot(void) {
+  frame_slot_t *free_slot = NULL;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  for (int i = 0; i < FRAME_BROADCASTER_SLOTS; i++) {
+    if (s_slots[i].handle == NULL) {
+      free_slot = &s_slots[i];
+      break;
+    }
+  }
+  xSemaphoreGive(s_lock);
+  return free_slot;
+}
+
+static void publish_frame(frame_slot_t *slot, void *handle,
+                          const uint8_t *buf, size_t len) {
+  void *stale = NULL;
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  slot->handle = handle;
+  slot->refs = 1; // Reference held by the broadcaster while it is the latest
+  slot->frame.buf = buf;
+  slot->frame.len = len;
+  slot->frame.seq = ++s_seq;
+  slot->frame.timestamp_us = esp_timer_get_time();
+
+  frame_slot_t *old = s_latest;
+  s_latest = slot;
+  if (old != NULL) {
+    stale = slot_unref_locked(old);
+  }
+
+  for (int i = 0; i < FRAME_BROADCASTER_MAX_SUBSCRIBERS; i++) {
+    if (s_subscribers[i] != NULL) {
+      xTaskNotifyGiveIndexed(s_subscribers[i],
+                             FRAME_BROADCASTER_NOTIFY_INDEX);
+    }
+  }
+  xSemaphoreGive(s_lock);
+
+  if (stale != NULL) {
+    s_source->put(s_source->ctx, stale);
+  }
+}
+
+static void capture_task(void *arg) {
+  int error_count = 0;
+
+  while (true) {
+    // Only pull frames while the camera is running and someone is watching
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool active = s_running && s_subscriber_count > 0;
+    s_capture_idle = !active;
+    xSemaphoreGive(s_lock);
+
+    if (!active) {
+      ulTaskNotifyTakeIndexed(FRAME_BROADCASTER_NOTIFY_INDEX, pdTRUE,
+                            pdMS_TO_TICKS(1000));
+      continue;
+    }
+
+    // Every slot is still held by a slow viewer; wait for a release
+    frame_slot_t *slot = find_free_slot();
+    if (slot == NULL) {
+      ulTaskNotifyTakeIndexed(FRAME_BROADCASTER_NOTIFY_INDEX, pdTRUE,
+                            pdMS_TO_TICKS(100));
+      continue;
+    }
+
+    const uint8_t *buf = NULL;
+    size_t len = 0;
+    void *handle = s_source->get(s_source->ctx, &buf, &len);
+    if (handle == NULL) {
+      if (++error_count % 10 == 1) {
+        ESP_LOGW(TAG, "Frame capture failed (%d), retrying...", error_count);
+      }
+      vTaskDelay(pdMS_TO_TICKS(100));
+      continue;
+    }
+    error_count = 0;
+
+    // Skip frames without valid JPEG data
+    if (len < MIN_JPEG_LEN || buf[0] != 0xFF || buf[1] != 0xD8) {
+      ESP_LOGW(TAG, "Invalid JPEG frame, skipping");
+      s_source->put(s_source->ctx, handle);
+      continue;
+    }
+
+    publish_frame(slot, handle, buf, len);
+  }
+}
+
+esp_err_t frame_broadcaster_init(const frame_source_t *source) {
+  if (source == NULL || source->get == NULL || source->put == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (s_capture_task != NULL) {
+    return ESP_OK;
+  }
+
+  s_source = source;
+  s_lock = xSemaphoreCreateMutex();
+  if (s_lock == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  if (task_topology_create(TASK_FRAME_CAPTURE, capture_task, NULL,
+                           &s_capture_task) != ESP_OK) {
+    vSemaphoreDelete(s_lock);
+    s_lock = NULL;
+    return ESP_ERR_NO_MEM;
+  }
+
+  ESP_LOGI(TAG, "Frame broadcaster ready (%d slots, %d viewers max)",
+           FRAME_BROADCASTER_SLOTS, FRAME_BROADCASTER_MAX_SUBSCRIBERS);
+  return ESP_OK;
+}
+
+esp_err_t frame_broadcaster_start(void) {
+  if (s_capture_task == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_running = true;
+  xSemaphoreGive(s_lock);
+
+  xTaskNotifyGiveIndexed(s_capture_task, FRAME_BROADCASTER_NOTIFY_INDEX);
+  return ESP_OK;
+}
+
+esp_err_t frame_broadcaster_stop(TickType_t timeout) {
+  if (s_capture_task == NULL) {
+    return ESP_OK;
+  }
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_running = false;
+  xSemaphoreGive(s_lock);
+  xTaskNotifyGiveIndexed(s_capture_task, FRAME_BROADCASTER_NOTIFY_INDEX);
+
+  TickType_t start = xTaskGetTickCount();
+  bool dropped_latest = false;
+
+  while (true) {
+    void *stale = NULL;
+    bool drained = true;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    // Once the capture task is parked no new frame can be published, so the
+    // broadcaster's own reference on the latest frame can be dropped
+    if (s_capture_idle && !dropped_latest) {
+      if (s_latest != NULL) {
+        stale = slot_unref_locked(s_latest);
+        s_latest = NULL;
+      }
+      dropped_latest = true;
+    }
+    for (int i = 0; i < FRAME_BROADCASTER_SLOTS; i++) {
+      if (s_slots[i].handle != NULL) {
+        drained = false;
+      }
+    }
+    xSemaphoreGive(s_lock);
+
+    if (stale != NULL) {
+      s_source->put(s_source->ctx, stale);
+      continue;
+    }
+    if (dropped_latest && drained) {
+      return ESP_OK;
+    }
+    if (xTaskGetTickCount() - start >= timeout) {
+      ESP_LOGW(TAG, "Timed out waiting for viewers to release frames");
+      return ESP_ERR_TIMEOUT;
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+esp_err_t frame_broadcaster_subscribe(void) {
+  if (s_capture_task == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  esp_err_t ret = ESP_ERR_NO_MEM;
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  for (int i = 0; i < FRAME_BROADCASTER_MAX_SUBSCRIBERS; i++) {
+    if (s_subscribers[i] == NULL) {
+      s_subscribers[i] = self;
+      s_subscriber_count++;
+      ret = ESP_OK;
+      break;
+    }
+  }
+  xSemaphoreGive(s_lock);
+
+  if (ret == ESP_OK) {
+    xTaskNotifyGiveIndexed(s_capture_task, FRAME_BROADCASTER_NOTIFY_INDEX);
+  }
+  return ret;
+}
+
+void frame_broadcaster_unsubscribe(void) {
+  if (s_capture_task == NULL) {
+    return;
+  }
+
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  for (int i = 0; i < FRAME_BROADCASTER_MAX_SUBSCRIBERS; i++) {
+    if (s_subscribers[i] == self) {
+      s_subscribers[i] = NULL;
+      s_subscriber_count--;
+      break;
+    }
+  }
+  xSemaphoreGive(s_lock);
+}
+
+const shared_frame_t *frame_broadcaster_acquire(uint32_t last_seq,
+                                                TickType_t timeout) {
+  if (s_capture_task == NULL) {
+    return NULL;
+  }
+
+  TickType_t start = xTaskGetTickCount();
+
+  while (true) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    frame_slot_t *slot = s_latest;
+    if (slot != NULL && slot->frame.seq != last_seq) {
+      slot->refs++;
+      xSemaphoreGive(s_lock);
+      return &slot->frame;
+    }
+    bool running = s_running;
+    xSemaphoreGive(s_lock);
+
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (!running || elapsed >= timeout) {
+      return NULL;
+    }
+    // Woken by publish_frame(); spurious wake-ups just loop again
+    ulTaskNotifyTakeIndexed(FRAME_BROADCASTER_NOTIFY_INDEX, pdTRUE,
+                            timeout - elapsed);
+  }
+}
+
+void frame_broadcaster_release(const shared_frame_t *frame) {
+  if (frame == NULL) {
+    return;
+  }
+
+  frame_slot_t *slot = (frame_slot_t *)frame;
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  void *stale = slot_unref_locked(slot);
+  xSemaphoreGive(s_lock);
+
+  if (stale != NULL) {
+    s_source->put(s_source->ctx, stale);
+    // The capture task may be waiting for a free slot
+    xTaskNotifyGiveIndexed(s_capture_task, FRAME_BROADCASTER_NOTIFY_INDEX);
+  }
+}
+
+int frame_broadcaster_subscriber_count(void) { return s_subscriber_count; }
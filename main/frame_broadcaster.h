@@ -0,0 +1,130 @@
+#ifndef FRAME_BROADCASTER_H
+#define FRAME_BROADCASTER_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Shared-frame broadcaster for the MJPEG stream
+ *
+ * A single capture task pulls JPEG frames from a frame source and publishes
+ * them into reference-counted slots. Every viewer acquires the newest frame,
+ * sends it and releases it again, so the camera is read once per frame no
+ * matter how many viewers are connected. A viewer that falls behind simply
+ * skips to whatever frame is newest when it comes back.
+ */
+
+// Number of frame slots; must not exceed the camera driver's fb_count
+#define FRAME_BROADCASTER_SLOTS 3
+
+// Maximum number of concurrently subscribed viewers
+#define FRAME_BROADCASTER_MAX_SUBSCRIBERS 8
+
+// Task notification index used for every broadcaster wake-up, so viewers
+// keep index 0 for their own use (needs
+// CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES >= 2)
+#define FRAME_BROADCASTER_NOTIFY_INDEX 1
+
+/**
+ * @brief A published frame, shared read-only between all viewers
+ */
+typedef struct {
+  const uint8_t *buf;   // JPEG data
+  size_t len;           // JPEG length in bytes
+  uint32_t seq;         // Frame sequence number, starts at 1
+  int64_t timestamp_us; // Capture time (esp_timer clock)
+} shared_frame_t;
+
+/**
+ * @brief Frame source backing the broadcaster
+ *
+ * On the target this wraps esp_camera_fb_get()/esp_camera_fb_return(); on a
+ * host build it can be replaced by a fake source feeding recorded frames.
+ */
+typedef struct {
+  /**
+   * @brief Grab the next frame (may block until one is available)
+   *
+   * @return Opaque frame handle, or NULL on capture failure
+   */
+  void *(*get)(void *ctx, const uint8_t **buf, size_t *len);
+
+  /**
+   * @brief Hand a frame obtained from get() back to the source
+   */
+  void (*put)(void *ctx, void *handle);
+
+  void *ctx;
+} frame_source_t;
+
+/**
+ * @brief Create the capture task
+ *
+ * The capture task stays parked until frame_broadcaster_start() has been
+ * called and at least one viewer is subscribed.
+ *
+ * @param source Frame source, must stay valid for the program lifetime
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t frame_broadcaster_init(const frame_source_t *source);
+
+/**
+ * @brief Allow the capture task to pull frames from the source
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t frame_broadcaster_start(void);
+
+/**
+ * @brief Stop capturing and hand every frame back to the source
+ *
+ * Waits until the capture task is parked and all viewers have released
+ * their frames, so the source can safely be torn down afterwards.
+ *
+ * @param timeout Maximum time to wait for outstanding frames
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if frames are still held
+ */
+esp_err_t frame_broadcaster_stop(TickType_t timeout);
+
+/**
+ * @brief Register the calling task as a viewer
+ *
+ * Capture only runs while at least one viewer is subscribed. The calling
+ * task is woken through notification FRAME_BROADCASTER_NOTIFY_INDEX when a
+ * new frame is published.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if all viewer slots are in use
+ */
+esp_err_t frame_broadcaster_subscribe(void);
+
+/**
+ * @brief Unregister the calling task
+ */
+void frame_broadcaster_unsubscribe(void);
+
+/**
+ * @brief Get the newest frame with a sequence number other than last_seq
+ *
+ * The returned frame is reference counted and must be given back with
+ * frame_broadcaster_release() once it has been sent.
+ *
+ * @param last_seq Sequence number of the frame the caller saw last (0: none)
+ * @param timeout Maximum time to wait for a new frame
+ * @return Shared frame, or NULL on timeout or when capture is stopped
+ */
+const shared_frame_t *frame_broadcaster_acquire(uint32_t last_seq,
+                                                TickType_t timeout);
+
+/**
+ * @brief Release a frame obtained from frame_broadcaster_acquire()
+ */
+void frame_broadcaster_release(const shared_frame_t *frame);
+
+/**
+ * @brief Number of currently subscribed viewers
+ */
+int frame_broadcaster_subscriber_count(void);
+
+#endif // FRAME_BROADCASTER_H
@@ -0,0 +1,94 @@
+#include "frame_cache.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "frame_broadcaster.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "FrameCache";
+
+static SemaphoreHandle_t s_lock = NULL;
+static uint8_t *s_buf = NULL; // PSRAM, grown to the largest frame seen
+static size_t s_capacity = 0;
+static cached_frame_t s_frame;
+
+esp_err_t frame_cache_init(void) {
+  if (s_lock != NULL) {
+    return ESP_OK;
+  }
+  s_lock = xSemaphoreCreateMutex();
+  return s_lock != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static esp_err_t copy_frame_locked(const shared_frame_t *frame) {
+  if (frame->len > s_capacity) {
+    uint8_t *buf =
+        heap_caps_realloc(s_buf, frame->len, MALLOC_CAP_SPIRAM);
+    if (buf == NULL) {
+      ESP_LOGW(TAG, "No PSRAM for a %u byte frame", (unsigned)frame->len);
+      return ESP_ERR_NO_MEM;
+    }
+    s_buf = buf;
+    s_capacity = frame->len;
+  }
+  memcpy(s_buf, frame->buf, frame->len);
+  s_frame.buf = s_buf;
+  s_frame.len = frame->len;
+  s_frame.seq = frame->seq;
+  s_frame.timestamp_us = frame->timestamp_us;
+  return ESP_OK;
+}
+
+esp_err_t frame_cache_get(int64_t max_age_us, TickType_t timeout,
+                          cached_frame_t *out) {
+  if (s_lock == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+
+  int64_t now = esp_timer_get_time();
+  esp_err_t ret = ESP_OK;
+
+  // A running stream keeps publishing: take its newest frame without
+  // waiting. A leftover frame from a finished stream may be old, though.
+  const shared_frame_t *frame = frame_broadcaster_acquire(s_frame.seq, 0);
+  if (frame != NULL && now - frame->timestamp_us > max_age_us) {
+    frame_broadcaster_release(frame);
+    frame = NULL;
+  }
+
+  if (frame == NULL &&
+      (s_frame.len == 0 || now - s_frame.timestamp_us > max_age_us)) {
+    // Nothing fresh: run the capture just long enough for one frame
+    if (frame_broadcaster_subscribe() == ESP_OK) {
+      uint32_t last_seq = s_frame.seq;
+      while (true) {
+        frame = frame_broadcaster_acquire(last_seq, timeout);
+        if (frame == NULL || frame->timestamp_us >= now) {
+          break;
+        }
+        last_seq = frame->seq; // Stale frame still queued, skip it
+        frame_broadcaster_release(frame);
+      }
+      frame_broadcaster_unsubscribe();
+    }
+  }
+
+  if (frame != NULL) {
+    ret = copy_frame_locked(frame);
+    frame_broadcaster_release(frame);
+  }
+
+  if (ret == ESP_OK && s_frame.len == 0) {
+    ret = ESP_ERR_NOT_FOUND;
+  }
+  if (ret != ESP_OK) {
+    xSemaphoreGive(s_lock);
+    return ret;
+  }
+  *out = s_frame;
+  return ESP_OK;
+}
+
+void frame_cache_put(void) { xSemaphoreGive(s_lock); }
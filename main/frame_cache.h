@@ -0,0 +1,53 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Latest-frame cache for single-image requests
+ *
+ * Keeps a PSRAM copy of the most recent broadcaster frame. A request only
+ * copies a frame when the broadcaster has published a newer one than the
+ * cached copy; the shared slot is released right after the copy, so the
+ * (possibly slow) send never holds a frame buffer the streams need. While
+ * no stream is running a capture is started only when the cached copy is
+ * older than the requested maximum age.
+ */
+
+typedef struct {
+  const uint8_t *buf;   // JPEG data (PSRAM)
+  size_t len;           // JPEG length in bytes
+  uint32_t seq;         // Broadcaster sequence number of the frame
+  int64_t timestamp_us; // Capture time (esp_timer clock)
+} cached_frame_t;
+
+/**
+ * @brief Create the cache lock
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t frame_cache_init(void);
+
+/**
+ * @brief Get the latest frame, refreshing the cache if needed
+ *
+ * On success the cache stays locked until frame_cache_put().
+ *
+ * @param max_age_us Capture a new frame if the cached one is older
+ * @param timeout Maximum time to wait for a new frame
+ * @param out Cached frame, valid until frame_cache_put()
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no frame is available,
+ *         ESP_ERR_NO_MEM if the copy could not be allocated
+ */
+esp_err_t frame_cache_get(int64_t max_age_us, TickType_t timeout,
+                          cached_frame_t *out);
+
+/**
+ * @brief Unlock the cache after frame_cache_get()
+ */
+void frame_cache_put(void);
+
+#endif // FRAME_CACHE_H
@@ -0,0 +1,98 @@
+#include "httpd_async.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "task_topology.h"
+
+static const char *TAG = "HttpdAsync";
+
+typedef struct {
+  httpd_req_t *req;
+  esp_err_t (*handler)(httpd_req_t *req);
+} async_req_t;
+
+static QueueHandle_t s_req_queue = NULL;
+static SemaphoreHandle_t s_idle_workers = NULL;
+static TaskHandle_t s_workers[HTTPD_ASYNC_WORKERS];
+
+static void async_worker_task(void *arg) {
+  while (true) {
+    // Announce that this worker can take a request
+    xSemaphoreGive(s_idle_workers);
+
+    async_req_t async_req;
+    if (xQueueReceive(s_req_queue, &async_req, portMAX_DELAY)) {
+      async_req.handler(async_req.req);
+
+      if (httpd_req_async_handler_complete(async_req.req) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to complete async request");
+      }
+    }
+  }
+}
+
+esp_err_t httpd_async_init(void) {
+  if (s_req_queue != NULL) {
+    return ESP_OK;
+  }
+
+  s_req_queue = xQueueCreate(HTTPD_ASYNC_WORKERS, sizeof(async_req_t));
+  s_idle_workers = xSemaphoreCreateCounting(HTTPD_ASYNC_WORKERS, 0);
+  if (s_req_queue == NULL || s_idle_workers == NULL) {
+    ESP_LOGE(TAG, "Failed to create worker queue");
+    return ESP_ERR_NO_MEM;
+  }
+
+  for (int i = 0; i < HTTPD_ASYNC_WORKERS; i++) {
+    if (task_topology_create(TASK_HTTPD_ASYNC, async_worker_task, NULL,
+                             &s_workers[i]) != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to start worker %d", i);
+      return ESP_ERR_NO_MEM;
+    }
+  }
+
+  ESP_LOGI(TAG, "%d async HTTP workers started", HTTPD_ASYNC_WORKERS);
+  return ESP_OK;
+}
+
+bool httpd_async_is_worker(void) {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  for (int i = 0; i < HTTPD_ASYNC_WORKERS; i++) {
+    if (s_workers[i] == self) {
+      return true;
+    }
+  }
+  return false;
+}
+
+esp_err_t httpd_async_submit(httpd_req_t *req,
+                             esp_err_t (*handler)(httpd_req_t *req)) {
+  if (s_req_queue == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  // Don't queue behind a busy worker: the request would wait indefinitely
+  if (xSemaphoreTake(s_idle_workers, 0) != pdTRUE) {
+    ESP_LOGW(TAG, "No idle async worker");
+    return ESP_ERR_NOT_FINISHED;
+  }
+
+  httpd_req_t *copy = NULL;
+  esp_err_t err = httpd_req_async_handler_begin(req, &copy);
+  if (err != ESP_OK) {
+    xSemaphoreGive(s_idle_workers);
+    return err;
+  }
+
+  async_req_t async_req = {.req = copy, .handler = handler};
+  if (xQueueSend(s_req_queue, &async_req, pdMS_TO_TICKS(100)) != pdTRUE) {
+    ESP_LOGE(TAG, "Worker queue full");
+    httpd_req_async_handler_complete(copy);
+    xSemaphoreGive(s_idle_workers);
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
@@ -0,0 +1,46 @@
+#ifndef HTTPD_ASYNC_H
+#define HTTPD_ASYNC_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stdbool.h>
+
+/**
+ * @brief Worker pool for long-lived HTTP requests
+ *
+ * esp_http_server runs every handler on its single server task, so a handler
+ * that loops forever (MJPEG stream) stalls every other request. Handlers
+ * registered through this module hand their request over to a small pool of
+ * dedicated worker tasks using the httpd async request API and return
+ * immediately, keeping the server task free for the JSON endpoints.
+ */
+
+// Number of worker tasks, i.e. long-lived requests served concurrently
+#define HTTPD_ASYNC_WORKERS 3
+
+/**
+ * @brief Create the worker tasks
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t httpd_async_init(void);
+
+/**
+ * @brief Check whether the caller runs on one of the async workers
+ */
+bool httpd_async_is_worker(void);
+
+/**
+ * @brief Hand a request over to an idle worker
+ *
+ * The worker calls handler() with a detached copy of the request and
+ * completes it afterwards. Fails without queueing if no worker is idle.
+ *
+ * @param req Request received on the server task
+ * @param handler Handler to run on the worker
+ * @return ESP_OK if queued, ESP_ERR_NOT_FINISHED if all workers are busy
+ */
+esp_err_t httpd_async_submit(httpd_req_t *req,
+                             esp_err_t (*handler)(httpd_req_t *req));
+
+#endif // HTTPD_ASYNC_H
@@ -0,0 +1,132 @@
+#include "i2c_bus.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "I2C_BUS";
+
+#define I2C_BUS_XFER_TIMEOUT_MS 100
+
+static i2c_master_bus_handle_t s_bus = NULL;
+static SemaphoreHandle_t s_lock = NULL;
+static i2c_bus_stats_t s_stats; // Updated under s_lock
+
+esp_err_t i2c_bus_init(void) {
+  if (s_bus != NULL) {
+    return ESP_OK;
+  }
+
+  s_lock = xSemaphoreCreateRecursiveMutex();
+  if (s_lock == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  i2c_master_bus_config_t bus_config = {
+      .clk_source = I2C_CLK_SRC_DEFAULT,
+      .i2c_port = I2C_BUS_PORT, // Fixed so the camera can look it up
+      .scl_io_num = I2C_BUS_SCL_IO,
+      .sda_io_num = I2C_BUS_SDA_IO,
+      .glitch_ignore_cnt = 7,
+      .flags.enable_internal_pullup = true,
+  };
+  esp_err_t ret = i2c_new_master_bus(&bus_config, &s_bus);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create I2C bus: %s", esp_err_to_name(ret));
+    vSemaphoreDelete(s_lock);
+    s_lock = NULL;
+    return ret;
+  }
+
+  ESP_LOGI(TAG, "I2C bus %d ready (SDA=IO%d, SCL=IO%d)", I2C_BUS_PORT,
+           I2C_BUS_SDA_IO, I2C_BUS_SCL_IO);
+  return ESP_OK;
+}
+
+esp_err_t i2c_bus_add_device(uint16_t addr, uint32_t scl_speed_hz,
+                             i2c_master_dev_handle_t *out) {
+  if (s_bus == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  i2c_device_config_t dev_config = {
+      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+      .device_address = addr,
+      .scl_speed_hz = scl_speed_hz,
+  };
+  return i2c_master_bus_add_device(s_bus, &dev_config, out);
+}
+
+esp_err_t i2c_bus_lock(TickType_t timeout) {
+  if (s_lock == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  return xSemaphoreTakeRecursive(s_lock, timeout) == pdTRUE ? ESP_OK
+                                                            : ESP_ERR_TIMEOUT;
+}
+
+void i2c_bus_unlock(void) { xSemaphoreGiveRecursive(s_lock); }
+
+static void record(int64_t start_us, esp_err_t ret) {
+  uint32_t us = (uint32_t)(esp_timer_get_time() - start_us);
+  s_stats.transactions++;
+  if (ret != ESP_OK) {
+    s_stats.errors++;
+  }
+  s_stats.last_us = us;
+  if (us > s_stats.max_us) {
+    s_stats.max_us = us;
+  }
+  s_stats.total_us += us;
+}
+
+esp_err_t i2c_bus_write(i2c_master_dev_handle_t dev, const uint8_t *data,
+                        size_t len) {
+  esp_err_t ret = i2c_bus_lock(pdMS_TO_TICKS(I2C_BUS_XFER_TIMEOUT_MS));
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  int64_t start = esp_timer_get_time();
+  ret = i2c_master_transmit(dev, data, len, I2C_BUS_XFER_TIMEOUT_MS);
+  record(start, ret);
+  i2c_bus_unlock();
+  return ret;
+}
+
+esp_err_t i2c_bus_write_read(i2c_master_dev_handle_t dev,
+                             const uint8_t *wdata, size_t wlen,
+                             uint8_t *rdata, size_t rlen) {
+  esp_err_t ret = i2c_bus_lock(pdMS_TO_TICKS(I2C_BUS_XFER_TIMEOUT_MS));
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  int64_t start = esp_timer_get_time();
+  ret = i2c_master_transmit_receive(dev, wdata, wlen, rdata, rlen,
+                                    I2C_BUS_XFER_TIMEOUT_MS);
+  record(start, ret);
+  i2c_bus_unlock();
+  return ret;
+}
+
+esp_err_t i2c_bus_check_attached(uint16_t addr) {
+  i2c_master_bus_handle_t bus = NULL;
+  if (s_bus == NULL || i2c_master_get_bus_handle(I2C_BUS_PORT, &bus) != ESP_OK ||
+      bus != s_bus) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  esp_err_t ret = i2c_bus_lock(pdMS_TO_TICKS(I2C_BUS_XFER_TIMEOUT_MS));
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  ret = i2c_master_probe(s_bus, addr, I2C_BUS_XFER_TIMEOUT_MS);
+  i2c_bus_unlock();
+  return ret == ESP_OK ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void i2c_bus_get_stats(i2c_bus_stats_t *out) {
+  if (i2c_bus_lock(portMAX_DELAY) != ESP_OK) {
+    *out = (i2c_bus_stats_t){0};
+    return;
+  }
+  *out = s_stats;
+  i2c_bus_unlock();
+}
@@ -0,0 +1,102 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include "driver/i2c_master.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Shared I2C bus on IO1 (SDA) / IO2 (SCL)
+ *
+ * The AXP313A PMIC and the camera SCCB share these pins. The bus is created
+ * once at boot and lives for the whole runtime; devices keep persistent
+ * handles on it. The camera driver attaches to the same bus through
+ * camera_config_t.sccb_i2c_port (with the SCCB pins set to -1) instead of
+ * creating its own.
+ *
+ * Single transactions are serialized by the I2C driver. The bus lock is a
+ * recursive mutex for multi-transaction sequences (read-modify-write) that
+ * must not interleave with another task's access to the same device.
+ */
+
+#define I2C_BUS_PORT 1
+#define I2C_BUS_SDA_IO 1
+#define I2C_BUS_SCL_IO 2
+
+/**
+ * @brief Transaction timing, measured around each driver call
+ */
+typedef struct {
+  uint32_t transactions;
+  uint32_t errors;
+  uint32_t last_us; // Duration of the most recent transaction
+  uint32_t max_us;
+  uint64_t total_us;
+} i2c_bus_stats_t;
+
+/**
+ * @brief Create the bus
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t i2c_bus_init(void);
+
+/**
+ * @brief Attach a 7-bit device to the bus
+ *
+ * @param addr Device address
+ * @param scl_speed_hz SCL clock for this device
+ * @param out Persistent device handle
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t i2c_bus_add_device(uint16_t addr, uint32_t scl_speed_hz,
+                             i2c_master_dev_handle_t *out);
+
+/**
+ * @brief Take the bus lock (recursive)
+ *
+ * @param timeout Maximum time to wait
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT otherwise
+ */
+esp_err_t i2c_bus_lock(TickType_t timeout);
+
+/**
+ * @brief Release the bus lock
+ */
+void i2c_bus_unlock(void);
+
+/**
+ * @brief Write bytes to a device (locked and timed)
+ */
+esp_err_t i2c_bus_write(i2c_master_dev_handle_t dev, const uint8_t *data,
+                        size_t len);
+
+/**
+ * @brief Write then read with a repeated start (locked and timed)
+ */
+esp_err_t i2c_bus_write_read(i2c_master_dev_handle_t dev,
+                             const uint8_t *wdata, size_t wlen,
+                             uint8_t *rdata, size_t rlen);
+
+/**
+ * @brief Check that a driver attached by port number shares this bus
+ *
+ * For the camera SCCB: I2C_BUS_PORT must still resolve to this bus, and
+ * the device at addr must answer on it. A camera driver that set up its
+ * own bus on IO1/IO2 instead of attaching takes the pins away, and the
+ * probe fails.
+ *
+ * @param addr 7-bit address of the attached device
+ * @return ESP_OK if shared, ESP_ERR_INVALID_STATE if the port resolves to
+ *         another bus, ESP_ERR_NOT_FOUND if the device doesn't answer
+ */
+esp_err_t i2c_bus_check_attached(uint16_t addr);
+
+/**
+ * @brief Copy the transaction statistics
+ */
+void i2c_bus_get_stats(i2c_bus_stats_t *out);
+
+#endif // I2C_BUS_H
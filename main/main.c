@@ -1,47 +1,62 @@
+#include "alarm_engine.h"
+#include "api_json.h"
 #include "axp313a.h"
-#include "esp_adc/adc_cali.h"
-#include "esp_adc/adc_cali_scheme.h"
-#include "esp_adc/adc_oneshot.h"
+#include "bulk_frame.h"
+#include "clip_recorder.h"
 #include "esp_camera.h"
 #include "esp_event.h"
+#include "esp_heap_caps.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
+#include "event_push.h"
+#include "frame_broadcaster.h"
+#include "frame_cache.h"
+#include "httpd_async.h"
+#include "i2c_bus.h"
+#include "metrics.h"
+#include "mjpeg_framing.h"
+#include "motion_detect.h"
+#include "mq137_adc.h"
+#include "mq137_ppm.h"
+#include "power_policy.h"
+#include "quality_ctrl.h"
+#include "stream_pacer.h"
+#include "task_topology.h"
+#include "telemetry.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
+#include "sensor_history.h"
+#include "sensor_snapshot.h"
 #include "sht30.h"
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 static const char *TAG = "SmartCoop";
 
 // Store IP address for display
 static char s_ip_addr[16] = "0.0.0.0";
 
-// ==========================================
-// MQ-137 Ammonia Sensor Configuration (GPIO 3)
-// ==========================================
-#define MQ137_ADC_CHANNEL ADC_CHANNEL_2 // GPIO 3 -> ADC1_CH2
-#define MQ137_ADC_ATTEN ADC_ATTEN_DB_12 // 0-3.3V range
-
-static adc_oneshot_unit_handle_t adc1_handle = NULL;
-static adc_cali_handle_t adc_cali_handle = NULL;
-static volatile int g_ammonia_raw = 0;
-static volatile int g_ammonia_voltage_mv = 0;
-
-// ==========================================
-// SHT30 Temperature & Humidity Data
-// ==========================================
-static volatile float g_temperature = 0.0f;
-static volatile float g_humidity = 0.0f;
+// Latest sensor readings are published via sensor_snapshot.h
 
 // ==========================================
 // Camera State Control
 // ==========================================
 static volatile bool g_camera_enabled = false;
 static volatile bool g_camera_initialized = false;
+static bool s_camera_powered = false; // ALDO1 rail
+
+// Measured by init_camera()/camera_standby(), reported by the status API
+static int64_t s_camera_on_us = 0;
+static int64_t s_camera_off_us = 0;
+static int s_camera_warmup_frames = 0;
 
 // ==========================================
 // WiFi Configuration
@@ -50,6 +65,9 @@ static volatile bool g_camera_initialized = false;
 #define WIFI_PASSWORD "12345678"
 #define WIFI_MAXIMUM_RETRY 10
 
+// Telemetry broker (telemetry.h); an empty URI disables publishing
+#define MQTT_BROKER_URI "mqtt://192.168.1.10:1883"
+
 // ==========================================
 // DFRobot Romeo ESP32-S3 Camera Pin Definition
 // Using original reference code pin mapping
@@ -57,8 +75,8 @@ static volatile bool g_camera_initialized = false;
 #define CAM_PIN_PWDN -1  // Not used / internal pull-down
 #define CAM_PIN_RESET -1 // Not used / internal pull-up
 #define CAM_PIN_XCLK 45  // External clock
-#define CAM_PIN_SIOD 1   // I2C SDA (SCCB)
-#define CAM_PIN_SIOC 2   // I2C SCL (SCCB)
+#define CAM_PIN_SIOD 1   // I2C SDA (SCCB), owned by i2c_bus
+#define CAM_PIN_SIOC 2   // I2C SCL (SCCB), owned by i2c_bus
 
 #define CAM_PIN_D7 48 // Data bit 7
 #define CAM_PIN_D6 46 // Data bit 6
@@ -73,6 +91,10 @@ static volatile bool g_camera_initialized = false;
 #define CAM_PIN_HREF 42 // Horizontal reference
 #define CAM_PIN_PCLK 5  // Pixel clock
 
+#if CONFIG_SCCB_HARDWARE_I2C_DRIVER_LEGACY
+#error "SCCB must use the new I2C driver to share i2c_bus (sdkconfig.defaults)"
+#endif
+
 // ==========================================
 // WiFi Event Handling
 // ==========================================
@@ -91,6 +113,7 @@ static void event_handler(void *arg, esp_event_base_t event_base,
     wifi_event_sta_disconnected_t *disconn =
         (wifi_event_sta_disconnected_t *)event_data;
     ESP_LOGW(TAG, "WiFi disconnected, reason: %d", disconn->reason);
+    metrics_wifi_disconnect(disconn->reason);
     if (s_retry_num < WIFI_MAXIMUM_RETRY) {
       esp_wifi_connect();
       s_retry_num++;
@@ -156,89 +179,222 @@ static esp_err_t wifi_init_sta(void) {
   return ESP_FAIL;
 }
 
-// ==========================================
-// MQ-137 ADC Initialization
-// ==========================================
-static esp_err_t init_mq137_adc(void) {
-  // ADC1 Unit Init
-  adc_oneshot_unit_init_cfg_t init_config = {
-      .unit_id = ADC_UNIT_1,
-  };
-  ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_config, &adc1_handle));
-
-  // ADC1 Channel Config
-  adc_oneshot_chan_cfg_t config = {
-      .bitwidth = ADC_BITWIDTH_DEFAULT,
-      .atten = MQ137_ADC_ATTEN,
-  };
-  ESP_ERROR_CHECK(
-      adc_oneshot_config_channel(adc1_handle, MQ137_ADC_CHANNEL, &config));
-
-  // ADC Calibration
-  adc_cali_curve_fitting_config_t cali_config = {
-      .unit_id = ADC_UNIT_1,
-      .atten = MQ137_ADC_ATTEN,
-      .bitwidth = ADC_BITWIDTH_DEFAULT,
-  };
-  esp_err_t ret =
-      adc_cali_create_scheme_curve_fitting(&cali_config, &adc_cali_handle);
-  if (ret != ESP_OK) {
-    ESP_LOGW(TAG, "ADC calibration scheme not supported, using raw values");
-    adc_cali_handle = NULL;
-  }
-
-  ESP_LOGI(TAG, "MQ-137 ADC initialized on GPIO 3 (ADC1_CH2)");
-  return ESP_OK;
-}
-
 // ==========================================
 // MQ-137 Data Reading Task
 // ==========================================
 static void mq137_task(void *arg) {
-  int raw_value = 0;
-  int voltage = 0;
+  mq137_reading_t reading;
 
   while (true) {
-    esp_err_t ret =
-        adc_oneshot_read(adc1_handle, MQ137_ADC_CHANNEL, &raw_value);
+    // Blocks until the next interval's burst is sampled; the ADC is stopped
+    // in between
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = mq137_adc_read(&reading, pdMS_TO_TICKS(2000));
+    task_topology_tick(TASK_MQ137);
+    metrics_observe_us(METRICS_HIST_ADC_READ, esp_timer_get_time() - start);
     if (ret == ESP_OK) {
-      g_ammonia_raw = raw_value;
-
-      if (adc_cali_handle) {
-        adc_cali_raw_to_voltage(adc_cali_handle, raw_value, &voltage);
-        g_ammonia_voltage_mv = voltage;
-      } else {
-        // Approximate conversion without calibration (12-bit, 3.3V)
-        g_ammonia_voltage_mv = (raw_value * 3300) / 4095;
+      float ppm = mq137_ppm_update(reading.voltage_mv);
+      sensor_snapshot_publish_ammonia(reading.raw, reading.voltage_mv,
+                                      reading.variance, ppm);
+      sensor_history_record(HISTORY_AMMONIA_MV, reading.voltage_mv);
+      telemetry_record(TELEMETRY_AMMONIA_MV, reading.voltage_mv);
+      alarm_engine_feed(ALARM_SRC_AMMONIA_MV, reading.voltage_mv);
+      if (!isnan(ppm)) {
+        alarm_engine_feed(ALARM_SRC_AMMONIA_PPM, ppm);
       }
+      event_push_notify();
+    } else if (ret != ESP_ERR_NOT_FOUND) {
+      metrics_add(METRICS_ADC_ERRORS, 1);
+      ESP_LOGW(TAG, "MQ-137 read failed: %s", esp_err_to_name(ret));
     }
-
-    vTaskDelay(pdMS_TO_TICKS(500)); // Read every 500ms
   }
 }
 
 // ==========================================
 // SHT30 Data Reading Task
 // ==========================================
+// The sensor measures on its own clock in periodic mode; the task only
+// fetches finished results, so no task sleeps waiting on a conversion.
+// Polling at twice the measurement rate keeps the result age below half a
+// period; early polls return without touching the bus.
+#define SHT30_RATE SHT30_RATE_1_MPS
+
 static void sht30_task(void *arg) {
   float temp, hum;
+  bool periodic = sht30_start_periodic(SHT30_RATE) == ESP_OK;
+  uint32_t interval_ms = periodic ? sht30_rate_period_ms(SHT30_RATE) / 2 : 2000;
+  if (!periodic) {
+    ESP_LOGW(TAG, "SHT30 periodic mode unavailable, using single-shot reads");
+  }
+  task_topology_set_period(TASK_SHT30, interval_ms);
 
+  TickType_t last_wake = xTaskGetTickCount();
   while (true) {
-    if (sht30_read(&temp, &hum) == ESP_OK) {
-      g_temperature = temp;
-      g_humidity = hum;
+    task_topology_tick(TASK_SHT30);
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret =
+        periodic ? sht30_fetch(&temp, &hum) : sht30_read(&temp, &hum);
+    // An early poll returns without touching the bus; not worth recording
+    if (ret != ESP_ERR_NOT_FINISHED) {
+      metrics_observe_us(METRICS_HIST_SHT30_READ,
+                         esp_timer_get_time() - start);
+    }
+    if (ret != ESP_OK && ret != ESP_ERR_NOT_FINISHED) {
+      metrics_add(METRICS_SHT30_ERRORS, 1);
     }
-    vTaskDelay(pdMS_TO_TICKS(2000)); // Read every 2 seconds
+    if (ret == ESP_OK) {
+      sensor_snapshot_publish_sht30(temp, hum);
+      sensor_history_record(HISTORY_TEMPERATURE, temp);
+      sensor_history_record(HISTORY_HUMIDITY, hum);
+      telemetry_record(TELEMETRY_TEMPERATURE, temp);
+      telemetry_record(TELEMETRY_HUMIDITY, hum);
+      alarm_engine_feed(ALARM_SRC_TEMPERATURE, temp);
+      alarm_engine_feed(ALARM_SRC_HUMIDITY, hum);
+      event_push_notify();
+    }
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(interval_ms));
+  }
+}
+
+// ==========================================
+// Camera Frame Source (feeds the frame broadcaster)
+// ==========================================
+static void *camera_source_get(void *ctx, const uint8_t **buf, size_t *len) {
+  int64_t start = esp_timer_get_time();
+  camera_fb_t *fb = esp_camera_fb_get();
+  metrics_observe_us(METRICS_HIST_CAMERA_FB_GET, esp_timer_get_time() - start);
+  if (fb != NULL) {
+    *buf = fb->buf;
+    *len = fb->len;
+  } else {
+    metrics_add(METRICS_CAMERA_ERRORS, 1);
   }
+  return fb;
 }
 
+static void camera_source_put(void *ctx, void *handle) {
+  esp_camera_fb_return((camera_fb_t *)handle);
+}
+
+static const frame_source_t s_camera_source = {
+    .get = camera_source_get,
+    .put = camera_source_put,
+    .ctx = NULL,
+};
+
 // ==========================================
 // Camera Initialization
 // ==========================================
-static esp_err_t init_camera(void) {
-  if (g_camera_initialized) {
-    ESP_LOGI(TAG, "Camera already initialized");
-    return ESP_OK;
+// Warm-up ends once consecutive JPEG sizes agree within this percentage:
+// the size tracks exposure, so a stable size means auto-exposure settled
+#define CAMERA_WARMUP_MAX_FRAMES 10
+#define CAMERA_WARMUP_STABLE_PCT 10
+
+// Sensor software standby: registers and AE state are kept, the output
+// stops and the sensor draws a few mA instead of ~100 mA
+static esp_err_t camera_sensor_standby(bool standby) {
+  sensor_t *s = esp_camera_sensor_get();
+  if (s == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  int ret;
+  switch (s->id.PID) {
+  case 0x3660: // OV3660
+  case 0x5640: // OV5640: SYSTEM CTRL0 bit 6 = software power down
+    ret = s->set_reg(s, 0x3008, 0x40, standby ? 0x40 : 0x00);
+    break;
+  case 0x26: // OV2640: COM2 (sensor bank) bit 4 = standby
+    ret = s->set_reg(s, 0x100 | 0x09, 0x10, standby ? 0x10 : 0x00);
+    break;
+  default:
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  return ret == 0 ? ESP_OK : ESP_FAIL;
+}
+
+// Discard frames until auto-exposure has settled. Frames captured before
+// since_us (still queued from before standby) are skipped.
+static int camera_warmup(int64_t since_us) {
+  size_t prev_len = 0;
+  int frames = 0;
+
+  for (int i = 0; i < 2 * CAMERA_WARMUP_MAX_FRAMES; i++) {
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (fb == NULL) {
+      continue;
+    }
+    int64_t ts = (int64_t)fb->timestamp.tv_sec * 1000000 +
+                 fb->timestamp.tv_usec;
+    size_t len = fb->len;
+    esp_camera_fb_return(fb);
+    if (ts < since_us) {
+      continue; // Stale frame
+    }
+
+    frames++;
+    if (frames >= CAMERA_WARMUP_MAX_FRAMES ||
+        (prev_len > 0 && labs((long)len - (long)prev_len) * 100 <
+                             (long)prev_len * CAMERA_WARMUP_STABLE_PCT)) {
+      break;
+    }
+    prev_len = len;
+  }
+  return frames;
+}
+
+// ==========================================
+// Stream Quality Ladder
+// ==========================================
+// Operating points from best to cheapest, picked at runtime by the
+// quality controller (quality_ctrl.h). Level 0 is what the driver is
+// initialized with; the frame buffers are sized for it, so no level may
+// exceed its frame size or quality.
+typedef struct {
+  framesize_t frame_size;
+  int jpeg_quality; // 0-63, lower is better
+  const char *name;
+} stream_quality_level_t;
+
+static const stream_quality_level_t s_quality_levels[] = {
+    {FRAMESIZE_VGA, 12, "640x480"},  {FRAMESIZE_VGA, 18, "640x480"},
+    {FRAMESIZE_CIF, 14, "400x296"},  {FRAMESIZE_CIF, 22, "400x296"},
+    {FRAMESIZE_QVGA, 14, "320x240"}, {FRAMESIZE_QVGA, 24, "320x240"},
+    {FRAMESIZE_QVGA, 35, "320x240"},
+};
+#define STREAM_QUALITY_LEVELS                                                 \
+  (int)(sizeof(s_quality_levels) / sizeof(s_quality_levels[0]))
+
+static quality_ctrl_t s_quality_ctrl;   // Guarded by s_quality_lock
+static SemaphoreHandle_t s_quality_lock = NULL;
+static int s_quality_applied = 0; // Level the sensor is running at
+
+// Push a ladder level to the sensor
+static esp_err_t stream_quality_apply(int level) {
+  sensor_t *s = esp_camera_sensor_get();
+  if (s == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  const stream_quality_level_t *next = &s_quality_levels[level];
+  const stream_quality_level_t *cur = &s_quality_levels[s_quality_applied];
+  if (next->frame_size != cur->frame_size &&
+      s->set_framesize(s, next->frame_size) != 0) {
+    return ESP_FAIL;
+  }
+  if (s->set_quality(s, next->jpeg_quality) != 0) {
+    return ESP_FAIL;
+  }
+  s_quality_applied = level;
+  return ESP_OK;
+}
+
+static esp_err_t camera_driver_init(void) {
+  if (!s_camera_powered) {
+    esp_err_t err = axp313a_camera_power_on();
+    if (err != ESP_OK) {
+      return err;
+    }
+    s_camera_powered = true;
   }
 
   camera_config_t config = {
@@ -256,16 +412,19 @@ static esp_err_t init_camera(void) {
       .pin_pclk = CAM_PIN_PCLK,
       .pin_vsync = CAM_PIN_VSYNC,
       .pin_href = CAM_PIN_HREF,
-      .pin_sccb_sda = CAM_PIN_SIOD,
-      .pin_sccb_scl = CAM_PIN_SIOC,
+      .pin_sccb_sda = -1, // SCCB attaches to the shared bus on IO1/IO2
+      .pin_sccb_scl = -1,
+      .sccb_i2c_port = I2C_BUS_PORT,
       .pin_pwdn = CAM_PIN_PWDN,
       .pin_reset = CAM_PIN_RESET,
 
       .xclk_freq_hz = 20000000,       // 20MHz XCLK
       .pixel_format = PIXFORMAT_JPEG, // JPEG for streaming
-      .frame_size = FRAMESIZE_VGA,    // 640x480 (stable for OV3660)
-      .jpeg_quality = 12,             // Good quality (0-63)
-      .fb_count = 2,                  // Double buffer
+      // 640x480 (stable for OV3660) at good quality; the stream quality
+      // controller only steps down from here
+      .frame_size = s_quality_levels[0].frame_size,
+      .jpeg_quality = s_quality_levels[0].jpeg_quality,
+      .fb_count = FRAME_BROADCASTER_SLOTS, // Shared between all viewers
       .fb_location = CAMERA_FB_IN_PSRAM,
       .grab_mode = CAMERA_GRAB_LATEST, // Always get latest frame
   };
@@ -276,52 +435,131 @@ static esp_err_t init_camera(void) {
     return err;
   }
 
-  // Get sensor and apply OV3660-specific settings
+  // A driver that ignored sccb_i2c_port set up its own bus on IO1/IO2 and
+  // took the pins from the AXP313A
   sensor_t *s = esp_camera_sensor_get();
-  if (s != NULL) {
-    ESP_LOGI(TAG, "Camera sensor PID: 0x%02X", s->id.PID);
+  err = s != NULL ? i2c_bus_check_attached(s->slv_addr) : ESP_ERR_NOT_FOUND;
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG,
+             "Camera SCCB not on the shared I2C bus (%s), check the "
+             "esp32-camera version in idf_component.yml",
+             esp_err_to_name(err));
+    esp_camera_deinit();
+    return ESP_ERR_INVALID_STATE;
+  }
 
-    // OV3660 specific optimizations
-    if (s->id.PID == 0x3660) {
-      ESP_LOGI(TAG, "Applying OV3660 optimizations...");
-      s->set_brightness(s, 1); // Slight brightness boost
-      s->set_saturation(s, 0); // Default saturation
-      s->set_contrast(s, 0);   // Default contrast
-    }
+  ESP_LOGI(TAG, "Camera sensor PID: 0x%02X", s->id.PID);
+
+  // OV3660 specific optimizations
+  if (s->id.PID == 0x3660) {
+    ESP_LOGI(TAG, "Applying OV3660 optimizations...");
+    s->set_brightness(s, 1); // Slight brightness boost
+    s->set_saturation(s, 0); // Default saturation
+    s->set_contrast(s, 0);   // Default contrast
   }
 
-  // Warm-up: capture and discard several frames to stabilize JPEG encoding
-  ESP_LOGI(TAG, "Camera warm-up: discarding initial frames...");
-  for (int i = 0; i < 10; i++) {
-    camera_fb_t *fb = esp_camera_fb_get();
-    if (fb) {
-      esp_camera_fb_return(fb);
-    }
-    vTaskDelay(pdMS_TO_TICKS(50));
+  // The driver starts at level 0; restore the controller's operating point
+  s_quality_applied = 0;
+  xSemaphoreTake(s_quality_lock, portMAX_DELAY);
+  if (s_quality_ctrl.level != 0) {
+    stream_quality_apply(s_quality_ctrl.level);
   }
+  xSemaphoreGive(s_quality_lock);
 
   g_camera_initialized = true;
+  return ESP_OK;
+}
+
+// Start capturing: resume from standby if the driver is still up,
+// otherwise run the full driver init first
+static esp_err_t init_camera(void) {
+  if (g_camera_enabled) {
+    ESP_LOGI(TAG, "Camera already running");
+    return ESP_OK;
+  }
+
+  int64_t start = esp_timer_get_time();
+  bool resume = g_camera_initialized;
+  if (resume) {
+    if (camera_sensor_standby(false) != ESP_OK) {
+      ESP_LOGW(TAG, "Sensor wake-up not supported");
+    }
+  } else {
+    esp_err_t err = camera_driver_init();
+    if (err != ESP_OK) {
+      return err;
+    }
+  }
+
+  s_camera_warmup_frames = camera_warmup(start);
+  frame_broadcaster_start();
+
   g_camera_enabled = true;
-  ESP_LOGI(TAG, "Camera initialized successfully!");
+  event_push_set_camera_state(true, true);
+  power_policy_set_camera(POWER_CAMERA_ON);
+  s_camera_on_us = esp_timer_get_time() - start;
+  ESP_LOGI(TAG, "Camera %s in %lld ms (%d warm-up frames)",
+           resume ? "resumed" : "initialized",
+           (long long)(s_camera_on_us / 1000), s_camera_warmup_frames);
   return ESP_OK;
 }
 
 // ==========================================
-// Camera Deinitialization
+// Camera Standby / Deinitialization
 // ==========================================
+// Stop capturing but keep the driver and frame buffers allocated, with the
+// sensor in standby, so the next init_camera() is a fast resume
+static esp_err_t camera_standby(void) {
+  if (!g_camera_initialized) {
+    return ESP_OK;
+  }
+  int64_t start = esp_timer_get_time();
+  g_camera_enabled = false; // Streams exit and release their frames
+
+  // All frame buffers must be back with the driver before capture stops.
+  // Wait longer than the httpd send timeout so a blocked viewer can finish.
+  esp_err_t err = frame_broadcaster_stop(pdMS_TO_TICKS(6000));
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Frames still in use, camera not stopped");
+    return err;
+  }
+  if (camera_sensor_standby(true) != ESP_OK) {
+    ESP_LOGW(TAG, "Sensor standby not supported, sensor keeps streaming");
+  }
+
+  event_push_set_camera_state(false, true);
+  power_policy_set_camera(POWER_CAMERA_STANDBY);
+  s_camera_off_us = esp_timer_get_time() - start;
+  ESP_LOGI(TAG, "Camera in standby (%lld ms)",
+           (long long)(s_camera_off_us / 1000));
+  return ESP_OK;
+}
+
+// Full teardown: releases the driver and its frame buffers and switches
+// the camera rail off
 static esp_err_t deinit_camera(void) {
   if (!g_camera_initialized) {
     return ESP_OK;
   }
 
-  esp_err_t err = esp_camera_deinit();
+  esp_err_t err = camera_standby();
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  err = esp_camera_deinit();
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "Camera deinit failed with error 0x%x", err);
     return err;
   }
 
   g_camera_initialized = false;
-  g_camera_enabled = false;
+  if (axp313a_camera_power_off() == ESP_OK) {
+    s_camera_powered = false;
+  }
+  event_push_set_camera_state(false, false);
+  power_policy_set_camera(s_camera_powered ? POWER_CAMERA_STANDBY
+                                           : POWER_CAMERA_OFF);
   ESP_LOGI(TAG, "Camera deinitialized");
   return ESP_OK;
 }
@@ -329,83 +567,290 @@ static esp_err_t deinit_camera(void) {
 // ==========================================
 // HTTP Stream Handler (MJPEG)
 // ==========================================
-#define PART_BOUNDARY "123456789000000000000987654321"
-static const char *STREAM_CONTENT_TYPE =
-    "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
-static const char *STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
-static const char *STREAM_PART =
-    "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
+#define STREAM_DEFAULT_FPS 10
 
-static esp_err_t stream_handler(httpd_req_t *req) {
-  if (!g_camera_enabled || !g_camera_initialized) {
+// A client whose socket stays backed up this long is considered dead
+#define STREAM_STALL_TIMEOUT_US 5000000
+
+// Pacers of the running streams, exposed by /api/stream/clients
+static stream_pacer_t *s_stream_pacers[HTTPD_ASYNC_WORKERS];
+static portMUX_TYPE s_stream_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Caller holds s_stream_lock
+static int stream_count_locked(void) {
+  int count = 0;
+  for (int i = 0; i < HTTPD_ASYNC_WORKERS; i++) {
+    if (s_stream_pacers[i] != NULL) {
+      count++;
+    }
+  }
+  return count;
+}
+
+static void stream_register(stream_pacer_t *pacer) {
+  portENTER_CRITICAL(&s_stream_lock);
+  for (int i = 0; i < HTTPD_ASYNC_WORKERS; i++) {
+    if (s_stream_pacers[i] == NULL) {
+      s_stream_pacers[i] = pacer;
+      break;
+    }
+  }
+  int count = stream_count_locked();
+  portEXIT_CRITICAL(&s_stream_lock);
+  power_policy_set_streams(count);
+}
+
+static void stream_unregister(stream_pacer_t *pacer) {
+  portENTER_CRITICAL(&s_stream_lock);
+  for (int i = 0; i < HTTPD_ASYNC_WORKERS; i++) {
+    if (s_stream_pacers[i] == pacer) {
+      s_stream_pacers[i] = NULL;
+    }
+  }
+  int count = stream_count_locked();
+  portEXIT_CRITICAL(&s_stream_lock);
+  power_policy_set_streams(count);
+}
+
+// Feed the viewer with the least headroom to the quality controller and
+// apply its decision. Called by each stream after a completed pacer
+// window; if another stream is already evaluating, this one skips.
+static void stream_quality_update(void) {
+  quality_sample_t worst;
+  uint32_t worst_pct = UINT32_MAX;
+  bool found = false;
+
+  portENTER_CRITICAL(&s_stream_lock);
+  for (int i = 0; i < HTTPD_ASYNC_WORKERS; i++) {
+    const stream_pacer_t *p = s_stream_pacers[i];
+    if (p == NULL || p->windows == 0) {
+      continue;
+    }
+    quality_sample_t sample = {
+        .target_fps = p->target_fps,
+        .achieved_fps = p->achieved_fps,
+        .throughput_kbps = p->throughput_kbps,
+        .frame_bytes = p->frame_bytes,
+    };
+    uint32_t pct = quality_ctrl_headroom_pct(&sample);
+    if (!found || pct < worst_pct) {
+      worst = sample;
+      worst_pct = pct;
+      found = true;
+    }
+  }
+  portEXIT_CRITICAL(&s_stream_lock);
+
+  if (!found || xSemaphoreTake(s_quality_lock, 0) != pdTRUE) {
+    return;
+  }
+  int from = s_quality_applied;
+  int level = quality_ctrl_update(&s_quality_ctrl, &worst,
+                                  esp_timer_get_time());
+  if (level != from) {
+    esp_err_t err = stream_quality_apply(level);
+    ESP_LOGI(TAG, "Stream quality %d -> %d (%s q%d, %lu/%lu kbps): %s", from,
+             level, s_quality_levels[level].name,
+             s_quality_levels[level].jpeg_quality,
+             (unsigned long)worst.throughput_kbps,
+             (unsigned long)(worst.frame_bytes * 8 * worst.target_fps / 1000),
+             esp_err_to_name(err));
+  }
+  xSemaphoreGive(s_quality_lock);
+}
+
+// Target frame rate from the "fps" query parameter, if given
+static int stream_requested_fps(httpd_req_t *req) {
+  char query[32];
+  char value[8];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+      httpd_query_key_value(query, "fps", value, sizeof(value)) == ESP_OK) {
+    return atoi(value);
+  }
+  return STREAM_DEFAULT_FPS;
+}
+
+// Runs on an async worker task for the lifetime of the stream. Frames are
+// written straight to the socket (see mjpeg_framing.h), bypassing httpd's
+// chunked encoding.
+static esp_err_t stream_worker_handler(httpd_req_t *req) {
+  if (frame_broadcaster_subscribe() != ESP_OK) {
     httpd_resp_set_status(req, "503 Service Unavailable");
-    httpd_resp_send(req, "Camera is off", 13);
+    httpd_resp_send(req, "Too many viewers", 16);
     return ESP_OK;
   }
 
-  camera_fb_t *fb = NULL;
+  const shared_frame_t *frame = NULL;
+  uint32_t last_seq = 0;
   esp_err_t res = ESP_OK;
-  char part_buf[64];
   int error_count = 0;
+  int sockfd = httpd_req_to_sockfd(req);
+
+  stream_pacer_t pacer;
+  stream_pacer_init(&pacer, stream_requested_fps(req), esp_timer_get_time());
 
-  res = httpd_resp_set_type(req, STREAM_CONTENT_TYPE);
+  res = mjpeg_send_response_header(sockfd, pacer.target_fps);
   if (res != ESP_OK) {
+    frame_broadcaster_unsubscribe();
+    httpd_sess_trigger_close(req->handle, sockfd);
     return res;
   }
 
-  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  httpd_resp_set_hdr(req, "X-Framerate", "10"); // Hint to browser
+  ESP_LOGI(TAG, "Stream started at %d fps (%d viewers)", pacer.target_fps,
+           frame_broadcaster_subscriber_count());
+  stream_register(&pacer);
 
-  ESP_LOGI(TAG, "Stream started");
+  int64_t start_us = esp_timer_get_time();
+  int64_t stalled_since_us = 0;
+  uint64_t bytes_sent = 0;
+  uint32_t windows_seen = 0;
 
   while (g_camera_enabled && g_camera_initialized) {
-    fb = esp_camera_fb_get();
-    if (!fb) {
-      ESP_LOGW(TAG, "Camera capture failed, retrying...");
+    // Sleep until the next deadline; time spent sending is already
+    // accounted for by the pacer
+    int64_t wait_us = stream_pacer_wait_us(&pacer, esp_timer_get_time());
+    if (wait_us > 0) {
+      vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+    }
+
+    // Always send the newest shared frame; frames published while this
+    // viewer was busy sending are skipped
+    frame = frame_broadcaster_acquire(last_seq, pdMS_TO_TICKS(1000));
+    if (!frame) {
+      ESP_LOGW(TAG, "No frame from camera, waiting...");
       error_count++;
       if (error_count > 5) {
         ESP_LOGE(TAG, "Too many capture errors, stopping stream");
         break;
       }
-      vTaskDelay(pdMS_TO_TICKS(100));
-      continue; // Skip this frame, try again
+      continue;
     }
     error_count = 0; // Reset on success
-
-    // Skip frames without valid JPEG data
-    if (fb->len < 100 || fb->buf[0] != 0xFF || fb->buf[1] != 0xD8) {
-      ESP_LOGW(TAG, "Invalid JPEG frame, skipping");
-      esp_camera_fb_return(fb);
-      vTaskDelay(pdMS_TO_TICKS(50));
+    last_seq = frame->seq;
+
+    // Client still hasn't drained the previous frame: drop this one
+    // instead of queueing it behind
+    int64_t now_us = esp_timer_get_time();
+    if (!mjpeg_socket_writable(sockfd)) {
+      frame_broadcaster_release(frame);
+      stream_pacer_on_dropped(&pacer, now_us);
+      metrics_add(METRICS_STREAM_DROPPED, 1);
+      if (stalled_since_us == 0) {
+        stalled_since_us = now_us;
+      } else if (now_us - stalled_since_us > STREAM_STALL_TIMEOUT_US) {
+        ESP_LOGW(TAG, "Client stalled, stopping stream");
+        break;
+      }
       continue;
     }
+    stalled_since_us = 0;
+
+    res = mjpeg_send_frame(sockfd, frame->buf, frame->len);
+    if (res == ESP_OK) {
+      int64_t sent_us = esp_timer_get_time();
+      stream_pacer_on_sent(&pacer, frame->len, frame->timestamp_us, now_us,
+                           sent_us);
+      bytes_sent += frame->len;
+      metrics_add(METRICS_STREAM_FRAMES, 1);
+      metrics_add(METRICS_STREAM_BYTES, frame->len);
+      metrics_observe_us(METRICS_HIST_STREAM_SEND, sent_us - now_us);
+    }
+    frame_broadcaster_release(frame);
 
-    size_t hlen = snprintf(part_buf, sizeof(part_buf), STREAM_PART, fb->len);
-
-    res = httpd_resp_send_chunk(req, STREAM_BOUNDARY, strlen(STREAM_BOUNDARY));
-    if (res != ESP_OK) {
-      esp_camera_fb_return(fb);
-      break;
+    if (pacer.windows != windows_seen) {
+      windows_seen = pacer.windows;
+      stream_quality_update();
     }
 
-    res = httpd_resp_send_chunk(req, part_buf, hlen);
     if (res != ESP_OK) {
-      esp_camera_fb_return(fb);
       break;
     }
+  }
 
-    res = httpd_resp_send_chunk(req, (const char *)fb->buf, fb->len);
-    esp_camera_fb_return(fb);
+  stream_unregister(&pacer);
+  frame_broadcaster_unsubscribe();
+
+  // The response has no length or chunked framing, so the stream can only
+  // be terminated by closing the connection
+  httpd_sess_trigger_close(req->handle, sockfd);
+
+  int64_t elapsed_ms = (esp_timer_get_time() - start_us) / 1000;
+  if (elapsed_ms > 0) {
+    ESP_LOGI(TAG,
+             "Stream ended: %lu frames sent, %lu dropped in %lld ms "
+             "(%.1f fps, %llu KB/s)",
+             (unsigned long)pacer.frames_sent,
+             (unsigned long)pacer.frames_dropped, (long long)elapsed_ms,
+             pacer.frames_sent * 1000.0f / elapsed_ms,
+             (unsigned long long)(bytes_sent / (uint64_t)elapsed_ms));
+  }
+  return res;
+}
 
-    if (res != ESP_OK) {
-      break;
-    }
+// Runs on the httpd task: hand the stream off so the API stays responsive
+static esp_err_t stream_handler(httpd_req_t *req) {
+  if (!g_camera_enabled || !g_camera_initialized) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_send(req, "Camera is off", 13);
+    return ESP_OK;
+  }
+
+  if (httpd_async_submit(req, stream_worker_handler) != ESP_OK) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_send(req, "Too many streams", 16);
+  }
+  return ESP_OK;
+}
+
+// ==========================================
+// HTTP Capture Handler (single JPEG)
+// ==========================================
+// While no stream runs, a cached frame younger than this is served as-is
+// instead of starting a capture
+#define CAPTURE_MAX_AGE_US 200000
 
-    // Control frame rate (~10 fps for stable streaming)
-    vTaskDelay(pdMS_TO_TICKS(100));
+// Latest frame from the cache; the ETag is the frame's sequence number and
+// publish time, so a poll between two frames revalidates to a 304
+static esp_err_t capture_handler(httpd_req_t *req) {
+  if (!g_camera_enabled || !g_camera_initialized) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_send(req, "Camera is off", 13);
+    return ESP_OK;
+  }
+
+  power_policy_camera_used();
+  cached_frame_t frame;
+  if (frame_cache_get(CAPTURE_MAX_AGE_US, pdMS_TO_TICKS(1000), &frame) !=
+      ESP_OK) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_send(req, "No frame", 8);
+    return ESP_OK;
   }
 
-  ESP_LOGI(TAG, "Stream ended");
+  char etag[32];
+  char seq[12];
+  char if_none_match[64];
+  snprintf(etag, sizeof(etag), "\"%lu-%llx\"", (unsigned long)frame.seq,
+           (unsigned long long)frame.timestamp_us);
+  snprintf(seq, sizeof(seq), "%lu", (unsigned long)frame.seq);
+  httpd_resp_set_hdr(req, "ETag", etag);
+  httpd_resp_set_hdr(req, "X-Frame-Seq", seq);
+  httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+  esp_err_t res;
+  if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match,
+                                  sizeof(if_none_match)) == ESP_OK &&
+      strstr(if_none_match, etag) != NULL) {
+    httpd_resp_set_status(req, "304 Not Modified");
+    res = httpd_resp_send(req, NULL, 0);
+  } else {
+    httpd_resp_set_type(req, "image/jpeg");
+    httpd_resp_set_hdr(req, "Content-Disposition",
+                       "inline; filename=capture.jpg");
+    res = httpd_resp_send(req, (const char *)frame.buf, frame.len);
+  }
+  frame_cache_put();
   return res;
 }
 
@@ -413,9 +858,11 @@ static esp_err_t stream_handler(httpd_req_t *req) {
 // Ammonia API Handler
 // ==========================================
 static esp_err_t ammonia_handler(httpd_req_t *req) {
+  sensor_snapshot_t snap;
+  sensor_snapshot_read(&snap);
+
   char response[128];
-  snprintf(response, sizeof(response), "{\"raw\":%d,\"voltage_mv\":%d}",
-           g_ammonia_raw, g_ammonia_voltage_mv);
+  api_json_ammonia(response, sizeof(response), &snap);
 
   httpd_resp_set_type(req, "application/json");
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
@@ -426,16 +873,253 @@ static esp_err_t ammonia_handler(httpd_req_t *req) {
 // SHT30 API Handler
 // ==========================================
 static esp_err_t sht30_handler(httpd_req_t *req) {
+  sensor_snapshot_t snap;
+  sensor_snapshot_read(&snap);
+
   char response[128];
-  snprintf(response, sizeof(response),
-           "{\"temperature\":%.1f,\"humidity\":%.1f}", g_temperature,
-           g_humidity);
+  api_json_sht30(response, sizeof(response), &snap);
 
   httpd_resp_set_type(req, "application/json");
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
   return httpd_resp_send(req, response, strlen(response));
 }
 
+// ==========================================
+// Combined Sensors API Handler
+// ==========================================
+// One consistent snapshot of every reading plus the camera state, so a
+// dashboard poll is a single round-trip. Times are ms since boot.
+static esp_err_t sensors_handler(httpd_req_t *req) {
+  sensor_snapshot_t snap;
+  sensor_snapshot_read(&snap);
+
+  char response[API_JSON_SENSORS_MAX];
+  api_json_sensors(response, sizeof(response), &snap,
+                   esp_timer_get_time() / 1000, g_camera_enabled,
+                   g_camera_initialized);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_send(req, response, strlen(response));
+}
+
+// ==========================================
+// Bulk Binary API Handler (bulk_frame.h)
+// ==========================================
+// Without ?since= the frame holds the newest sample of each sensor. With
+// since=<seq> it holds every logged sample after that seq, so a scraper
+// that passes the last seq it saw gets everything new in one response. A
+// seq from before a reboot restarts at the oldest sample (BULK_FLAG_GAP).
+#define BULK_MAX_RECORDS 128
+#define BULK_BATCH 16 // Samples copied out of the log at a time
+
+static esp_err_t bulk_handler(httpd_req_t *req) {
+  char query[32];
+  char value[12];
+  bool delta =
+      httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+      httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK;
+  uint32_t since = delta ? strtoul(value, NULL, 10) : 0;
+
+  uint8_t *frame = malloc(BULK_FRAME_HEADER_SIZE +
+                          BULK_MAX_RECORDS * BULK_FRAME_RECORD_SIZE);
+  if (frame == NULL) {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                               "Out of memory");
+  }
+
+  int64_t now_ms = esp_timer_get_time() / 1000;
+  bulk_frame_header_t header = {
+      .since = since,
+      .now_ms = now_ms,
+      .heap_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+      .flags = (g_camera_enabled ? BULK_FLAG_CAMERA_ENABLED : 0) |
+               (g_camera_initialized ? BULK_FLAG_CAMERA_INITIALIZED : 0),
+  };
+  size_t len = BULK_FRAME_HEADER_SIZE;
+  sensor_sample_t batch[BULK_BATCH];
+  uint32_t next = since;
+
+  if (!delta) {
+    static const sensor_sample_kind_t kinds[] = {SENSOR_SAMPLE_AMMONIA,
+                                                 SENSOR_SAMPLE_SHT30};
+    for (size_t i = 0; i < 2; i++) {
+      if (sensor_snapshot_log_latest(kinds[i], &batch[0])) {
+        len += bulk_frame_record(&frame[len], &batch[0], now_ms);
+        header.count++;
+      }
+    }
+  } else {
+    sensor_snapshot_t newest;
+    sensor_snapshot_read(&newest);
+    uint32_t oldest;
+    sensor_snapshot_log_read(0, batch, 0, &oldest);
+    bool gap;
+    next = bulk_frame_resume(since, newest.version, oldest, &gap);
+    if (gap) {
+      header.flags |= BULK_FLAG_GAP;
+    }
+    while (header.count < BULK_MAX_RECORDS) {
+      size_t want = BULK_MAX_RECORDS - header.count;
+      size_t n = sensor_snapshot_log_read(
+          next, batch, want < BULK_BATCH ? want : BULK_BATCH, &oldest);
+      if (n == 0) {
+        break;
+      }
+      for (size_t i = 0; i < n; i++) {
+        len += bulk_frame_record(&frame[len], &batch[i], now_ms);
+      }
+      header.count += n;
+      next = batch[n - 1].version;
+    }
+  }
+
+  sensor_snapshot_t snap;
+  sensor_snapshot_read(&snap);
+  header.seq = snap.version;
+  if (delta && snap.version > next) {
+    header.flags |= BULK_FLAG_MORE;
+  }
+  bulk_frame_header(frame, &header);
+
+  httpd_resp_set_type(req, "application/octet-stream");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  esp_err_t res = httpd_resp_send(req, (const char *)frame, len);
+  free(frame);
+  return res;
+}
+
+// ==========================================
+// History API Handler
+// ==========================================
+// Points copied out of the history store per chunk; keeps the httpd stack
+// usage small regardless of the size of the query
+#define HISTORY_BATCH_POINTS 16
+
+// Longest step accepted, in seconds
+#define HISTORY_MAX_STEP_S (366 * 24 * 3600)
+
+// step=raw|1m|1h selects a tier's own points. A step in seconds is served
+// from the coarsest tier that still resolves it, merged into buckets of that
+// step (rounded up to a multiple of the tier's resolution).
+static history_tier_t history_step_parse(const char *step, uint32_t *step_ds) {
+  *step_ds = 0;
+  if (strcmp(step, "1h") == 0) {
+    return HISTORY_TIER_HOUR;
+  }
+  if (strcmp(step, "1m") == 0) {
+    return HISTORY_TIER_MINUTE;
+  }
+  long seconds = strtol(step, NULL, 10);
+  if (seconds <= 0) {
+    return HISTORY_TIER_RAW;
+  }
+  if (seconds > HISTORY_MAX_STEP_S) {
+    seconds = HISTORY_MAX_STEP_S;
+  }
+  history_tier_t tier = sensor_history_tier_for_step(seconds * 10);
+  uint32_t unit = tier == HISTORY_TIER_HOUR     ? 3600
+                  : tier == HISTORY_TIER_MINUTE ? 60
+                                                : 1;
+  *step_ds = (seconds + unit - 1) / unit * unit * 10;
+  return tier;
+}
+
+// GET /api/history?sensor=ammonia|temperature|humidity&from=<ms>&step=<step>
+//                  [&format=csv|bin]
+// from is milliseconds since boot; a negative value is relative to now.
+// Results are streamed in chunks straight from the PSRAM store. Except for
+// raw points, the last row is the bucket still being filled.
+static esp_err_t history_handler(httpd_req_t *req) {
+  char query[96];
+  char sensor_name[16] = "";
+  char value[24];
+  int64_t from_ms = 0;
+  history_tier_t tier = HISTORY_TIER_RAW;
+  uint32_t step_ds = 0;
+  bool binary = false;
+
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+    httpd_query_key_value(query, "sensor", sensor_name, sizeof(sensor_name));
+    if (httpd_query_key_value(query, "from", value, sizeof(value)) == ESP_OK) {
+      from_ms = strtoll(value, NULL, 10);
+    }
+    if (httpd_query_key_value(query, "step", value, sizeof(value)) == ESP_OK) {
+      tier = history_step_parse(value, &step_ds);
+    }
+    if (httpd_query_key_value(query, "format", value, sizeof(value)) ==
+        ESP_OK) {
+      binary = strcmp(value, "bin") == 0;
+    }
+  }
+
+  history_sensor_t sensor = sensor_history_sensor_from_name(sensor_name);
+  if (sensor == HISTORY_SENSOR_COUNT) {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown sensor");
+  }
+  if (from_ms < 0) {
+    from_ms += esp_timer_get_time() / 1000;
+  }
+
+  bool raw = tier == HISTORY_TIER_RAW && step_ds == 0;
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  if (binary) {
+    // Little-endian packed records
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "X-History-Layout",
+                       raw ? "u32 t_ds,f32 value"
+                           : "u32 t_ds,f32 min,f32 max,f32 mean");
+  } else {
+    httpd_resp_set_type(req, "text/csv");
+  }
+
+  history_point_t points[HISTORY_BATCH_POINTS];
+  char out[HISTORY_BATCH_POINTS * 48];
+  history_cursor_t cursor = {0};
+  esp_err_t res = ESP_OK;
+  size_t len = 0;
+
+  if (!binary) {
+    len = snprintf(out, sizeof(out),
+                   raw ? "t_ms,value\n" : "t_ms,min,max,mean\n");
+  }
+
+  while (res == ESP_OK) {
+    size_t n = sensor_history_read(sensor, tier, step_ds, from_ms, &cursor,
+                                   points, HISTORY_BATCH_POINTS);
+    for (size_t i = 0; i < n; i++) {
+      const history_point_t *p = &points[i];
+      if (binary) {
+        // A raw record is just t_ds followed by the value (== min)
+        size_t rec = raw ? 8 : sizeof(history_point_t);
+        memcpy(&out[len], p, rec);
+        len += rec;
+      } else if (raw) {
+        len += snprintf(&out[len], sizeof(out) - len, "%llu,%.2f\n",
+                        (unsigned long long)p->t_ds * 100, p->mean);
+      } else {
+        len += snprintf(&out[len], sizeof(out) - len, "%llu,%.2f,%.2f,%.2f\n",
+                        (unsigned long long)p->t_ds * 100, p->min, p->max,
+                        p->mean);
+      }
+    }
+
+    if (len > 0) {
+      res = httpd_resp_send_chunk(req, out, len);
+      len = 0;
+    }
+    if (n == 0) {
+      break;
+    }
+  }
+
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
 // ==========================================
 // Camera Control Handlers
 // ==========================================
@@ -449,11 +1133,18 @@ static esp_err_t camera_on_handler(httpd_req_t *req) {
   return httpd_resp_send(req, response, strlen(response));
 }
 
+// /api/camera/off puts the camera in standby; ?deep=1 also releases the
+// driver and frame buffers and switches the camera rail off
 static esp_err_t camera_off_handler(httpd_req_t *req) {
-  g_camera_enabled = false;
-  vTaskDelay(pdMS_TO_TICKS(200)); // Allow stream to stop
-
-  esp_err_t ret = deinit_camera();
+  char query[16];
+  char value[4];
+  bool deep = httpd_req_get_url_query_str(req, query, sizeof(query)) ==
+                  ESP_OK &&
+              httpd_query_key_value(query, "deep", value, sizeof(value)) ==
+                  ESP_OK &&
+              atoi(value) != 0;
+
+  esp_err_t ret = deep ? deinit_camera() : camera_standby();
   const char *response =
       ret == ESP_OK ? "{\"status\":\"off\"}" : "{\"status\":\"error\"}";
 
@@ -463,10 +1154,157 @@ static esp_err_t camera_off_handler(httpd_req_t *req) {
 }
 
 static esp_err_t camera_status_handler(httpd_req_t *req) {
-  char response[64];
-  snprintf(response, sizeof(response), "{\"enabled\":%s,\"initialized\":%s}",
+  char response[160];
+  snprintf(response, sizeof(response),
+           "{\"enabled\":%s,\"initialized\":%s,\"standby\":%s,"
+           "\"on_ms\":%lld,\"off_ms\":%lld,\"warmup_frames\":%d}",
            g_camera_enabled ? "true" : "false",
-           g_camera_initialized ? "true" : "false");
+           g_camera_initialized ? "true" : "false",
+           g_camera_initialized && !g_camera_enabled ? "true" : "false",
+           (long long)(s_camera_on_us / 1000),
+           (long long)(s_camera_off_us / 1000), s_camera_warmup_frames);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_send(req, response, strlen(response));
+}
+
+static esp_err_t motion_handler(httpd_req_t *req) {
+  motion_status_t st;
+  motion_detect_get_status(&st);
+
+  char response[240];
+  snprintf(response, sizeof(response),
+           "{\"armed\":%s,\"active\":%s,\"score\":%u,\"blobs\":%d,"
+           "\"largest_blob\":%d,\"events\":%lu,\"last_motion_ms\":%lld,"
+           "\"frames\":%lu,\"kernel_us\":%lu}",
+           st.armed ? "true" : "false", st.active ? "true" : "false",
+           st.score, st.blobs, st.largest_blob,
+           (unsigned long)st.events, (long long)(st.last_motion_us / 1000),
+           (unsigned long)st.frames, (unsigned long)st.kernel_us);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_send(req, response, strlen(response));
+}
+
+// POST /api/motion?armed=0|1 arms or disarms the detector (kept in NVS).
+// Arming starts the camera, which then stays on until disarmed; responds
+// like GET.
+static esp_err_t motion_set_handler(httpd_req_t *req) {
+  char query[16];
+  char value[4];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+      httpd_query_key_value(query, "armed", value, sizeof(value)) != ESP_OK) {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing armed");
+  }
+  if (strcmp(value, "0") != 0 && strcmp(value, "1") != 0) {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid armed");
+  }
+
+  bool armed = value[0] == '1';
+  esp_err_t err = motion_detect_set_armed(armed);
+  if (armed && init_camera() != ESP_OK) {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                               "Armed but camera failed to start");
+  }
+  if (err != ESP_OK) {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                               "armed applied but not saved");
+  }
+  return motion_handler(req);
+}
+
+// Shared IO1/IO2 bus transaction timing (AXP313A traffic)
+static esp_err_t i2c_stats_handler(httpd_req_t *req) {
+  i2c_bus_stats_t st;
+  i2c_bus_get_stats(&st);
+
+  char response[160];
+  snprintf(response, sizeof(response),
+           "{\"transactions\":%lu,\"errors\":%lu,\"last_us\":%lu,"
+           "\"max_us\":%lu,\"avg_us\":%lu}",
+           (unsigned long)st.transactions, (unsigned long)st.errors,
+           (unsigned long)st.last_us, (unsigned long)st.max_us,
+           (unsigned long)(st.transactions ? st.total_us / st.transactions
+                                           : 0));
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_send(req, response, strlen(response));
+}
+
+static esp_err_t stream_clients_handler(httpd_req_t *req) {
+  stream_pacer_t pacers[HTTPD_ASYNC_WORKERS];
+  int count = 0;
+
+  // Snapshot under the lock, format outside of it
+  portENTER_CRITICAL(&s_stream_lock);
+  for (int i = 0; i < HTTPD_ASYNC_WORKERS; i++) {
+    if (s_stream_pacers[i] != NULL) {
+      pacers[count++] = *s_stream_pacers[i];
+    }
+  }
+  portEXIT_CRITICAL(&s_stream_lock);
+
+  char response[32 + HTTPD_ASYNC_WORKERS * 224];
+  int len = snprintf(response, sizeof(response), "{\"clients\":[");
+  for (int i = 0; i < count; i++) {
+    const stream_pacer_t *p = &pacers[i];
+    len += snprintf(response + len, sizeof(response) - len,
+                    "%s{\"target_fps\":%d,\"achieved_fps\":%.1f,"
+                    "\"frames_sent\":%lu,\"frames_dropped\":%lu,"
+                    "\"latency_ms\":%d,\"send_ms\":%d,"
+                    "\"throughput_kbps\":%lu,\"frame_bytes\":%lu}",
+                    i == 0 ? "" : ",", p->target_fps, p->achieved_fps,
+                    (unsigned long)p->frames_sent,
+                    (unsigned long)p->frames_dropped,
+                    (int)(p->latency_us / 1000), (int)(p->send_us / 1000),
+                    (unsigned long)p->throughput_kbps,
+                    (unsigned long)p->frame_bytes);
+  }
+  snprintf(response + len, sizeof(response) - len, "]}");
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_send(req, response, strlen(response));
+}
+
+// Current operating point, the ladder and the recent level changes
+static esp_err_t stream_quality_handler(httpd_req_t *req) {
+  quality_change_t history[QUALITY_CTRL_HISTORY];
+
+  xSemaphoreTake(s_quality_lock, portMAX_DELAY);
+  int level = s_quality_applied;
+  int64_t up_hold_us = s_quality_ctrl.up_hold_us;
+  uint32_t changes = s_quality_ctrl.changes;
+  int n = quality_ctrl_history(&s_quality_ctrl, history, QUALITY_CTRL_HISTORY);
+  xSemaphoreGive(s_quality_lock);
+
+  const stream_quality_level_t *cur = &s_quality_levels[level];
+  char response[256 + STREAM_QUALITY_LEVELS * 48 + QUALITY_CTRL_HISTORY * 96];
+  int len = snprintf(response, sizeof(response),
+                     "{\"level\":%d,\"frame_size\":\"%s\",\"quality\":%d,"
+                     "\"up_hold_ms\":%lld,\"changes\":%lu,\"levels\":[",
+                     level, cur->name, cur->jpeg_quality,
+                     (long long)(up_hold_us / 1000), (unsigned long)changes);
+  for (int i = 0; i < STREAM_QUALITY_LEVELS; i++) {
+    len += snprintf(response + len, sizeof(response) - len,
+                    "%s{\"frame_size\":\"%s\",\"quality\":%d}",
+                    i == 0 ? "" : ",", s_quality_levels[i].name,
+                    s_quality_levels[i].jpeg_quality);
+  }
+  len += snprintf(response + len, sizeof(response) - len, "],\"history\":[");
+  for (int i = 0; i < n; i++) {
+    const quality_change_t *c = &history[i];
+    len += snprintf(response + len, sizeof(response) - len,
+                    "%s{\"t_ms\":%lld,\"from\":%d,\"to\":%d,"
+                    "\"throughput_kbps\":%lu,\"demand_kbps\":%lu}",
+                    i == 0 ? "" : ",", (long long)(c->t_us / 1000), c->from,
+                    c->to, (unsigned long)c->throughput_kbps,
+                    (unsigned long)c->demand_kbps);
+  }
+  snprintf(response + len, sizeof(response) - len, "]}");
 
   httpd_resp_set_type(req, "application/json");
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
@@ -476,182 +1314,235 @@ static esp_err_t camera_status_handler(httpd_req_t *req) {
 // ==========================================
 // Root Handler - Web UI
 // ==========================================
+// main/www/index.html, gzipped at build time (see main/CMakeLists.txt)
+extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_end[] asm("_binary_index_html_gz_end");
+
+// Long enough for browsers to skip the request entirely on normal page
+// loads; a reload revalidates against the ETag and gets a 304
+#define INDEX_CACHE_CONTROL "public, max-age=86400"
+
+static char s_index_etag[12];
+
+// Content hash (FNV-1a) of the embedded page, computed on first use
+static const char *index_etag(void) {
+  if (s_index_etag[0] == '\0') {
+    uint32_t hash = 2166136261u;
+    for (const uint8_t *p = index_html_gz_start; p < index_html_gz_end; p++) {
+      hash = (hash ^ *p) * 16777619u;
+    }
+    snprintf(s_index_etag, sizeof(s_index_etag), "\"%08lx\"",
+             (unsigned long)hash);
+  }
+  return s_index_etag;
+}
+
 static esp_err_t index_handler(httpd_req_t *req) {
-  const char *html =
-      "<!DOCTYPE html>"
-      "<html><head><title>SmartCoop Monitor</title>"
-      "<meta name='viewport' content='width=device-width, initial-scale=1'>"
-      "<meta charset='UTF-8'>"
-      "<style>"
-      "*{box-sizing:border-box;margin:0;padding:0;}"
-      "body{font-family:'Segoe UI',Arial,sans-serif;background:linear-gradient("
-      "135deg,#1a1a2e 0%,#16213e "
-      "100%);color:#fff;min-height:100vh;padding:20px;}"
-      ".container{max-width:800px;margin:0 auto;}"
-      "h1{text-align:center;color:#00d4ff;margin-bottom:20px;font-size:1.8em;"
-      "text-shadow:0 0 20px rgba(0,212,255,0.5);}"
-      ".card{background:rgba(255,255,255,0.1);border-radius:16px;padding:20px;"
-      "margin-bottom:20px;backdrop-filter:blur(10px);border:1px solid "
-      "rgba(255,255,255,0.1);}"
-      ".card-title{font-size:1.2em;color:#00d4ff;margin-bottom:15px;display:"
-      "flex;"
-      "align-items:center;gap:10px;}"
-      ".card-title::before{content:'';width:4px;height:20px;background:#00d4ff;"
-      "border-radius:2px;}"
-      ".sensor-data{display:flex;justify-content:space-around;text-align:"
-      "center;}"
-      ".sensor-item{padding:15px;}"
-      ".sensor-value{font-size:2.5em;font-weight:bold;color:#4caf50;}"
-      ".sensor-label{color:#aaa;font-size:0.9em;margin-top:5px;}"
-      ".camera-container{text-align:center;}"
-      "#stream{max-width:100%;border-radius:12px;background:#000;display:none;}"
-      ".camera-placeholder{background:rgba(0,0,0,0.3);border-radius:12px;"
-      "padding:60px;"
-      "color:#666;font-size:1.2em;}"
-      ".btn{padding:12px "
-      "30px;font-size:1em;border:none;border-radius:8px;cursor:pointer;"
-      "transition:all 0.3s;margin:10px 5px;font-weight:bold;}"
-      ".btn-on{background:linear-gradient(135deg,#4caf50,#45a049);color:#fff;}"
-      ".btn-off{background:linear-gradient(135deg,#f44336,#d32f2f);color:#fff;}"
-      ".btn:hover{transform:translateY(-2px);box-shadow:0 5px 20px "
-      "rgba(0,0,0,0.3);}"
-      ".btn:disabled{opacity:0.5;cursor:not-allowed;transform:none;}"
-      ".status{display:inline-block;padding:5px "
-      "12px;border-radius:20px;font-size:0.85em;}"
-      ".status-on{background:#4caf50;}"
-      ".status-off{background:#666;}"
-      "</style></head><body>"
-      "<div class='container'>"
-      "<h1>\ud83d\udc14 SmartCoop Monitor</h1>"
-      "<div class='card'>"
-      "<div class='card-title'>\u6c28\u6c14\u4f20\u611f\u5668 (MQ-137)</div>"
-      "<div class='sensor-data'>"
-      "<div class='sensor-item'>"
-      "<div class='sensor-value' id='voltage'>--</div>"
-      "<div class='sensor-label'>\u7535\u538b (mV)</div>"
-      "</div>"
-      "<div class='sensor-item'>"
-      "<div class='sensor-value' id='raw'>--</div>"
-      "<div class='sensor-label'>ADC \u539f\u59cb\u503c</div>"
-      "</div>"
-      "</div></div>"
-      "<div class='card'>"
-      "<div class='card-title'>\u6e29\u6e7f\u5ea6\u4f20\u611f\u5668 (SHT30)</div>"
-      "<div class='sensor-data'>"
-      "<div class='sensor-item'>"
-      "<div class='sensor-value' id='temp'>--</div>"
-      "<div class='sensor-label'>\u6e29\u5ea6 (\u00b0C)</div>"
-      "</div>"
-      "<div class='sensor-item'>"
-      "<div class='sensor-value' id='hum'>--</div>"
-      "<div class='sensor-label'>\u6e7f\u5ea6 (%)</div>"
-      "</div>"
-      "</div></div>"
-      "<div class='card'>"
-      "<div class='card-title'>\u6444\u50cf\u5934\u76d1\u63a7 "
-      "<span class='status status-off' id='cam-status'>\u5173\u95ed</span></div>"
-      "<div class='camera-container'>"
-      "<div class='camera-placeholder' id='placeholder'>\ud83d\udcf7 \u6444\u50cf\u5934\u5df2\u5173\u95ed</div>"
-      "<img id='stream' src='' alt='Camera Stream'>"
-      "<div style='margin-top:15px;'>"
-      "<button class='btn btn-on' id='btn-on' "
-      "onclick='cameraOn()'>\u5f00\u542f\u6444\u50cf\u5934</button>"
-      "<button class='btn btn-off' id='btn-off' onclick='cameraOff()' "
-      "disabled>\u5173\u95ed\u6444\u50cf\u5934</button>"
-      "</div></div></div>"
-      "</div>"
-      "<script>"
-      "function updateAmmonia(){"
-      "fetch('/api/ammonia').then(r=>r.json()).then(d=>{"
-      "document.getElementById('voltage').textContent=d.voltage_mv;"
-      "document.getElementById('raw').textContent=d.raw;"
-      "}).catch(e=>console.log('Ammonia fetch error'));"
-      "}"
-      "function updateSHT30(){"
-      "fetch('/api/sht30').then(r=>r.json()).then(d=>{"
-      "document.getElementById('temp').textContent=d.temperature.toFixed(1);"
-      "document.getElementById('hum').textContent=d.humidity.toFixed(1);"
-      "}).catch(e=>console.log('SHT30 fetch error'));"
-      "}"
-      "function updateCameraStatus(){"
-      "fetch('/api/camera/status').then(r=>r.json()).then(d=>{"
-      "var st=document.getElementById('cam-status');"
-      "var img=document.getElementById('stream');"
-      "var ph=document.getElementById('placeholder');"
-      "var btnOn=document.getElementById('btn-on');"
-      "var btnOff=document.getElementById('btn-off');"
-      "if(d.enabled&&d.initialized){"
-      "st.textContent='\u8fd0\u884c\u4e2d';st.className='status status-on';"
-      "img.style.display='block';ph.style.display='none';"
-      "if(!img.src.includes('/stream'))img.src='/stream?t='+Date.now();"
-      "btnOn.disabled=true;btnOff.disabled=false;"
-      "}else{"
-      "st.textContent='\u5173\u95ed';st.className='status status-off';"
-      "img.style.display='none';ph.style.display='block';img.src='';"
-      "btnOn.disabled=false;btnOff.disabled=true;"
-      "}"
-      "}).catch(e=>console.log('Status fetch error'));"
-      "}"
-      "function cameraOn(){"
-      "var btnOn=document.getElementById('btn-on');"
-      "btnOn.disabled=true;btnOn.textContent='\u6b63\u5728\u5f00\u542f...';"
-      "fetch('/api/camera/on').then(r=>r.json()).then(d=>{"
-      "btnOn.textContent='\u5f00\u542f\u6444\u50cf\u5934';"
-      "updateCameraStatus();"
-      "}).catch(e=>{alert('\u5f00\u542f\u5931\u8d25');btnOn.textContent='\u5f00\u542f\u6444\u50cf\u5934';btnOn.disabled=false;});"
-      "}"
-      "function cameraOff(){"
-      "fetch('/api/camera/off').then(r=>r.json()).then(d=>{"
-      "updateCameraStatus();"
-      "}).catch(e=>alert('\u5173\u95ed\u5931\u8d25'));"
-      "}"
-      "setInterval(updateAmmonia,1000);"
-      "setInterval(updateSHT30,2000);"
-      "setInterval(updateCameraStatus,3000);"
-      "updateAmmonia();updateSHT30();updateCameraStatus();"
-      "</script></body></html>";
-
-  return httpd_resp_send(req, html, strlen(html));
+  const char *etag = index_etag();
+  char if_none_match[64];
+
+  httpd_resp_set_hdr(req, "ETag", etag);
+  httpd_resp_set_hdr(req, "Cache-Control", INDEX_CACHE_CONTROL);
+
+  if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match,
+                                  sizeof(if_none_match)) == ESP_OK &&
+      strstr(if_none_match, etag) != NULL) {
+    httpd_resp_set_status(req, "304 Not Modified");
+    return httpd_resp_send(req, NULL, 0);
+  }
+
+  httpd_resp_set_type(req, "text/html; charset=utf-8");
+  httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+  httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+  return httpd_resp_send(req, (const char *)index_html_gz_start,
+                         index_html_gz_end - index_html_gz_start);
+}
+
+// ==========================================
+// Camera Idle Power-Down (power_policy.h)
+// ==========================================
+static httpd_handle_t s_server = NULL;
+
+static bool camera_busy(void) {
+  portENTER_CRITICAL(&s_stream_lock);
+  int streams = stream_count_locked();
+  portEXIT_CRITICAL(&s_stream_lock);
+  // Armed motion detection needs frames to see motion and record clips;
+  // disarmed it doesn't hold the camera
+  return streams > 0 || motion_detect_armed();
+}
+
+// Runs on the httpd task, like every other camera state change
+static void camera_idle_work(void *arg) {
+  if (!camera_busy()) {
+    deinit_camera();
+  }
+}
+
+static void camera_idle(void) {
+  if (s_server != NULL) {
+    httpd_queue_work(s_server, camera_idle_work, NULL);
+  }
 }
 
 // ==========================================
 // Server Initialization
 // ==========================================
+// Request and socket counts for /api/metrics, e.g. to compare dashboard
+// polling with the event push (tools/push_vs_poll.py)
+static esp_err_t counted_handler(httpd_req_t *req) {
+  metrics_add(METRICS_HTTP_REQUESTS, 1);
+  return ((esp_err_t(*)(httpd_req_t *))req->user_ctx)(req);
+}
+
+static void register_uri(httpd_handle_t server, httpd_uri_t *uri) {
+  uri->user_ctx = (void *)uri->handler;
+  uri->handler = counted_handler;
+  httpd_register_uri_handler(server, uri);
+}
+
+static esp_err_t socket_opened(httpd_handle_t hd, int sockfd) {
+  metrics_add(METRICS_HTTP_SOCKETS_OPENED, 1);
+  return ESP_OK;
+}
+
+// Replaces the server's own close, so it has to close the socket
+static void socket_closed(httpd_handle_t hd, int sockfd) {
+  metrics_add(METRICS_HTTP_SOCKETS_CLOSED, 1);
+  close(sockfd);
+}
+
 static httpd_handle_t start_webserver(void) {
   httpd_handle_t server = NULL;
   httpd_config_t config = HTTPD_DEFAULT_CONFIG();
   config.lru_purge_enable = true;
+  // Streams and event clients hold their socket for as long as they are
+  // connected; leave room for the API requests next to them
+  config.max_open_sockets = HTTPD_ASYNC_WORKERS + EVENT_PUSH_MAX_CLIENTS + 4;
+  config.max_uri_handlers = 32;
+  // /api/clips/<id>
+  config.uri_match_fn = httpd_uri_match_wildcard;
+  config.open_fn = socket_opened;
+  config.close_fn = socket_closed;
+  const task_config_t *httpd_task = task_topology_config(TASK_HTTPD);
+  config.core_id = httpd_task->core;
+  config.task_priority = httpd_task->priority;
+  config.stack_size = httpd_task->stack;
 
   ESP_LOGI(TAG, "Starting web server on port: '%d'", config.server_port);
   if (httpd_start(&server, &config) == ESP_OK) {
     // URI Handlers
     httpd_uri_t index_uri = {
         .uri = "/", .method = HTTP_GET, .handler = index_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &index_uri);
+    register_uri(server, &index_uri);
 
     httpd_uri_t stream_uri = {
         .uri = "/stream", .method = HTTP_GET, .handler = stream_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &stream_uri);
+    register_uri(server, &stream_uri);
+
+    httpd_uri_t capture_uri = {
+        .uri = "/capture", .method = HTTP_GET, .handler = capture_handler, .user_ctx = NULL};
+    register_uri(server, &capture_uri);
 
     httpd_uri_t ammonia_uri = {
         .uri = "/api/ammonia", .method = HTTP_GET, .handler = ammonia_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &ammonia_uri);
+    register_uri(server, &ammonia_uri);
+
+    httpd_uri_t calibrate_uri = {
+        .uri = "/api/ammonia/calibrate", .method = HTTP_GET, .handler = mq137_ppm_status_handler, .user_ctx = NULL};
+    register_uri(server, &calibrate_uri);
+
+    httpd_uri_t calibrate_set_uri = {
+        .uri = "/api/ammonia/calibrate", .method = HTTP_POST, .handler = mq137_ppm_calibrate_handler, .user_ctx = NULL};
+    register_uri(server, &calibrate_set_uri);
 
     httpd_uri_t sht30_uri = {
         .uri = "/api/sht30", .method = HTTP_GET, .handler = sht30_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &sht30_uri);
+    register_uri(server, &sht30_uri);
+
+    httpd_uri_t sensors_uri = {
+        .uri = "/api/sensors", .method = HTTP_GET, .handler = sensors_handler, .user_ctx = NULL};
+    register_uri(server, &sensors_uri);
+
+    httpd_uri_t events_uri = {
+        .uri = "/api/events", .method = HTTP_GET, .handler = event_push_handler, .user_ctx = NULL};
+    register_uri(server, &events_uri);
 
     httpd_uri_t cam_on_uri = {
         .uri = "/api/camera/on", .method = HTTP_GET, .handler = camera_on_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &cam_on_uri);
+    register_uri(server, &cam_on_uri);
 
     httpd_uri_t cam_off_uri = {
         .uri = "/api/camera/off", .method = HTTP_GET, .handler = camera_off_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &cam_off_uri);
+    register_uri(server, &cam_off_uri);
 
     httpd_uri_t cam_status_uri = {
         .uri = "/api/camera/status", .method = HTTP_GET, .handler = camera_status_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &cam_status_uri);
+    register_uri(server, &cam_status_uri);
+
+    httpd_uri_t stream_clients_uri = {
+        .uri = "/api/stream/clients", .method = HTTP_GET, .handler = stream_clients_handler, .user_ctx = NULL};
+    register_uri(server, &stream_clients_uri);
+
+    httpd_uri_t quality_uri = {
+        .uri = "/api/stream/quality", .method = HTTP_GET, .handler = stream_quality_handler, .user_ctx = NULL};
+    register_uri(server, &quality_uri);
+
+    httpd_uri_t history_uri = {
+        .uri = "/api/history", .method = HTTP_GET, .handler = history_handler, .user_ctx = NULL};
+    register_uri(server, &history_uri);
+
+    httpd_uri_t motion_uri = {
+        .uri = "/api/motion", .method = HTTP_GET, .handler = motion_handler, .user_ctx = NULL};
+    register_uri(server, &motion_uri);
+
+    httpd_uri_t motion_set_uri = {
+        .uri = "/api/motion", .method = HTTP_POST, .handler = motion_set_handler, .user_ctx = NULL};
+    register_uri(server, &motion_set_uri);
+
+    httpd_uri_t i2c_uri = {
+        .uri = "/api/i2c", .method = HTTP_GET, .handler = i2c_stats_handler, .user_ctx = NULL};
+    register_uri(server, &i2c_uri);
+
+    httpd_uri_t metrics_uri = {
+        .uri = "/api/metrics", .method = HTTP_GET, .handler = metrics_handler, .user_ctx = NULL};
+    register_uri(server, &metrics_uri);
+
+    httpd_uri_t clips_uri = {
+        .uri = "/api/clips", .method = HTTP_GET, .handler = clip_recorder_list_handler, .user_ctx = NULL};
+    register_uri(server, &clips_uri);
+
+    httpd_uri_t clip_play_uri = {
+        .uri = "/api/clips/*", .method = HTTP_GET, .handler = clip_recorder_play_handler, .user_ctx = NULL};
+    register_uri(server, &clip_play_uri);
+
+    httpd_uri_t tasks_uri = {
+        .uri = "/api/tasks", .method = HTTP_GET, .handler = task_topology_handler, .user_ctx = NULL};
+    register_uri(server, &tasks_uri);
+
+    httpd_uri_t power_uri = {
+        .uri = "/api/power", .method = HTTP_GET, .handler = power_policy_handler, .user_ctx = NULL};
+    register_uri(server, &power_uri);
+
+    httpd_uri_t power_set_uri = {
+        .uri = "/api/power", .method = HTTP_POST, .handler = power_policy_set_handler, .user_ctx = NULL};
+    register_uri(server, &power_set_uri);
+
+    httpd_uri_t telemetry_uri = {
+        .uri = "/api/telemetry", .method = HTTP_GET, .handler = telemetry_handler, .user_ctx = NULL};
+    register_uri(server, &telemetry_uri);
+
+    httpd_uri_t bulk_uri = {
+        .uri = "/api/v1/bulk", .method = HTTP_GET, .handler = bulk_handler, .user_ctx = NULL};
+    register_uri(server, &bulk_uri);
+
+    httpd_uri_t alarms_uri = {
+        .uri = "/api/alarms", .method = HTTP_GET, .handler = alarm_engine_get_handler, .user_ctx = NULL};
+    register_uri(server, &alarms_uri);
+
+    httpd_uri_t alarms_set_uri = {
+        .uri = "/api/alarms", .method = HTTP_POST, .handler = alarm_engine_set_handler, .user_ctx = NULL};
+    register_uri(server, &alarms_set_uri);
 
     return server;
   }
@@ -679,13 +1570,33 @@ void app_main(void) {
     return;
   }
 
-  // Turn on camera power immediately to let it stabilize
-  axp313a_camera_power_on();
+  // The camera starts disabled: keep its rail off until it is turned on
+  axp313a_camera_power_off();
+  if (axp313a_verify() != ESP_OK) {
+    ESP_LOGW(TAG, "AXP313A readback does not match the requested state");
+  }
+
+  // Sensor history lives in PSRAM; sensors keep running without it
+  if (sensor_history_init() != ESP_OK) {
+    ESP_LOGW(TAG, "Sensor history unavailable");
+  }
+  // Rules are evaluated from the sensor tasks; start before them
+  if (alarm_engine_init() != ESP_OK) {
+    ESP_LOGW(TAG, "Alarm engine unavailable");
+  }
 
   // Step 3: Initialize MQ-137 Ammonia Sensor
   ESP_LOGI(TAG, "Step 3: Initializing MQ-137 ADC...");
-  init_mq137_adc();
-  xTaskCreate(mq137_task, "mq137_task", 2048, NULL, 5, NULL);
+  mq137_adc_config_t mq137_config = MQ137_ADC_DEFAULT_CONFIG();
+  if (mq137_ppm_init() != ESP_OK) {
+    ESP_LOGW(TAG, "MQ-137 ppm conversion unavailable");
+  }
+  if (mq137_adc_init(&mq137_config) != ESP_OK) {
+    ESP_LOGE(TAG, "MQ-137 ADC initialization failed");
+  } else {
+    task_topology_set_period(TASK_MQ137, mq137_config.publish_interval_ms);
+    task_topology_create(TASK_MQ137, mq137_task, NULL, NULL);
+  }
 
   // Step 4: Initialize SHT30 temperature & humidity sensor
   ESP_LOGI(TAG, "Step 4: Initializing SHT30 sensor (SDA=IO16, SCL=IO17)...");
@@ -693,16 +1604,46 @@ void app_main(void) {
   if (ret != ESP_OK) {
     ESP_LOGW(TAG, "SHT30 initialization failed (sensor may not be connected)");
   } else {
-    xTaskCreate(sht30_task, "sht30_task", 2048, NULL, 5, NULL);
+    task_topology_create(TASK_SHT30, sht30_task, NULL, NULL);
     ESP_LOGI(TAG, "SHT30 reading task started");
   }
 
+  // Camera frames are captured once and shared by all stream viewers
+  frame_broadcaster_init(&s_camera_source);
+  s_quality_lock = xSemaphoreCreateMutex();
+  quality_ctrl_init(&s_quality_ctrl, STREAM_QUALITY_LEVELS, 0,
+                    esp_timer_get_time());
+  frame_cache_init();
+  if (motion_detect_init() != ESP_OK) {
+    ESP_LOGW(TAG, "Motion detection unavailable");
+  }
+  clip_recorder_init();
+
   // Step 5: Connect to WiFi
   ESP_LOGI(TAG, "Step 5: Connecting to WiFi...");
   if (wifi_init_sta() == ESP_OK) {
     // Step 6: Start HTTP Server
     ESP_LOGI(TAG, "Step 6: Starting Web Server...");
-    start_webserver();
+    httpd_async_init();
+    event_push_init();
+    s_server = start_webserver();
+
+    // Step 7: Telemetry publisher
+    telemetry_config_t telemetry_config = TELEMETRY_DEFAULT_CONFIG();
+    telemetry_config.broker_uri = MQTT_BROKER_URI;
+    if (telemetry_init(&telemetry_config) != ESP_OK) {
+      ESP_LOGW(TAG, "MQTT telemetry disabled");
+    }
+  }
+
+  // Step 8: Power policy (DFS, light sleep, modem sleep, camera idle-off)
+  power_policy_config_t power_config = POWER_POLICY_DEFAULT_CONFIG();
+  power_policy_hooks_t power_hooks = {
+      .camera_busy = camera_busy,
+      .camera_idle = camera_idle,
+  };
+  if (power_policy_init(&power_config, &power_hooks) != ESP_OK) {
+    ESP_LOGW(TAG, "Power policy unavailable");
   }
 
   ESP_LOGI(TAG, "System ready! IP: %s", s_ip_addr);
@@ -0,0 +1,311 @@
+#include "metrics.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "i2c_bus.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "Metrics";
+
+#define METRICS_PREFIX "smartcoop_"
+
+// Histogram bucket upper bounds in microseconds (100 us .. 1 s)
+static const uint32_t s_bounds_us[] = {
+    100,   250,    500,    1000,   2500,   5000,   10000,
+    25000, 50000, 100000, 250000, 500000, 1000000,
+};
+#define METRICS_BUCKETS (sizeof(s_bounds_us) / sizeof(s_bounds_us[0]))
+
+typedef struct {
+  uint32_t buckets[METRICS_BUCKETS + 1]; // Last one is +Inf
+  uint32_t sum_us;
+} histogram_t;
+
+typedef struct {
+  const char *name;
+  const char *help;
+} metric_desc_t;
+
+static const metric_desc_t s_counter_desc[METRICS_COUNTER_COUNT] = {
+    [METRICS_STREAM_FRAMES] = {"stream_frames_total",
+                               "Frames written to stream viewers"},
+    [METRICS_STREAM_BYTES] = {"stream_bytes_total",
+                              "JPEG bytes written to stream viewers"},
+    [METRICS_STREAM_DROPPED] = {"stream_frames_dropped_total",
+                                "Frames skipped for backed-up viewers"},
+    [METRICS_CAMERA_ERRORS] = {"camera_capture_errors_total",
+                               "Camera frame grabs that returned no frame"},
+    [METRICS_SHT30_ERRORS] = {"sht30_read_errors_total",
+                              "Failed SHT30 reads"},
+    [METRICS_ADC_ERRORS] = {"adc_read_errors_total",
+                            "Failed MQ-137 ADC reads"},
+    [METRICS_HTTP_REQUESTS] = {"http_requests_total",
+                               "Requests dispatched by the web server"},
+    [METRICS_HTTP_SOCKETS_OPENED] = {"http_sockets_opened_total",
+                                     "Client connections accepted"},
+    [METRICS_HTTP_SOCKETS_CLOSED] = {"http_sockets_closed_total",
+                                     "Client connections closed"},
+};
+
+static const metric_desc_t s_hist_desc[METRICS_HIST_COUNT] = {
+    [METRICS_HIST_CAMERA_FB_GET] = {"camera_fb_get_seconds",
+                                    "Wait for a camera frame buffer"},
+    [METRICS_HIST_STREAM_SEND] = {"stream_send_seconds",
+                                  "Socket write time per stream frame"},
+    [METRICS_HIST_SHT30_READ] = {"sht30_read_seconds",
+                                 "SHT30 read call duration"},
+    [METRICS_HIST_ADC_READ] = {"adc_read_seconds",
+                               "MQ-137 ADC read duration, incl. DMA wait"},
+};
+
+// Written by the hot paths with relaxed atomics only
+static uint32_t s_counters[METRICS_COUNTER_COUNT];
+static histogram_t s_hists[METRICS_HIST_COUNT];
+static uint32_t s_wifi_disconnects[256];
+
+// 64-bit extensions of the wrapping values, updated at export
+static uint64_t s_counter_ext[METRICS_COUNTER_COUNT];
+static uint64_t s_sum_ext[METRICS_HIST_COUNT];
+static portMUX_TYPE s_export_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void metrics_add(metrics_counter_t counter, uint32_t n) {
+  __atomic_fetch_add(&s_counters[counter], n, __ATOMIC_RELAXED);
+}
+
+void metrics_observe_us(metrics_hist_t hist, uint32_t us) {
+  histogram_t *h = &s_hists[hist];
+  size_t i = 0;
+  while (i < METRICS_BUCKETS && us > s_bounds_us[i]) {
+    i++;
+  }
+  __atomic_fetch_add(&h->buckets[i], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&h->sum_us, us, __ATOMIC_RELAXED);
+}
+
+void metrics_wifi_disconnect(uint8_t reason) {
+  __atomic_fetch_add(&s_wifi_disconnects[reason], 1, __ATOMIC_RELAXED);
+}
+
+// Extend a wrapping 32-bit value, given its last 64-bit reading
+static uint64_t extend(uint32_t now, uint64_t *last) {
+  uint64_t value = (*last & ~(uint64_t)UINT32_MAX) | now;
+  if (value < *last) {
+    value += (uint64_t)1 << 32;
+  }
+  *last = value;
+  return value;
+}
+
+// ------------------------------------------
+// Export
+// ------------------------------------------
+#define OUT_BUF_SIZE 1024
+#define OUT_LINE_MAX 192 // Flush when less than this is left
+
+typedef struct {
+  httpd_req_t *req;
+  esp_err_t err;
+  size_t len;
+  char buf[OUT_BUF_SIZE];
+} out_t;
+
+static void emit(out_t *out, const char *fmt, ...) {
+  if (out->err != ESP_OK) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(&out->buf[out->len], OUT_BUF_SIZE - out->len, fmt, args);
+  va_end(args);
+  // Lines are shorter than OUT_LINE_MAX, so nothing is ever truncated
+  if (n > 0) {
+    out->len += n;
+  }
+  if (OUT_BUF_SIZE - out->len < OUT_LINE_MAX) {
+    out->err = httpd_resp_send_chunk(out->req, out->buf, out->len);
+    out->len = 0;
+  }
+}
+
+static void emit_header(out_t *out, const char *name, const char *help,
+                        const char *type) {
+  emit(out, "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s %s\n",
+       name, help, name, type);
+}
+
+static void emit_histogram(out_t *out, const metric_desc_t *desc,
+                           const histogram_t *h, uint64_t *sum_ext) {
+  emit_header(out, desc->name, desc->help, "histogram");
+
+  // Cumulative counts; the total is taken from the buckets so +Inf always
+  // equals _count even while observations come in
+  uint32_t buckets[METRICS_BUCKETS + 1];
+  for (size_t i = 0; i <= METRICS_BUCKETS; i++) {
+    buckets[i] = __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+  }
+  uint32_t sum = __atomic_load_n(&h->sum_us, __ATOMIC_RELAXED);
+  portENTER_CRITICAL(&s_export_lock);
+  uint64_t sum_us = extend(sum, sum_ext);
+  portEXIT_CRITICAL(&s_export_lock);
+
+  uint64_t total = 0;
+  for (size_t i = 0; i < METRICS_BUCKETS; i++) {
+    total += buckets[i];
+    emit(out, METRICS_PREFIX "%s_bucket{le=\"%g\"} %llu\n", desc->name,
+         s_bounds_us[i] / 1e6, (unsigned long long)total);
+  }
+  total += buckets[METRICS_BUCKETS];
+  emit(out,
+       METRICS_PREFIX "%s_bucket{le=\"+Inf\"} %llu\n" METRICS_PREFIX
+                      "%s_sum %.6f\n" METRICS_PREFIX "%s_count %llu\n",
+       desc->name, (unsigned long long)total, desc->name, sum_us / 1e6,
+       desc->name, (unsigned long long)total);
+}
+
+static void emit_heap(out_t *out) {
+  static const struct {
+    const char *region;
+    uint32_t caps;
+  } regions[] = {
+      {"internal", MALLOC_CAP_INTERNAL},
+      {"psram", MALLOC_CAP_SPIRAM},
+  };
+
+  emit_header(out, "heap_free_bytes", "Free heap", "gauge");
+  for (size_t i = 0; i < 2; i++) {
+    emit(out, METRICS_PREFIX "heap_free_bytes{region=\"%s\"} %u\n",
+         regions[i].region,
+         (unsigned)heap_caps_get_free_size(regions[i].caps));
+  }
+  emit_header(out, "heap_min_free_bytes", "Low-water mark of free heap",
+              "gauge");
+  for (size_t i = 0; i < 2; i++) {
+    emit(out, METRICS_PREFIX "heap_min_free_bytes{region=\"%s\"} %u\n",
+         regions[i].region,
+         (unsigned)heap_caps_get_minimum_free_size(regions[i].caps));
+  }
+  emit_header(out, "heap_largest_free_block_bytes",
+              "Largest allocatable block", "gauge");
+  for (size_t i = 0; i < 2; i++) {
+    emit(out,
+         METRICS_PREFIX "heap_largest_free_block_bytes{region=\"%s\"} %u\n",
+         regions[i].region,
+         (unsigned)heap_caps_get_largest_free_block(regions[i].caps));
+  }
+}
+
+// Needs CONFIG_FREERTOS_USE_TRACE_FACILITY (sdkconfig.defaults)
+static void emit_tasks(out_t *out) {
+  UBaseType_t count = uxTaskGetNumberOfTasks() + 2; // Room for new tasks
+  TaskStatus_t *tasks = malloc(count * sizeof(TaskStatus_t));
+  if (tasks == NULL) {
+    ESP_LOGW(TAG, "No memory for the task list");
+    return;
+  }
+  count = uxTaskGetSystemState(tasks, count, NULL);
+
+  emit_header(out, "task_stack_high_water_bytes",
+              "Least free stack seen per task", "gauge");
+  for (UBaseType_t i = 0; i < count; i++) {
+    // Task names are not unique (async workers), the task number is
+    emit(out,
+         METRICS_PREFIX
+         "task_stack_high_water_bytes{task=\"%s\",id=\"%u\"} %lu\n",
+         tasks[i].pcTaskName, (unsigned)tasks[i].xTaskNumber,
+         (unsigned long)tasks[i].usStackHighWaterMark);
+  }
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  // Microseconds of esp_timer in a 32-bit counter: wraps every ~71 minutes,
+  // so only differences between nearby scrapes are meaningful
+  emit_header(out, "task_cpu_seconds_total",
+              "CPU time per task, wraps at 2^32 us", "counter");
+  for (UBaseType_t i = 0; i < count; i++) {
+    emit(out,
+         METRICS_PREFIX "task_cpu_seconds_total{task=\"%s\",id=\"%u\"} "
+                        "%.6f\n",
+         tasks[i].pcTaskName, (unsigned)tasks[i].xTaskNumber,
+         (uint32_t)tasks[i].ulRunTimeCounter / 1e6);
+  }
+#endif
+  free(tasks);
+}
+
+static void emit_i2c(out_t *out) {
+  i2c_bus_stats_t stats;
+  i2c_bus_get_stats(&stats);
+  emit_header(out, "i2c_transactions_total", "Shared I2C bus transactions",
+              "counter");
+  emit(out, METRICS_PREFIX "i2c_transactions_total %lu\n",
+       (unsigned long)stats.transactions);
+  emit_header(out, "i2c_errors_total", "Failed I2C bus transactions",
+              "counter");
+  emit(out, METRICS_PREFIX "i2c_errors_total %lu\n",
+       (unsigned long)stats.errors);
+  emit_header(out, "i2c_busy_seconds_total", "Time spent in I2C transactions",
+              "counter");
+  emit(out, METRICS_PREFIX "i2c_busy_seconds_total %.6f\n",
+       stats.total_us / 1e6);
+}
+
+static void emit_wifi(out_t *out) {
+  emit_header(out, "wifi_disconnects_total",
+              "WiFi station disconnects by reason code", "counter");
+  for (int reason = 0; reason < 256; reason++) {
+    uint32_t n =
+        __atomic_load_n(&s_wifi_disconnects[reason], __ATOMIC_RELAXED);
+    if (n > 0) {
+      emit(out, METRICS_PREFIX "wifi_disconnects_total{reason=\"%d\"} %lu\n",
+           reason, (unsigned long)n);
+    }
+  }
+}
+
+esp_err_t metrics_handler(httpd_req_t *req) {
+  out_t *out = malloc(sizeof(out_t));
+  if (out == NULL) {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                               "Out of memory");
+  }
+  out->req = req;
+  out->err = ESP_OK;
+  out->len = 0;
+
+  httpd_resp_set_type(req, "text/plain; version=0.0.4");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+  emit_header(out, "uptime_seconds", "Time since boot", "gauge");
+  emit(out, METRICS_PREFIX "uptime_seconds %.3f\n",
+       esp_timer_get_time() / 1e6);
+
+  for (int i = 0; i < METRICS_COUNTER_COUNT; i++) {
+    uint32_t now = __atomic_load_n(&s_counters[i], __ATOMIC_RELAXED);
+    portENTER_CRITICAL(&s_export_lock);
+    uint64_t value = extend(now, &s_counter_ext[i]);
+    portEXIT_CRITICAL(&s_export_lock);
+    emit_header(out, s_counter_desc[i].name, s_counter_desc[i].help,
+                "counter");
+    emit(out, METRICS_PREFIX "%s %llu\n", s_counter_desc[i].name,
+         (unsigned long long)value);
+  }
+  for (int i = 0; i < METRICS_HIST_COUNT; i++) {
+    emit_histogram(out, &s_hist_desc[i], &s_hists[i], &s_sum_ext[i]);
+  }
+  emit_heap(out);
+  emit_tasks(out);
+  emit_i2c(out);
+  emit_wifi(out);
+
+  esp_err_t err = out->err;
+  if (err == ESP_OK && out->len > 0) {
+    err = httpd_resp_send_chunk(req, out->buf, out->len);
+  }
+  if (err == ESP_OK) {
+    err = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  free(out);
+  return err;
+}
@@ -0,0 +1,66 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stdint.h>
+
+/**
+ * @brief Runtime metrics, exported at /api/metrics in Prometheus text format
+ *
+ * Hot paths only bump 32-bit counters with relaxed atomic adds, which are
+ * native on the ESP32-S3, so recording never takes a lock. Counters that
+ * can wrap (bytes, microsecond sums) are extended to 64 bits when they are
+ * exported, which is exact as long as they are scraped at least once per
+ * wrap (about 70 minutes for a sum of send times at full duty).
+ *
+ * Gauges that are cheap to read on demand (heap, task stacks and CPU time,
+ * I2C bus statistics) are sampled at export time and cost nothing in
+ * between.
+ */
+
+typedef enum {
+  METRICS_STREAM_FRAMES = 0,   // Frames written to stream viewers
+  METRICS_STREAM_BYTES,        // JPEG bytes written to stream viewers
+  METRICS_STREAM_DROPPED,      // Frames skipped for backed-up viewers
+  METRICS_CAMERA_ERRORS,       // esp_camera_fb_get() returning no frame
+  METRICS_SHT30_ERRORS,        // Failed SHT30 reads
+  METRICS_ADC_ERRORS,          // Failed MQ-137 ADC reads
+  METRICS_HTTP_REQUESTS,       // Requests dispatched by the web server
+  METRICS_HTTP_SOCKETS_OPENED, // Client connections accepted
+  METRICS_HTTP_SOCKETS_CLOSED, // Client connections closed
+  METRICS_COUNTER_COUNT
+} metrics_counter_t;
+
+typedef enum {
+  METRICS_HIST_CAMERA_FB_GET = 0, // Wait in esp_camera_fb_get()
+  METRICS_HIST_STREAM_SEND,       // Socket write time per frame
+  METRICS_HIST_SHT30_READ,        // sht30_fetch()/sht30_read() call
+  METRICS_HIST_ADC_READ,          // mq137_adc_read() call, incl. DMA wait
+  METRICS_HIST_COUNT
+} metrics_hist_t;
+
+/**
+ * @brief Add to a counter
+ */
+void metrics_add(metrics_counter_t counter, uint32_t n);
+
+/**
+ * @brief Record a duration in a histogram
+ *
+ * @param hist Histogram
+ * @param us Duration in microseconds
+ */
+void metrics_observe_us(metrics_hist_t hist, uint32_t us);
+
+/**
+ * @brief Count a WiFi station disconnect by its reason code
+ */
+void metrics_wifi_disconnect(uint8_t reason);
+
+/**
+ * @brief URI handler for GET /api/metrics
+ */
+esp_err_t metrics_handler(httpd_req_t *req);
+
+#endif // METRICS_H
@@ -0,0 +1,106 @@
+#include "mjpeg_framing.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "MJPEG";
+
+static const char PART_PREFIX[] = "\r\n--" MJPEG_PART_BOUNDARY "\r\n"
+                                  "Content-Type: image/jpeg\r\n"
+                                  "Content-Length: ";
+
+static const char RESPONSE_HEADER[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: multipart/x-mixed-replace;boundary=" MJPEG_PART_BOUNDARY
+    "\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Cache-Control: no-cache, no-store\r\n"
+    "Connection: close\r\n"
+    "X-Framerate: %d\r\n"
+    "\r\n";
+
+size_t mjpeg_part_header(char *buf, size_t jpeg_len) {
+  memcpy(buf, PART_PREFIX, sizeof(PART_PREFIX) - 1);
+  size_t pos = sizeof(PART_PREFIX) - 1;
+
+  // Decimal length, written backwards into a scratch buffer
+  char digits[20];
+  int n = 0;
+  do {
+    digits[n++] = (char)('0' + jpeg_len % 10);
+    jpeg_len /= 10;
+  } while (jpeg_len > 0);
+  while (n > 0) {
+    buf[pos++] = digits[--n];
+  }
+
+  memcpy(&buf[pos], "\r\n\r\n", 4);
+  return pos + 4;
+}
+
+// Write every vector completely, resuming after partial writes
+static esp_err_t write_all(int sockfd, struct iovec *iov, int iovcnt) {
+  while (iovcnt > 0) {
+    ssize_t written = lwip_writev(sockfd, iov, iovcnt);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ESP_LOGD(TAG, "Socket write failed: errno %d", errno);
+      return ESP_FAIL;
+    }
+
+    size_t n = (size_t)written;
+    while (iovcnt > 0 && n >= iov->iov_len) {
+      n -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (uint8_t *)iov->iov_base + n;
+      iov->iov_len -= n;
+    }
+  }
+  return ESP_OK;
+}
+
+esp_err_t mjpeg_send_response_header(int sockfd, int framerate) {
+  char header[sizeof(RESPONSE_HEADER) + 16];
+  int len = snprintf(header, sizeof(header), RESPONSE_HEADER, framerate);
+
+  struct iovec iov = {.iov_base = header, .iov_len = (size_t)len};
+  return write_all(sockfd, &iov, 1);
+}
+
+esp_err_t mjpeg_send_frame(int sockfd, const uint8_t *jpeg, size_t len) {
+  char part[MJPEG_PART_HDR_MAX];
+  size_t hlen = mjpeg_part_header(part, len);
+
+  struct iovec iov[2] = {
+      {.iov_base = part, .iov_len = hlen},
+      {.iov_base = (void *)jpeg, .iov_len = len},
+  };
+  return write_all(sockfd, iov, 2);
+}
+
+esp_err_t mjpeg_send_part_header(int sockfd, size_t len) {
+  char part[MJPEG_PART_HDR_MAX];
+  struct iovec iov = {.iov_base = part,
+                      .iov_len = mjpeg_part_header(part, len)};
+  return write_all(sockfd, &iov, 1);
+}
+
+esp_err_t mjpeg_send_data(int sockfd, const uint8_t *data, size_t len) {
+  struct iovec iov = {.iov_base = (void *)data, .iov_len = len};
+  return write_all(sockfd, &iov, 1);
+}
+
+bool mjpeg_socket_writable(int sockfd) {
+  fd_set wfds;
+  FD_ZERO(&wfds);
+  FD_SET(sockfd, &wfds);
+  struct timeval tv = {.tv_sec = 0, .tv_usec = 0};
+  return lwip_select(sockfd + 1, NULL, &wfds, NULL, &tv) > 0;
+}
@@ -0,0 +1,89 @@
+#ifndef MJPEG_FRAMING_H
+#define MJPEG_FRAMING_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief MJPEG (multipart/x-mixed-replace) framing on a raw socket
+ *
+ * The stream is written directly to the connection socket instead of going
+ * through httpd's chunked transfer encoding: one response header, then per
+ * frame a single gathered write of the part header and the JPEG payload,
+ * straight from the (PSRAM) frame buffer without intermediate copies.
+ */
+
+#define MJPEG_PART_BOUNDARY "123456789000000000000987654321"
+
+// Large enough for the boundary, part headers and a 10-digit length
+#define MJPEG_PART_HDR_MAX 128
+
+/**
+ * @brief Build the per-frame part header
+ *
+ * Produces "\r\n--<boundary>\r\nContent-Type: image/jpeg\r\n
+ * Content-Length: <len>\r\n\r\n" without going through snprintf.
+ *
+ * @param buf Output buffer of at least MJPEG_PART_HDR_MAX bytes
+ * @param jpeg_len Length of the JPEG payload that follows
+ * @return Header length in bytes (not NUL terminated)
+ */
+size_t mjpeg_part_header(char *buf, size_t jpeg_len);
+
+/**
+ * @brief Send the HTTP response header that opens the stream
+ *
+ * The connection is marked "Connection: close": the body ends when the
+ * socket is closed, so no chunked encoding is needed.
+ *
+ * @param sockfd Connection socket
+ * @param framerate Frame rate hint sent in X-Framerate
+ * @return ESP_OK on success, ESP_FAIL if the socket write failed
+ */
+esp_err_t mjpeg_send_response_header(int sockfd, int framerate);
+
+/**
+ * @brief Send one frame as a single gathered socket write
+ *
+ * @param sockfd Connection socket
+ * @param jpeg JPEG data
+ * @param len JPEG length
+ * @return ESP_OK on success, ESP_FAIL if the socket write failed
+ */
+esp_err_t mjpeg_send_frame(int sockfd, const uint8_t *jpeg, size_t len);
+
+/**
+ * @brief Send only the part header of a frame
+ *
+ * For frames that are not in memory as a whole: follow up with the payload
+ * in pieces through mjpeg_send_data().
+ *
+ * @param sockfd Connection socket
+ * @param len Length of the JPEG payload that follows
+ * @return ESP_OK on success, ESP_FAIL if the socket write failed
+ */
+esp_err_t mjpeg_send_part_header(int sockfd, size_t len);
+
+/**
+ * @brief Send raw payload bytes
+ *
+ * @param sockfd Connection socket
+ * @param data Payload
+ * @param len Payload length
+ * @return ESP_OK on success, ESP_FAIL if the socket write failed
+ */
+esp_err_t mjpeg_send_data(int sockfd, const uint8_t *data, size_t len);
+
+/**
+ * @brief Check whether the socket can take more data without blocking
+ *
+ * Used to drop a frame instead of queueing it behind a backed-up client.
+ *
+ * @param sockfd Connection socket
+ * @return true if the send buffer has room
+ */
+bool mjpeg_socket_writable(int sockfd);
+
+#endif // MJPEG_FRAMING_H
@@ -0,0 +1,252 @@
+#include "motion_detect.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "event_push.h"
+#include "frame_broadcaster.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "img_converters.h"
+#include "motion_kernel.h"
+#include "nvs.h"
+#include "task_topology.h"
+
+static const char *TAG = "Motion";
+
+#define MOTION_INTERVAL_MS 500
+
+#define NVS_NAMESPACE "motion"
+#define NVS_KEY_ARMED "armed"
+
+// Largest luma image analysed (1/8 of 1280x960)
+#define MOTION_MAX_W 160
+#define MOTION_MAX_H 120
+
+#define MOTION_PIXEL_THRESHOLD 25 // Luma difference counted as a change
+#define MOTION_CELL_MIN 8         // Changed pixels (of 32) for an active cell
+#define MOTION_SCORE_ON 15        // Per mille of changed pixels for motion
+// Above this nearly the whole scene changed at once: a light switch or an
+// exposure jump, not something moving
+#define MOTION_SCORE_GLOBAL 600
+#define MOTION_HOLD_US 5000000 // Event ends after this long without motion
+
+static uint8_t *s_rgb = NULL;  // Decoded RGB565, PSRAM
+static uint8_t *s_luma[2];     // Current and previous luma images
+static int s_ref_w = 0;        // Size of the previous luma image, 0 = none
+static int s_ref_h = 0;
+static uint16_t s_cells[MOTION_MAX_CELLS];
+static motion_blob_work_t s_blob_work;
+
+static volatile bool s_armed = false;
+static TaskHandle_t s_task = NULL;
+static motion_status_t s_status;
+static portMUX_TYPE s_status_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Width and height from the JPEG SOF marker
+static bool jpeg_dimensions(const uint8_t *buf, size_t len, int *w, int *h) {
+  size_t i = 2; // Skip SOI
+  while (i + 9 < len) {
+    if (buf[i] != 0xFF) {
+      return false;
+    }
+    uint8_t marker = buf[i + 1];
+    size_t seg_len = (buf[i + 2] << 8) | buf[i + 3];
+    if (marker == 0xC0 || marker == 0xC1 || marker == 0xC2) {
+      *h = (buf[i + 5] << 8) | buf[i + 6];
+      *w = (buf[i + 7] << 8) | buf[i + 8];
+      return true;
+    }
+    i += 2 + seg_len;
+  }
+  return false;
+}
+
+// Decode a frame to luma at 1/8 scale, cropped to whole cells. Returns
+// false if the frame cannot be used.
+static bool decode_luma(const shared_frame_t *frame, uint8_t *luma, int *w,
+                        int *h) {
+  int jw, jh;
+  if (!jpeg_dimensions(frame->buf, frame->len, &jw, &jh)) {
+    return false;
+  }
+  int sw = jw / 8;
+  int sh = jh / 8;
+  if (sw > MOTION_MAX_W || sh > MOTION_MAX_H) {
+    return false;
+  }
+  if (!jpg2rgb565(frame->buf, frame->len, s_rgb, JPG_SCALE_8X)) {
+    return false;
+  }
+
+  *w = sw - sw % MOTION_CELL_W;
+  *h = sh - sh % MOTION_CELL_H;
+  for (int y = 0; y < *h; y++) {
+    motion_rgb565_to_luma(&s_rgb[y * sw * 2], &luma[y * *w], *w);
+  }
+  return true;
+}
+
+static void update_status(uint16_t score, int blobs, int largest,
+                          uint32_t kernel_us) {
+  int64_t now = esp_timer_get_time();
+  bool moving =
+      score >= MOTION_SCORE_ON && score < MOTION_SCORE_GLOBAL && blobs > 0;
+  bool changed = false;
+
+  portENTER_CRITICAL(&s_status_lock);
+  s_status.score = score;
+  s_status.blobs = blobs;
+  s_status.largest_blob = largest;
+  s_status.frames++;
+  s_status.kernel_us = kernel_us;
+  if (moving) {
+    s_status.last_motion_us = now;
+    if (!s_status.active) {
+      s_status.active = true;
+      s_status.events++;
+      changed = true;
+    }
+  } else if (s_status.active &&
+             now - s_status.last_motion_us > MOTION_HOLD_US) {
+    s_status.active = false;
+    changed = true;
+  }
+  bool active = s_status.active;
+  uint32_t events = s_status.events;
+  portEXIT_CRITICAL(&s_status_lock);
+
+  if (changed) {
+    ESP_LOGI(TAG, "Motion %s (score %u, %d blobs)",
+             active ? "started" : "ended", score, blobs);
+    event_push_set_motion(active, events);
+  }
+}
+
+// Disarmed: an event in progress ends with it
+static void end_event(void) {
+  portENTER_CRITICAL(&s_status_lock);
+  bool was_active = s_status.active;
+  s_status.active = false;
+  uint32_t events = s_status.events;
+  portEXIT_CRITICAL(&s_status_lock);
+
+  if (was_active) {
+    event_push_set_motion(false, events);
+  }
+}
+
+static void motion_task(void *arg) {
+  uint32_t last_seq = 0;
+  int cur = 0;
+  bool subscribed = false;
+
+  while (true) {
+    bool armed = s_armed;
+    if (armed && !subscribed) {
+      subscribed = frame_broadcaster_subscribe() == ESP_OK;
+      if (!subscribed) {
+        ESP_LOGW(TAG, "No broadcaster slot, retrying");
+      }
+    } else if (!armed && subscribed) {
+      frame_broadcaster_unsubscribe();
+      subscribed = false;
+      s_ref_w = 0;
+      end_event();
+    }
+    if (!subscribed) {
+      // Woken by motion_detect_set_armed()
+      ulTaskNotifyTake(pdTRUE, armed ? pdMS_TO_TICKS(1000) : portMAX_DELAY);
+      continue;
+    }
+
+    const shared_frame_t *frame =
+        frame_broadcaster_acquire(last_seq, pdMS_TO_TICKS(1000));
+    if (frame == NULL) {
+      s_ref_w = 0; // Camera stopped; start over with a fresh reference
+      vTaskDelay(pdMS_TO_TICKS(MOTION_INTERVAL_MS));
+      continue;
+    }
+    last_seq = frame->seq;
+
+    int w, h;
+    bool ok = decode_luma(frame, s_luma[cur], &w, &h);
+    frame_broadcaster_release(frame);
+
+    if (ok && w == s_ref_w && h == s_ref_h) {
+      int64_t start = esp_timer_get_time();
+      uint32_t changed = motion_diff_cells(s_luma[cur], s_luma[cur ^ 1], w,
+                                           h, MOTION_PIXEL_THRESHOLD, s_cells);
+      int largest;
+      int blobs = motion_count_blobs(s_cells, w / MOTION_CELL_W,
+                                     h / MOTION_CELL_H, MOTION_CELL_MIN,
+                                     &s_blob_work, &largest);
+      uint32_t kernel_us = esp_timer_get_time() - start;
+      update_status(changed * 1000 / (w * h), blobs, largest, kernel_us);
+    }
+    if (ok) {
+      s_ref_w = w;
+      s_ref_h = h;
+      cur ^= 1;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(MOTION_INTERVAL_MS));
+  }
+}
+
+esp_err_t motion_detect_init(void) {
+  s_rgb = heap_caps_malloc(MOTION_MAX_W * MOTION_MAX_H * 2, MALLOC_CAP_SPIRAM);
+  s_luma[0] = heap_caps_malloc(MOTION_MAX_W * MOTION_MAX_H, MALLOC_CAP_SPIRAM);
+  s_luma[1] = heap_caps_malloc(MOTION_MAX_W * MOTION_MAX_H, MALLOC_CAP_SPIRAM);
+  if (s_rgb == NULL || s_luma[0] == NULL || s_luma[1] == NULL) {
+    ESP_LOGE(TAG, "Failed to allocate image buffers");
+    return ESP_ERR_NO_MEM;
+  }
+
+  nvs_handle_t nvs;
+  uint8_t armed;
+  if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+    if (nvs_get_u8(nvs, NVS_KEY_ARMED, &armed) == ESP_OK) {
+      s_armed = armed != 0;
+    }
+    nvs_close(nvs);
+  }
+  s_status.armed = s_armed;
+  ESP_LOGI(TAG, "Motion detection %s", s_armed ? "armed" : "disarmed");
+
+  return task_topology_create(TASK_MOTION, motion_task, NULL, &s_task);
+}
+
+esp_err_t motion_detect_set_armed(bool armed) {
+  s_armed = armed;
+  portENTER_CRITICAL(&s_status_lock);
+  s_status.armed = armed;
+  portEXIT_CRITICAL(&s_status_lock);
+  if (s_task != NULL) {
+    xTaskNotifyGive(s_task);
+  }
+  ESP_LOGI(TAG, "Motion detection %s", armed ? "armed" : "disarmed");
+
+  nvs_handle_t nvs;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (err == ESP_OK) {
+    err = nvs_set_u8(nvs, NVS_KEY_ARMED, armed);
+    if (err == ESP_OK) {
+      err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to save motion arming: %s", esp_err_to_name(err));
+  }
+  return err;
+}
+
+void motion_detect_get_status(motion_status_t *out) {
+  portENTER_CRITICAL(&s_status_lock);
+  *out = s_status;
+  portEXIT_CRITICAL(&s_status_lock);
+}
+
+bool motion_detect_active(void) { return s_status.active; }
+
+bool motion_detect_armed(void) { return s_armed; }
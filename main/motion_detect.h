@@ -0,0 +1,69 @@
+#ifndef MOTION_DETECT_H
+#define MOTION_DETECT_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Motion detection on downscaled camera frames
+ *
+ * While armed and the camera runs, a low-priority task takes a broadcaster
+ * frame twice a second, decodes it at 1/8 scale to a luma image (80x60 for
+ * VGA) and compares it with the previous one (see motion_kernel.h). Motion
+ * starts an event that lasts until the scene has been still for a few
+ * seconds.
+ *
+ * Arming is explicit and kept in NVS; the detector starts disarmed. Armed,
+ * it holds a broadcaster subscription and keeps the camera busy, so the
+ * power policy never powers it down. Disarmed, it lets go of both.
+ */
+
+typedef struct {
+  bool armed;             // See motion_detect_set_armed()
+  bool active;            // Inside a motion event
+  uint16_t score;         // Changed pixels in the last frame, per mille
+  int blobs;              // Connected regions of change in the last frame
+  int largest_blob;       // Size of the largest region, in cells
+  uint32_t events;        // Motion events since boot
+  int64_t last_motion_us; // Last frame with motion (esp_timer clock)
+  uint32_t frames;        // Frames analysed
+  uint32_t kernel_us;     // Difference + blob kernel time, last frame
+} motion_status_t;
+
+/**
+ * @brief Allocate the image buffers and create the detection task
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t motion_detect_init(void);
+
+/**
+ * @brief Copy the current detector state
+ */
+void motion_detect_get_status(motion_status_t *out);
+
+/**
+ * @brief Check whether a motion event is in progress
+ */
+bool motion_detect_active(void);
+
+/**
+ * @brief Arm or disarm the detector and store the choice in NVS
+ *
+ * Takes effect at once for motion_detect_armed(); the detection task
+ * subscribes to or leaves the broadcaster within a second.
+ *
+ * @param armed Detect motion
+ * @return ESP_OK on success, the NVS error if applied but not saved
+ */
+esp_err_t motion_detect_set_armed(bool armed);
+
+/**
+ * @brief Check whether the detector is armed
+ *
+ * The camera has to stay on while armed, or no motion is ever seen.
+ */
+bool motion_detect_armed(void);
+
+#endif // MOTION_DETECT_H
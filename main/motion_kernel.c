@@ -0,0 +1,121 @@
+#include "motion_kernel.h"
+#include <string.h>
+
+void motion_rgb565_to_luma(const uint8_t *rgb, uint8_t *luma, size_t pixels) {
+  for (size_t i = 0; i < pixels; i++) {
+    uint32_t p = ((uint32_t)rgb[2 * i] << 8) | rgb[2 * i + 1];
+    uint32_t r = (p >> 11) & 0x1F;
+    uint32_t g = (p >> 5) & 0x3F;
+    uint32_t b = p & 0x1F;
+    // BT.601 weights (77, 150, 29) / 256, folded with the 5/6-bit scaling
+    luma[i] = (uint8_t)((r * 616 + g * 600 + b * 232) >> 8);
+  }
+}
+
+uint32_t motion_diff_cells_ref(const uint8_t *cur, const uint8_t *ref,
+                               int width, int height, uint8_t threshold,
+                               uint16_t *cells) {
+  int cols = width / MOTION_CELL_W;
+  uint32_t total = 0;
+
+  memset(cells, 0, cols * (height / MOTION_CELL_H) * sizeof(uint16_t));
+  for (int y = 0; y < height; y++) {
+    uint16_t *row_cells = &cells[(y / MOTION_CELL_H) * cols];
+    for (int x = 0; x < width; x++) {
+      int d = cur[y * width + x] - ref[y * width + x];
+      if (d > threshold || -d > threshold) {
+        row_cells[x / MOTION_CELL_W]++;
+        total++;
+      }
+    }
+  }
+  return total;
+}
+
+// Flags bit 15 of each 16-bit lane whose two 8-bit values (x, y) differ by
+// more than the threshold baked into the biases. d = 256 + x - y stays in
+// 1..511, so neither the add nor the subtract carries across lanes.
+static inline uint32_t lanes_changed(uint32_t x, uint32_t y, uint32_t hi_bias,
+                                     uint32_t lo_bias) {
+  uint32_t d = (x | 0x01000100u) - y;
+  return ((d + hi_bias) | (lo_bias - d)) & 0x80008000u;
+}
+
+static inline int words_changed(uint32_t a, uint32_t b, uint32_t hi_bias,
+                                uint32_t lo_bias) {
+  uint32_t even = lanes_changed(a & 0x00FF00FFu, b & 0x00FF00FFu, hi_bias,
+                                lo_bias);
+  uint32_t odd = lanes_changed((a >> 8) & 0x00FF00FFu,
+                               (b >> 8) & 0x00FF00FFu, hi_bias, lo_bias);
+  // Flags sit on bits 15/31 and 14/30: one popcount for all four pixels
+  return __builtin_popcount(even | (odd >> 1));
+}
+
+uint32_t motion_diff_cells_swar(const uint8_t *cur, const uint8_t *ref,
+                                int width, int height, uint8_t threshold,
+                                uint16_t *cells) {
+  int cols = width / MOTION_CELL_W;
+  uint32_t total = 0;
+  // Lane d > 256 + t sets bit 15 of d + hi; d < 256 - t sets it in lo - d
+  uint32_t hi_bias = (0x7FFFu - 256 - threshold) * 0x00010001u;
+  uint32_t lo_bias = (0x8000u + 255 - threshold) * 0x00010001u;
+
+  memset(cells, 0, cols * (height / MOTION_CELL_H) * sizeof(uint16_t));
+  for (int y = 0; y < height; y++) {
+    const uint32_t *a = (const uint32_t *)(cur + y * width);
+    const uint32_t *b = (const uint32_t *)(ref + y * width);
+    uint16_t *row_cells = &cells[(y / MOTION_CELL_H) * cols];
+    for (int c = 0; c < cols; c++) {
+      // MOTION_CELL_W == 8: two words per cell
+      int n = words_changed(a[2 * c], b[2 * c], hi_bias, lo_bias) +
+              words_changed(a[2 * c + 1], b[2 * c + 1], hi_bias, lo_bias);
+      row_cells[c] += n;
+      total += n;
+    }
+  }
+  return total;
+}
+
+int motion_count_blobs(const uint16_t *cells, int cols, int rows,
+                       uint16_t min_count, motion_blob_work_t *work,
+                       int *largest) {
+  int n = cols * rows;
+  int blobs = 0;
+
+  *largest = 0;
+  memset(work->visited, 0, n);
+  for (int start = 0; start < n; start++) {
+    if (work->visited[start] || cells[start] < min_count) {
+      continue;
+    }
+
+    // Iterative flood fill; every cell is pushed at most once
+    int top = 0;
+    int size = 0;
+    work->visited[start] = 1;
+    work->stack[top++] = start;
+    while (top > 0) {
+      int i = work->stack[--top];
+      int x = i % cols;
+      int y = i / cols;
+      size++;
+
+      int neighbours[4] = {x > 0 ? i - 1 : -1, x < cols - 1 ? i + 1 : -1,
+                           y > 0 ? i - cols : -1,
+                           y < rows - 1 ? i + cols : -1};
+      for (int k = 0; k < 4; k++) {
+        int j = neighbours[k];
+        if (j >= 0 && !work->visited[j] && cells[j] >= min_count) {
+          work->visited[j] = 1;
+          work->stack[top++] = j;
+        }
+      }
+    }
+
+    blobs++;
+    if (size > *largest) {
+      *largest = size;
+    }
+  }
+  return blobs;
+}
@@ -0,0 +1,88 @@
+#ifndef MOTION_KERNEL_H
+#define MOTION_KERNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Motion-detection kernels on 8-bit luma images
+ *
+ * Plain C with no ESP-IDF dependency, so they can be built and exercised on
+ * a host. The frame difference is counted per cell of
+ * MOTION_CELL_W x MOTION_CELL_H pixels; cells with enough changed pixels
+ * are grouped into 4-connected blobs.
+ */
+
+#define MOTION_CELL_W 8
+#define MOTION_CELL_H 4
+
+// Largest grid motion_count_blobs() can label (160x120 luma image)
+#define MOTION_MAX_CELLS ((160 / MOTION_CELL_W) * (120 / MOTION_CELL_H))
+
+/**
+ * @brief Scratch space for motion_count_blobs()
+ */
+typedef struct {
+  uint8_t visited[MOTION_MAX_CELLS];
+  uint16_t stack[MOTION_MAX_CELLS];
+} motion_blob_work_t;
+
+/**
+ * @brief Convert big-endian RGB565 (as produced by jpg2rgb565) to luma
+ *
+ * @param rgb Source pixels, 2 bytes each
+ * @param luma Destination, 1 byte per pixel
+ * @param pixels Number of pixels
+ */
+void motion_rgb565_to_luma(const uint8_t *rgb, uint8_t *luma, size_t pixels);
+
+/**
+ * @brief Count pixels whose luma changed by more than threshold, per cell
+ *
+ * Portable reference implementation.
+ *
+ * @param cur Current image
+ * @param ref Reference (previous) image
+ * @param width Width in pixels, multiple of MOTION_CELL_W
+ * @param height Height in pixels, multiple of MOTION_CELL_H
+ * @param threshold Luma difference that counts as a change
+ * @param cells Output, (width / MOTION_CELL_W) * (height / MOTION_CELL_H)
+ *              changed-pixel counts in row-major order
+ * @return Total number of changed pixels
+ */
+uint32_t motion_diff_cells_ref(const uint8_t *cur, const uint8_t *ref,
+                               int width, int height, uint8_t threshold,
+                               uint16_t *cells);
+
+/**
+ * @brief Same as motion_diff_cells_ref(), four pixels per 32-bit word
+ *
+ * SWAR: two pixels per 16-bit lane, compared without branches. Both images
+ * must be 4-byte aligned.
+ */
+uint32_t motion_diff_cells_swar(const uint8_t *cur, const uint8_t *ref,
+                                int width, int height, uint8_t threshold,
+                                uint16_t *cells);
+
+#ifdef MOTION_KERNEL_REFERENCE
+#define motion_diff_cells motion_diff_cells_ref
+#else
+#define motion_diff_cells motion_diff_cells_swar
+#endif
+
+/**
+ * @brief Count 4-connected blobs of active cells
+ *
+ * @param cells Per-cell changed-pixel counts
+ * @param cols Grid width in cells
+ * @param rows Grid height in cells (cols * rows <= MOTION_MAX_CELLS)
+ * @param min_count Changed pixels for a cell to be active
+ * @param work Scratch space
+ * @param largest Output, size of the largest blob in cells
+ * @return Number of blobs
+ */
+int motion_count_blobs(const uint16_t *cells, int cols, int rows,
+                       uint16_t min_count, motion_blob_work_t *work,
+                       int *largest);
+
+#endif // MOTION_KERNEL_H
@@ -0,0 +1,197 @@
+#include "mq137_adc.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "signal_filter.h"
+#include "soc/soc_caps.h"
+
+static const char *TAG = "MQ137";
+
+#define MQ137_ADC_UNIT ADC_UNIT_1
+#define MQ137_ADC_CHANNEL ADC_CHANNEL_2 // GPIO 3 -> ADC1_CH2
+#define MQ137_ADC_ATTEN ADC_ATTEN_DB_12 // 0-3.3V range
+
+static adc_continuous_handle_t s_handle = NULL;
+static adc_cali_handle_t s_cali_handle = NULL;
+static mq137_adc_config_t s_config;
+
+static uint8_t *s_frame = NULL;    // DMA frame as delivered by the driver
+static uint32_t s_frame_bytes = 0;
+static uint16_t *s_samples = NULL; // MQ-137 samples extracted from a frame
+static filter_iir_t s_iir;
+static bool s_bursts = false;      // ADC stopped between reads
+static TickType_t s_burst_tick;    // Start of the current interval
+
+esp_err_t mq137_adc_init(const mq137_adc_config_t *config) {
+  if (config->sample_rate_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW ||
+      config->sample_rate_hz > SOC_ADC_SAMPLE_FREQ_THRES_HIGH ||
+      config->publish_interval_ms == 0 || config->burst_ms == 0 ||
+      config->burst_ms > config->publish_interval_ms ||
+      config->median_window == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  s_config = *config;
+
+  // One DMA frame per burst
+  uint32_t samples = config->sample_rate_hz * config->burst_ms / 1000;
+  s_frame_bytes = samples * SOC_ADC_DIGI_RESULT_BYTES;
+  s_frame = heap_caps_malloc(s_frame_bytes, MALLOC_CAP_INTERNAL);
+  s_samples = heap_caps_malloc(samples * sizeof(uint16_t), MALLOC_CAP_INTERNAL);
+  if (s_frame == NULL || s_samples == NULL) {
+    ESP_LOGE(TAG, "Failed to allocate sample buffers");
+    return ESP_ERR_NO_MEM;
+  }
+
+  adc_continuous_handle_cfg_t handle_config = {
+      .max_store_buf_size = s_frame_bytes * 2,
+      .conv_frame_size = s_frame_bytes,
+      .flags.flush_pool = true, // Prefer fresh data if the reader lags
+  };
+  esp_err_t ret = adc_continuous_new_handle(&handle_config, &s_handle);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create ADC handle: %s", esp_err_to_name(ret));
+    return ret;
+  }
+
+  adc_digi_pattern_config_t pattern = {
+      .atten = MQ137_ADC_ATTEN,
+      .channel = MQ137_ADC_CHANNEL & 0x7,
+      .unit = MQ137_ADC_UNIT,
+      .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+  };
+  adc_continuous_config_t dig_config = {
+      .pattern_num = 1,
+      .adc_pattern = &pattern,
+      .sample_freq_hz = config->sample_rate_hz,
+      .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+      .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+  };
+  ret = adc_continuous_config(s_handle, &dig_config);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to configure ADC: %s", esp_err_to_name(ret));
+    return ret;
+  }
+
+  // ADC Calibration
+  adc_cali_curve_fitting_config_t cali_config = {
+      .unit_id = MQ137_ADC_UNIT,
+      .atten = MQ137_ADC_ATTEN,
+      .bitwidth = ADC_BITWIDTH_12,
+  };
+  if (adc_cali_create_scheme_curve_fitting(&cali_config, &s_cali_handle) !=
+      ESP_OK) {
+    ESP_LOGW(TAG, "ADC calibration scheme not supported, using raw values");
+    s_cali_handle = NULL;
+  }
+
+  filter_iir_init(&s_iir, config->iir_shift);
+
+  // The first burst starts right away
+  s_bursts = config->burst_ms < config->publish_interval_ms;
+  s_burst_tick =
+      xTaskGetTickCount() - pdMS_TO_TICKS(config->publish_interval_ms);
+  if (!s_bursts) {
+    ret = adc_continuous_start(s_handle);
+    if (ret != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to start ADC: %s", esp_err_to_name(ret));
+      return ret;
+    }
+  }
+
+  ESP_LOGI(TAG,
+           "MQ-137 continuous ADC on GPIO 3 (ADC1_CH2): %lu Hz, %lu samples "
+           "per block, %lu of every %lu ms, filter %d",
+           (unsigned long)config->sample_rate_hz, (unsigned long)samples,
+           (unsigned long)config->burst_ms,
+           (unsigned long)config->publish_interval_ms, config->filter);
+  return ESP_OK;
+}
+
+// Mean of the medians of consecutive windows; rejects short spikes
+static float median_of_windows(uint16_t *samples, size_t count,
+                               size_t window) {
+  uint32_t sum = 0;
+  uint32_t windows = 0;
+  for (size_t off = 0; off < count; off += window) {
+    size_t len = count - off < window ? count - off : window;
+    sum += filter_median(&samples[off], len);
+    windows++;
+  }
+  return (float)sum / windows;
+}
+
+esp_err_t mq137_adc_read(mq137_reading_t *out, TickType_t timeout) {
+  if (s_handle == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  esp_err_t ret;
+  if (s_bursts) {
+    // Stopped until here, so light sleep was free to run
+    vTaskDelayUntil(&s_burst_tick, pdMS_TO_TICKS(s_config.publish_interval_ms));
+    ret = adc_continuous_start(s_handle);
+    if (ret != ESP_OK) {
+      return ret;
+    }
+  }
+
+  uint32_t len = 0;
+  ret = adc_continuous_read(s_handle, s_frame, s_frame_bytes, &len,
+                            timeout * portTICK_PERIOD_MS);
+  if (s_bursts) {
+    // Conversions past the frame would be stale by the next burst
+    adc_continuous_stop(s_handle);
+    adc_continuous_flush_pool(s_handle);
+  }
+  if (ret != ESP_OK) {
+    return ret;
+  }
+
+  size_t count = 0;
+  for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len;
+       i += SOC_ADC_DIGI_RESULT_BYTES) {
+    const adc_digi_output_data_t *p =
+        (const adc_digi_output_data_t *)&s_frame[i];
+    if (p->type2.unit == MQ137_ADC_UNIT &&
+        p->type2.channel == MQ137_ADC_CHANNEL) {
+      s_samples[count++] = p->type2.data;
+    }
+  }
+  if (count == 0) {
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  // Statistics first: the median filter reorders the samples
+  filter_stats_t stats;
+  filter_stats_reset(&stats);
+  filter_stats_add(&stats, s_samples, count);
+
+  float value;
+  switch (s_config.filter) {
+  case MQ137_FILTER_MEDIAN:
+    value = median_of_windows(s_samples, count, s_config.median_window);
+    break;
+  case MQ137_FILTER_IIR:
+    value = filter_iir_update(&s_iir, s_samples, count);
+    break;
+  case MQ137_FILTER_MEAN:
+  default:
+    value = filter_stats_mean(&stats);
+    break;
+  }
+
+  out->raw = (int)(value + 0.5f);
+  out->variance = filter_stats_variance(&stats);
+  out->samples = count;
+
+  if (s_cali_handle == NULL ||
+      adc_cali_raw_to_voltage(s_cali_handle, out->raw, &out->voltage_mv) !=
+          ESP_OK) {
+    // Approximate conversion without calibration (12-bit, 3.3V)
+    out->voltage_mv = (out->raw * 3300) / 4095;
+  }
+  return ESP_OK;
+}
@@ -0,0 +1,77 @@
+#ifndef MQ137_ADC_H
+#define MQ137_ADC_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+
+/**
+ * @brief MQ-137 sampling with the ADC in continuous (DMA) mode
+ *
+ * The ADC samples GPIO 3 (ADC1_CH2) into DMA buffers in one burst of
+ * burst_ms per publish interval. One DMA frame holds a whole burst, so the
+ * reading task wakes once per published value instead of once per sample.
+ * Between bursts the ADC is stopped: the running driver holds a PM lock
+ * that keeps the chip out of light sleep. With burst_ms equal to
+ * publish_interval_ms the ADC runs without pause.
+ *
+ * Each block is reduced with the configured filter (see signal_filter.h)
+ * to a denoised value plus the variance of the raw samples.
+ */
+
+typedef enum {
+  MQ137_FILTER_MEAN = 0, // Oversampling: mean of all samples
+  MQ137_FILTER_MEDIAN,   // Mean of medians over short windows (spike-robust)
+  MQ137_FILTER_IIR,      // Exponential moving average across blocks
+} mq137_filter_t;
+
+typedef struct {
+  uint32_t sample_rate_hz;      // ADC conversion rate
+  uint32_t publish_interval_ms; // One filtered value per interval
+  uint32_t burst_ms;            // Sampling time per interval
+  mq137_filter_t filter;
+  uint16_t median_window; // Window length for MQ137_FILTER_MEDIAN
+  uint8_t iir_shift;      // y += (x - y) / 2^shift for MQ137_FILTER_IIR
+} mq137_adc_config_t;
+
+#define MQ137_ADC_DEFAULT_CONFIG()                                            \
+  {                                                                           \
+      .sample_rate_hz = 5000,                                                 \
+      .publish_interval_ms = 500,                                             \
+      .burst_ms = 100, /* 5 mains periods at 50 Hz, 6 at 60 Hz */             \
+      .filter = MQ137_FILTER_MEDIAN,                                          \
+      .median_window = 15,                                                    \
+      .iir_shift = 6,                                                         \
+  }
+
+/**
+ * @brief One published reading
+ */
+typedef struct {
+  int raw;         // Filtered ADC counts
+  int voltage_mv;  // Filtered value converted to millivolts
+  float variance;  // Variance of the raw samples in the block (counts^2)
+  uint32_t samples; // Number of raw samples in the block
+} mq137_reading_t;
+
+/**
+ * @brief Configure sampling, starting the ADC when it runs without pauses
+ *
+ * @param config Sampling and filter configuration
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mq137_adc_init(const mq137_adc_config_t *config);
+
+/**
+ * @brief Wait for the next block and reduce it to one reading
+ *
+ * With bursts, waits for the start of the next publish interval, samples
+ * one burst and stops the ADC again.
+ *
+ * @param out Filtered reading
+ * @param timeout Maximum time to wait for the DMA frame once sampling
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if no frame arrived
+ */
+esp_err_t mq137_adc_read(mq137_reading_t *out, TickType_t timeout);
+
+#endif // MQ137_ADC_H
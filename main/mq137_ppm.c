@@ -0,0 +1,203 @@
+#include "mq137_ppm.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "nh3_model.h"
+#include "nvs.h"
+#include "sensor_snapshot.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "MQ137ppm";
+
+#define NVS_NAMESPACE "mq137"
+#define NVS_KEY_R0 "r0" // Ohms
+
+// Older SHT30 samples are not used for compensation
+#define SHT30_MAX_AGE_US (60 * 1000000LL)
+
+#define CALIBRATE_DEFAULT_S 60
+#define CALIBRATE_MIN_S 10
+#define CALIBRATE_MAX_S 600
+
+static nh3_model_t s_model;
+
+// Guarded by s_lock
+static float s_r0 = 0; // 0 = not calibrated
+static float s_rs = -1;
+static float s_compensation = 1.0f;
+static bool s_compensated = false;
+static bool s_calibrating = false;
+static int64_t s_calibrate_end_us = 0;
+static float s_calibrate_sum = 0;
+static uint32_t s_calibrate_count = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_err_t r0_save(float r0) {
+  nvs_handle_t nvs;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (err == ESP_OK) {
+    err = nvs_set_u32(nvs, NVS_KEY_R0, (uint32_t)lroundf(r0));
+    if (err == ESP_OK) {
+      err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to save R0: %s", esp_err_to_name(err));
+  }
+  return err;
+}
+
+esp_err_t mq137_ppm_init(void) {
+  nh3_model_params_t params = NH3_MODEL_DEFAULT_PARAMS();
+  if (!nh3_model_init(&s_model, &params)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  nvs_handle_t nvs;
+  uint32_t r0 = 0;
+  if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+    nvs_get_u32(nvs, NVS_KEY_R0, &r0);
+    nvs_close(nvs);
+  }
+  portENTER_CRITICAL(&s_lock);
+  s_r0 = r0;
+  portEXIT_CRITICAL(&s_lock);
+
+  if (r0 > 0) {
+    ESP_LOGI(TAG, "R0 = %lu ohm", (unsigned long)r0);
+  } else {
+    ESP_LOGW(TAG, "MQ-137 not calibrated, ppm unavailable until "
+                  "/api/ammonia/calibrate has run");
+  }
+  return ESP_OK;
+}
+
+float mq137_ppm_update(float voltage_mv) {
+  int64_t now = esp_timer_get_time();
+  float rs = nh3_model_rs(&s_model, voltage_mv);
+
+  sensor_snapshot_t snap;
+  sensor_snapshot_read(&snap);
+  bool compensated =
+      snap.sht30_seq > 0 && now - snap.sht30_time_us < SHT30_MAX_AGE_US;
+  float k = compensated ? nh3_model_compensation(&s_model, snap.temperature,
+                                                 snap.humidity)
+                        : 1.0f;
+  // Rs at the reference conditions R0 is defined for
+  float rs_ref = rs / k;
+
+  bool calibrated = false;
+  bool failed = false;
+  portENTER_CRITICAL(&s_lock);
+  s_rs = rs;
+  s_compensation = k;
+  s_compensated = compensated;
+  if (s_calibrating && rs > 0) {
+    s_calibrate_sum += rs_ref;
+    s_calibrate_count++;
+  }
+  if (s_calibrating && now >= s_calibrate_end_us) {
+    s_calibrating = false;
+    if (s_calibrate_count > 0) {
+      s_r0 = s_calibrate_sum / s_calibrate_count /
+             s_model.params.clean_air_ratio;
+      calibrated = true;
+    } else {
+      failed = true;
+    }
+  }
+  float r0 = s_r0;
+  portEXIT_CRITICAL(&s_lock);
+
+  if (calibrated) {
+    // Rare; a slow flash write only delays this one reading
+    ESP_LOGI(TAG, "Calibrated: R0 = %.0f ohm", r0);
+    r0_save(r0);
+  } else if (failed) {
+    ESP_LOGW(TAG, "Calibration failed: no valid reading (%.0f mV)",
+             voltage_mv);
+  }
+  if (rs <= 0 || r0 <= 0) {
+    return NAN;
+  }
+  return nh3_model_ppm(&s_model, rs_ref / r0);
+}
+
+esp_err_t mq137_ppm_status_handler(httpd_req_t *req) {
+  portENTER_CRITICAL(&s_lock);
+  float r0 = s_r0;
+  float rs = s_rs;
+  float k = s_compensation;
+  bool compensated = s_compensated;
+  bool calibrating = s_calibrating;
+  int64_t remaining_us = s_calibrate_end_us - esp_timer_get_time();
+  portEXIT_CRITICAL(&s_lock);
+  long long remaining_s =
+      calibrating && remaining_us > 0 ? remaining_us / 1000000 : 0;
+
+  char r0_str[16] = "null";
+  char rs_str[16] = "null";
+  if (r0 > 0) {
+    snprintf(r0_str, sizeof(r0_str), "%.0f", r0);
+  }
+  if (rs > 0) {
+    snprintf(rs_str, sizeof(rs_str), "%.0f", rs);
+  }
+  char response[192];
+  snprintf(response, sizeof(response),
+           "{\"r0\":%s,\"rs\":%s,\"compensation\":%.3f,"
+           "\"compensated\":%s,\"calibrating\":%s,\"remaining_s\":%lld}",
+           r0_str, rs_str, k, compensated ? "true" : "false",
+           calibrating ? "true" : "false", remaining_s);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_sendstr(req, response);
+}
+
+esp_err_t mq137_ppm_calibrate_handler(httpd_req_t *req) {
+  char query[64];
+  char value[16];
+  bool has_query =
+      httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+
+  if (has_query &&
+      httpd_query_key_value(query, "r0", value, sizeof(value)) == ESP_OK) {
+    float r0 = strtof(value, NULL);
+    if (!(r0 >= 1.0f && r0 < 1e8f)) {
+      return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid r0");
+    }
+    portENTER_CRITICAL(&s_lock);
+    s_r0 = r0;
+    s_calibrating = false;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "R0 set to %.0f ohm", r0);
+    if (r0_save(r0) != ESP_OK) {
+      return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                                 "R0 applied but not saved");
+    }
+  } else {
+    int seconds = CALIBRATE_DEFAULT_S;
+    if (has_query &&
+        httpd_query_key_value(query, "seconds", value, sizeof(value)) ==
+            ESP_OK) {
+      seconds = atoi(value);
+    }
+    if (seconds < CALIBRATE_MIN_S || seconds > CALIBRATE_MAX_S) {
+      return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                                 "seconds out of range");
+    }
+    portENTER_CRITICAL(&s_lock);
+    s_calibrating = true;
+    s_calibrate_end_us = esp_timer_get_time() + seconds * 1000000LL;
+    s_calibrate_sum = 0;
+    s_calibrate_count = 0;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Calibrating in clean air for %d s", seconds);
+  }
+
+  return mq137_ppm_status_handler(req);
+}
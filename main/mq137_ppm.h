@@ -0,0 +1,53 @@
+#ifndef MQ137_PPM_H
+#define MQ137_PPM_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+/**
+ * @brief NH3 ppm from MQ-137 readings, with the R0 baseline kept in NVS
+ *
+ * mq137_ppm_update() converts every published voltage with nh3_model.h,
+ * compensated with the latest SHT30 sample from the snapshot (uncompensated
+ * while that is missing or stale). Until R0 is known, ppm is NaN and the
+ * API reports null.
+ *
+ * Calibration: with the sensor warmed up in clean air, POST
+ * /api/ammonia/calibrate?seconds=N averages the compensated Rs over N
+ * seconds and stores R0 = Rs / clean_air_ratio. ?r0=<ohms> stores a known
+ * R0 directly.
+ */
+
+/**
+ * @brief Build the conversion table and load R0 from NVS
+ *
+ * Requires nvs_flash_init().
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mq137_ppm_init(void);
+
+/**
+ * @brief Convert one published voltage, and feed a running calibration
+ *
+ * Call from the MQ-137 task for every reading.
+ *
+ * @param voltage_mv Filtered ADC voltage
+ * @return NH3 concentration in ppm, NaN if not calibrated or out of range
+ */
+float mq137_ppm_update(float voltage_mv);
+
+/**
+ * @brief URI handler for GET /api/ammonia/calibrate (R0 and last Rs)
+ */
+esp_err_t mq137_ppm_status_handler(httpd_req_t *req);
+
+/**
+ * @brief URI handler for POST /api/ammonia/calibrate
+ *
+ * Query parameters: seconds (10-600, default 60) to calibrate in clean
+ * air, or r0 (ohms) to set R0.
+ */
+esp_err_t mq137_ppm_calibrate_handler(httpd_req_t *req);
+
+#endif // MQ137_PPM_H
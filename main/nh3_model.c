@@ -0,0 +1,88 @@
+#include "nh3_model.h"
+#include <math.h>
+
+#define MANTISSA_ONE (1u << 24) // Q24
+#define MANTISSA_BITS 6         // log2(NH3_LUT_SEGMENTS)
+
+// Table range in Q16, upper bound exclusive
+#define RATIO_MIN_Q16 (1u << (16 + NH3_RATIO_MIN_EXP))
+#define RATIO_MAX_Q16 ((1u << (16 + NH3_RATIO_MAX_EXP)) - 1)
+
+bool nh3_model_init(nh3_model_t *model, const nh3_model_params_t *params) {
+  if (!(params->curve_b < 0) || !(params->curve_a > 0)) {
+    return false;
+  }
+  model->params = *params;
+
+  // Built once, in double so the table itself adds no rounding error
+  for (int i = 0; i <= NH3_LUT_SEGMENTS; i++) {
+    double m = 1.0 + (double)i / NH3_LUT_SEGMENTS;
+    model->mantissa[i] =
+        (uint32_t)lround(pow(m, params->curve_b) * MANTISSA_ONE);
+  }
+  for (int e = NH3_RATIO_MIN_EXP; e < NH3_RATIO_MAX_EXP; e++) {
+    double micro_ppm = params->curve_a * pow(2.0, e * params->curve_b) * 1e6;
+    // Times a Q24 mantissa <= 1 must fit 64 bits
+    if (micro_ppm >= (double)(UINT64_MAX >> 24)) {
+      return false;
+    }
+    model->octave[e - NH3_RATIO_MIN_EXP] = (uint64_t)llround(micro_ppm);
+  }
+  return true;
+}
+
+float nh3_model_rs(const nh3_model_t *model, float voltage_mv) {
+  const nh3_model_params_t *p = &model->params;
+  float vout = voltage_mv * p->adc_scale;
+  if (!(vout > 0) || vout >= p->supply_mv) {
+    return -1.0f;
+  }
+  return p->load_ohm * (p->supply_mv - vout) / vout;
+}
+
+float nh3_model_compensation(const nh3_model_t *model, float temperature,
+                             float humidity) {
+  const nh3_model_params_t *p = &model->params;
+  float k = 1.0f + p->temp_coeff * (temperature - 20.0f) +
+            p->hum_coeff * (humidity - 65.0f);
+  // Outside the datasheet curves; do not let a bad reading invert Rs
+  return k < 0.5f ? 0.5f : k > 1.5f ? 1.5f : k;
+}
+
+float nh3_model_ppm(const nh3_model_t *model, float ratio) {
+  if (isnan(ratio)) {
+    return NAN;
+  }
+  uint32_t q;
+  if (ratio * 65536.0f < RATIO_MIN_Q16) {
+    q = RATIO_MIN_Q16;
+  } else if (ratio * 65536.0f >= RATIO_MAX_Q16) {
+    q = RATIO_MAX_Q16;
+  } else {
+    q = (uint32_t)(ratio * 65536.0f + 0.5f);
+  }
+
+  // q = 2^(e+16) * m: normalize so the mantissa's leading 1 is bit 31
+  int shift = __builtin_clz(q);
+  int e = 15 - shift;
+  uint32_t n = q << shift;
+  uint32_t i = (n >> (31 - MANTISSA_BITS)) & (NH3_LUT_SEGMENTS - 1);
+  uint32_t frac = (n >> (15 - MANTISSA_BITS)) & 0xFFFF;
+
+  int64_t y0 = model->mantissa[i];
+  int64_t y1 = model->mantissa[i + 1];
+  uint64_t m = (uint64_t)(y0 + (((y1 - y0) * frac) >> 16));
+  uint64_t micro_ppm = (model->octave[e - NH3_RATIO_MIN_EXP] * m) >> 24;
+  return micro_ppm / 1e6f;
+}
+
+float nh3_model_ppm_reference(const nh3_model_params_t *params, float ratio) {
+  const float lo = ldexpf(1.0f, NH3_RATIO_MIN_EXP);
+  const float hi = ldexpf(1.0f, NH3_RATIO_MAX_EXP);
+  if (!(ratio >= lo)) {
+    ratio = lo;
+  } else if (ratio >= hi) {
+    ratio = hi;
+  }
+  return params->curve_a * powf(ratio, params->curve_b);
+}
@@ -0,0 +1,103 @@
+#ifndef NH3_MODEL_H
+#define NH3_MODEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief MQ-137 voltage to NH3 ppm
+ *
+ * The sensor output is the voltage across the load resistor RL in series
+ * with the sensing resistance Rs:
+ *
+ *   Rs = RL * (Vc - Vout) / Vout
+ *
+ * Rs depends on temperature and humidity; it is divided by a linear fit of
+ * the datasheet curves (1 at 20 degC / 65 %RH) before it is compared with
+ * R0, the resistance in clean air divided by the clean-air ratio. The
+ * ratio maps to ppm through the datasheet power law
+ *
+ *   ppm = a * (Rs / R0)^b
+ *
+ * evaluated from a fixed-point table built once by nh3_model_init(): the
+ * ratio is split into an octave 2^e and a mantissa m in [1, 2), and
+ * ppm = (a * 2^(e*b)) * m^b with m^b interpolated linearly between 64
+ * points. No powf()/logf() per sample; the error against the float curve
+ * stays below 0.1 % over the table range for curve_b down to -4 (it grows
+ * with b * (b - 1); host/test/test_nh3_model.c checks it).
+ *
+ * Plain C with no ESP-IDF dependency, like signal_filter.h.
+ */
+
+// Ratios outside [2^MIN_EXP, 2^MAX_EXP) are clamped to the table range
+#define NH3_RATIO_MIN_EXP (-2)
+#define NH3_RATIO_MAX_EXP 3
+#define NH3_LUT_SEGMENTS 64
+
+typedef struct {
+  float supply_mv;       // Vc across the sensor and RL
+  float load_ohm;        // RL
+  float adc_scale;       // Sensor output / ADC pin voltage (divider ratio)
+  float curve_a;         // ppm at Rs/R0 = 1
+  float curve_b;         // Exponent, negative
+  float clean_air_ratio; // Rs/R0 in clean air
+  float temp_coeff;      // Relative change of Rs per degC above 20 degC
+  float hum_coeff;       // Relative change of Rs per %RH above 65 %RH
+} nh3_model_params_t;
+
+// MQ-137 datasheet: log10(Rs/R0) = -0.263 * log10(ppm) + 0.42, clean air
+// ratio 3.6; Rs drops ~27 % from -10 to 50 degC and ~9 % from 33 to 85 %RH
+#define NH3_MODEL_DEFAULT_PARAMS()                                            \
+  {                                                                           \
+      .supply_mv = 5000.0f,                                                   \
+      .load_ohm = 10000.0f,                                                   \
+      .adc_scale = 1.0f,                                                      \
+      .curve_a = 39.44f,                                                      \
+      .curve_b = -3.802f,                                                     \
+      .clean_air_ratio = 3.6f,                                                \
+      .temp_coeff = -0.0045f,                                                 \
+      .hum_coeff = -0.0017f,                                                  \
+  }
+
+typedef struct {
+  nh3_model_params_t params;
+  uint32_t mantissa[NH3_LUT_SEGMENTS + 1]; // m^b, Q24
+  // a * 2^(e*b) in 1e-6 ppm, from e = NH3_RATIO_MIN_EXP
+  uint64_t octave[NH3_RATIO_MAX_EXP - NH3_RATIO_MIN_EXP];
+} nh3_model_t;
+
+/**
+ * @brief Build the lookup tables
+ *
+ * @return false if the parameters are out of range (curve_a must be
+ *         positive and curve_b negative)
+ */
+bool nh3_model_init(nh3_model_t *model, const nh3_model_params_t *params);
+
+/**
+ * @brief Sensor resistance from the ADC voltage
+ *
+ * @return Rs in ohms, or a negative value if the voltage is outside
+ *         (0, supply_mv)
+ */
+float nh3_model_rs(const nh3_model_t *model, float voltage_mv);
+
+/**
+ * @brief Rs at the given conditions relative to Rs at 20 degC / 65 %RH
+ */
+float nh3_model_compensation(const nh3_model_t *model, float temperature,
+                             float humidity);
+
+/**
+ * @brief NH3 concentration for a compensated Rs/R0 ratio (table lookup)
+ *
+ * @return ppm, NaN if ratio is NaN
+ */
+float nh3_model_ppm(const nh3_model_t *model, float ratio);
+
+/**
+ * @brief Same as nh3_model_ppm() evaluated with powf(), for comparison
+ */
+float nh3_model_ppm_reference(const nh3_model_params_t *params, float ratio);
+
+#endif // NH3_MODEL_H
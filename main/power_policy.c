@@ -0,0 +1,330 @@
+#include "power_policy.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "task_topology.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "Power";
+
+#define POWER_CHECK_MS 1000
+
+#define NVS_NAMESPACE "power"
+#define NVS_KEY_CAMERA_IDLE "camera_idle_s"
+
+#define CAMERA_IDLE_MAX_S (24 * 3600)
+
+// Switchable loads and their nominal draw per state in mW at the board
+// input. Rough figures from the datasheets, good enough to compare
+// policies; the MQ-137 heater and other constant loads are left out.
+typedef enum {
+  DOMAIN_CPU = 0,
+  DOMAIN_WIFI,
+  DOMAIN_CAMERA,
+  DOMAIN_COUNT
+} power_domain_id_t;
+
+#define DOMAIN_MAX_STATES 3
+
+typedef struct {
+  const char *name;
+  int states;
+  const char *state_names[DOMAIN_MAX_STATES];
+  uint16_t mw[DOMAIN_MAX_STATES];
+  int state;
+  int64_t since_us;
+  int64_t time_us[DOMAIN_MAX_STATES];
+} power_domain_t;
+
+enum { CPU_SCALING = 0, CPU_MAX };
+enum { WIFI_MODEM_SLEEP = 0, WIFI_ACTIVE };
+
+static power_domain_t s_domains[DOMAIN_COUNT] = {
+    // Scaling averages 80 MHz operation with light sleep in between
+    [DOMAIN_CPU] = {"cpu", 2, {"scaling", "max"}, {40, 120}},
+    // Modem sleep averaged over DTIM wake-ups
+    [DOMAIN_WIFI] = {"wifi", 2, {"modem_sleep", "active"}, {30, 330}},
+    [DOMAIN_CAMERA] = {"camera", 3, {"off", "standby", "on"}, {0, 15, 330}},
+};
+static portMUX_TYPE s_state_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static power_policy_config_t s_config;
+static power_policy_hooks_t s_hooks;
+static bool s_pm_enabled = false;
+static esp_pm_lock_handle_t s_cpu_lock = NULL;     // Held while streaming
+static esp_pm_lock_handle_t s_no_sleep_lock = NULL; // Held while capturing
+static SemaphoreHandle_t s_stream_lock = NULL;
+static bool s_streaming = false;
+static int s_stream_count = 0;
+static int64_t s_start_us = 0;
+static int64_t s_camera_used_us = 0;
+static uint32_t s_camera_idle_offs = 0;
+
+// Caller holds s_state_lock
+static void domain_set(power_domain_id_t id, int state, int64_t now) {
+  power_domain_t *d = &s_domains[id];
+  d->time_us[d->state] += now - d->since_us;
+  d->state = state;
+  d->since_us = now;
+}
+
+void power_policy_set_camera(power_camera_state_t state) {
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&s_state_lock);
+  int prev = s_domains[DOMAIN_CAMERA].state;
+  domain_set(DOMAIN_CAMERA, state, now);
+  s_camera_used_us = now;
+  portEXIT_CRITICAL(&s_state_lock);
+
+  // XCLK and the DVP DMA stop in light sleep
+  if (s_no_sleep_lock != NULL && (prev == POWER_CAMERA_ON) !=
+                                     (state == POWER_CAMERA_ON)) {
+    if (state == POWER_CAMERA_ON) {
+      esp_pm_lock_acquire(s_no_sleep_lock);
+    } else {
+      esp_pm_lock_release(s_no_sleep_lock);
+    }
+  }
+}
+
+void power_policy_camera_used(void) {
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&s_state_lock);
+  s_camera_used_us = now;
+  portEXIT_CRITICAL(&s_state_lock);
+}
+
+void power_policy_set_streams(int count) {
+  if (s_stream_lock == NULL) {
+    return;
+  }
+  xSemaphoreTake(s_stream_lock, portMAX_DELAY);
+  s_stream_count = count;
+  bool streaming = count > 0;
+  if (streaming != s_streaming) {
+    s_streaming = streaming;
+    if (s_cpu_lock != NULL) {
+      if (streaming) {
+        esp_pm_lock_acquire(s_cpu_lock);
+      } else {
+        esp_pm_lock_release(s_cpu_lock);
+      }
+    }
+    // Modem sleep adds up to a DTIM interval of latency to every frame
+    esp_err_t err = esp_wifi_set_ps(streaming ? WIFI_PS_NONE
+                                              : WIFI_PS_MIN_MODEM);
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "WiFi power save change failed: %s",
+               esp_err_to_name(err));
+    }
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_state_lock);
+    domain_set(DOMAIN_CPU, streaming ? CPU_MAX : CPU_SCALING, now);
+    domain_set(DOMAIN_WIFI, streaming ? WIFI_ACTIVE : WIFI_MODEM_SLEEP, now);
+    portEXIT_CRITICAL(&s_state_lock);
+    ESP_LOGI(TAG, "%s", streaming ? "Streaming: full power"
+                                  : "No viewers: DFS and modem sleep");
+  }
+  xSemaphoreGive(s_stream_lock);
+}
+
+static void check_camera_idle(int64_t now) {
+  if (s_hooks.camera_busy != NULL && s_hooks.camera_busy()) {
+    power_policy_camera_used();
+    return;
+  }
+
+  portENTER_CRITICAL(&s_state_lock);
+  bool powered = s_domains[DOMAIN_CAMERA].state != POWER_CAMERA_OFF;
+  int64_t idle_us = now - s_camera_used_us;
+  int64_t limit_us = (int64_t)s_config.camera_idle_s * 1000000;
+  bool expired = powered && limit_us > 0 && idle_us >= limit_us;
+  if (expired) {
+    s_camera_used_us = now; // Retry after another idle period if needed
+    s_camera_idle_offs++;
+  }
+  portEXIT_CRITICAL(&s_state_lock);
+
+  if (expired && s_hooks.camera_idle != NULL) {
+    ESP_LOGI(TAG, "Camera idle for %lu s, powering down",
+             (unsigned long)s_config.camera_idle_s);
+    s_hooks.camera_idle();
+  }
+}
+
+static void power_task(void *arg) {
+  TickType_t last_wake = xTaskGetTickCount();
+  while (true) {
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(POWER_CHECK_MS));
+    task_topology_tick(TASK_POWER);
+    check_camera_idle(esp_timer_get_time());
+  }
+}
+
+static esp_err_t camera_idle_save(uint32_t seconds) {
+  nvs_handle_t nvs;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (err == ESP_OK) {
+    err = nvs_set_u32(nvs, NVS_KEY_CAMERA_IDLE, seconds);
+    if (err == ESP_OK) {
+      err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to save camera idle time: %s",
+             esp_err_to_name(err));
+  }
+  return err;
+}
+
+esp_err_t power_policy_init(const power_policy_config_t *config,
+                            const power_policy_hooks_t *hooks) {
+  s_config = *config;
+  s_hooks = *hooks;
+
+  // A value set through POST /api/power overrides the default
+  nvs_handle_t nvs;
+  uint32_t idle_s;
+  if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+    if (nvs_get_u32(nvs, NVS_KEY_CAMERA_IDLE, &idle_s) == ESP_OK &&
+        idle_s <= CAMERA_IDLE_MAX_S) {
+      s_config.camera_idle_s = idle_s;
+    }
+    nvs_close(nvs);
+  }
+
+  int64_t now = esp_timer_get_time();
+  s_start_us = now;
+  for (int i = 0; i < DOMAIN_COUNT; i++) {
+    s_domains[i].since_us = now;
+  }
+  s_camera_used_us = now;
+
+  esp_pm_config_t pm = {
+      .max_freq_mhz = config->max_freq_mhz,
+      .min_freq_mhz = config->min_freq_mhz,
+      .light_sleep_enable = config->light_sleep,
+  };
+  esp_err_t err = esp_pm_configure(&pm);
+  if (err != ESP_OK) {
+    // CONFIG_PM_ENABLE off, or light sleep without tickless idle
+    ESP_LOGW(TAG, "esp_pm unavailable (%s), running at a fixed clock",
+             esp_err_to_name(err));
+  } else {
+    s_pm_enabled = true;
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "stream", &s_cpu_lock) !=
+            ESP_OK ||
+        esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "camera",
+                           &s_no_sleep_lock) != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to create PM locks");
+      return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "DFS %u-%u MHz, light sleep %s", config->min_freq_mhz,
+             config->max_freq_mhz, config->light_sleep ? "on" : "off");
+  }
+
+  s_stream_lock = xSemaphoreCreateMutex();
+  if (s_stream_lock == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  // No viewers yet: start in modem sleep
+  esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+
+  return task_topology_create(TASK_POWER, power_task, NULL, NULL);
+}
+
+esp_err_t power_policy_handler(httpd_req_t *req) {
+  power_domain_t domains[DOMAIN_COUNT];
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&s_state_lock);
+  for (int i = 0; i < DOMAIN_COUNT; i++) {
+    domains[i] = s_domains[i];
+    domains[i].time_us[domains[i].state] += now - domains[i].since_us;
+  }
+  int64_t camera_idle_us = now - s_camera_used_us;
+  uint32_t idle_offs = s_camera_idle_offs;
+  portEXIT_CRITICAL(&s_state_lock);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+  char buf[384];
+  int len = snprintf(
+      buf, sizeof(buf),
+      "{\"pm\":%s,\"light_sleep\":%s,\"min_mhz\":%u,\"max_mhz\":%u,"
+      "\"streams\":%d,\"camera_idle_s\":%lu,\"camera_unused_s\":%lld,"
+      "\"camera_idle_offs\":%lu,\"domains\":[",
+      s_pm_enabled ? "true" : "false",
+      s_pm_enabled && s_config.light_sleep ? "true" : "false",
+      s_config.min_freq_mhz, s_config.max_freq_mhz, s_stream_count,
+      (unsigned long)s_config.camera_idle_s,
+      (long long)(camera_idle_us / 1000000), (unsigned long)idle_offs);
+  esp_err_t res = httpd_resp_send_chunk(req, buf, len);
+
+  double total_mj = 0;
+  for (int i = 0; i < DOMAIN_COUNT && res == ESP_OK; i++) {
+    const power_domain_t *d = &domains[i];
+    len = snprintf(buf, sizeof(buf), "%s{\"domain\":\"%s\",\"state\":\"%s\","
+                                     "\"states\":[",
+                   i == 0 ? "" : ",", d->name, d->state_names[d->state]);
+    for (int s = 0; s < d->states; s++) {
+      // mW * us = nJ
+      double mj = (double)d->mw[s] * d->time_us[s] / 1e6;
+      total_mj += mj;
+      len += snprintf(buf + len, sizeof(buf) - len,
+                      "%s{\"state\":\"%s\",\"mw\":%u,\"s\":%.1f,"
+                      "\"mj\":%.0f}",
+                      s == 0 ? "" : ",", d->state_names[s], d->mw[s],
+                      d->time_us[s] / 1e6, mj);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "]}");
+    res = httpd_resp_send_chunk(req, buf, len);
+  }
+
+  if (res == ESP_OK) {
+    double elapsed_s = (now - s_start_us) / 1e6;
+    len = snprintf(buf, sizeof(buf),
+                   "],\"energy_mj\":%.0f,\"energy_mwh\":%.2f,"
+                   "\"avg_mw\":%.1f}",
+                   total_mj, total_mj / 3600.0,
+                   elapsed_s > 0 ? total_mj / elapsed_s : 0.0);
+    res = httpd_resp_send_chunk(req, buf, len);
+  }
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+esp_err_t power_policy_set_handler(httpd_req_t *req) {
+  char query[32];
+  char value[12];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+      httpd_query_key_value(query, "camera_idle_s", value, sizeof(value)) !=
+          ESP_OK) {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                               "Missing camera_idle_s");
+  }
+  char *end;
+  unsigned long seconds = strtoul(value, &end, 10);
+  if (end == value || *end != '\0' || seconds > CAMERA_IDLE_MAX_S) {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                               "Invalid camera_idle_s");
+  }
+
+  s_config.camera_idle_s = seconds;
+  ESP_LOGI(TAG, "Camera idle power-down %lu s", seconds);
+  if (camera_idle_save(seconds) != ESP_OK) {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                               "camera_idle_s applied but not saved");
+  }
+  return power_policy_handler(req);
+}
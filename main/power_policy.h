@@ -0,0 +1,105 @@
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Idle-aware power management
+ *
+ * - CPU: esp_pm dynamic frequency scaling between min_freq_mhz and
+ *   max_freq_mhz, with automatic light sleep when every task is blocked
+ *   (tickless idle, see sdkconfig.defaults). A CPU_FREQ_MAX lock is held
+ *   only while stream viewers are connected.
+ * - WiFi: modem sleep while no stream viewer is connected, full power
+ *   otherwise.
+ * - MQ-137: the ADC samples in short bursts and is stopped in between (see
+ *   mq137_adc.h), so it does not hold off light sleep.
+ * - Camera: light sleep is blocked while the camera captures (XCLK and the
+ *   DVP DMA must keep running). Once nothing has used the camera for
+ *   camera_idle_s, the camera_idle hook powers the sensor and its ALDO1
+ *   rail down; the next camera start powers them up again.
+ *
+ * Time spent in each state is accumulated and, with nominal power figures
+ * per state, turned into an energy estimate served at /api/power.
+ */
+
+typedef struct {
+  uint16_t max_freq_mhz;
+  uint16_t min_freq_mhz;
+  bool light_sleep;       // Automatic light sleep when idle
+  uint32_t camera_idle_s; // Camera power-down after this idle time, 0 = off
+} power_policy_config_t;
+
+#define POWER_POLICY_DEFAULT_CONFIG()                                         \
+  {                                                                           \
+      .max_freq_mhz = 240,                                                    \
+      .min_freq_mhz = 80,                                                     \
+      .light_sleep = true,                                                    \
+      .camera_idle_s = 600,                                                   \
+  }
+
+typedef enum {
+  POWER_CAMERA_OFF = 0, // Rail off
+  POWER_CAMERA_STANDBY, // Powered, sensor in standby
+  POWER_CAMERA_ON,      // Capturing
+} power_camera_state_t;
+
+typedef struct {
+  // Whether something needs the camera right now (viewers, armed motion
+  // detection)
+  bool (*camera_busy)(void);
+  // Called from the policy task when the idle time has run out; hands the
+  // power-down to the task that owns the camera. Called again after another
+  // idle period if the camera is still powered.
+  void (*camera_idle)(void);
+} power_policy_hooks_t;
+
+/**
+ * @brief Configure esp_pm and start the policy task
+ *
+ * Call after WiFi is started so the modem sleep setting sticks, and after
+ * nvs_flash_init() so a stored camera idle time is picked up.
+ *
+ * @param config Policy configuration
+ * @param hooks Camera hooks
+ * @return ESP_OK on success; if esp_pm is not available in this build the
+ *         policy still runs without DFS/light sleep
+ */
+esp_err_t power_policy_init(const power_policy_config_t *config,
+                            const power_policy_hooks_t *hooks);
+
+/**
+ * @brief Report a camera state change
+ */
+void power_policy_set_camera(power_camera_state_t state);
+
+/**
+ * @brief Mark the camera as used now (one-off consumers such as /capture)
+ */
+void power_policy_camera_used(void);
+
+/**
+ * @brief Report the number of connected stream viewers
+ */
+void power_policy_set_streams(int count);
+
+/**
+ * @brief URI handler for GET /api/power
+ *
+ * Returns the policy state and energy estimate.
+ */
+esp_err_t power_policy_handler(httpd_req_t *req);
+
+/**
+ * @brief URI handler for POST /api/power?camera_idle_s=N
+ *
+ * Changes the camera idle time (0-86400 s, 0 = never) and stores it in
+ * NVS, where it overrides the configured default from the next boot on.
+ * Responds like GET.
+ */
+esp_err_t power_policy_set_handler(httpd_req_t *req);
+
+#endif // POWER_POLICY_H
@@ -0,0 +1,109 @@
+#include "quality_ctrl.h"
+#include <stdbool.h>
+
+// Below this share of the target fps a viewer counts as falling behind
+#define FPS_MISS_PCT 85
+// A viewer falling behind is throughput-bound (and not just waiting for the
+// camera) while its measured throughput is below this share of its demand
+#define CONGESTED_PCT 110
+// Headroom needed before trying a better level
+#define HEADROOM_PCT 200
+// A step down within this time after a step up marks the probe as failed
+#define PROBE_WINDOW_US 30000000
+
+static uint32_t demand_kbps(const quality_sample_t *sample) {
+  return (uint64_t)sample->frame_bytes * 8 * sample->target_fps / 1000;
+}
+
+void quality_ctrl_init(quality_ctrl_t *ctrl, int levels, int level,
+                       int64_t now_us) {
+  *ctrl = (quality_ctrl_t){
+      .levels = levels,
+      .level = level,
+      .last_change_us = now_us,
+      .up_hold_us = QUALITY_CTRL_UP_HOLD_US,
+  };
+}
+
+uint32_t quality_ctrl_headroom_pct(const quality_sample_t *sample) {
+  uint32_t demand = demand_kbps(sample);
+  if (demand == 0) {
+    return UINT32_MAX;
+  }
+  uint64_t pct = (uint64_t)sample->throughput_kbps * 100 / demand;
+  return pct > UINT32_MAX ? UINT32_MAX : (uint32_t)pct;
+}
+
+static void change_level(quality_ctrl_t *ctrl, int level,
+                         const quality_sample_t *sample, int64_t now_us) {
+  int idx = (ctrl->hist_head + ctrl->hist_count) % QUALITY_CTRL_HISTORY;
+  if (ctrl->hist_count == QUALITY_CTRL_HISTORY) {
+    ctrl->hist_head = (ctrl->hist_head + 1) % QUALITY_CTRL_HISTORY;
+  } else {
+    ctrl->hist_count++;
+  }
+  ctrl->history[idx] = (quality_change_t){
+      .t_us = now_us,
+      .from = (uint8_t)ctrl->level,
+      .to = (uint8_t)level,
+      .throughput_kbps = sample->throughput_kbps,
+      .demand_kbps = demand_kbps(sample),
+  };
+  ctrl->changes++;
+
+  int dir = level < ctrl->level ? 1 : -1;
+  if (dir < 0 && ctrl->last_dir > 0 &&
+      now_us - ctrl->last_change_us < PROBE_WINDOW_US) {
+    // The better level didn't hold: wait longer before the next probe
+    ctrl->up_hold_us *= 2;
+    if (ctrl->up_hold_us > QUALITY_CTRL_UP_HOLD_MAX_US) {
+      ctrl->up_hold_us = QUALITY_CTRL_UP_HOLD_MAX_US;
+    }
+  } else if (dir > 0 && ctrl->last_dir > 0) {
+    ctrl->up_hold_us = QUALITY_CTRL_UP_HOLD_US; // Previous probe held
+  }
+
+  ctrl->level = level;
+  ctrl->last_dir = dir;
+  ctrl->last_change_us = now_us;
+  ctrl->headroom_since_us = 0;
+}
+
+int quality_ctrl_update(quality_ctrl_t *ctrl, const quality_sample_t *sample,
+                        int64_t now_us) {
+  uint32_t headroom = quality_ctrl_headroom_pct(sample);
+  bool on_target = sample->achieved_fps * 100 >=
+                   (float)sample->target_fps * FPS_MISS_PCT;
+
+  if (!on_target && headroom < CONGESTED_PCT) {
+    ctrl->headroom_since_us = 0;
+    if (ctrl->level < ctrl->levels - 1 &&
+        now_us - ctrl->last_change_us >= QUALITY_CTRL_DOWN_HOLD_US) {
+      change_level(ctrl, ctrl->level + 1, sample, now_us);
+    }
+    return ctrl->level;
+  }
+
+  if (!on_target || headroom < HEADROOM_PCT) {
+    ctrl->headroom_since_us = 0;
+    return ctrl->level;
+  }
+  if (ctrl->headroom_since_us == 0) {
+    ctrl->headroom_since_us = now_us;
+  }
+  if (ctrl->level > 0 &&
+      now_us - ctrl->headroom_since_us >= ctrl->up_hold_us &&
+      now_us - ctrl->last_change_us >= ctrl->up_hold_us) {
+    change_level(ctrl, ctrl->level - 1, sample, now_us);
+  }
+  return ctrl->level;
+}
+
+int quality_ctrl_history(const quality_ctrl_t *ctrl, quality_change_t *out,
+                         int max) {
+  int n = 0;
+  for (int i = ctrl->hist_count - 1; i >= 0 && n < max; i--) {
+    out[n++] = ctrl->history[(ctrl->hist_head + i) % QUALITY_CTRL_HISTORY];
+  }
+  return n;
+}
@@ -0,0 +1,102 @@
+#ifndef QUALITY_CTRL_H
+#define QUALITY_CTRL_H
+
+#include <stdint.h>
+
+/**
+ * @brief Stream operating point controller
+ *
+ * Picks a level on a ladder of camera settings (0 = best, each higher
+ * level cheaper to send) so the slowest viewer gets its target frame rate
+ * within the throughput its link delivers. The measurements come from the
+ * viewers' pacers (see stream_pacer.h); the ladder itself and applying a
+ * level to the sensor are up to the caller.
+ *
+ * Hysteresis keeps the level from oscillating:
+ * - it steps down as soon as a viewer misses its frame rate for lack of
+ *   throughput, but at most once per QUALITY_CTRL_DOWN_HOLD_US;
+ * - it steps up only after the demand of the current level has fitted into
+ *   half of the measured throughput for the whole up-hold time;
+ * - an up-step that has to be undone shortly afterwards doubles the
+ *   up-hold time, so a link sitting between two levels is probed less and
+ *   less often.
+ *
+ * Plain C with caller-supplied timestamps, so it has no FreeRTOS dependency.
+ */
+
+#define QUALITY_CTRL_HISTORY 16
+#define QUALITY_CTRL_DOWN_HOLD_US 2000000
+#define QUALITY_CTRL_UP_HOLD_US 10000000
+#define QUALITY_CTRL_UP_HOLD_MAX_US 160000000
+
+/**
+ * @brief Measurement for one viewer over one pacer window
+ */
+typedef struct {
+  int target_fps;
+  float achieved_fps;
+  uint32_t throughput_kbps;
+  uint32_t frame_bytes;
+} quality_sample_t;
+
+/**
+ * @brief A level change, as kept in the history
+ */
+typedef struct {
+  int64_t t_us;
+  uint8_t from;
+  uint8_t to;
+  uint32_t throughput_kbps; // Of the viewer that triggered the change
+  uint32_t demand_kbps;     // Frame size times target fps at the old level
+} quality_change_t;
+
+typedef struct {
+  int levels;
+  int level;
+  int64_t last_change_us;
+  int last_dir; // +1 after a step to a better level, -1 after a step down
+  int64_t up_hold_us;
+  int64_t headroom_since_us; // Start of the current headroom run, 0 = none
+
+  quality_change_t history[QUALITY_CTRL_HISTORY]; // Ring, oldest first
+  int hist_head;
+  int hist_count;
+  uint32_t changes;
+} quality_ctrl_t;
+
+/**
+ * @brief Initialize a controller
+ *
+ * @param ctrl Controller state
+ * @param levels Number of ladder levels
+ * @param level Initial level
+ * @param now_us Current time in microseconds
+ */
+void quality_ctrl_init(quality_ctrl_t *ctrl, int levels, int level,
+                       int64_t now_us);
+
+/**
+ * @brief Ratio of throughput to demand, in percent
+ *
+ * Used to pick the viewer the controller is fed with: the one with the
+ * lowest ratio.
+ */
+uint32_t quality_ctrl_headroom_pct(const quality_sample_t *sample);
+
+/**
+ * @brief Feed the measurement of the worst viewer
+ *
+ * @return The level to run at, possibly changed
+ */
+int quality_ctrl_update(quality_ctrl_t *ctrl, const quality_sample_t *sample,
+                        int64_t now_us);
+
+/**
+ * @brief Copy the change history, newest first
+ *
+ * @return Number of entries written to out
+ */
+int quality_ctrl_history(const quality_ctrl_t *ctrl, quality_change_t *out,
+                         int max);
+
+#endif // QUALITY_CTRL_H
@@ -0,0 +1,309 @@
+#include "sensor_history.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "History";
+
+typedef struct {
+  uint32_t t_ds;
+  float value;
+} raw_point_t;
+
+// Rollup bucket being accumulated; emitted once a sample of the next
+// bucket arrives
+typedef struct {
+  uint32_t bucket;
+  uint32_t count;
+  float min;
+  float max;
+  float sum;
+} rollup_acc_t;
+
+typedef struct {
+  raw_point_t *raw;
+  history_point_t *rollup[HISTORY_TIER_COUNT]; // MINUTE and HOUR only
+  uint32_t head[HISTORY_TIER_COUNT];           // Points ever written
+  rollup_acc_t acc[HISTORY_TIER_COUNT];        // MINUTE and HOUR only
+} sensor_series_t;
+
+static const uint32_t s_capacity[HISTORY_TIER_COUNT] = {
+    HISTORY_RAW_POINTS, HISTORY_MINUTE_POINTS, HISTORY_HOUR_POINTS};
+
+// Rollup bucket length in deciseconds
+static const uint32_t s_bucket_ds[HISTORY_TIER_COUNT] = {0, 600, 36000};
+
+static const char *const s_sensor_names[HISTORY_SENSOR_COUNT] = {
+    "ammonia", "temperature", "humidity"};
+
+static sensor_series_t s_series[HISTORY_SENSOR_COUNT];
+static SemaphoreHandle_t s_lock = NULL;
+
+esp_err_t sensor_history_init(void) {
+  if (s_lock != NULL) {
+    return ESP_OK;
+  }
+
+  size_t total = 0;
+  for (int i = 0; i < HISTORY_SENSOR_COUNT; i++) {
+    sensor_series_t *series = &s_series[i];
+    series->raw = heap_caps_calloc(HISTORY_RAW_POINTS, sizeof(raw_point_t),
+                                   MALLOC_CAP_SPIRAM);
+    series->rollup[HISTORY_TIER_MINUTE] = heap_caps_calloc(
+        HISTORY_MINUTE_POINTS, sizeof(history_point_t), MALLOC_CAP_SPIRAM);
+    series->rollup[HISTORY_TIER_HOUR] = heap_caps_calloc(
+        HISTORY_HOUR_POINTS, sizeof(history_point_t), MALLOC_CAP_SPIRAM);
+
+    if (series->raw == NULL || series->rollup[HISTORY_TIER_MINUTE] == NULL ||
+        series->rollup[HISTORY_TIER_HOUR] == NULL) {
+      ESP_LOGE(TAG, "Failed to allocate history buffers in PSRAM");
+      return ESP_ERR_NO_MEM;
+    }
+    total += HISTORY_RAW_POINTS * sizeof(raw_point_t) +
+             (HISTORY_MINUTE_POINTS + HISTORY_HOUR_POINTS) *
+                 sizeof(history_point_t);
+  }
+
+  s_lock = xSemaphoreCreateMutex();
+  if (s_lock == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  ESP_LOGI(TAG, "Sensor history ready (%u KB PSRAM)",
+           (unsigned)(total / 1024));
+  return ESP_OK;
+}
+
+static void rollup_add(sensor_series_t *series, history_tier_t tier,
+                       uint32_t t_ds, float value) {
+  rollup_acc_t *acc = &series->acc[tier];
+  uint32_t bucket = t_ds / s_bucket_ds[tier];
+
+  if (acc->count > 0 && bucket != acc->bucket) {
+    history_point_t *point =
+        &series->rollup[tier][series->head[tier] % s_capacity[tier]];
+    point->t_ds = acc->bucket * s_bucket_ds[tier];
+    point->min = acc->min;
+    point->max = acc->max;
+    point->mean = acc->sum / acc->count;
+    series->head[tier]++;
+    acc->count = 0;
+  }
+
+  if (acc->count == 0) {
+    acc->bucket = bucket;
+    acc->min = value;
+    acc->max = value;
+    acc->sum = 0.0f;
+  } else if (value < acc->min) {
+    acc->min = value;
+  } else if (value > acc->max) {
+    acc->max = value;
+  }
+  acc->sum += value;
+  acc->count++;
+}
+
+void sensor_history_record(history_sensor_t sensor, float value) {
+  if (s_lock == NULL || sensor >= HISTORY_SENSOR_COUNT) {
+    return;
+  }
+
+  uint32_t t_ds = (uint32_t)(esp_timer_get_time() / 100000);
+  sensor_series_t *series = &s_series[sensor];
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  raw_point_t *raw =
+      &series->raw[series->head[HISTORY_TIER_RAW] % HISTORY_RAW_POINTS];
+  raw->t_ds = t_ds;
+  raw->value = value;
+  series->head[HISTORY_TIER_RAW]++;
+
+  rollup_add(series, HISTORY_TIER_MINUTE, t_ds, value);
+  rollup_add(series, HISTORY_TIER_HOUR, t_ds, value);
+  xSemaphoreGive(s_lock);
+}
+
+static uint32_t point_time(const sensor_series_t *series, history_tier_t tier,
+                           uint32_t index) {
+  uint32_t slot = index % s_capacity[tier];
+  if (tier == HISTORY_TIER_RAW) {
+    return series->raw[slot].t_ds;
+  }
+  return series->rollup[tier][slot].t_ds;
+}
+
+static void get_point(const sensor_series_t *series, history_tier_t tier,
+                      uint32_t index, history_point_t *out) {
+  uint32_t slot = index % s_capacity[tier];
+  if (tier == HISTORY_TIER_RAW) {
+    out->t_ds = series->raw[slot].t_ds;
+    out->min = series->raw[slot].value;
+    out->max = out->min;
+    out->mean = out->min;
+  } else {
+    *out = series->rollup[tier][slot];
+  }
+}
+
+// Rollup in progress as a point; false for the raw tier or if it is empty
+static bool pending_point(const sensor_series_t *series, history_tier_t tier,
+                          history_point_t *out) {
+  const rollup_acc_t *acc = &series->acc[tier];
+  if (tier == HISTORY_TIER_RAW || acc->count == 0) {
+    return false;
+  }
+  out->t_ds = acc->bucket * s_bucket_ds[tier];
+  out->min = acc->min;
+  out->max = acc->max;
+  out->mean = acc->sum / acc->count;
+  return true;
+}
+
+// Folds a point into a step bucket; n is the number of points merged so far
+static void merge_point(history_point_t *bucket, uint32_t n,
+                        const history_point_t *p) {
+  if (n == 0) {
+    bucket->min = p->min;
+    bucket->max = p->max;
+    bucket->mean = p->mean;
+    return;
+  }
+  if (p->min < bucket->min) {
+    bucket->min = p->min;
+  }
+  if (p->max > bucket->max) {
+    bucket->max = p->max;
+  }
+  bucket->mean += (p->mean - bucket->mean) / (n + 1);
+}
+
+// Caller holds s_lock; merges [cursor->next, head) plus the rollup in
+// progress into step buckets. A bucket is only returned once the first point
+// of the next one is seen, so it never spans two calls; the bucket reaching
+// past head is the provisional last one.
+static size_t read_steps(const sensor_series_t *series, history_tier_t tier,
+                         uint32_t step_ds, uint32_t from_ds, uint32_t head,
+                         history_cursor_t *cursor, history_point_t *out,
+                         size_t max_points) {
+  history_point_t pending;
+  bool has_pending =
+      pending_point(series, tier, &pending) && pending.t_ds >= from_ds;
+  size_t count = 0;
+
+  while (count < max_points && !cursor->done) {
+    history_point_t p;
+    if (cursor->next < head) {
+      get_point(series, tier, cursor->next, &p);
+    } else if (has_pending) {
+      p = pending;
+    } else {
+      cursor->done = true;
+      break;
+    }
+
+    history_point_t *bucket = &out[count++];
+    uint32_t index = p.t_ds / step_ds;
+    uint32_t n = 0;
+    bucket->t_ds = index * step_ds;
+    while (true) {
+      merge_point(bucket, n++, &p);
+      if (cursor->next < head) {
+        cursor->next++;
+      } else {
+        cursor->done = true; // Merged the rollup in progress
+        break;
+      }
+      if (cursor->next < head) {
+        get_point(series, tier, cursor->next, &p);
+      } else if (has_pending) {
+        p = pending;
+      } else {
+        cursor->done = true;
+        break;
+      }
+      if (p.t_ds / step_ds != index) {
+        break;
+      }
+    }
+  }
+  return count;
+}
+
+size_t sensor_history_read(history_sensor_t sensor, history_tier_t tier,
+                           uint32_t step_ds, int64_t from_ms,
+                           history_cursor_t *cursor, history_point_t *out,
+                           size_t max_points) {
+  if (s_lock == NULL || sensor >= HISTORY_SENSOR_COUNT ||
+      tier >= HISTORY_TIER_COUNT || cursor->done) {
+    return 0;
+  }
+
+  const sensor_series_t *series = &s_series[sensor];
+  uint32_t from_ds = from_ms > 0 ? (uint32_t)(from_ms / 100) : 0;
+  size_t count = 0;
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  uint32_t head = series->head[tier];
+  uint32_t oldest = head > s_capacity[tier] ? head - s_capacity[tier] : 0;
+
+  if (!cursor->started) {
+    // Timestamps are monotonic, so binary search for the first point
+    uint32_t lo = oldest;
+    uint32_t hi = head;
+    while (lo < hi) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      if (point_time(series, tier, mid) < from_ds) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    cursor->next = lo;
+    cursor->started = true;
+  } else if (cursor->next < oldest) {
+    // The writer overtook us; continue with what is still kept
+    cursor->next = oldest;
+  }
+
+  if (step_ds > 0) {
+    count = read_steps(series, tier, step_ds, from_ds, head, cursor, out,
+                       max_points);
+  } else {
+    while (count < max_points && cursor->next < head) {
+      get_point(series, tier, cursor->next++, &out[count++]);
+    }
+    // Then the rollup in progress, once
+    if (count < max_points && cursor->next == head &&
+        pending_point(series, tier, &out[count]) &&
+        out[count].t_ds >= from_ds) {
+      count++;
+      cursor->done = true;
+    }
+  }
+  xSemaphoreGive(s_lock);
+
+  return count;
+}
+
+history_tier_t sensor_history_tier_for_step(uint32_t step_ds) {
+  if (step_ds >= s_bucket_ds[HISTORY_TIER_HOUR]) {
+    return HISTORY_TIER_HOUR;
+  }
+  if (step_ds >= s_bucket_ds[HISTORY_TIER_MINUTE]) {
+    return HISTORY_TIER_MINUTE;
+  }
+  return HISTORY_TIER_RAW;
+}
+
+history_sensor_t sensor_history_sensor_from_name(const char *name) {
+  for (int i = 0; i < HISTORY_SENSOR_COUNT; i++) {
+    if (strcmp(name, s_sensor_names[i]) == 0) {
+      return (history_sensor_t)i;
+    }
+  }
+  return HISTORY_SENSOR_COUNT;
+}
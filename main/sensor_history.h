@@ -0,0 +1,120 @@
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief On-device sensor time-series store
+ *
+ * Every sensor keeps three ring buffers in PSRAM: raw samples, 1-minute and
+ * 1-hour rollups (min/max/mean). Rollups are updated incrementally as
+ * samples are recorded, so recording is O(1) and never rescans history.
+ * Readers copy small batches out under the lock, so a large query can be
+ * streamed without blocking the sensor tasks or buffering the whole result.
+ *
+ * Timestamps are uptime in deciseconds (stored as 32 bit), exposed as
+ * milliseconds since boot.
+ */
+
+typedef enum {
+  HISTORY_AMMONIA_MV = 0,
+  HISTORY_TEMPERATURE,
+  HISTORY_HUMIDITY,
+  HISTORY_SENSOR_COUNT,
+} history_sensor_t;
+
+typedef enum {
+  HISTORY_TIER_RAW = 0,
+  HISTORY_TIER_MINUTE,
+  HISTORY_TIER_HOUR,
+  HISTORY_TIER_COUNT,
+} history_tier_t;
+
+// Ring capacities in points per sensor
+#define HISTORY_RAW_POINTS 16384   // ~2.3 h of ammonia at 2 Hz
+#define HISTORY_MINUTE_POINTS 10080 // 7 days
+#define HISTORY_HOUR_POINTS 8760    // 1 year
+
+/**
+ * @brief One history point; raw points have min == max == mean
+ */
+typedef struct {
+  uint32_t t_ds; // Uptime in deciseconds (start of bucket for rollups)
+  float min;
+  float max;
+  float mean;
+} history_point_t;
+
+/**
+ * @brief Read position for sensor_history_read(), zero-initialize to start
+ */
+typedef struct {
+  uint32_t next; // Absolute index of the next point to read
+  bool started;  // False until the start point has been located
+  bool done;     // Provisional last point returned, nothing follows
+} history_cursor_t;
+
+/**
+ * @brief Allocate the ring buffers in PSRAM
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if PSRAM is not available
+ */
+esp_err_t sensor_history_init(void);
+
+/**
+ * @brief Record a sample at the current time
+ *
+ * Must only be called from one task per sensor.
+ */
+void sensor_history_record(history_sensor_t sensor, float value);
+
+/**
+ * @brief Read points in chronological order
+ *
+ * Call repeatedly with the same cursor until it returns 0. If the writer
+ * overtakes a slow reader, reading resumes at the oldest point still kept.
+ *
+ * With step_ds = 0 the tier's own points are returned. Otherwise points
+ * are merged into buckets of step_ds aligned to uptime 0: min of the
+ * minima, max of the maxima and the mean of the means. Use a step that is
+ * a multiple of the tier's resolution.
+ *
+ * Except for raw points at step_ds = 0, the last point returned is
+ * provisional: the bucket still being filled (the rollup in progress, or
+ * the newest step bucket), updated by later samples. It ends the read.
+ *
+ * @param sensor Sensor to read
+ * @param tier Resolution tier
+ * @param step_ds Bucket length in deciseconds, 0 = the tier's own points
+ * @param from_ms Skip points older than this (ms since boot)
+ * @param cursor Read position, zero-initialized before the first call
+ * @param out Output buffer
+ * @param max_points Capacity of out
+ * @return Number of points copied to out
+ */
+size_t sensor_history_read(history_sensor_t sensor, history_tier_t tier,
+                           uint32_t step_ds, int64_t from_ms,
+                           history_cursor_t *cursor, history_point_t *out,
+                           size_t max_points);
+
+/**
+ * @brief Coarsest tier that still resolves a step
+ *
+ * @param step_ds Step in deciseconds
+ * @return HISTORY_TIER_HOUR for a step of an hour or more,
+ *         HISTORY_TIER_MINUTE for a minute or more, HISTORY_TIER_RAW
+ *         otherwise
+ */
+history_tier_t sensor_history_tier_for_step(uint32_t step_ds);
+
+/**
+ * @brief Look up a sensor by its API name ("ammonia", "temperature", ...)
+ *
+ * @return Sensor id, or HISTORY_SENSOR_COUNT if the name is unknown
+ */
+history_sensor_t sensor_history_sensor_from_name(const char *name);
+
+#endif // SENSOR_HISTORY_H
@@ -0,0 +1,132 @@
+#include "sensor_snapshot.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <stdatomic.h>
+
+// Even: data stable; odd: a writer is updating it
+static atomic_uint s_seq = 0;
+static sensor_snapshot_t s_data;
+
+// Serializes the writers (the sensor tasks may run on different cores);
+// also guards the sample log
+static portMUX_TYPE s_write_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Sample of version v at s_log[v % SENSOR_SNAPSHOT_LOG_SIZE]
+static sensor_sample_t s_log[SENSOR_SNAPSHOT_LOG_SIZE];
+
+// Newest sample per sensor_sample_kind_t, version 0 = none yet; kept by
+// the writers so the lookup does not scan the log
+#define SAMPLE_KINDS 2
+static sensor_sample_t s_latest[SAMPLE_KINDS];
+
+static void write_begin(void) {
+  portENTER_CRITICAL(&s_write_lock);
+  atomic_fetch_add_explicit(&s_seq, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+// Caller holds s_write_lock; logs the sample of the version being written
+static sensor_sample_t *log_slot(sensor_sample_kind_t kind, int64_t now) {
+  uint32_t version = s_data.version + 1;
+  sensor_sample_t *slot = &s_log[version % SENSOR_SNAPSHOT_LOG_SIZE];
+  slot->version = version;
+  slot->kind = kind;
+  slot->time_us = now;
+  return slot;
+}
+
+// Publishes the logged sample as the newest of its kind
+static void write_end(const sensor_sample_t *slot) {
+  s_latest[slot->kind] = *slot;
+  s_data.version++;
+  atomic_fetch_add_explicit(&s_seq, 1, memory_order_release);
+  portEXIT_CRITICAL(&s_write_lock);
+}
+
+void sensor_snapshot_publish_ammonia(int raw, int voltage_mv,
+                                     float variance, float ppm) {
+  int64_t now = esp_timer_get_time();
+
+  write_begin();
+  s_data.ammonia_raw = raw;
+  s_data.ammonia_voltage_mv = voltage_mv;
+  s_data.ammonia_variance = variance;
+  s_data.ammonia_ppm = ppm;
+  s_data.ammonia_seq++;
+  s_data.ammonia_time_us = now;
+  sensor_sample_t *slot = log_slot(SENSOR_SAMPLE_AMMONIA, now);
+  slot->ammonia.raw = raw;
+  slot->ammonia.voltage_mv = voltage_mv;
+  slot->ammonia.variance = variance;
+  slot->ammonia.ppm = ppm;
+  write_end(slot);
+}
+
+void sensor_snapshot_publish_sht30(float temperature, float humidity) {
+  int64_t now = esp_timer_get_time();
+
+  write_begin();
+  s_data.temperature = temperature;
+  s_data.humidity = humidity;
+  s_data.sht30_seq++;
+  s_data.sht30_time_us = now;
+  sensor_sample_t *slot = log_slot(SENSOR_SAMPLE_SHT30, now);
+  slot->sht30.temperature = temperature;
+  slot->sht30.humidity = humidity;
+  write_end(slot);
+}
+
+void sensor_snapshot_read(sensor_snapshot_t *out) {
+  unsigned begin;
+  unsigned end = 0;
+
+  do {
+    begin = atomic_load_explicit(&s_seq, memory_order_acquire);
+    if (begin & 1) {
+      continue; // Writer in progress
+    }
+    *out = s_data;
+    atomic_thread_fence(memory_order_acquire);
+    end = atomic_load_explicit(&s_seq, memory_order_relaxed);
+  } while ((begin & 1) || begin != end);
+}
+
+// Caller holds s_write_lock
+static uint32_t log_oldest(uint32_t latest) {
+  if (latest == 0) {
+    return 0;
+  }
+  return latest > SENSOR_SNAPSHOT_LOG_SIZE
+             ? latest - SENSOR_SNAPSHOT_LOG_SIZE + 1
+             : 1;
+}
+
+size_t sensor_snapshot_log_read(uint32_t since, sensor_sample_t *out,
+                                size_t max, uint32_t *oldest) {
+  size_t n = 0;
+
+  portENTER_CRITICAL(&s_write_lock);
+  uint32_t latest = s_data.version;
+  uint32_t first = log_oldest(latest);
+  *oldest = first;
+  uint32_t v = since + 1 > first ? since + 1 : first;
+  if (first != 0 && since < latest) {
+    for (; v <= latest && n < max; v++) {
+      out[n++] = s_log[v % SENSOR_SNAPSHOT_LOG_SIZE];
+    }
+  }
+  portEXIT_CRITICAL(&s_write_lock);
+  return n;
+}
+
+bool sensor_snapshot_log_latest(sensor_sample_kind_t kind,
+                                sensor_sample_t *out) {
+  if ((unsigned)kind >= SAMPLE_KINDS) {
+    return false;
+  }
+
+  portENTER_CRITICAL(&s_write_lock);
+  *out = s_latest[kind];
+  portEXIT_CRITICAL(&s_write_lock);
+  return out->version != 0;
+}
@@ -0,0 +1,114 @@
+#ifndef SENSOR_SNAPSHOT_H
+#define SENSOR_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Consistent snapshot of the latest sensor readings
+ *
+ * The sensor tasks publish into a single struct guarded by a seqlock:
+ * writers (serialized by a spinlock) bump the sequence to odd, update the
+ * data and bump it back to even; readers copy the struct lock-free and
+ * retry if the sequence was odd or changed meanwhile. A reader therefore
+ * never sees a temperature from one sample and a humidity from the next.
+ */
+
+typedef struct {
+  uint32_t version; // Incremented on every publish of any sensor
+
+  // MQ-137 ammonia sensor
+  int ammonia_raw;        // ADC raw counts
+  int ammonia_voltage_mv; // Calibrated voltage
+  float ammonia_variance; // Variance of the raw block (counts^2)
+  float ammonia_ppm;      // NH3 concentration, NaN if not calibrated
+  uint32_t ammonia_seq;   // Sample number, 0 = no sample yet
+  int64_t ammonia_time_us; // Sample time (esp_timer clock)
+
+  // SHT30 temperature & humidity sensor
+  float temperature;     // °C
+  float humidity;        // %RH
+  uint32_t sht30_seq;    // Sample number, 0 = no sample yet
+  int64_t sht30_time_us; // Sample time (esp_timer clock)
+} sensor_snapshot_t;
+
+/**
+ * @brief Log of the most recent samples, keyed by snapshot version
+ *
+ * Every publish also appends the sample to a ring, stamped with the
+ * version it produced. Versions are consecutive, so the sample for version
+ * v sits at a fixed slot and a reader resumes after any version in O(1).
+ */
+#define SENSOR_SNAPSHOT_LOG_SIZE 512 // ~2 min of both sensors at 2 Hz
+
+typedef enum {
+  SENSOR_SAMPLE_AMMONIA = 0,
+  SENSOR_SAMPLE_SHT30,
+} sensor_sample_kind_t;
+
+typedef struct {
+  uint32_t version; // Snapshot version this sample produced
+  uint8_t kind;     // sensor_sample_kind_t
+  int64_t time_us;  // Sample time (esp_timer clock)
+  union {
+    struct {
+      int raw;
+      int voltage_mv;
+      float variance;
+      float ppm;
+    } ammonia;
+    struct {
+      float temperature;
+      float humidity;
+    } sht30;
+  };
+} sensor_sample_t;
+
+/**
+ * @brief Publish a new MQ-137 sample
+ *
+ * @param ppm Converted concentration (mq137_ppm.h), NaN if unavailable
+ */
+void sensor_snapshot_publish_ammonia(int raw, int voltage_mv,
+                                     float variance, float ppm);
+
+/**
+ * @brief Publish a new SHT30 sample
+ */
+void sensor_snapshot_publish_sht30(float temperature, float humidity);
+
+/**
+ * @brief Copy a consistent snapshot of all readings
+ *
+ * Lock-free; safe to call from any task.
+ */
+void sensor_snapshot_read(sensor_snapshot_t *out);
+
+/**
+ * @brief Copy logged samples newer than a version, oldest first
+ *
+ * If the log no longer reaches back to since + 1, reading starts at the
+ * oldest sample still kept.
+ *
+ * @param since Return samples with a version above this
+ * @param out Output buffer
+ * @param max Capacity of out
+ * @param oldest Output, version of the oldest sample kept (0 = log empty)
+ * @return Number of samples copied
+ */
+size_t sensor_snapshot_log_read(uint32_t since, sensor_sample_t *out,
+                                size_t max, uint32_t *oldest);
+
+/**
+ * @brief Copy the newest sample of one sensor
+ *
+ * O(1): the writers keep the newest sample of each sensor aside, so it is
+ * found even after the other sensor has filled the whole log since.
+ *
+ * @return false if that sensor has not published yet
+ */
+bool sensor_snapshot_log_latest(sensor_sample_kind_t kind,
+                                sensor_sample_t *out);
+
+#endif // SENSOR_SNAPSHOT_H
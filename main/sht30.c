@@ -1,6 +1,7 @@
 #include "sht30.h"
 #include "driver/i2c_master.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -16,13 +17,35 @@ static const char *TAG = "SHT30";
 #define SHT30_CMD_MEASURE_HIGH_REP_MSB 0x24
 #define SHT30_CMD_MEASURE_HIGH_REP_LSB 0x00
 
+// Periodic mode commands
+#define SHT30_CMD_FETCH_DATA 0xE000
+#define SHT30_CMD_BREAK 0x3093
+
+// A fetch that keeps returning no data for this many periods is an error
+#define SHT30_FETCH_MISS_PERIODS 3
+
+typedef struct {
+  uint16_t cmd;       // Periodic, high repeatability
+  uint32_t period_ms; // Time between measurements
+} sht30_rate_info_t;
+
+static const sht30_rate_info_t s_rates[] = {
+    [SHT30_RATE_0_5_MPS] = {0x2032, 2000},
+    [SHT30_RATE_1_MPS] = {0x2130, 1000},
+    [SHT30_RATE_2_MPS] = {0x2236, 500},
+    [SHT30_RATE_4_MPS] = {0x2334, 250},
+    [SHT30_RATE_10_MPS] = {0x2737, 100},
+};
+
 static i2c_master_bus_handle_t s_bus_handle = NULL;
 static i2c_master_dev_handle_t s_dev_handle = NULL;
 
-/**
- * @brief CRC-8 calculation for SHT30
- */
-static uint8_t sht30_crc8(const uint8_t *data, size_t len) {
+// Periodic mode state
+static bool s_periodic = false;
+static int64_t s_period_us = 0;
+static int64_t s_next_due_us = 0; // Earliest time a new result can exist
+
+uint8_t sht30_crc8(const uint8_t *data, size_t len) {
   uint8_t crc = 0xFF;
   for (size_t i = 0; i < len; i++) {
     crc ^= data[i];
@@ -37,6 +60,42 @@ static uint8_t sht30_crc8(const uint8_t *data, size_t len) {
   return crc;
 }
 
+esp_err_t sht30_parse(const uint8_t data[6], float *temperature,
+                      float *humidity) {
+  // Verify CRC for temperature and humidity
+  if (sht30_crc8(&data[0], 2) != data[2] ||
+      sht30_crc8(&data[3], 2) != data[5]) {
+    return ESP_ERR_INVALID_CRC;
+  }
+
+  // Calculate temperature: T = -45 + 175 * (raw / 65535)
+  uint16_t raw_temp = (data[0] << 8) | data[1];
+  *temperature = -45.0f + 175.0f * ((float)raw_temp / 65535.0f);
+
+  // Calculate humidity: RH = 100 * (raw / 65535)
+  uint16_t raw_hum = (data[3] << 8) | data[4];
+  *humidity = 100.0f * ((float)raw_hum / 65535.0f);
+
+  return ESP_OK;
+}
+
+// sht30_parse() does not log, so it builds without ESP-IDF; bus reads do
+static esp_err_t parse_logged(const uint8_t data[6], float *temperature,
+                              float *humidity) {
+  esp_err_t ret = sht30_parse(data, temperature, humidity);
+  if (ret == ESP_ERR_INVALID_CRC) {
+    ESP_LOGW(TAG, "%s CRC mismatch",
+             sht30_crc8(&data[0], 2) != data[2] ? "Temperature" : "Humidity");
+  }
+  return ret;
+}
+
+static esp_err_t sht30_send_cmd(uint16_t cmd) {
+  uint8_t buf[2] = {cmd >> 8, cmd & 0xFF};
+  return i2c_master_transmit(s_dev_handle, buf, sizeof(buf),
+                             pdMS_TO_TICKS(100));
+}
+
 esp_err_t sht30_init(void) {
   esp_err_t ret;
 
@@ -90,7 +149,7 @@ esp_err_t sht30_init(void) {
 }
 
 esp_err_t sht30_read(float *temperature, float *humidity) {
-  if (s_dev_handle == NULL) {
+  if (s_dev_handle == NULL || s_periodic) {
     return ESP_ERR_INVALID_STATE;
   }
 
@@ -117,30 +176,87 @@ esp_err_t sht30_read(float *temperature, float *humidity) {
     return ret;
   }
 
-  // Verify CRC for temperature
-  if (sht30_crc8(&data[0], 2) != data[2]) {
-    ESP_LOGW(TAG, "Temperature CRC mismatch");
-    return ESP_ERR_INVALID_CRC;
-  }
+  return parse_logged(data, temperature, humidity);
+}
 
-  // Verify CRC for humidity
-  if (sht30_crc8(&data[3], 2) != data[5]) {
-    ESP_LOGW(TAG, "Humidity CRC mismatch");
-    return ESP_ERR_INVALID_CRC;
+uint32_t sht30_rate_period_ms(sht30_rate_t rate) {
+  return s_rates[rate].period_ms;
+}
+
+esp_err_t sht30_start_periodic(sht30_rate_t rate) {
+  if (s_dev_handle == NULL || rate > SHT30_RATE_10_MPS) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (s_periodic) {
+    esp_err_t ret = sht30_stop_periodic();
+    if (ret != ESP_OK) {
+      return ret;
+    }
+    vTaskDelay(pdMS_TO_TICKS(2)); // Sensor needs 1 ms after a break
   }
 
-  // Calculate temperature: T = -45 + 175 * (raw / 65535)
-  uint16_t raw_temp = (data[0] << 8) | data[1];
-  *temperature = -45.0f + 175.0f * ((float)raw_temp / 65535.0f);
+  esp_err_t ret = sht30_send_cmd(s_rates[rate].cmd);
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "Failed to start periodic mode: %s", esp_err_to_name(ret));
+    return ret;
+  }
 
-  // Calculate humidity: RH = 100 * (raw / 65535)
-  uint16_t raw_hum = (data[3] << 8) | data[4];
-  *humidity = 100.0f * ((float)raw_hum / 65535.0f);
+  s_periodic = true;
+  s_period_us = (int64_t)s_rates[rate].period_ms * 1000;
+  s_next_due_us = esp_timer_get_time() + s_period_us;
+  ESP_LOGI(TAG, "Periodic mode started (%lu ms period)",
+           (unsigned long)s_rates[rate].period_ms);
+  return ESP_OK;
+}
 
+esp_err_t sht30_stop_periodic(void) {
+  if (!s_periodic) {
+    return ESP_OK;
+  }
+  esp_err_t ret = sht30_send_cmd(SHT30_CMD_BREAK);
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "Failed to stop periodic mode: %s", esp_err_to_name(ret));
+    return ret;
+  }
+  s_periodic = false;
   return ESP_OK;
 }
 
+esp_err_t sht30_fetch(float *temperature, float *humidity) {
+  if (s_dev_handle == NULL || !s_periodic) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  int64_t now = esp_timer_get_time();
+  if (now < s_next_due_us) {
+    return ESP_ERR_NOT_FINISHED; // No new measurement yet; skip the bus
+  }
+
+  uint8_t data[6];
+  esp_err_t ret = sht30_send_cmd(SHT30_CMD_FETCH_DATA);
+  if (ret == ESP_OK) {
+    // The sensor NACKs the read header when no new data is available
+    ret = i2c_master_receive(s_dev_handle, data, sizeof(data),
+                             pdMS_TO_TICKS(100));
+  }
+  if (ret != ESP_OK) {
+    if (now - s_next_due_us < SHT30_FETCH_MISS_PERIODS * s_period_us) {
+      return ESP_ERR_NOT_FINISHED;
+    }
+    ESP_LOGW(TAG, "No periodic data: %s", esp_err_to_name(ret));
+    s_next_due_us = now + s_period_us;
+    return ret;
+  }
+
+  // Fetching clears the result; the next one is a full period away
+  s_next_due_us = now + s_period_us;
+  return parse_logged(data, temperature, humidity);
+}
+
 esp_err_t sht30_deinit(void) {
+  if (s_periodic) {
+    sht30_stop_periodic();
+  }
   if (s_dev_handle != NULL) {
     i2c_master_bus_rm_device(s_dev_handle);
     s_dev_handle = NULL;
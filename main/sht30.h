@@ -2,6 +2,8 @@
 #define SHT30_H
 
 #include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
 
 /**
  * @brief SHT30 温湿度传感器驱动
@@ -28,6 +30,80 @@ esp_err_t sht30_init(void);
  */
 esp_err_t sht30_read(float *temperature, float *humidity);
 
+/**
+ * @brief 周期测量频率 (每秒测量次数, mps)
+ */
+typedef enum {
+  SHT30_RATE_0_5_MPS = 0,
+  SHT30_RATE_1_MPS,
+  SHT30_RATE_2_MPS,
+  SHT30_RATE_4_MPS,
+  SHT30_RATE_10_MPS,
+} sht30_rate_t;
+
+/**
+ * @brief 启动周期测量模式 (高重复性)
+ *
+ * 传感器按设定频率自行测量, 之后用 sht30_fetch() 取回最新结果。
+ * 周期模式下 sht30_read() 不可用。
+ *
+ * @param rate 测量频率
+ * @return ESP_OK 成功, 其他值表示错误
+ */
+esp_err_t sht30_start_periodic(sht30_rate_t rate);
+
+/**
+ * @brief 停止周期测量模式 (Break 命令)
+ *
+ * @return ESP_OK 成功, 其他值表示错误
+ */
+esp_err_t sht30_stop_periodic(void);
+
+/**
+ * @brief 非阻塞读取周期测量结果
+ *
+ * 不会挂起调用任务: 未到下一个测量周期时不访问总线, 直接返回;
+ * 到期后发送 Fetch Data 命令并读取结果。
+ *
+ * @param temperature 输出温度值 (摄氏度)
+ * @param humidity 输出相对湿度值 (%)
+ * @return ESP_OK 有新数据, ESP_ERR_NOT_FINISHED 尚无新数据,
+ *         ESP_ERR_INVALID_STATE 未启动周期模式, 其他值表示错误
+ */
+esp_err_t sht30_fetch(float *temperature, float *humidity);
+
+/**
+ * @brief 测量周期 (毫秒)
+ *
+ * @param rate 测量频率
+ * @return 两次测量之间的间隔
+ */
+uint32_t sht30_rate_period_ms(sht30_rate_t rate);
+
+/**
+ * @brief SHT30 CRC-8 校验 (多项式 0x31, 初值 0xFF)
+ *
+ * 纯计算, 不访问总线, 可在主机上单独编译测试
+ *
+ * @param data 数据
+ * @param len 数据长度
+ * @return CRC 值
+ */
+uint8_t sht30_crc8(const uint8_t *data, size_t len);
+
+/**
+ * @brief 校验并换算 6 字节测量结果 (T, CRC, RH, CRC)
+ *
+ * 纯计算, 不访问总线, 也不打印日志 (CRC 错误由调用方记录)
+ *
+ * @param data 传感器返回的 6 字节
+ * @param temperature 输出温度值 (摄氏度)
+ * @param humidity 输出相对湿度值 (%)
+ * @return ESP_OK 成功, ESP_ERR_INVALID_CRC 校验失败
+ */
+esp_err_t sht30_parse(const uint8_t data[6], float *temperature,
+                      float *humidity);
+
 /**
  * @brief 释放 SHT30 资源
  *
@@ -0,0 +1,103 @@
+#include "signal_filter.h"
+
+void filter_stats_reset(filter_stats_t *stats) {
+  stats->count = 0;
+  stats->sum = 0;
+  stats->sum_sq = 0;
+}
+
+void filter_stats_add(filter_stats_t *stats, const uint16_t *samples,
+                      size_t count) {
+  uint32_t sum = 0;    // A block of 12-bit samples fits comfortably
+  uint64_t sum_sq = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t x = samples[i];
+    sum += x;
+    sum_sq += x * x;
+  }
+  stats->count += count;
+  stats->sum += sum;
+  stats->sum_sq += sum_sq;
+}
+
+float filter_stats_mean(const filter_stats_t *stats) {
+  if (stats->count == 0) {
+    return 0.0f;
+  }
+  return (float)stats->sum / stats->count;
+}
+
+float filter_stats_variance(const filter_stats_t *stats) {
+  if (stats->count == 0) {
+    return 0.0f;
+  }
+  // n * sum(x^2) - sum(x)^2 is exact in 64-bit integers for 12-bit samples
+  uint64_t n = stats->count;
+  uint64_t num = n * stats->sum_sq - stats->sum * stats->sum;
+  return (float)num / ((float)n * (float)n);
+}
+
+static void swap(uint16_t *a, uint16_t *b) {
+  uint16_t t = *a;
+  *a = *b;
+  *b = t;
+}
+
+uint16_t filter_median(uint16_t *samples, size_t count) {
+  size_t k = count / 2;
+  size_t lo = 0;
+  size_t hi = count - 1;
+
+  // Hoare-style quickselect with middle pivot
+  while (lo < hi) {
+    uint16_t pivot = samples[lo + (hi - lo) / 2];
+    size_t i = lo;
+    size_t j = hi;
+    while (i <= j) {
+      while (samples[i] < pivot) {
+        i++;
+      }
+      while (samples[j] > pivot) {
+        j--;
+      }
+      if (i <= j) {
+        swap(&samples[i], &samples[j]);
+        i++;
+        if (j == 0) {
+          break;
+        }
+        j--;
+      }
+    }
+    if (k <= j) {
+      hi = j;
+    } else if (k >= i) {
+      lo = i;
+    } else {
+      break; // k lies between the partitions: already in place
+    }
+  }
+  return samples[k];
+}
+
+void filter_iir_init(filter_iir_t *iir, uint8_t shift) {
+  iir->state_q16 = 0;
+  iir->shift = shift;
+  iir->primed = false;
+}
+
+uint16_t filter_iir_update(filter_iir_t *iir, const uint16_t *samples,
+                           size_t count) {
+  size_t i = 0;
+  if (!iir->primed && count > 0) {
+    iir->state_q16 = (int32_t)samples[0] << 16;
+    iir->primed = true;
+    i = 1;
+  }
+  for (; i < count; i++) {
+    int32_t x_q16 = (int32_t)samples[i] << 16;
+    iir->state_q16 += (x_q16 - iir->state_q16) >> iir->shift;
+  }
+  // Round to nearest
+  return (uint16_t)((iir->state_q16 + (1 << 15)) >> 16);
+}
@@ -0,0 +1,77 @@
+#ifndef SIGNAL_FILTER_H
+#define SIGNAL_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Filter kernels for ADC sample blocks
+ *
+ * Plain C on integer samples with no ESP-IDF dependency, so they can be
+ * built and exercised on a host.
+ */
+
+/**
+ * @brief Running mean / variance over a stream of samples
+ *
+ * Exact integer sums; 12-bit samples cannot overflow 64-bit sums of
+ * squares for any realistic block length.
+ */
+typedef struct {
+  uint32_t count;
+  uint64_t sum;
+  uint64_t sum_sq;
+} filter_stats_t;
+
+void filter_stats_reset(filter_stats_t *stats);
+
+/**
+ * @brief Add a block of samples
+ */
+void filter_stats_add(filter_stats_t *stats, const uint16_t *samples,
+                      size_t count);
+
+/**
+ * @brief Mean of all samples added since the last reset (0 if empty)
+ */
+float filter_stats_mean(const filter_stats_t *stats);
+
+/**
+ * @brief Population variance of all samples added since the last reset
+ */
+float filter_stats_variance(const filter_stats_t *stats);
+
+/**
+ * @brief Median of a block (quickselect, O(n) average)
+ *
+ * Reorders the samples in place.
+ *
+ * @param samples Sample block, at least one element
+ * @param count Number of samples
+ * @return Median value (upper median for even counts)
+ */
+uint16_t filter_median(uint16_t *samples, size_t count);
+
+/**
+ * @brief First-order IIR low-pass (exponential moving average)
+ *
+ * y += (x - y) / 2^shift, computed in Q16 fixed point.
+ */
+typedef struct {
+  int32_t state_q16;
+  uint8_t shift;
+  bool primed;
+} filter_iir_t;
+
+void filter_iir_init(filter_iir_t *iir, uint8_t shift);
+
+/**
+ * @brief Feed a block of samples and return the filtered value
+ *
+ * The first sample after init primes the filter directly.
+ */
+uint16_t filter_iir_update(filter_iir_t *iir, const uint16_t *samples,
+                           size_t count);
+
+#endif // SIGNAL_FILTER_H
@@ -0,0 +1,72 @@
+#include "stream_pacer.h"
+
+// Length of the window the achieved frame rate is measured over
+#define FPS_WINDOW_US 2000000
+
+// Smoothing for latency / send time: avg += (sample - avg) / 8
+#define SMOOTH_SHIFT 3
+
+void stream_pacer_init(stream_pacer_t *pacer, int target_fps, int64_t now_us) {
+  if (target_fps < STREAM_PACER_MIN_FPS) {
+    target_fps = STREAM_PACER_MIN_FPS;
+  } else if (target_fps > STREAM_PACER_MAX_FPS) {
+    target_fps = STREAM_PACER_MAX_FPS;
+  }
+
+  *pacer = (stream_pacer_t){
+      .target_fps = target_fps,
+      .interval_us = 1000000 / target_fps,
+      .next_due_us = now_us,
+      .window_start_us = now_us,
+  };
+}
+
+int64_t stream_pacer_wait_us(const stream_pacer_t *pacer, int64_t now_us) {
+  int64_t wait = pacer->next_due_us - now_us;
+  return wait > 0 ? wait : 0;
+}
+
+static void advance_deadline(stream_pacer_t *pacer, int64_t now_us) {
+  pacer->next_due_us += pacer->interval_us;
+  // More than one interval behind: don't burst, restart from now
+  if (pacer->next_due_us + pacer->interval_us < now_us) {
+    pacer->next_due_us = now_us + pacer->interval_us;
+  }
+}
+
+void stream_pacer_on_sent(stream_pacer_t *pacer, size_t len,
+                          int64_t capture_us, int64_t send_start_us,
+                          int64_t send_end_us) {
+  pacer->frames_sent++;
+  pacer->window_frames++;
+  pacer->window_bytes += len;
+
+  int64_t latency = send_end_us - capture_us;
+  int64_t send = send_end_us - send_start_us;
+  pacer->latency_us += (latency - pacer->latency_us) >> SMOOTH_SHIFT;
+  pacer->send_us += (send - pacer->send_us) >> SMOOTH_SHIFT;
+  pacer->window_send_us += send;
+
+  int64_t window = send_end_us - pacer->window_start_us;
+  if (window >= FPS_WINDOW_US) {
+    pacer->achieved_fps = pacer->window_frames * 1000000.0f / window;
+    pacer->frame_bytes = pacer->window_bytes / pacer->window_frames;
+    // bits per millisecond of write time; never blocked = unbounded
+    uint64_t kbps = pacer->window_send_us > 0
+                        ? pacer->window_bytes * 8000 / pacer->window_send_us
+                        : UINT32_MAX;
+    pacer->throughput_kbps = kbps > UINT32_MAX ? UINT32_MAX : (uint32_t)kbps;
+    pacer->windows++;
+    pacer->window_frames = 0;
+    pacer->window_bytes = 0;
+    pacer->window_send_us = 0;
+    pacer->window_start_us = send_end_us;
+  }
+
+  advance_deadline(pacer, send_end_us);
+}
+
+void stream_pacer_on_dropped(stream_pacer_t *pacer, int64_t now_us) {
+  pacer->frames_dropped++;
+  advance_deadline(pacer, now_us);
+}
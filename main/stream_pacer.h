@@ -0,0 +1,84 @@
+#ifndef STREAM_PACER_H
+#define STREAM_PACER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Per-client frame pacing for the MJPEG stream
+ *
+ * Deadline-based pacing: every frame is due one interval after the previous
+ * deadline, so the time spent waiting for and sending a frame is subtracted
+ * from the next sleep instead of being added on top of it. A client that
+ * falls more than one interval behind is rescheduled from "now" rather than
+ * bursting to catch up. Frames the client cannot take (socket backed up)
+ * are counted as dropped, never queued.
+ *
+ * Plain C with caller-supplied timestamps, so it has no FreeRTOS dependency.
+ */
+
+#define STREAM_PACER_MIN_FPS 1
+#define STREAM_PACER_MAX_FPS 30
+
+typedef struct {
+  int target_fps;
+  int64_t interval_us; // Target frame interval
+  int64_t next_due_us; // Deadline of the next frame
+
+  // Statistics
+  uint32_t frames_sent;
+  uint32_t frames_dropped;
+  int64_t latency_us;       // Smoothed capture-to-sent latency
+  int64_t send_us;          // Smoothed socket write time
+  float achieved_fps;       // Frames sent per second over the last window
+  uint32_t throughput_kbps; // Bytes over socket write time, last window
+  uint32_t frame_bytes;     // Mean frame size over the last window
+  uint32_t windows;         // Completed measurement windows
+  int64_t window_start_us;  // Start of the current fps measurement window
+  uint32_t window_frames;   // Frames sent in the current window
+  uint64_t window_bytes;    // Bytes sent in the current window
+  int64_t window_send_us;   // Time spent in socket writes in the window
+} stream_pacer_t;
+
+/**
+ * @brief Initialize a pacer
+ *
+ * @param pacer Pacer state
+ * @param target_fps Target frame rate, clamped to [MIN_FPS, MAX_FPS]
+ * @param now_us Current time in microseconds
+ */
+void stream_pacer_init(stream_pacer_t *pacer, int target_fps, int64_t now_us);
+
+/**
+ * @brief Time to wait before the next frame is due
+ *
+ * @return Microseconds until the deadline, 0 if the frame is already due
+ */
+int64_t stream_pacer_wait_us(const stream_pacer_t *pacer, int64_t now_us);
+
+/**
+ * @brief Record a frame that was written to the socket
+ *
+ * Writes only block once the socket's send buffer is full, so the bytes
+ * per write time measured over a window approximate the link throughput
+ * when the link is the bottleneck and overestimate it otherwise.
+ *
+ * @param len Frame length in bytes
+ * @param capture_us Capture timestamp of the frame
+ * @param send_start_us Time the socket write started
+ * @param send_end_us Time the socket write completed
+ */
+void stream_pacer_on_sent(stream_pacer_t *pacer, size_t len,
+                          int64_t capture_us, int64_t send_start_us,
+                          int64_t send_end_us);
+
+/**
+ * @brief Record a frame that was skipped because the client was backed up
+ *
+ * The deadline is pushed back by one interval so the next attempt happens
+ * after the socket had time to drain.
+ */
+void stream_pacer_on_dropped(stream_pacer_t *pacer, int64_t now_us);
+
+#endif // STREAM_PACER_H
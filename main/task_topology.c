@@ -0,0 +1,190 @@
+#include "task_topology.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "httpd_async.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+static const char *TAG = "Tasks";
+
+#define CORE_NET 0    // WiFi, lwIP, httpd, camera
+#define CORE_SENSOR 1 // Sensor sampling
+
+// Periods later than nominal by more than this share count as late
+#define LATE_PCT 10
+
+static const task_config_t s_config[TASK_COUNT] = {
+    [TASK_MQ137] = {"mq137_task", CORE_SENSOR, 6, 3072, 500},
+    [TASK_SHT30] = {"sht30_task", CORE_SENSOR, 6, 3072, 500},
+    [TASK_MOTION] = {"motion", CORE_SENSOR, 2, 4096, 0},
+    [TASK_FRAME_CAPTURE] = {"frame_capture", CORE_NET, 5, 3072, 0},
+    [TASK_CLIP_REC] = {"clip_rec", CORE_NET, 3, 4096, 0},
+    [TASK_EVENT_PUSH] = {"event_push", CORE_NET, 4, 4096, 0},
+    [TASK_HTTPD_ASYNC] = {"httpd_async", CORE_NET, 5, 4096, 0},
+    [TASK_HTTPD] = {"httpd", CORE_NET, 5, 4096, 0},
+    [TASK_POWER] = {"power", CORE_NET, 1, 2560, 1000},
+    [TASK_TELEMETRY] = {"telemetry", CORE_NET, 3, 3072, 0},
+    [TASK_MQTT] = {"mqtt_task", CORE_NET, 5, 6144, 0},
+    [TASK_ALARM] = {"alarm", CORE_NET, 3, 3072, 0},
+};
+
+typedef struct {
+  uint32_t period_us; // Nominal
+  int64_t last_us;    // Previous wake-up, 0 = none
+  uint32_t samples;
+  uint32_t last_period_us;
+  uint32_t min_period_us;
+  uint32_t max_period_us;
+  uint32_t max_jitter_us; // Largest |period - nominal|
+  uint64_t sum_jitter_us;
+  uint32_t late;
+} task_jitter_t;
+
+static task_jitter_t s_jitter[TASK_COUNT];
+static portMUX_TYPE s_jitter_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Tasks created through the table, for the stack high-water marks
+#define MAX_INSTANCES (TASK_COUNT + HTTPD_ASYNC_WORKERS)
+static struct {
+  task_id_t id;
+  TaskHandle_t handle;
+} s_instances[MAX_INSTANCES];
+static int s_instance_count = 0;
+
+const task_config_t *task_topology_config(task_id_t id) {
+  return &s_config[id];
+}
+
+esp_err_t task_topology_create(task_id_t id, TaskFunction_t fn, void *arg,
+                               TaskHandle_t *handle) {
+  const task_config_t *cfg = &s_config[id];
+  TaskHandle_t task;
+  if (xTaskCreatePinnedToCore(fn, cfg->name, cfg->stack, arg, cfg->priority,
+                              &task, cfg->core) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to create %s", cfg->name);
+    return ESP_ERR_NO_MEM;
+  }
+
+  portENTER_CRITICAL(&s_jitter_lock);
+  if (s_instance_count < MAX_INSTANCES) {
+    s_instances[s_instance_count].id = id;
+    s_instances[s_instance_count].handle = task;
+    s_instance_count++;
+  }
+  if (s_jitter[id].period_us == 0) {
+    s_jitter[id].period_us = cfg->period_ms * 1000;
+  }
+  portEXIT_CRITICAL(&s_jitter_lock);
+
+  if (handle != NULL) {
+    *handle = task;
+  }
+  return ESP_OK;
+}
+
+void task_topology_set_period(task_id_t id, uint32_t period_ms) {
+  portENTER_CRITICAL(&s_jitter_lock);
+  s_jitter[id] = (task_jitter_t){.period_us = period_ms * 1000};
+  portEXIT_CRITICAL(&s_jitter_lock);
+}
+
+void task_topology_reset_period(task_id_t id) {
+  portENTER_CRITICAL(&s_jitter_lock);
+  s_jitter[id].last_us = 0;
+  portEXIT_CRITICAL(&s_jitter_lock);
+}
+
+void task_topology_tick(task_id_t id) {
+  int64_t now = esp_timer_get_time();
+  task_jitter_t *j = &s_jitter[id];
+
+  portENTER_CRITICAL(&s_jitter_lock);
+  if (j->last_us != 0) {
+    uint32_t period = (uint32_t)(now - j->last_us);
+    uint32_t jitter = period > j->period_us ? period - j->period_us
+                                            : j->period_us - period;
+    if (j->samples == 0 || period < j->min_period_us) {
+      j->min_period_us = period;
+    }
+    if (period > j->max_period_us) {
+      j->max_period_us = period;
+    }
+    if (jitter > j->max_jitter_us) {
+      j->max_jitter_us = jitter;
+    }
+    if ((uint64_t)period * 100 > (uint64_t)j->period_us * (100 + LATE_PCT)) {
+      j->late++;
+    }
+    j->sum_jitter_us += jitter;
+    j->last_period_us = period;
+    j->samples++;
+  }
+  j->last_us = now;
+  portEXIT_CRITICAL(&s_jitter_lock);
+}
+
+esp_err_t task_topology_handler(httpd_req_t *req) {
+  task_jitter_t jitter[TASK_COUNT];
+  UBaseType_t high_water[MAX_INSTANCES];
+  task_id_t ids[MAX_INSTANCES];
+
+  portENTER_CRITICAL(&s_jitter_lock);
+  for (int i = 0; i < TASK_COUNT; i++) {
+    jitter[i] = s_jitter[i];
+  }
+  int instances = s_instance_count;
+  for (int i = 0; i < instances; i++) {
+    ids[i] = s_instances[i].id;
+  }
+  portEXIT_CRITICAL(&s_jitter_lock);
+  // Handles never change once registered; read the marks outside the lock
+  for (int i = 0; i < instances; i++) {
+    high_water[i] = uxTaskGetStackHighWaterMark(s_instances[i].handle);
+  }
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+  char buf[512];
+  esp_err_t res = httpd_resp_send_chunk(req, "{\"tasks\":[", 10);
+  for (int id = 0; id < TASK_COUNT && res == ESP_OK; id++) {
+    const task_config_t *cfg = &s_config[id];
+    const task_jitter_t *j = &jitter[id];
+    int len = snprintf(buf, sizeof(buf),
+                       "%s{\"name\":\"%s\",\"core\":%d,\"priority\":%u,"
+                       "\"stack\":%lu,\"stack_free_min\":[",
+                       id == 0 ? "" : ",", cfg->name,
+                       cfg->core == tskNO_AFFINITY ? -1 : (int)cfg->core,
+                       (unsigned)cfg->priority, (unsigned long)cfg->stack);
+    bool first = true;
+    for (int i = 0; i < instances; i++) {
+      if (ids[i] == (task_id_t)id) {
+        len += snprintf(buf + len, sizeof(buf) - len, "%s%u",
+                        first ? "" : ",", (unsigned)high_water[i]);
+        first = false;
+      }
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "]");
+    if (j->period_us > 0) {
+      len += snprintf(
+          buf + len, sizeof(buf) - len,
+          ",\"period_ms\":%lu,\"samples\":%lu,\"last_us\":%lu,"
+          "\"min_us\":%lu,\"max_us\":%lu,\"jitter_mean_us\":%lu,"
+          "\"jitter_max_us\":%lu,\"late\":%lu",
+          (unsigned long)(j->period_us / 1000), (unsigned long)j->samples,
+          (unsigned long)j->last_period_us, (unsigned long)j->min_period_us,
+          (unsigned long)j->max_period_us,
+          (unsigned long)(j->samples > 0 ? j->sum_jitter_us / j->samples : 0),
+          (unsigned long)j->max_jitter_us, (unsigned long)j->late);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "}");
+    res = httpd_resp_send_chunk(req, buf, len);
+  }
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, "]}", 2);
+  }
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
@@ -0,0 +1,90 @@
+#ifndef TASK_TOPOLOGY_H
+#define TASK_TOPOLOGY_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdint.h>
+
+/**
+ * @brief Central table of the firmware's tasks: core, priority, stack
+ *
+ * Core 0 carries everything network- and camera-bound: WiFi and lwIP
+ * (pinned there by sdkconfig.defaults), httpd and its async workers, event
+ * push, frame capture and the clip recorder. Core 1 is kept for sensor
+ * sampling, with motion analysis below it as the only other load, so a
+ * burst of stream traffic or a flash write can't delay a sample.
+ *
+ * Periodic tasks call task_topology_tick() once per wake-up; the measured
+ * periods and their deviation from the nominal period are served at
+ * /api/tasks together with each task's configuration and stack high-water
+ * mark.
+ */
+
+typedef enum {
+  TASK_MQ137 = 0,
+  TASK_SHT30,
+  TASK_MOTION,
+  TASK_FRAME_CAPTURE,
+  TASK_CLIP_REC,
+  TASK_EVENT_PUSH,
+  TASK_HTTPD_ASYNC,
+  TASK_HTTPD, // Created by esp_http_server from its config
+  TASK_POWER,
+  TASK_TELEMETRY,
+  TASK_MQTT, // Created by esp-mqtt; core set in sdkconfig.defaults
+  TASK_ALARM,
+  TASK_COUNT
+} task_id_t;
+
+typedef struct {
+  const char *name;
+  BaseType_t core; // 0, 1 or tskNO_AFFINITY
+  UBaseType_t priority;
+  uint32_t stack;     // Bytes
+  uint32_t period_ms; // Nominal period of a periodic task, 0 = event driven
+} task_config_t;
+
+/**
+ * @brief Configuration of a task
+ */
+const task_config_t *task_topology_config(task_id_t id);
+
+/**
+ * @brief Create a task as configured in the table
+ *
+ * May be called several times for the same id (worker pools).
+ *
+ * @param id Task
+ * @param fn Task function
+ * @param arg Task argument
+ * @param handle Output, may be NULL
+ * @return ESP_OK on success, ESP_ERR_NO_MEM otherwise
+ */
+esp_err_t task_topology_create(task_id_t id, TaskFunction_t fn, void *arg,
+                               TaskHandle_t *handle);
+
+/**
+ * @brief Override the nominal period, for tasks that pick it at runtime
+ */
+void task_topology_set_period(task_id_t id, uint32_t period_ms);
+
+/**
+ * @brief Record a wake-up of a periodic task
+ *
+ * Call at the same point of every iteration, right after the wait.
+ */
+void task_topology_tick(task_id_t id);
+
+/**
+ * @brief Restart period measurement, e.g. after the task paused on purpose
+ */
+void task_topology_reset_period(task_id_t id);
+
+/**
+ * @brief URI handler for GET /api/tasks
+ */
+esp_err_t task_topology_handler(httpd_req_t *req);
+
+#endif // TASK_TOPOLOGY_H
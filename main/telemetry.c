@@ -0,0 +1,311 @@
+#include "telemetry.h"
+#include "cbor_lite.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "mqtt_client.h"
+#include "task_topology.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "Telemetry";
+
+// Worst case per sample: channel (1) + dt (5) + value (5)
+#define SAMPLE_MAX_BYTES 11
+// Map with "dev", "seq", "t" and the sample array header
+#define HEADER_MAX_BYTES 64
+
+typedef struct {
+  uint32_t t_ms; // Low 32 bits of ms since boot
+  int32_t value; // Scaled, see s_scale
+  uint8_t channel;
+} sample_t;
+
+// Channel unit to transmitted integer
+static const float s_scale[TELEMETRY_CHANNELS] = {
+    [TELEMETRY_AMMONIA_MV] = 1.0f,
+    [TELEMETRY_TEMPERATURE] = 100.0f,
+    [TELEMETRY_HUMIDITY] = 100.0f,
+};
+
+static telemetry_config_t s_config;
+static esp_mqtt_client_handle_t s_client = NULL;
+static TaskHandle_t s_task = NULL;
+
+// Ring of pending samples and the statistics, guarded by s_lock
+static sample_t *s_ring = NULL;
+static uint16_t s_head = 0;
+static uint16_t s_count = 0;
+static telemetry_stats_t s_stats;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Publisher task only
+static sample_t *s_batch = NULL;
+static uint8_t *s_payload = NULL;
+static size_t s_payload_cap = 0;
+static uint32_t s_seq = 0;
+static char s_device[13];
+static char s_topic[64];
+
+void telemetry_record(telemetry_channel_t channel, float value) {
+  if (s_ring == NULL) {
+    return;
+  }
+  sample_t sample = {
+      .t_ms = (uint32_t)(esp_timer_get_time() / 1000),
+      .value = (int32_t)lroundf(value * s_scale[channel]),
+      .channel = (uint8_t)channel,
+  };
+
+  portENTER_CRITICAL(&s_lock);
+  uint16_t cap = s_config.queue_samples;
+  if (s_count == cap) {
+    s_head = (s_head + 1) % cap;
+    s_count--;
+    s_stats.dropped++;
+  }
+  s_ring[(s_head + s_count) % cap] = sample;
+  s_count++;
+  s_stats.recorded++;
+  bool flush = s_count == s_config.flush_samples;
+  portEXIT_CRITICAL(&s_lock);
+
+  if (flush) {
+    xTaskNotifyGive(s_task);
+  }
+}
+
+static size_t encode_batch(const sample_t *batch, int n) {
+  // Samples keep 32-bit ms; anchor the batch on the full 64-bit clock
+  uint64_t now_ms = esp_timer_get_time() / 1000;
+  uint64_t t0_ms = now_ms - (uint32_t)((uint32_t)now_ms - batch[0].t_ms);
+
+  cbor_writer_t w;
+  cbor_init(&w, s_payload, s_payload_cap);
+  cbor_map(&w, 4);
+  cbor_text(&w, "dev");
+  cbor_text(&w, s_device);
+  cbor_text(&w, "seq");
+  cbor_uint(&w, s_seq);
+  cbor_text(&w, "t");
+  cbor_uint(&w, t0_ms);
+  cbor_text(&w, "s");
+  cbor_array(&w, 3 * n);
+  uint32_t prev_ms = batch[0].t_ms;
+  for (int i = 0; i < n; i++) {
+    cbor_uint(&w, batch[i].channel);
+    cbor_uint(&w, batch[i].t_ms - prev_ms);
+    cbor_int(&w, batch[i].value);
+    prev_ms = batch[i].t_ms;
+  }
+  return w.overflow ? 0 : w.len;
+}
+
+// Publish the oldest queued samples as one message. Returns true if a full
+// batch went out and more may be waiting.
+static bool publish_batch(void) {
+  portENTER_CRITICAL(&s_lock);
+  uint16_t cap = s_config.queue_samples;
+  int n = s_count < s_config.flush_samples ? s_count : s_config.flush_samples;
+  for (int i = 0; i < n; i++) {
+    s_batch[i] = s_ring[(s_head + i) % cap];
+  }
+  uint32_t dropped = s_stats.dropped;
+  portEXIT_CRITICAL(&s_lock);
+  if (n == 0) {
+    return false;
+  }
+
+  size_t len = encode_batch(s_batch, n);
+  if (len == 0) {
+    ESP_LOGE(TAG, "Batch does not fit the payload buffer");
+    return false;
+  }
+  // Queued in the client's outbox until the broker acknowledges it
+  int msg_id = esp_mqtt_client_publish(s_client, s_topic,
+                                       (const char *)s_payload, len, 1, 0);
+
+  portENTER_CRITICAL(&s_lock);
+  if (msg_id < 0) {
+    s_stats.rejected++;
+  } else {
+    // Samples dropped meanwhile came off the head of this batch
+    int remove = n - (int)(s_stats.dropped - dropped);
+    if (remove > 0) {
+      s_head = (s_head + remove) % cap;
+      s_count -= remove;
+    }
+    s_stats.batches++;
+    s_stats.last_size = len;
+  }
+  portEXIT_CRITICAL(&s_lock);
+
+  if (msg_id < 0) {
+    ESP_LOGW(TAG, "Publish refused (%d), keeping %d samples", msg_id, n);
+    return false;
+  }
+  s_seq++;
+  return n == s_config.flush_samples;
+}
+
+static void publisher_task(void *arg) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(s_config.flush_interval_ms));
+
+    portENTER_CRITICAL(&s_lock);
+    bool connected = s_stats.connected;
+    portEXIT_CRITICAL(&s_lock);
+    if (!connected) {
+      continue; // Samples wait in the ring
+    }
+    while (publish_batch()) {
+    }
+  }
+}
+
+static void mqtt_event_handler(void *arg, esp_event_base_t base,
+                               int32_t event_id, void *event_data) {
+  switch ((esp_mqtt_event_id_t)event_id) {
+  case MQTT_EVENT_CONNECTED:
+    ESP_LOGI(TAG, "Connected to %s", s_config.broker_uri);
+    portENTER_CRITICAL(&s_lock);
+    s_stats.connected = true;
+    portEXIT_CRITICAL(&s_lock);
+    xTaskNotifyGive(s_task); // Flush what queued up while offline
+    break;
+  case MQTT_EVENT_DISCONNECTED:
+    ESP_LOGW(TAG, "Disconnected from broker");
+    portENTER_CRITICAL(&s_lock);
+    s_stats.connected = false;
+    portEXIT_CRITICAL(&s_lock);
+    break;
+  case MQTT_EVENT_PUBLISHED:
+    portENTER_CRITICAL(&s_lock);
+    s_stats.acked++;
+    portEXIT_CRITICAL(&s_lock);
+    break;
+  default:
+    break;
+  }
+}
+
+esp_err_t telemetry_init(const telemetry_config_t *config) {
+  if (config->broker_uri == NULL || config->broker_uri[0] == '\0') {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (config->flush_samples == 0 ||
+      config->flush_samples > config->queue_samples) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  s_config = *config;
+
+  uint8_t mac[6];
+  esp_read_mac(mac, ESP_MAC_WIFI_STA);
+  snprintf(s_device, sizeof(s_device), "%02x%02x%02x%02x%02x%02x", mac[0],
+           mac[1], mac[2], mac[3], mac[4], mac[5]);
+  snprintf(s_topic, sizeof(s_topic), "%s/%s/telemetry", config->topic_prefix,
+           s_device);
+
+  s_payload_cap = HEADER_MAX_BYTES + SAMPLE_MAX_BYTES * config->flush_samples;
+  s_payload = malloc(s_payload_cap);
+  s_batch = malloc(config->flush_samples * sizeof(sample_t));
+  sample_t *ring = malloc(config->queue_samples * sizeof(sample_t));
+  if (s_payload == NULL || s_batch == NULL || ring == NULL) {
+    free(s_payload);
+    free(s_batch);
+    free(ring);
+    s_payload = NULL;
+    s_batch = NULL;
+    return ESP_ERR_NO_MEM;
+  }
+
+  char client_id[24];
+  snprintf(client_id, sizeof(client_id), "smartcoop-%s", s_device);
+  const task_config_t *mqtt_task = task_topology_config(TASK_MQTT);
+  esp_mqtt_client_config_t mqtt_config = {
+      .broker.address.uri = config->broker_uri,
+      .credentials.client_id = client_id,
+      .task.priority = mqtt_task->priority,
+      .task.stack_size = mqtt_task->stack,
+      .outbox.limit = config->outbox_limit,
+  };
+  s_client = esp_mqtt_client_init(&mqtt_config);
+  if (s_client == NULL) {
+    free(ring);
+    return ESP_FAIL;
+  }
+  esp_mqtt_client_register_event(s_client, MQTT_EVENT_ANY, mqtt_event_handler,
+                                 NULL);
+
+  esp_err_t err =
+      task_topology_create(TASK_TELEMETRY, publisher_task, NULL, &s_task);
+  if (err != ESP_OK) {
+    free(ring);
+    return err;
+  }
+  // Publish the ring last: telemetry_record() is live from here on
+  portENTER_CRITICAL(&s_lock);
+  s_ring = ring;
+  portEXIT_CRITICAL(&s_lock);
+
+  err = esp_mqtt_client_start(s_client);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "MQTT client start failed: %s", esp_err_to_name(err));
+    return err;
+  }
+  ESP_LOGI(TAG, "Publishing to %s every %lu ms or %u samples", s_topic,
+           (unsigned long)config->flush_interval_ms, config->flush_samples);
+  return ESP_OK;
+}
+
+esp_err_t telemetry_publish_event(const char *name, const char *payload,
+                                  size_t len) {
+  if (s_ring == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  char topic[80];
+  snprintf(topic, sizeof(topic), "%s/%s/%s", s_config.topic_prefix, s_device,
+           name);
+  // The outbox keeps it while the broker is unreachable, unlike the ring
+  // which only holds samples
+  int msg_id = esp_mqtt_client_enqueue(s_client, topic, payload, len, 1, 0,
+                                       true);
+  if (msg_id < 0) {
+    ESP_LOGW(TAG, "Event %s not queued (%d)", name, msg_id);
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+void telemetry_get_stats(telemetry_stats_t *out) {
+  portENTER_CRITICAL(&s_lock);
+  *out = s_stats;
+  out->queued = s_count;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t telemetry_handler(httpd_req_t *req) {
+  telemetry_stats_t st;
+  telemetry_get_stats(&st);
+
+  char response[256];
+  snprintf(response, sizeof(response),
+           "{\"enabled\":%s,\"connected\":%s,\"topic\":\"%s\","
+           "\"queued\":%lu,\"recorded\":%lu,\"dropped\":%lu,"
+           "\"batches\":%lu,\"acked\":%lu,\"rejected\":%lu,"
+           "\"last_size\":%lu}",
+           s_client != NULL ? "true" : "false",
+           st.connected ? "true" : "false", s_topic,
+           (unsigned long)st.queued, (unsigned long)st.recorded,
+           (unsigned long)st.dropped, (unsigned long)st.batches,
+           (unsigned long)st.acked, (unsigned long)st.rejected,
+           (unsigned long)st.last_size);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_send(req, response, strlen(response));
+}
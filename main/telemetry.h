@@ -0,0 +1,107 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Batched sensor telemetry over MQTT
+ *
+ * The sensor tasks hand every published sample to telemetry_record(), which
+ * only appends it to a bounded ring (the oldest sample is dropped when it
+ * is full). A publisher task flushes the ring every flush_interval_ms, or
+ * as soon as flush_samples are queued, as one CBOR message with QoS 1 on
+ * <topic_prefix>/<device id>/telemetry:
+ *
+ *   {"dev": "<sta mac>", "seq": <batch>, "t": <ms since boot of the
+ *    first sample>, "s": [ch, dt_ms, value, ch, dt_ms, value, ...]}
+ *
+ * dt_ms is relative to the previous sample (the first to "t") and values
+ * are scaled integers (see telemetry_channel_t), so a typical sample
+ * takes 4-6 bytes. Nothing is published while the broker is unreachable;
+ * samples wait in the ring, and unacknowledged QoS 1 messages are bounded
+ * by outbox_limit.
+ */
+
+typedef enum {
+  TELEMETRY_AMMONIA_MV = 0, // MQ-137 voltage, mV
+  TELEMETRY_TEMPERATURE,    // SHT30, 0.01 degC
+  TELEMETRY_HUMIDITY,       // SHT30, 0.01 %RH
+  TELEMETRY_CHANNELS
+} telemetry_channel_t;
+
+typedef struct {
+  const char *broker_uri; // e.g. "mqtt://192.168.1.10:1883"
+  const char *topic_prefix;
+  uint32_t flush_interval_ms;
+  uint16_t flush_samples; // Flush early at this many queued samples
+  uint16_t queue_samples; // Ring capacity
+  uint32_t outbox_limit;  // Bytes of unacknowledged messages
+} telemetry_config_t;
+
+#define TELEMETRY_DEFAULT_CONFIG()                                            \
+  {                                                                           \
+      .broker_uri = NULL,                                                     \
+      .topic_prefix = "smartcoop",                                            \
+      .flush_interval_ms = 10000,                                             \
+      .flush_samples = 64,                                                    \
+      .queue_samples = 512,                                                   \
+      .outbox_limit = 16 * 1024,                                              \
+  }
+
+typedef struct {
+  uint32_t queued;    // Samples waiting in the ring
+  uint32_t recorded;  // Samples handed to telemetry_record()
+  uint32_t dropped;   // Samples lost to a full ring
+  uint32_t batches;   // Messages handed to the MQTT client
+  uint32_t acked;     // Messages acknowledged by the broker
+  uint32_t rejected;  // Publishes refused (outbox full)
+  uint32_t last_size; // Bytes of the last message
+  bool connected;
+} telemetry_stats_t;
+
+/**
+ * @brief Start the MQTT client and the publisher task
+ *
+ * @param config Publisher configuration; strings must stay valid
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG without a broker URI
+ */
+esp_err_t telemetry_init(const telemetry_config_t *config);
+
+/**
+ * @brief Queue a sample, timestamped now
+ *
+ * Non-blocking; safe to call before telemetry_init() (does nothing).
+ *
+ * @param channel Sensor channel
+ * @param value Value in the channel's unit
+ */
+void telemetry_record(telemetry_channel_t channel, float value);
+
+/**
+ * @brief Publish a one-off message on <prefix>/<device>/<name>
+ *
+ * QoS 1, queued in the client outbox when the broker is unreachable.
+ *
+ * @param name Topic suffix, e.g. "alarm"
+ * @param payload Message body
+ * @param len Body length in bytes
+ * @return ESP_OK if queued, ESP_ERR_INVALID_STATE before telemetry_init()
+ */
+esp_err_t telemetry_publish_event(const char *name, const char *payload,
+                                  size_t len);
+
+/**
+ * @brief Copy the publisher statistics
+ */
+void telemetry_get_stats(telemetry_stats_t *out);
+
+/**
+ * @brief URI handler for GET /api/telemetry (publisher statistics)
+ */
+esp_err_t telemetry_handler(httpd_req_t *req);
+
+#endif // TELEMETRY_H
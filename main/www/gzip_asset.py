@@ -0,0 +1,31 @@
+#!/usr/bin/env python3
+"""Compress a web UI asset for embedding in the firmware.
+
+Leading indentation and blank lines are stripped before compressing with
+gzip -9. The gzip header carries no timestamp or file name, so identical
+input always produces identical output (and the same ETag on the device).
+
+Usage: gzip_asset.py <input> <output.gz>
+"""
+import gzip
+import sys
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    src, dst = sys.argv[1], sys.argv[2]
+
+    with open(src, encoding="utf-8") as f:
+        lines = (line.strip() for line in f)
+        data = "\n".join(line for line in lines if line).encode("utf-8")
+
+    compressed = gzip.compress(data, compresslevel=9, mtime=0)
+    with open(dst, "wb") as f:
+        f.write(compressed)
+
+    print(f"{src}: {len(data)} -> {len(compressed)} bytes gzipped")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+"""Compare dashboard polling with the SSE event push on the device.
+
+Runs two phases with the same number of dashboard clients:
+
+  poll  every client GETs /api/sensors once per --interval, the way the
+        dashboard does without EventSource (keep-alive connection, or a
+        new one per request with --no-keepalive);
+  sse   every client holds one /api/events connection.
+
+/api/metrics is scraped before and after each phase. Per phase the script
+prints the HTTP requests and sockets the server handled
+(http_requests_total, http_sockets_opened_total), the CPU time of the
+server and push tasks (task_cpu_seconds_total, needs
+CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) and the sensor updates each
+client received.
+
+    python3 tools/push_vs_poll.py 192.168.1.100
+    python3 tools/push_vs_poll.py 192.168.1.100 --clients 4 --seconds 120
+
+Standard library only. Exit status 0 if both phases ran without client
+errors.
+"""
+
+import argparse
+import http.client
+import os
+import re
+import socket
+import sys
+import threading
+import time
+
+# Tasks that serve the dashboard: the server task answers the polls, the
+# push task formats and sends the events
+SERVER_TASKS = ("httpd", "event_push")
+
+
+def default_max_clients():
+    header = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          "..", "main", "event_push.h")
+    try:
+        with open(header) as f:
+            m = re.search(r"#define\s+EVENT_PUSH_MAX_CLIENTS\s+(\d+)",
+                          f.read())
+            if m:
+                return int(m.group(1))
+    except OSError:
+        pass
+    return 4
+
+
+METRIC_RE = re.compile(r"^smartcoop_(\w+)(?:\{([^}]*)\})?\s+(\S+)$")
+
+
+def scrape(host, port):
+    """Counters and per-task CPU seconds (summed over tasks of one name)."""
+    conn = http.client.HTTPConnection(host, port, timeout=10)
+    try:
+        conn.request("GET", "/api/metrics")
+        resp = conn.getresponse()
+        text = resp.read().decode()
+        if resp.status != 200:
+            raise RuntimeError("/api/metrics returned %d" % resp.status)
+    finally:
+        conn.close()
+
+    counters = {}
+    cpu = {}
+    for line in text.splitlines():
+        m = METRIC_RE.match(line)
+        if not m:
+            continue
+        name, labels, value = m.group(1), m.group(2) or "", float(m.group(3))
+        if name == "task_cpu_seconds_total":
+            task = re.search(r'task="([^"]*)"', labels).group(1)
+            cpu[task] = cpu.get(task, 0.0) + value
+        elif not labels:
+            counters[name] = value
+    return counters, cpu
+
+
+def cpu_delta(before, after):
+    """Seconds per task between two scrapes; the counters wrap at 2^32 us."""
+    wrap = 2 ** 32 / 1e6
+    return {task: (after[task] - before.get(task, 0.0)) % wrap
+            for task in after}
+
+
+class Poller(threading.Thread):
+    def __init__(self, host, port, interval, keepalive):
+        super().__init__(daemon=True)
+        self.host, self.port = host, port
+        self.interval = interval
+        self.keepalive = keepalive
+        self.updates = 0
+        self.errors = 0
+        self.stopped = False
+
+    def run(self):
+        conn = None
+        next_at = time.monotonic()
+        while not self.stopped:
+            try:
+                if conn is None:
+                    conn = http.client.HTTPConnection(self.host, self.port,
+                                                      timeout=5)
+                conn.request("GET", "/api/sensors")
+                resp = conn.getresponse()
+                resp.read()
+                if resp.status == 200:
+                    self.updates += 1
+                else:
+                    self.errors += 1
+                if not self.keepalive or resp.will_close:
+                    conn.close()
+                    conn = None
+            except (OSError, http.client.HTTPException):
+                self.errors += 1
+                if conn is not None:
+                    conn.close()
+                conn = None
+            next_at += self.interval
+            time.sleep(max(0, next_at - time.monotonic()))
+        if conn is not None:
+            conn.close()
+
+    def close(self):
+        self.stopped = True
+
+
+class Listener(threading.Thread):
+    def __init__(self, host, port):
+        super().__init__(daemon=True)
+        self.sock = socket.create_connection((host, port), timeout=10)
+        self.sock.sendall(("GET /api/events HTTP/1.1\r\nHost: %s\r\n"
+                           "Accept: text/event-stream\r\n\r\n"
+                           % host).encode())
+        self.updates = 0
+        self.errors = 0
+        self.stopped = False
+
+    def run(self):
+        tail = b""
+        try:
+            while not self.stopped:
+                chunk = self.sock.recv(4096)
+                if not chunk:
+                    self.errors += 1
+                    return
+                data = tail + chunk
+                self.updates += data.count(b"event: sensors")
+                tail = data[-16:]
+                self.updates -= tail.count(b"event: sensors")
+                if b" 503 " in data[:16]:
+                    self.errors += 1
+                    return
+        except OSError:
+            if not self.stopped:
+                self.errors += 1
+
+    def close(self):
+        self.stopped = True
+        try:
+            self.sock.shutdown(socket.SHUT_RDWR)
+        except OSError:
+            pass
+        self.sock.close()
+
+
+def run_phase(args, mode):
+    time.sleep(2)  # Let sockets of the previous phase close
+    counters0, cpu0 = scrape(args.host, args.port)
+    start = time.monotonic()
+    if mode == "poll":
+        clients = [Poller(args.host, args.port, args.interval,
+                          not args.no_keepalive)
+                   for _ in range(args.clients)]
+    else:
+        clients = [Listener(args.host, args.port)
+                   for _ in range(args.clients)]
+    for c in clients:
+        c.start()
+    time.sleep(args.seconds)
+    for c in clients:
+        c.close()
+    for c in clients:
+        c.join(timeout=5)
+    counters1, cpu1 = scrape(args.host, args.port)
+    elapsed = time.monotonic() - start
+
+    # The closing scrape is counted in the second reading
+    requests = counters1.get("http_requests_total", 0) - \
+        counters0.get("http_requests_total", 0) - 1
+    sockets = counters1.get("http_sockets_opened_total", 0) - \
+        counters0.get("http_sockets_opened_total", 0) - 1
+    cpu = cpu_delta(cpu0, cpu1)
+    return {
+        "elapsed": elapsed,
+        "requests": requests,
+        "sockets": sockets,
+        "cpu": {t: cpu.get(t) for t in SERVER_TASKS},
+        "updates": sum(c.updates for c in clients) / len(clients),
+        "errors": sum(c.errors for c in clients),
+        "have_counters": "http_requests_total" in counters1,
+    }
+
+
+def report(mode, r):
+    print("%-5s %6.1f req/s  %4d sockets opened  %5.1f updates/client  "
+          "%d error(s)" % (mode, r["requests"] / r["elapsed"], r["sockets"],
+                           r["updates"], r["errors"]))
+    for task, seconds in r["cpu"].items():
+        if seconds is None:
+            print("      %-10s no CPU counter" % task)
+        else:
+            print("      %-10s %6.3f s CPU (%.2f%% of a core)"
+                  % (task, seconds, 100 * seconds / r["elapsed"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host", help="device IP or name")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--clients", type=int, default=2,
+                        help="dashboard clients per phase")
+    parser.add_argument("--seconds", type=float, default=60,
+                        help="duration of each phase")
+    parser.add_argument("--interval", type=float, default=1.0,
+                        help="poll interval (the dashboard's is 1 s)")
+    parser.add_argument("--no-keepalive", action="store_true",
+                        help="poll with a new connection per request")
+    args = parser.parse_args()
+
+    max_clients = default_max_clients()
+    if args.clients > max_clients:
+        parser.error("the device serves at most %d event clients "
+                     "(EVENT_PUSH_MAX_CLIENTS)" % max_clients)
+
+    results = {}
+    for mode in ("poll", "sse"):
+        results[mode] = run_phase(args, mode)
+        report(mode, results[mode])
+        if not results[mode]["have_counters"]:
+            print("firmware without http_requests_total, update it")
+            return 1
+
+    poll, sse = results["poll"], results["sse"]
+    print("sse vs poll: %d vs %d requests, %d vs %d sockets"
+          % (sse["requests"], poll["requests"], sse["sockets"],
+             poll["sockets"]))
+    poll_cpu = sum(v or 0 for v in poll["cpu"].values())
+    sse_cpu = sum(v or 0 for v in sse["cpu"].values())
+    if poll_cpu > 0:
+        print("             %.3f vs %.3f s CPU in %s (%.0f%%)"
+              % (sse_cpu, poll_cpu, "+".join(SERVER_TASKS),
+                 100 * sse_cpu / poll_cpu))
+    return 1 if poll["errors"] or sse["errors"] else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+"""Check that MJPEG streams do not stall the JSON API.
+
+Opens as many /stream viewers as there are async workers
+(HTTPD_ASYNC_WORKERS in main/httpd_async.h) and, while they run:
+
+  - times GET /api/ammonia and fails if it gets slower than --max-ms
+    (the streams run on the workers, so the server task must stay free);
+  - opens one more stream and expects 503 "Too many streams";
+  - checks that every stream keeps delivering frames.
+
+After the streams are closed, a new stream must be accepted again.
+
+    python3 tools/stream_load.py 192.168.1.100
+    python3 tools/stream_load.py 192.168.1.100 --requests 100 --max-ms 150
+
+Standard library only. Exit status 0 if every check passed.
+"""
+
+import argparse
+import http.client
+import os
+import re
+import socket
+import statistics
+import sys
+import threading
+import time
+
+
+def default_workers():
+    header = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          "..", "main", "httpd_async.h")
+    try:
+        with open(header) as f:
+            m = re.search(r"#define\s+HTTPD_ASYNC_WORKERS\s+(\d+)", f.read())
+            if m:
+                return int(m.group(1))
+    except OSError:
+        pass
+    return 3
+
+
+class Stream(threading.Thread):
+    """One /stream viewer on a raw socket, counting multipart parts."""
+
+    def __init__(self, host, port, fps):
+        super().__init__(daemon=True)
+        self.sock = socket.create_connection((host, port), timeout=10)
+        self.sock.sendall(("GET /stream?fps=%d HTTP/1.1\r\nHost: %s\r\n\r\n"
+                           % (fps, host)).encode())
+        self.status, self.body = self._read_head()
+        self.frames = 0
+        self.bytes = 0
+        self.error = None
+        self.stopped = False
+
+    def _read_head(self):
+        data = b""
+        while b"\r\n\r\n" not in data:
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+        head, _, rest = data.partition(b"\r\n\r\n")
+        status = int(head.split(b" ", 2)[1]) if head.startswith(b"HTTP/") \
+            else 0
+        if status != 200:
+            # Error responses are short; read all of the body
+            m = re.search(rb"(?i)content-length:\s*(\d+)", head)
+            length = int(m.group(1)) if m else 1 << 16
+            while len(rest) < length:
+                chunk = self.sock.recv(4096)
+                if not chunk:
+                    break
+                rest += chunk
+        return status, rest
+
+    def run(self):
+        if self.status != 200:
+            return
+        tail = self.body
+        try:
+            while not self.stopped:
+                chunk = self.sock.recv(16384)
+                if not chunk:
+                    self.error = "closed by device"
+                    return
+                self.bytes += len(chunk)
+                # Count part headers, also when split across reads
+                data = tail + chunk
+                self.frames += data.count(b"Content-Type: image/jpeg")
+                tail = data[-32:]
+                self.frames -= tail.count(b"Content-Type: image/jpeg")
+        except OSError as e:
+            if not self.stopped:
+                self.error = str(e)
+
+    def close(self):
+        self.stopped = True
+        try:
+            self.sock.shutdown(socket.SHUT_RDWR)
+        except OSError:
+            pass
+        self.sock.close()
+
+
+def get(host, port, path, timeout=5):
+    conn = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        conn.request("GET", path)
+        resp = conn.getresponse()
+        return resp.status, resp.read()
+    finally:
+        conn.close()
+
+
+def time_requests(host, port, path, count):
+    times = []
+    for _ in range(count):
+        start = time.monotonic()
+        status, _ = get(host, port, path)
+        times.append((time.monotonic() - start) * 1000)
+        if status != 200:
+            raise RuntimeError("%s returned %d" % (path, status))
+        time.sleep(0.05)
+    return times
+
+
+def summary(times):
+    times = sorted(times)
+    p95 = times[min(len(times) - 1, int(len(times) * 0.95))]
+    return "median %.1f ms, p95 %.1f ms, max %.1f ms" % (
+        statistics.median(times), p95, times[-1])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host", help="device IP or name")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--workers", type=int, default=default_workers(),
+                        help="streams to open (default: HTTPD_ASYNC_WORKERS)")
+    parser.add_argument("--fps", type=int, default=10,
+                        help="frame rate requested per stream")
+    parser.add_argument("--requests", type=int, default=50,
+                        help="/api/ammonia requests per measurement")
+    parser.add_argument("--max-ms", type=float, default=200,
+                        help="fail if one /api/ammonia takes longer")
+    parser.add_argument("--no-camera-on", action="store_true",
+                        help="do not call /api/camera/on first")
+    args = parser.parse_args()
+
+    failures = []
+
+    def check(ok, what):
+        print("%s %s" % ("ok  " if ok else "FAIL", what))
+        if not ok:
+            failures.append(what)
+
+    if not args.no_camera_on:
+        status, _ = get(args.host, args.port, "/api/camera/on", timeout=15)
+        check(status == 200, "camera on")
+
+    idle = time_requests(args.host, args.port, "/api/ammonia", args.requests)
+    print("     /api/ammonia idle:   " + summary(idle))
+
+    streams = []
+    try:
+        for i in range(args.workers):
+            s = Stream(args.host, args.port, args.fps)
+            streams.append(s)
+            check(s.status == 200, "stream %d accepted" % (i + 1))
+            s.start()
+        time.sleep(2)  # Let the pacers settle
+
+        loaded = time_requests(args.host, args.port, "/api/ammonia",
+                               args.requests)
+        print("     /api/ammonia loaded: " + summary(loaded))
+        check(max(loaded) <= args.max_ms,
+              "/api/ammonia max %.1f ms <= %.0f ms with %d streams"
+              % (max(loaded), args.max_ms, args.workers))
+
+        extra = Stream(args.host, args.port, args.fps)
+        extra.close()
+        check(extra.status == 503 and b"Too many" in extra.body,
+              "stream %d rejected with 503 (got %d %r)"
+              % (args.workers + 1, extra.status, extra.body[:32]))
+
+        before = [s.frames for s in streams]
+        time.sleep(3)
+        for i, s in enumerate(streams):
+            check(s.error is None and s.frames > before[i],
+                  "stream %d delivering (%d frames, %d kB%s)"
+                  % (i + 1, s.frames, s.bytes // 1024,
+                     ", " + s.error if s.error else ""))
+    finally:
+        for s in streams:
+            s.close()
+
+    # Workers are released once the device notices the closed sockets
+    deadline = time.monotonic() + 10
+    while True:
+        s = Stream(args.host, args.port, args.fps)
+        s.close()
+        if s.status == 200 or time.monotonic() > deadline:
+            break
+        time.sleep(0.5)
+    check(s.status == 200, "stream accepted again after closing")
+
+    print("%d check(s) failed" % len(failures) if failures else "all passed")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
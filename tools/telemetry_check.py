@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+"""Validate the MQTT telemetry frames published by the device.
+
+Subscribes with mosquitto_sub (or reads "topic hexpayload" lines from
+stdin) and checks every message against the layout encode_batch() in
+main/telemetry.c produces:
+
+  {"dev": <STA MAC, 12 hex digits>, "seq": uint, "t": uint ms since boot,
+   "s": [channel, dt_ms, value, channel, dt_ms, value, ...]}
+
+  - a definite map with exactly these four keys, in this order;
+  - "dev" matches the topic smartcoop/<dev>/telemetry;
+  - "s" is a flat array of triplets, 1..--max-samples samples; channel is
+    0 (NH3 mV), 1 (temperature x100) or 2 (humidity x100); dt_ms is an
+    unsigned delta to the previous sample, 0 for the first; values are
+    integers within the channel's physical range;
+  - every CBOR head uses its shortest form (as cbor_lite.c writes it) and
+    nothing follows the map;
+  - per device, seq counts up by one and sample times never go backwards
+    (a QoS 1 redelivery repeats a seq, a reboot restarts it: both are
+    reported, not failed; a gap means lost batches).
+
+Decoding is done here, so no CBOR package is needed:
+
+    python3 tools/telemetry_check.py --host 192.168.1.10 --count 20
+    mosquitto_sub -t 'smartcoop/+/telemetry' -v -F '%t %x' | \\
+        python3 tools/telemetry_check.py --stdin
+
+Exit status 0 if every message passed.
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+
+CHANNELS = {
+    0: ("nh3_mv", 0, 5000),
+    1: ("temperature_x100", -4000, 12500),  # SHT30: -40..125 degC
+    2: ("humidity_x100", 0, 10000),
+}
+KEYS = ["dev", "seq", "t", "s"]
+TOPIC_RE = re.compile(r"^[^/]+/([^/]+)/telemetry$")
+
+
+class FrameError(Exception):
+    pass
+
+
+class Reader:
+    """Strict decoder for the subset of CBOR the firmware writes."""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def head(self):
+        if self.pos >= len(self.data):
+            raise FrameError("truncated at byte %d" % self.pos)
+        start = self.pos
+        ib = self.data[self.pos]
+        self.pos += 1
+        major, info = ib >> 5, ib & 0x1F
+        if info < 24:
+            return major, info
+        if info > 27:
+            raise FrameError("indefinite or reserved length at byte %d"
+                             % start)
+        n = 1 << (info - 24)
+        if self.pos + n > len(self.data):
+            raise FrameError("truncated at byte %d" % start)
+        arg = int.from_bytes(self.data[self.pos:self.pos + n], "big")
+        self.pos += n
+        shortest = 24 if arg < 256 else 25 if arg < 1 << 16 else \
+            26 if arg < 1 << 32 else 27
+        if arg < 24 or info != shortest:
+            raise FrameError("non-shortest head 0x%02x for %d at byte %d"
+                             % (ib, arg, start))
+        return major, arg
+
+    def uint(self, what):
+        major, arg = self.head()
+        if major != 0:
+            raise FrameError("%s: expected unsigned int, major type %d"
+                             % (what, major))
+        return arg
+
+    def int(self, what):
+        major, arg = self.head()
+        if major == 0:
+            return arg
+        if major == 1:
+            return -1 - arg
+        raise FrameError("%s: expected int, major type %d" % (what, major))
+
+    def text(self, what):
+        major, n = self.head()
+        if major != 3:
+            raise FrameError("%s: expected text, major type %d"
+                             % (what, major))
+        raw = self.data[self.pos:self.pos + n]
+        if len(raw) != n:
+            raise FrameError("%s: truncated text" % what)
+        self.pos += n
+        return raw.decode("utf-8")
+
+    def container(self, major_expected, what):
+        major, n = self.head()
+        if major != major_expected:
+            raise FrameError("%s: expected major type %d, got %d"
+                             % (what, major_expected, major))
+        return n
+
+
+def check_frame(payload, topic_dev, max_samples):
+    """Decode one message; returns (dev, seq, t, samples)."""
+    r = Reader(payload)
+    if r.container(5, "top level") != len(KEYS):
+        raise FrameError("top-level map must have %d pairs" % len(KEYS))
+    fields = {}
+    for key in KEYS:
+        got = r.text("key")
+        if got != key:
+            raise FrameError("key %r where %r was expected" % (got, key))
+        if key == "dev":
+            fields[key] = r.text("dev")
+        elif key == "s":
+            fields[key] = r.container(4, "s")
+        else:
+            fields[key] = r.uint(key)
+
+    dev = fields["dev"]
+    if not re.fullmatch(r"[0-9a-f]{12}", dev):
+        raise FrameError("dev %r is not 12 lowercase hex digits" % dev)
+    if topic_dev is not None and dev != topic_dev:
+        raise FrameError("dev %r does not match topic (%r)"
+                         % (dev, topic_dev))
+
+    items = fields["s"]
+    if items == 0 or items % 3 != 0:
+        raise FrameError("s has %d items, not a positive multiple of 3"
+                         % items)
+    if items // 3 > max_samples:
+        raise FrameError("%d samples, more than %d"
+                         % (items // 3, max_samples))
+    samples = []
+    t = fields["t"]
+    for i in range(items // 3):
+        ch = r.uint("s[%d].channel" % i)
+        dt = r.uint("s[%d].dt_ms" % i)
+        value = r.int("s[%d].value" % i)
+        if ch not in CHANNELS:
+            raise FrameError("s[%d]: unknown channel %d" % (i, ch))
+        if i == 0 and dt != 0:
+            raise FrameError("first sample has dt_ms %d, expected 0" % dt)
+        name, lo, hi = CHANNELS[ch]
+        if not lo <= value <= hi:
+            raise FrameError("s[%d]: %s %d outside %d..%d"
+                             % (i, name, value, lo, hi))
+        t += dt
+        samples.append((ch, t, value))
+    if r.pos != len(payload):
+        raise FrameError("%d trailing bytes" % (len(payload) - r.pos))
+    return dev, fields["seq"], fields["t"], samples
+
+
+def lines_from_mosquitto(args):
+    cmd = ["mosquitto_sub", "-h", args.host, "-p", str(args.port),
+           "-t", args.topic, "-q", "1", "-v", "-F", "%t %x"]
+    if args.count:
+        cmd += ["-C", str(args.count)]
+    try:
+        proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, text=True)
+    except FileNotFoundError:
+        sys.exit("mosquitto_sub not found (mosquitto-clients package)")
+    yield from proc.stdout
+    proc.wait()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--host", default="localhost", help="MQTT broker")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--topic", default="smartcoop/+/telemetry")
+    parser.add_argument("--count", type=int, default=0,
+                        help="stop after this many messages (0 = never)")
+    parser.add_argument("--max-samples", type=int, default=64,
+                        help="flush_samples of the device config")
+    parser.add_argument("--stdin", action="store_true",
+                        help="read 'topic hexpayload' lines from stdin")
+    parser.add_argument("-q", "--quiet", action="store_true",
+                        help="print failures and the summary only")
+    args = parser.parse_args()
+
+    lines = sys.stdin if args.stdin else lines_from_mosquitto(args)
+    last = {}  # dev -> (seq, time of the last sample)
+    passed = failed = 0
+    for line in lines:
+        line = line.strip()
+        if not line:
+            continue
+        topic, _, hexdata = line.rpartition(" ")
+        m = TOPIC_RE.match(topic)
+        try:
+            dev, seq, t, samples = check_frame(
+                bytes.fromhex(hexdata), m.group(1) if m else None,
+                args.max_samples)
+        except (FrameError, ValueError) as e:
+            failed += 1
+            print("FAIL %s: %s" % (topic or "-", e))
+            continue
+
+        note = ""
+        if dev in last:
+            prev_seq, prev_t = last[dev]
+            if seq == prev_seq:
+                note = " (redelivered)"
+            elif seq < prev_seq:
+                note = " (seq restarted: reboot?)"
+            elif seq != prev_seq + 1:
+                note = " (%d batches missing)" % (seq - prev_seq - 1)
+            elif t < prev_t:
+                failed += 1
+                print("FAIL %s: seq %d starts at %d ms, before the last "
+                      "sample of seq %d (%d ms)"
+                      % (topic, seq, t, prev_seq, prev_t))
+                continue
+        last[dev] = (seq, samples[-1][1])
+        passed += 1
+        if not args.quiet or note:
+            counts = [sum(1 for s in samples if s[0] == ch) for ch in CHANNELS]
+            print("ok   %s seq %d t %d ms: %d samples (nh3 %d, temp %d, "
+                  "rh %d), %d bytes%s"
+                  % (dev, seq, t, len(samples), counts[0], counts[1],
+                     counts[2], len(hexdata) // 2, note))
+
+    print("%d passed, %d failed" % (passed, failed))
+    return 1 if failed or passed == 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())